@@ -0,0 +1,60 @@
+from __future__ import print_function
+import itk
+import numpy as np
+import sys
+import os
+from concurrent.futures import ThreadPoolExecutor
+
+# Parse inputs
+if len(sys.argv) < 4:
+  os.sys.exit('Usage: {} <NumberOfThreads> <Sigma1>[,<Sigma2>,...]'.format(sys.argv[0]) +
+    ' <InputFileName> [<InputFileName> ...]')
+
+numberOfThreads = int(sys.argv[1])
+sigmaArray = [float(sigma) for sigma in sys.argv[2].split(',')]
+inputFileNames = sys.argv[3:]
+
+Dimension = 3
+ImageType = itk.Image[itk.F, Dimension]
+EigenImageType = itk.Image[itk.Vector[itk.F, Dimension], Dimension]
+
+def enhance(array, spacing):
+  '''Krcah measure of a NumPy volume. The filter reads a view of array and writes straight into the returned
+  array, so neither is copied. Only an array which is not contiguous float32 is converted first.'''
+  array = np.ascontiguousarray(array, dtype=np.float32)
+  output = np.empty_like(array)
+
+  inputView = itk.image_view_from_array(array)
+  inputView.SetSpacing(spacing)
+  outputView = itk.image_view_from_array(output)
+
+  multiscaleFilter = itk.MultiScaleHessianEnhancementImageFilter[ImageType, ImageType].New()
+  multiscaleFilter.SetInput(inputView)
+  multiscaleFilter.SetEigenToMeasureImageFilter(
+    itk.KrcahEigenToMeasureImageFilter[EigenImageType, ImageType].New())
+  multiscaleFilter.SetEigenToMeasureParameterEstimationFilter(
+    itk.KrcahEigenToMeasureParameterEstimationFilter[EigenImageType, EigenImageType].New())
+  multiscaleFilter.SetSigmaArray(sigmaArray)
+  multiscaleFilter.SetPreallocatedOutput(outputView)
+  multiscaleFilter.Update()
+  return output
+
+# Read every volume as a NumPy view of its image
+print('Reading {} volumes'.format(len(inputFileNames)))
+images = [itk.imread(fileName, itk.F) for fileName in inputFileNames]
+arrays = [itk.array_view_from_image(image) for image in images]
+
+# Each volume gets its own filter. The volumes overlap in time as far as the wrapping releases the interpreter
+# lock during Update( ), the threads of each filter run in parallel either way.
+print('Enhancing with {} threads...'.format(numberOfThreads))
+with ThreadPoolExecutor(max_workers=numberOfThreads) as executor:
+  measures = list(executor.map(lambda pair: enhance(pair[0], pair[1].GetSpacing()), zip(arrays, images)))
+
+# Write the results next to the inputs
+for fileName, image, measure in zip(inputFileNames, images, measures):
+  root, extension = os.path.splitext(fileName)
+  outputFileName = '{}_measure{}'.format(root, extension)
+  print('Writing results to {}'.format(outputFileName))
+  outputImage = itk.image_view_from_array(measure)
+  outputImage.CopyInformation(image)
+  itk.imwrite(outputImage, outputFileName)
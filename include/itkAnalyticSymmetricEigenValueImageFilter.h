@@ -0,0 +1,156 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkAnalyticSymmetricEigenValueImageFilter_h
+#define itkAnalyticSymmetricEigenValueImageFilter_h
+
+#include "itkImageToImageFilter.h"
+#include "itkSymmetricEigenAnalysis.h"
+#include "itkSymmetricSecondRankTensor.h"
+#include <cmath>
+
+namespace itk
+{
+/** \class AnalyticSymmetricEigenValueImageFilter
+ * \brief Compute the eigenvalues of an image of symmetric 2x2 or 3x3 matrices in closed form.
+ *
+ * SymmetricEigenAnalysisImageFilter computes the eigenvalues of every pixel with an iterative
+ * QL decomposition. When only the eigenvalues are needed, the characteristic polynomial of a
+ * 2x2 or 3x3 matrix can be solved directly. In 3D the trigonometric solution of the cubic is
+ * used: with q = trace(A) / 3, p = sqrt(trace((A - qI)^2) / 6) and r = det(A - qI) / (2 p^3),
+ * the eigenvalues are q + 2 p cos(acos(r) / 3 + 2 pi k / 3) for k = 0, 1, 2.
+ *
+ * Each scanline is copied into one array per tensor component, solved as arrays in double
+ * precision and written back. The ordering is done with selects instead of branches, so the
+ * solving loop has no data dependent control flow and can be vectorized where the compiler
+ * provides vector versions of sqrt, acos and cos.
+ *
+ * When two eigenvalues are nearly equal r is close to -1 or 1, where acos is badly
+ * conditioned. Those pixels are flagged during the solve and recomputed afterwards with
+ * SymmetricEigenAnalysis. Images of other dimensions use SymmetricEigenAnalysis for every pixel.
+ *
+ * The eigenvalues are ordered by SetEigenValueOrder( ). Both OrderByValue and OrderByMagnitude
+ * are ascending, as in SymmetricEigenAnalysis. DoNotOrder is treated as OrderByValue.
+ *
+ * \sa SymmetricEigenAnalysisImageFilter
+ * \sa MultiScaleHessianEnhancementImageFilter
+ *
+ * \author: Bryce Besler
+ * \ingroup BoneEnhancement
+ */
+template <typename TInputImage, typename TOutputImage>
+class ITK_TEMPLATE_EXPORT AnalyticSymmetricEigenValueImageFilter : public ImageToImageFilter<TInputImage, TOutputImage>
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(AnalyticSymmetricEigenValueImageFilter);
+
+  /** Standard Self typedef */
+  using Self = AnalyticSymmetricEigenValueImageFilter;
+  using Superclass = ImageToImageFilter<TInputImage, TOutputImage>;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(AnalyticSymmetricEigenValueImageFilter, ImageToImageFilter);
+
+  /** Image related typedefs. */
+  using InputImageType = TInputImage;
+  using InputPixelType = typename InputImageType::PixelType;
+  using OutputImageType = TOutputImage;
+  using OutputPixelType = typename OutputImageType::PixelType;
+  using OutputImageRegionType = typename OutputImageType::RegionType;
+  using OutputValueType = typename OutputPixelType::ValueType;
+  itkStaticConstMacro(ImageDimension, unsigned int, TInputImage::ImageDimension);
+
+  /** Dimension of the matrices and number of independent components of each. */
+  itkStaticConstMacro(MatrixDimension, unsigned int, InputPixelType::Dimension);
+  itkStaticConstMacro(NumberOfComponents, unsigned int, MatrixDimension *(MatrixDimension + 1) / 2);
+
+  /** Robust solver used for degenerate pixels and for other dimensions. */
+  using FallbackMatrixType = SymmetricSecondRankTensor<double, Self::MatrixDimension>;
+  using FallbackVectorType = FixedArray<double, Self::MatrixDimension>;
+  using FallbackCalculatorType = SymmetricEigenAnalysis<FallbackMatrixType, FallbackVectorType>;
+
+  /** Eigenvalue ordering. */
+  using EigenValueOrderEnum = SymmetricEigenAnalysisEnums::EigenValueOrder;
+  itkSetEnumMacro(EigenValueOrder, EigenValueOrderEnum);
+  itkGetEnumMacro(EigenValueOrder, EigenValueOrderEnum);
+
+  /** Same as SetEigenValueOrder( ), named as in SymmetricEigenAnalysisImageFilter. */
+  void
+  OrderEigenValuesBy(EigenValueOrderEnum order)
+  {
+    this->SetEigenValueOrder(order);
+  }
+
+  /** Closeness of |r| to one below which a 3x3 pixel is recomputed with the robust solver. */
+  static constexpr double DegenerateTolerance = 1e-10;
+
+  /** Solve length 3x3 matrices given as six arrays of components in the order a00, a01, a02, a11,
+   * a12, a22. The eigenvalues are written to three arrays and degenerate[ i ] is set to one for
+   * the matrices which need the robust solver. */
+  static void
+  ComputeEigenValues3x3(const double *  components,
+                        double *        eigenValues,
+                        unsigned char * degenerate,
+                        SizeValueType   length,
+                        bool            orderByMagnitude);
+
+  /** Solve length 2x2 matrices given as three arrays of components in the order a00, a01, a11. */
+  static void
+  ComputeEigenValues2x2(const double * components, double * eigenValues, SizeValueType length, bool orderByMagnitude);
+
+#ifdef ITK_USE_CONCEPT_CHECKING
+  // Begin concept checking
+  itkConceptMacro(InputHasNumericTraitsCheck, (Concept::HasNumericTraits<typename InputPixelType::ValueType>));
+  // End concept checking
+#endif
+
+protected:
+  AnalyticSymmetricEigenValueImageFilter();
+  ~AnalyticSymmetricEigenValueImageFilter() override = default;
+
+  void
+  DynamicThreadedGenerateData(const OutputImageRegionType & outputRegionForThread) override;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  /** Swap a and b when enabled and |a| > |b|, with selects instead of a branch. */
+  static inline void
+  CompareSwap(double & a, double & b, bool enabled)
+  {
+    const bool   swap = enabled & (std::abs(a) > std::abs(b));
+    const double lower = swap ? b : a;
+    b = swap ? a : b;
+    a = lower;
+  }
+
+  EigenValueOrderEnum m_EigenValueOrder{ EigenValueOrderEnum::OrderByValue };
+}; // end class
+} // namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkAnalyticSymmetricEigenValueImageFilter.hxx"
+#endif
+
+#endif // itkAnalyticSymmetricEigenValueImageFilter_h
@@ -0,0 +1,228 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkAnalyticSymmetricEigenValueImageFilter_hxx
+#define itkAnalyticSymmetricEigenValueImageFilter_hxx
+
+#include "itkAnalyticSymmetricEigenValueImageFilter.h"
+#include "itkImageScanlineConstIterator.h"
+#include "itkImageScanlineIterator.h"
+#include "itkMath.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace itk
+{
+
+template <typename TInputImage, typename TOutputImage>
+constexpr double AnalyticSymmetricEigenValueImageFilter<TInputImage, TOutputImage>::DegenerateTolerance;
+
+template <typename TInputImage, typename TOutputImage>
+AnalyticSymmetricEigenValueImageFilter<TInputImage, TOutputImage>::AnalyticSymmetricEigenValueImageFilter()
+{
+  this->DynamicMultiThreadingOn();
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+AnalyticSymmetricEigenValueImageFilter<TInputImage, TOutputImage>::ComputeEigenValues3x3(const double *  components,
+                                                                                         double *        eigenValues,
+                                                                                         unsigned char * degenerate,
+                                                                                         SizeValueType   length,
+                                                                                         bool orderByMagnitude)
+{
+  const double * a00 = components;
+  const double * a01 = components + length;
+  const double * a02 = components + 2 * length;
+  const double * a11 = components + 3 * length;
+  const double * a12 = components + 4 * length;
+  const double * a22 = components + 5 * length;
+  double *       lambda1 = eigenValues;
+  double *       lambda2 = eigenValues + length;
+  double *       lambda3 = eigenValues + 2 * length;
+
+  const double twoPiOverThree = 2.0 * Math::pi / 3.0;
+  for (SizeValueType i = 0; i < length; ++i)
+  {
+    /* B = A - qI has the same eigenvectors and eigenvalues shifted by q */
+    const double q = (a00[i] + a11[i] + a22[i]) / 3.0;
+    const double b00 = a00[i] - q;
+    const double b11 = a11[i] - q;
+    const double b22 = a22[i] - q;
+    const double offDiagonal = a01[i] * a01[i] + a02[i] * a02[i] + a12[i] * a12[i];
+    const double p = std::sqrt((b00 * b00 + b11 * b11 + b22 * b22 + 2.0 * offDiagonal) / 6.0);
+
+    /* r = det(B / p) / 2, which is in [-1, 1] up to rounding. A multiple of the identity has p = 0. */
+    const double determinant = b00 * (b11 * b22 - a12[i] * a12[i]) - a01[i] * (a01[i] * b22 - a12[i] * a02[i]) +
+                               a02[i] * (a01[i] * a12[i] - b11 * a02[i]);
+    const double pCubed = p * p * p;
+    const bool   isMultipleOfIdentity = !(pCubed > 0.0);
+    const double r = std::min(std::max(determinant / (isMultipleOfIdentity ? 1.0 : 2.0 * pCubed), -1.0), 1.0);
+    const double phi = std::acos(isMultipleOfIdentity ? 0.0 : r) / 3.0;
+
+    /* Descending by construction, e1 >= e2 >= e3 */
+    const double e1 = q + 2.0 * p * std::cos(phi);
+    const double e3 = q + 2.0 * p * std::cos(phi + twoPiOverThree);
+    const double e2 = 3.0 * q - e1 - e3;
+
+    degenerate[i] = static_cast<unsigned char>(!isMultipleOfIdentity && (1.0 - std::abs(r) < DegenerateTolerance));
+
+    /* Ascending by value, then a sorting network on the magnitudes when asked for */
+    double l1 = e3;
+    double l2 = e2;
+    double l3 = e1;
+    CompareSwap(l1, l2, orderByMagnitude);
+    CompareSwap(l2, l3, orderByMagnitude);
+    CompareSwap(l1, l2, orderByMagnitude);
+
+    lambda1[i] = l1;
+    lambda2[i] = l2;
+    lambda3[i] = l3;
+  }
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+AnalyticSymmetricEigenValueImageFilter<TInputImage, TOutputImage>::ComputeEigenValues2x2(const double * components,
+                                                                                         double *       eigenValues,
+                                                                                         SizeValueType  length,
+                                                                                         bool orderByMagnitude)
+{
+  const double * a00 = components;
+  const double * a01 = components + length;
+  const double * a11 = components + 2 * length;
+  double *       lambda1 = eigenValues;
+  double *       lambda2 = eigenValues + length;
+
+  for (SizeValueType i = 0; i < length; ++i)
+  {
+    const double mean = 0.5 * (a00[i] + a11[i]);
+    const double halfDifference = 0.5 * (a00[i] - a11[i]);
+    const double radius = std::sqrt(halfDifference * halfDifference + a01[i] * a01[i]);
+
+    double l1 = mean - radius;
+    double l2 = mean + radius;
+    CompareSwap(l1, l2, orderByMagnitude);
+
+    lambda1[i] = l1;
+    lambda2[i] = l2;
+  }
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+AnalyticSymmetricEigenValueImageFilter<TInputImage, TOutputImage>::DynamicThreadedGenerateData(
+  const OutputImageRegionType & outputRegionForThread)
+{
+  const InputImageType * inputPtr = this->GetInput();
+  OutputImageType *      outputPtr = this->GetOutput();
+
+  const bool orderByMagnitude = (m_EigenValueOrder == EigenValueOrderEnum::OrderByMagnitude);
+
+  FallbackCalculatorType calculator;
+  calculator.SetDimension(MatrixDimension);
+  calculator.SetOrderEigenValues(!orderByMagnitude);
+  calculator.SetOrderEigenMagnitudes(orderByMagnitude);
+
+  ImageScanlineConstIterator<InputImageType> inputIt(inputPtr, outputRegionForThread);
+  ImageScanlineIterator<OutputImageType>     outputIt(outputPtr, outputRegionForThread);
+
+  const SizeValueType        lineLength = outputRegionForThread.GetSize(0);
+  std::vector<double>        components(NumberOfComponents * lineLength);
+  std::vector<double>        eigenValues(MatrixDimension * lineLength);
+  std::vector<unsigned char> degenerate(lineLength, (MatrixDimension == 2 || MatrixDimension == 3) ? 0 : 1);
+
+  while (!inputIt.IsAtEnd())
+  {
+    /* Scanlines are contiguous in memory, gather them into one array per component */
+    for (SizeValueType x = 0; !inputIt.IsAtEndOfLine(); ++inputIt, ++x)
+    {
+      const InputPixelType & pixel = inputIt.Get();
+      unsigned int           component = 0;
+      for (unsigned int row = 0; row < MatrixDimension; ++row)
+      {
+        for (unsigned int column = row; column < MatrixDimension; ++column, ++component)
+        {
+          components[component * lineLength + x] = static_cast<double>(pixel(row, column));
+        }
+      }
+    }
+
+    if (MatrixDimension == 3)
+    {
+      Self::ComputeEigenValues3x3(
+        components.data(), eigenValues.data(), degenerate.data(), lineLength, orderByMagnitude);
+    }
+    else if (MatrixDimension == 2)
+    {
+      Self::ComputeEigenValues2x2(components.data(), eigenValues.data(), lineLength, orderByMagnitude);
+    }
+
+    /* Degenerate pixels, or all of them for other dimensions, go through the robust solver */
+    for (SizeValueType x = 0; x < lineLength; ++x)
+    {
+      if (!degenerate[x])
+      {
+        continue;
+      }
+
+      FallbackMatrixType matrix;
+      unsigned int       component = 0;
+      for (unsigned int row = 0; row < MatrixDimension; ++row)
+      {
+        for (unsigned int column = row; column < MatrixDimension; ++column, ++component)
+        {
+          matrix(row, column) = components[component * lineLength + x];
+        }
+      }
+
+      FallbackVectorType values;
+      calculator.ComputeEigenValues(matrix, values);
+      for (unsigned int d = 0; d < MatrixDimension; ++d)
+      {
+        eigenValues[d * lineLength + x] = values[d];
+      }
+    }
+
+    for (SizeValueType x = 0; !outputIt.IsAtEndOfLine(); ++outputIt, ++x)
+    {
+      OutputPixelType eigenValuePixel;
+      for (unsigned int d = 0; d < MatrixDimension; ++d)
+      {
+        eigenValuePixel[d] = static_cast<OutputValueType>(eigenValues[d * lineLength + x]);
+      }
+      outputIt.Set(eigenValuePixel);
+    }
+
+    inputIt.NextLine();
+    outputIt.NextLine();
+  }
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+AnalyticSymmetricEigenValueImageFilter<TInputImage, TOutputImage>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "EigenValueOrder: " << static_cast<int>(m_EigenValueOrder) << std::endl;
+}
+
+} // namespace itk
+
+#endif // itkAnalyticSymmetricEigenValueImageFilter_hxx
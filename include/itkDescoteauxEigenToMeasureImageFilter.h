@@ -21,9 +21,144 @@
 
 #include "itkEigenToMeasureImageFilter.h"
 #include "itkMath.h"
+#include "itkFastExponential.h"
 
 namespace itk
 {
+namespace Functor
+{
+/** \class DescoteauxEigenToMeasure
+ * \brief Compute the Descoteaux et al. sheetness of one eigenvalue triple.
+ *
+ * The parameters are unpacked once on construction so the measure can be inlined
+ * into the loop of DescoteauxEigenToMeasureImageFilter. See that class for the equation.
+ *
+ * \sa DescoteauxEigenToMeasureImageFilter
+ *
+ * \author: Bryce Besler
+ * \ingroup BoneEnhancement
+ */
+template <typename TInputPixel, typename TOutputPixel>
+class DescoteauxEigenToMeasure
+{
+public:
+  DescoteauxEigenToMeasure() = default;
+
+  DescoteauxEigenToMeasure(double alpha, double beta, double c, double enhanceType)
+    : m_TwoAlpha2(2 * alpha * alpha)
+    , m_TwoBeta2(2 * beta * beta)
+    , m_TwoC2(2 * c * c)
+    , m_EnhanceType(enhanceType)
+  {}
+
+  ~DescoteauxEigenToMeasure() = default;
+
+  bool
+  operator!=(const DescoteauxEigenToMeasure & other) const
+  {
+    return Math::NotExactlyEquals(m_TwoAlpha2, other.m_TwoAlpha2) ||
+           Math::NotExactlyEquals(m_TwoBeta2, other.m_TwoBeta2) || Math::NotExactlyEquals(m_TwoC2, other.m_TwoC2) ||
+           Math::NotExactlyEquals(m_EnhanceType, other.m_EnhanceType);
+  }
+
+  bool
+  operator==(const DescoteauxEigenToMeasure & other) const
+  {
+    return !(*this != other);
+  }
+
+  inline TOutputPixel
+  operator()(const TInputPixel & pixel) const
+  {
+    /* Grab pixel values */
+    const auto   a1 = static_cast<double>(pixel[0]);
+    const auto   a2 = static_cast<double>(pixel[1]);
+    const auto   a3 = static_cast<double>(pixel[2]);
+    const double l1 = Math::abs(a1);
+    const double l2 = Math::abs(a2);
+    const double l3 = Math::abs(a3);
+
+    /* Deal with l3 > 0 */
+    if (m_EnhanceType * a3 < 0)
+    {
+      return static_cast<TOutputPixel>(0.0);
+    }
+
+    /* Avoid divisions by zero (or close to zero) */
+    if (l3 < Math::eps)
+    {
+      return static_cast<TOutputPixel>(0.0);
+    }
+
+    /* Compute measures */
+    const double Rsheet = l2 / l3;
+    const double Rblob = Math::abs(2 * l3 - l2 - l1) / l3;
+    const double Rnoise2 = l1 * l1 + l2 * l2 + l3 * l3;
+
+    /* Multiply together to get sheetness */
+    double sheetness = 1.0;
+    sheetness *= std::exp(-(Rsheet * Rsheet) / m_TwoAlpha2);
+    sheetness *= (1.0 - std::exp(-(Rblob * Rblob) / m_TwoBeta2));
+    sheetness *= (1.0 - std::exp(-Rnoise2 / m_TwoC2));
+
+    return static_cast<TOutputPixel>(sheetness);
+  }
+
+  /** Evaluate the measure over length eigenvalue triples given as three arrays. TReal is the type
+   * of the arithmetic and exponential the function used for exp( ). Triples of the wrong sign or
+   * which would divide by (almost) zero are computed with a harmless denominator and then replaced
+   * by zero with a select, which never carries a NaN or a negative zero through, so the loop has
+   * no branches and can be vectorized. */
+  template <typename TReal, typename TExponential>
+  void
+  Evaluate(const TReal *        lambda1,
+           const TReal *        lambda2,
+           const TReal *        lambda3,
+           TOutputPixel *       output,
+           SizeValueType        length,
+           const TExponential & exponential) const
+  {
+    const auto  twoAlpha2 = static_cast<TReal>(m_TwoAlpha2);
+    const auto  twoBeta2 = static_cast<TReal>(m_TwoBeta2);
+    const auto  twoC2 = static_cast<TReal>(m_TwoC2);
+    const auto  enhanceType = static_cast<TReal>(m_EnhanceType);
+    const auto  eps = static_cast<TReal>(Math::eps);
+    const TReal one = 1;
+    const TReal two = 2;
+    const TReal zero = 0;
+
+    for (SizeValueType i = 0; i < length; ++i)
+    {
+      const TReal a3 = lambda3[i];
+      const TReal l1 = std::abs(lambda1[i]);
+      const TReal l2 = std::abs(lambda2[i]);
+      const TReal l3 = std::abs(a3);
+
+      /* The triples the scalar path does not return zero for */
+      const bool  valid = !(enhanceType * a3 < zero || l3 < eps);
+      const TReal safeL3 = valid ? l3 : one;
+
+      const TReal Rsheet = l2 / safeL3;
+      const TReal Rblob = std::abs(two * l3 - l2 - l1) / safeL3;
+      const TReal Rnoise2 = l1 * l1 + l2 * l2 + l3 * l3;
+
+      TReal sheetness = one;
+      sheetness *= exponential(-(Rsheet * Rsheet) / twoAlpha2);
+      sheetness *= (one - exponential(-(Rblob * Rblob) / twoBeta2));
+      sheetness *= (one - exponential(-Rnoise2 / twoC2));
+
+      output[i] = static_cast<TOutputPixel>(valid ? sheetness : zero);
+    }
+  }
+
+private:
+  double m_TwoAlpha2{ 0.5 };
+  double m_TwoBeta2{ 0.5 };
+  double m_TwoC2{ 2.0 };
+  double m_EnhanceType{ -1.0 };
+}; // end of class
+} // namespace Functor
+
 /** \class DescoteauxEigenToMeasureImageFilter
  * \brief Convert eigenvalues into a measure of sheetness according to the method of Descoteaux et al.
  *
@@ -41,6 +176,12 @@ namespace itk
  *
  * Note that if \f$ \lambda_3 > 0 \f$, \f$ s = 0 \f$.
  *
+ * The measure is evaluated with Functor::DescoteauxEigenToMeasure, which holds the parameters
+ * unpacked in BeforeThreadedGenerateData( ). With SetMeasurePrecision( FastSinglePrecision ) it is
+ * evaluated in float with Functor::FastExponential. The result is then within 1e-6 (absolute) of the
+ * double precision result.
+ *
+ * \sa Functor::DescoteauxEigenToMeasure
  * \sa DescoteauxEigenToMeasureParameterEstimationFilter
  * \sa EigenToMeasureImageFilter
  * \sa MultiScaleHessianEnhancementImageFilter
@@ -78,6 +219,9 @@ public:
   using ParameterArrayType = typename Superclass::ParameterArrayType;
   using ParameterDecoratedType = typename Superclass::ParameterDecoratedType;
 
+  /** Functor typedefs */
+  using FunctorType = Functor::DescoteauxEigenToMeasure<InputImagePixelType, OutputImagePixelType>;
+
   /** Method for creation through the object factory. */
   itkNewMacro(Self);
 
@@ -119,7 +263,12 @@ protected:
   OutputImagePixelType
   ProcessPixel(const InputImagePixelType & pixel) override;
 
-  /** Check the input has the right number of parameters. */
+  /** Evaluate the functor over each scanline instead of calling ProcessPixel( ), in the
+   * arithmetic selected with SetMeasurePrecision( ). */
+  void
+  GenerateData() override;
+
+  /** Check the input has the right number of parameters and unpack them into the functor. */
   void
   BeforeThreadedGenerateData() override;
 
@@ -128,7 +277,8 @@ protected:
 
 private:
   /* Member variables */
-  RealType m_EnhanceType;
+  RealType    m_EnhanceType;
+  FunctorType m_Functor;
 }; // end class
 } /* end namespace itk */
 
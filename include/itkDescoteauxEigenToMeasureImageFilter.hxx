@@ -20,8 +20,6 @@
 #define itkDescoteauxEigenToMeasureImageFilter_hxx
 
 #include "itkDescoteauxEigenToMeasureImageFilter.h"
-#include "itkImageRegionConstIteratorWithIndex.h"
-#include "itkImageRegionIterator.h"
 
 namespace itk
 {
@@ -39,51 +37,30 @@ DescoteauxEigenToMeasureImageFilter<TInputImage, TOutputImage>::BeforeThreadedGe
   {
     itkExceptionMacro(<< "Parameters must have size 3. Given array of size " << parameters.GetSize());
   }
+
+  /* Unpack the parameters once */
+  m_Functor = FunctorType(parameters[0], parameters[1], parameters[2], m_EnhanceType);
 }
 
 template <typename TInputImage, typename TOutputImage>
-typename DescoteauxEigenToMeasureImageFilter<TInputImage, TOutputImage>::OutputImagePixelType
-DescoteauxEigenToMeasureImageFilter<TInputImage, TOutputImage>::ProcessPixel(const InputImagePixelType & pixel)
+void
+DescoteauxEigenToMeasureImageFilter<TInputImage, TOutputImage>::GenerateData()
 {
-  /* Grab parameters */
-  ParameterArrayType parameters = this->GetParametersInput()->Get();
-  RealType           alpha = parameters[0];
-  RealType           beta = parameters[1];
-  RealType           c = parameters[2];
-
-  /* Grab pixel values */
-  double sheetness = 0.0;
-  auto   a1 = static_cast<double>(pixel[0]);
-  auto   a2 = static_cast<double>(pixel[1]);
-  auto   a3 = static_cast<double>(pixel[2]);
-  double l1 = Math::abs(a1);
-  double l2 = Math::abs(a2);
-  double l3 = Math::abs(a3);
-
-  /* Deal with l3 > 0 */
-  if (m_EnhanceType * a3 < 0)
+  if (this->GetMeasurePrecision() == Superclass::MeasurePrecisionEnum::FastSinglePrecision)
   {
-    return static_cast<OutputImagePixelType>(0.0);
+    this->template GenerateDataUsingBatchFunctor<float>(m_Functor, Functor::FastExponential());
   }
-
-  /* Avoid divisions by zero (or close to zero) */
-  if (l3 < Math::eps)
+  else
   {
-    return static_cast<OutputImagePixelType>(0.0);
+    this->template GenerateDataUsingBatchFunctor<double>(m_Functor, [](double x) { return std::exp(x); });
   }
+}
 
-  /* Compute measures */
-  const double Rsheet = l2 / l3;
-  const double Rblob = Math::abs(2 * l3 - l2 - l1) / l3;
-  const double Rnoise = sqrt(l1 * l1 + l2 * l2 + l3 * l3);
-
-  /* Multiply together to get sheetness */
-  sheetness = 1.0;
-  sheetness *= std::exp(-(Rsheet * Rsheet) / (2 * alpha * alpha));
-  sheetness *= (1.0 - std::exp(-(Rblob * Rblob) / (2 * beta * beta)));
-  sheetness *= (1.0 - std::exp(-(Rnoise * Rnoise) / (2 * c * c)));
-
-  return static_cast<OutputImagePixelType>(sheetness);
+template <typename TInputImage, typename TOutputImage>
+typename DescoteauxEigenToMeasureImageFilter<TInputImage, TOutputImage>::OutputImagePixelType
+DescoteauxEigenToMeasureImageFilter<TInputImage, TOutputImage>::ProcessPixel(const InputImagePixelType & pixel)
+{
+  return m_Functor(pixel);
 }
 
 template <typename TInputImage, typename TOutputImage>
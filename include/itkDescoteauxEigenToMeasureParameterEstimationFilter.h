@@ -21,7 +21,8 @@
 
 #include "itkMath.h"
 #include "itkEigenToMeasureParameterEstimationFilter.h"
-#include <mutex>
+#include <atomic>
+#include <memory>
 
 namespace itk
 {
@@ -42,6 +43,13 @@ namespace itk
  * If a mask is given, parameters are evaluated only where IsInside returns
  * true.
  *
+ * A few very bright pixels, for instance next to metal, decide the maximum on
+ * their own. SetFrobeniusNormPercentile( p ) with p < 100 uses the p-th percentile
+ * of the norms instead. The norms are counted in a histogram of 64 bins per octave,
+ * so the percentile is the upper edge of its bin, at most 1/64 above the exact
+ * value and never above the maximum. The counts are integers, so the result does
+ * not depend on the threads either.
+ *
  * \sa DescoteauxEigenToMeasureImageFilter
  * \sa EigenToMeasureParameterEstimationFilter
  * \sa MultiScaleHessianEnhancementImageFilter
@@ -94,6 +102,10 @@ public:
   itkSetMacro(FrobeniusNormWeight, RealType);
   itkGetConstMacro(FrobeniusNormWeight, RealType);
 
+  /** Set/Get the percentile of the Frobenius norms c is scaled from. Default is 100, the maximum. */
+  itkSetClampMacro(FrobeniusNormPercentile, RealType, 0, 100);
+  itkGetConstMacro(FrobeniusNormPercentile, RealType);
+
 #ifdef ITK_USE_CONCEPT_CHECKING
   // Begin concept checking
   itkConceptMacro(InputHaveDimension3Check, (Concept::SameDimension<TInputImage::ImageDimension, 3u>));
@@ -112,22 +124,38 @@ protected:
   void
   AfterThreadedGenerateData() override;
 
-  /** Multi-thread version GenerateData. */
+  /** Accumulate over one piece of the input. */
   void
-  DynamicThreadedGenerateData(const OutputImageRegionType & outputRegionForThread) override;
+  GeneratePieceData(const InputImageType *       input,
+                    const InputImageRegionType & region,
+                    MultiThreaderBase *          multiThreader) override;
 
   inline RealType
   CalculateFrobeniusNorm(const InputImagePixelType & pixel) const;
 
+  /** Bin of the norm histogram holding norm, and the largest norm a bin holds. Bin 0 holds zero. */
+  static SizeValueType
+  ComputeNormBin(RealType norm);
+  static RealType
+  ComputeNormBinUpperEdge(SizeValueType bin);
+
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
 
 private:
   /* Member variables */
-  RealType m_FrobeniusNormWeight;
-  RealType m_MaxFrobeniusNorm;
-
-  std::mutex m_Mutex;
+  RealType                         m_FrobeniusNormWeight;
+  RealType                         m_FrobeniusNormPercentile{ 100 };
+  RealType                         m_MaxFrobeniusNorm;
+  DeterministicReduction<RealType> m_FrobeniusNormReduction;
+
+  /** Histogram of the norms, only filled for percentiles below 100 */
+  static constexpr int           BinsPerOctave = 64;
+  static constexpr int           MinimumExponent = -128;
+  static constexpr int           MaximumExponent = 128;
+  static constexpr SizeValueType NumberOfNormBins = 1 + (MaximumExponent - MinimumExponent + 1) * BinsPerOctave;
+
+  std::unique_ptr<std::atomic<SizeValueType>[]> m_NormHistogram;
 }; // end class
 } // namespace itk
 
@@ -20,10 +20,20 @@
 #define itkDescoteauxEigenToMeasureParameterEstimationFilter_hxx
 
 #include "itkDescoteauxEigenToMeasureParameterEstimationFilter.h"
+#include <cmath>
 
 namespace itk
 {
 
+template <typename TInputImage, typename TOutputImage>
+constexpr int DescoteauxEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::BinsPerOctave;
+template <typename TInputImage, typename TOutputImage>
+constexpr int DescoteauxEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::MinimumExponent;
+template <typename TInputImage, typename TOutputImage>
+constexpr int DescoteauxEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::MaximumExponent;
+template <typename TInputImage, typename TOutputImage>
+constexpr SizeValueType DescoteauxEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::NumberOfNormBins;
+
 template <typename TInputImage, typename TOutputImage>
 DescoteauxEigenToMeasureParameterEstimationFilter<TInputImage,
                                                   TOutputImage>::DescoteauxEigenToMeasureParameterEstimationFilter()
@@ -44,6 +54,18 @@ void
 DescoteauxEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::BeforeThreadedGenerateData()
 {
   m_MaxFrobeniusNorm = NumericTraits<RealType>::NonpositiveMin();
+  m_FrobeniusNormReduction.Initialize(this->GetNumberOfLineSlots(), NumericTraits<RealType>::NonpositiveMin());
+
+  /* The percentile needs the distribution of the norms */
+  m_NormHistogram.reset();
+  if (m_FrobeniusNormPercentile < 100)
+  {
+    m_NormHistogram.reset(new std::atomic<SizeValueType>[NumberOfNormBins]);
+    for (SizeValueType bin = 0; bin < NumberOfNormBins; ++bin)
+    {
+      m_NormHistogram[bin].store(0, std::memory_order_relaxed);
+    }
+  }
 }
 
 template <typename TInputImage, typename TOutputImage>
@@ -56,10 +78,39 @@ DescoteauxEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::Af
   beta = 0.5f;
   c = 0.0f;
 
+  /* Merge the scanlines */
+  m_MaxFrobeniusNorm =
+    m_FrobeniusNormReduction.Reduce([](const RealType & a, const RealType & b) { return std::max(a, b); });
+
+  /* The upper edge of the bin of the percentile, which cannot be above the maximum */
+  RealType norm = m_MaxFrobeniusNorm;
+  if (m_NormHistogram)
+  {
+    SizeValueType total = 0;
+    for (SizeValueType bin = 0; bin < NumberOfNormBins; ++bin)
+    {
+      total += m_NormHistogram[bin].load(std::memory_order_relaxed);
+    }
+
+    const auto rank = std::max(static_cast<SizeValueType>(1),
+                               static_cast<SizeValueType>(std::ceil(m_FrobeniusNormPercentile / 100.0 * total)));
+    SizeValueType cumulative = 0;
+    for (SizeValueType bin = 0; bin < NumberOfNormBins && total > 0; ++bin)
+    {
+      cumulative += m_NormHistogram[bin].load(std::memory_order_relaxed);
+      if (cumulative >= rank)
+      {
+        norm = std::min(m_MaxFrobeniusNorm, ComputeNormBinUpperEdge(bin));
+        break;
+      }
+    }
+    m_NormHistogram.reset();
+  }
+
   /* Scale c */
-  if (m_MaxFrobeniusNorm > 0)
+  if (norm > 0)
   {
-    c = m_FrobeniusNormWeight * m_MaxFrobeniusNorm;
+    c = m_FrobeniusNormWeight * norm;
   }
 
   /* Assign outputs parameters */
@@ -73,68 +124,52 @@ DescoteauxEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::Af
 
 template <typename TInputImage, typename TOutputImage>
 void
-DescoteauxEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::DynamicThreadedGenerateData(
-  const OutputImageRegionType & outputRegionForThread)
+DescoteauxEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::GeneratePieceData(
+  const InputImageType *       input,
+  const InputImageRegionType & region,
+  MultiThreaderBase *          multiThreader)
 {
   /* If size is zero, return */
-  const SizeValueType size0 = outputRegionForThread.GetSize(0);
+  const SizeValueType size0 = region.GetSize(0);
   if (size0 == 0)
   {
     return;
   }
 
-  /* Get input and mask pointer */
-  InputImageConstPointer            inputPointer = this->GetInput();
-  MaskSpatialObjectTypeConstPointer maskPointer = this->GetMask();
-
-  OutputImageType * outputPtr = this->GetOutput(0);
-
-  // Define the portion of the input to walk for this thread, using
-  // the CallCopyOutputRegionToInputRegion method allows for the input
-  // and output images to be different dimensions
-  InputImageRegionType inputRegionForThread;
+  std::atomic<SizeValueType> * histogram = m_NormHistogram.get();
+  auto visitLine = [input, this, histogram](const InputImageRegionType & line, SizeValueType slot) {
+    /* Keep track of the current max */
+    RealType max = NumericTraits<RealType>::NonpositiveMin();
 
-  this->CallCopyOutputRegionToInputRegion(inputRegionForThread, outputRegionForThread);
+    /* Neighbouring norms mostly share a bin, so runs of a bin are counted at once */
+    SizeValueType runBin = 0;
+    SizeValueType runLength = 0;
 
-  MultiThreaderBase::Pointer mt = this->GetMultiThreader();
-
-  mt->ParallelizeImageRegion<TInputImage::ImageDimension>(
-    outputRegionForThread,
-    [inputPointer, maskPointer, outputPtr, this](const OutputImageRegionType region) {
-      /* Keep track of the current max */
-      RealType max = NumericTraits<RealType>::NonpositiveMin();
-
-      typename InputImageType::PointType point;
-
-      /* Setup iterator */
-      ImageRegionConstIteratorWithIndex<TInputImage> inputIt(inputPointer, region);
-      ImageRegionIterator<OutputImageType>           outputIt(outputPtr, region);
-
-      /* Iterate and count */
-      while (!inputIt.IsAtEnd())
+    /* Compute max norm */
+    this->VisitPixelsInMask(input, line, [&](const InputImagePixelType & pixel) {
+      const RealType norm = this->CalculateFrobeniusNorm(pixel);
+      max = std::max(max, norm);
+      if (histogram)
       {
-        // Process point
-        inputPointer->TransformIndexToPhysicalPoint(inputIt.GetIndex(), point);
-        if ((!maskPointer) || (maskPointer->IsInsideInObjectSpace(point)))
+        const SizeValueType bin = ComputeNormBin(norm);
+        if (bin != runBin && runLength > 0)
         {
-          /* Compute max norm */
-          max = std::max(max, this->CalculateFrobeniusNorm(inputIt.Get()));
+          histogram[runBin].fetch_add(runLength, std::memory_order_relaxed);
+          runLength = 0;
         }
-
-        // Set
-        outputIt.Set(static_cast<OutputImagePixelType>(inputIt.Get()));
-
-        // Increment
-        ++inputIt;
-        ++outputIt;
+        runBin = bin;
+        ++runLength;
       }
-
-
-      /* Block and store */
-      std::lock_guard<std::mutex> mutexHolder(m_Mutex);
-      m_MaxFrobeniusNorm = std::max(m_MaxFrobeniusNorm, max);
-    },
-    nullptr);
+    });
+    if (runLength > 0)
+    {
+      histogram[runBin].fetch_add(runLength, std::memory_order_relaxed);
+    }
+
+    /* Every scanline has its own slot, nothing to lock */
+    m_FrobeniusNormReduction[slot] = max;
+  };
+  this->ParallelizeLines(multiThreader, region, visitLine);
 }
 
 template <typename TInputImage, typename TOutputImage>
@@ -153,6 +188,45 @@ DescoteauxEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::Ca
   return sqrt(norm);
 }
 
+template <typename TInputImage, typename TOutputImage>
+SizeValueType
+DescoteauxEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::ComputeNormBin(RealType norm)
+{
+  if (!(norm > 0))
+  {
+    return 0;
+  }
+
+  /* norm = mantissa 2^exponent with mantissa in [0.5, 1), split linearly in each octave */
+  int          exponent;
+  const double mantissa = std::frexp(static_cast<double>(norm), &exponent);
+  if (exponent < MinimumExponent)
+  {
+    return 1;
+  }
+  if (exponent > MaximumExponent)
+  {
+    return NumberOfNormBins - 1;
+  }
+  const int subBin = std::min(static_cast<int>((2.0 * mantissa - 1.0) * BinsPerOctave), BinsPerOctave - 1);
+  return 1 + static_cast<SizeValueType>((exponent - MinimumExponent) * BinsPerOctave + subBin);
+}
+
+template <typename TInputImage, typename TOutputImage>
+typename DescoteauxEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::RealType
+DescoteauxEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::ComputeNormBinUpperEdge(
+  SizeValueType bin)
+{
+  if (bin == 0)
+  {
+    return 0;
+  }
+  const auto k = static_cast<int>(bin - 1);
+  const int  exponent = MinimumExponent + k / BinsPerOctave;
+  const int  subBin = k % BinsPerOctave;
+  return static_cast<RealType>(std::ldexp(0.5 * (1.0 + (subBin + 1.0) / BinsPerOctave), exponent));
+}
+
 template <typename TInputImage, typename TOutputImage>
 void
 DescoteauxEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::PrintSelf(std::ostream & os,
@@ -160,6 +234,7 @@ DescoteauxEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::Pr
 {
   Superclass::PrintSelf(os, indent);
   os << indent << "FrobeniusNormWeight: " << GetFrobeniusNormWeight() << std::endl;
+  os << indent << "FrobeniusNormPercentile: " << GetFrobeniusNormPercentile() << std::endl;
 }
 
 } // namespace itk
@@ -0,0 +1,105 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkDeterministicReduction_h
+#define itkDeterministicReduction_h
+
+#include "itkIntTypes.h"
+#include <vector>
+
+namespace itk
+{
+/** \class DeterministicReduction
+ * \brief Partial results reduced in an order which does not depend on the threads.
+ *
+ * Merging the partial result of every thread into a shared accumulator needs a lock, and the
+ * result of a floating point sum then depends on the order in which the threads finish. Here the
+ * work is instead divided into a fixed number of slots, for instance one per scanline of an image,
+ * chosen without looking at the threads. Each slot is written by exactly one task, so no lock is
+ * needed, and Reduce( ) merges the slots along a fixed binary tree: slot i with slot i + 1, then
+ * slot i with slot i + 2 and so on. The result is bit for bit the same whatever the number of
+ * threads or the order they run in, and for sums the tree is a pairwise summation whose rounding
+ * error only grows with the logarithm of the number of slots.
+ *
+ * \sa EigenToMeasureParameterEstimationFilter
+ *
+ * \author: Bryce Besler
+ * \ingroup BoneEnhancement
+ */
+template <typename TValue>
+class DeterministicReduction
+{
+public:
+  using ValueType = TValue;
+
+  /** Reset to numberOfSlots slots holding identity, the value merging leaves unchanged. */
+  void
+  Initialize(SizeValueType numberOfSlots, const ValueType & identity)
+  {
+    m_Identity = identity;
+    m_Slots.assign(numberOfSlots, identity);
+  }
+
+  SizeValueType
+  GetNumberOfSlots() const
+  {
+    return m_Slots.size();
+  }
+
+  /** Slots may be written concurrently as long as no two tasks write the same one. */
+  ValueType &
+  operator[](SizeValueType slot)
+  {
+    return m_Slots[slot];
+  }
+  const ValueType &
+  operator[](SizeValueType slot) const
+  {
+    return m_Slots[slot];
+  }
+
+  /** Merge every slot with merge( const ValueType &, const ValueType & ) along the fixed tree.
+   * Returns the identity when there are no slots. */
+  template <typename TMerge>
+  ValueType
+  Reduce(TMerge merge) const
+  {
+    if (m_Slots.empty())
+    {
+      return m_Identity;
+    }
+
+    std::vector<ValueType> level(m_Slots);
+    const SizeValueType    numberOfSlots = level.size();
+    for (SizeValueType width = 1; width < numberOfSlots; width *= 2)
+    {
+      for (SizeValueType i = 0; i + width < numberOfSlots; i += 2 * width)
+      {
+        level[i] = merge(level[i], level[i + width]);
+      }
+    }
+    return level[0];
+  }
+
+private:
+  ValueType              m_Identity{};
+  std::vector<ValueType> m_Slots;
+};
+} // end namespace itk
+
+#endif // itkDeterministicReduction_h
@@ -22,6 +22,7 @@
 #include "itkImageToImageFilter.h"
 #include "itkSimpleDataObjectDecorator.h"
 #include "itkSpatialObject.h"
+#include "itkRunLengthMask.h"
 
 namespace itk
 {
@@ -32,6 +33,15 @@ namespace itk
  * Any algorithm implementing a local-structure measure should inherit from this class
  * so they can be used in the MultiScaleHessianEnhancementImageFilter framework.
  *
+ * Subclasses implement ProcessPixel( ), which is called through a virtual function for every
+ * pixel. Subclasses that care about speed can instead override GenerateData( ) and call
+ * GenerateDataUsingFunctor( ) with a functor holding the unpacked parameters, so the per pixel
+ * kernel is inlined into a loop over each scanline. GenerateDataUsingBatchFunctor( ) goes one
+ * step further and hands each scanline to the functor as three arrays of eigenvalues.
+ *
+ * Pixels outside of the mask are set to zero. SetMaskRuns( ) with the mask rasterized once onto
+ * the grid of the input is much faster than SetMask( ), because no pixel is tested for itself.
+ *
  * \sa MultiScaleHessianEnhancementImageFilter
  * \sa EigenToMeasureParameterEstimationFilter
  *
@@ -81,10 +91,17 @@ public:
   /** Process object */
   itkSetGetDecoratedInputMacro(Parameters, ParameterArrayType);
 
+  using MaskRunsType = RunLengthMask<Self::ImageDimension>;
+
   /** Methods to set/get the mask image */
   itkSetInputMacro(Mask, MaskSpatialObjectType);
   itkGetInputMacro(Mask, MaskSpatialObjectType);
 
+  /** Methods to set/get the mask rasterized onto the grid of the input. When set it
+   * is used instead of the mask and only the pixels inside of it are visited. */
+  itkSetInputMacro(MaskRuns, MaskRunsType);
+  itkGetInputMacro(MaskRuns, MaskRunsType);
+
   /**\class EigenValueOrderEnum
    * Template the EigenValueOrderEnum. Methods that inherit from this class can override this function
    * to produce a different eigenvalue ordering. Ideally, the enum EigenValueOrderEnum should come from
@@ -109,6 +126,22 @@ public:
   virtual EigenValueOrderEnum
   GetEigenValueOrder() const = 0;
 
+  /**\class MeasurePrecisionEnum
+   * Arithmetic used to evaluate the measure. DoublePrecision evaluates in double with std::exp.
+   * FastSinglePrecision evaluates in float with Functor::FastExponential. Subclasses which do not
+   * provide a fast path ignore this setting.
+   * \ingroup BoneEnhancement
+   */
+  enum class MeasurePrecisionEnum : uint8_t
+  {
+    DoublePrecision = 1,
+    FastSinglePrecision
+  };
+
+  /** Set/Get the arithmetic used to evaluate the measure. Default is DoublePrecision. */
+  itkSetEnumMacro(MeasurePrecision, MeasurePrecisionEnum);
+  itkGetEnumMacro(MeasurePrecision, MeasurePrecisionEnum);
+
 protected:
   EigenToMeasureImageFilter() = default;
   ~EigenToMeasureImageFilter() override = default;
@@ -118,6 +151,27 @@ protected:
 
   void
   GenerateData() override;
+
+  /** Compute the output by calling functor( pixel ) for every input pixel. BeforeThreadedGenerateData( )
+   * is called before the functor is first used, so a functor held by reference can be set up there. */
+  template <typename TFunctor>
+  void
+  GenerateDataUsingFunctor(const TFunctor & functor);
+
+  /** Compute the output one scanline at a time. The eigenvalues of the scanline are copied to three
+   * arrays of TReal and the functor is called as
+   *    functor.Evaluate(lambda1, lambda2, lambda3, output, length, exponential)
+   * where exponential is the function used for exp( ). Pixels outside of the mask are set to zero
+   * afterwards. With a rasterized mask the functor is only called on the runs inside of it. */
+  template <typename TReal, typename TFunctor, typename TExponential>
+  void
+  GenerateDataUsingBatchFunctor(const TFunctor & functor, const TExponential & exponential);
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  MeasurePrecisionEnum m_MeasurePrecision{ MeasurePrecisionEnum::DoublePrecision };
 }; // end class
 } // namespace itk
 
@@ -20,8 +20,10 @@
 #define itkEigenToMeasureImageFilter_hxx
 
 #include "itkEigenToMeasureImageFilter.h"
-#include "itkImageRegionConstIteratorWithIndex.h"
-#include "itkImageRegionIterator.h"
+#include "itkImageScanlineConstIterator.h"
+#include "itkImageScanlineIterator.h"
+#include <algorithm>
+#include <vector>
 
 namespace itk
 {
@@ -29,48 +31,165 @@ namespace itk
 template <typename TInputImage, typename TOutputImage>
 void
 EigenToMeasureImageFilter<TInputImage, TOutputImage>::GenerateData()
+{
+  this->GenerateDataUsingFunctor(
+    [this](const InputImagePixelType & pixel) -> OutputImagePixelType { return this->ProcessPixel(pixel); });
+}
+
+template <typename TInputImage, typename TOutputImage>
+template <typename TFunctor>
+void
+EigenToMeasureImageFilter<TInputImage, TOutputImage>::GenerateDataUsingFunctor(const TFunctor & functor)
 {
   const InputImageType *        inputPtr = this->GetInput(0);
   OutputImageType *             outputPtr = this->GetOutput(0);
   const MaskSpatialObjectType * maskPointer = this->GetMask();
+  const MaskRunsType *          maskRuns = this->GetMaskRuns();
 
   this->AllocateOutputs();
 
   this->BeforeThreadedGenerateData();
 
-  const OutputImageRegionType requestedRegion( outputPtr->GetRequestedRegion() );
+  const OutputImageRegionType requestedRegion(outputPtr->GetRequestedRegion());
+
+  MultiThreaderBase::Pointer mt = this->GetMultiThreader();
+
+  mt->ParallelizeImageRegion<TInputImage::ImageDimension>(
+    requestedRegion,
+    [inputPtr, maskPointer, maskRuns, outputPtr, &functor](const OutputImageRegionType & region) {
+      typename InputImageType::PointType point;
+
+      /* Setup iterator */
+      ImageScanlineConstIterator<TInputImage> inputIt(inputPtr, region);
+      ImageScanlineIterator<OutputImageType>  outputIt(outputPtr, region);
+      const SizeValueType                     lineLength = region.GetSize(0);
+
+      while (!inputIt.IsAtEnd())
+      {
+        /* Scanlines are contiguous in memory */
+        const InputImagePixelType * in = &(inputIt.Value());
+        OutputImagePixelType *      out = &(outputIt.Value());
 
-  // Define the portion of the input to walk for this thread, using
-  // the CallCopyOutputRegionToInputRegion method allows for the input
-  // and output images to be different dimensions
-  InputImageRegionType inputRegionForThread;
-  this->CallCopyOutputRegionToInputRegion(inputRegionForThread, requestedRegion);
+        if (maskRuns)
+        {
+          /* Only the runs inside of the mask are computed */
+          const IndexValueType lineFirst = inputIt.GetIndex()[0];
+          std::fill(out, out + lineLength, NumericTraits<OutputImagePixelType>::ZeroValue());
+          maskRuns->VisitRuns(inputIt.GetIndex(), lineLength, [&](IndexValueType start, SizeValueType length) {
+            const auto offset = static_cast<SizeValueType>(start - lineFirst);
+            for (SizeValueType x = offset; x < offset + length; ++x)
+            {
+              out[x] = functor(in[x]);
+            }
+          });
+        }
+        else if (!maskPointer)
+        {
+          for (SizeValueType x = 0; x < lineLength; ++x)
+          {
+            out[x] = functor(in[x]);
+          }
+        }
+        else
+        {
+          typename InputImageType::IndexType index = inputIt.GetIndex();
+          for (SizeValueType x = 0; x < lineLength; ++x, ++index[0])
+          {
+            inputPtr->TransformIndexToPhysicalPoint(index, point);
+            out[x] = maskPointer->IsInsideInObjectSpace(point) ? functor(in[x])
+                                                               : NumericTraits<OutputImagePixelType>::ZeroValue();
+          }
+        }
+
+        inputIt.NextLine();
+        outputIt.NextLine();
+      }
+    },
+    nullptr);
+
+  this->AfterThreadedGenerateData();
+}
+
+template <typename TInputImage, typename TOutputImage>
+template <typename TReal, typename TFunctor, typename TExponential>
+void
+EigenToMeasureImageFilter<TInputImage, TOutputImage>::GenerateDataUsingBatchFunctor(const TFunctor &     functor,
+                                                                                   const TExponential & exponential)
+{
+  const InputImageType *        inputPtr = this->GetInput(0);
+  OutputImageType *             outputPtr = this->GetOutput(0);
+  const MaskSpatialObjectType * maskPointer = this->GetMask();
+  const MaskRunsType *          maskRuns = this->GetMaskRuns();
+
+  this->AllocateOutputs();
+
+  this->BeforeThreadedGenerateData();
+
+  const OutputImageRegionType requestedRegion(outputPtr->GetRequestedRegion());
 
   MultiThreaderBase::Pointer mt = this->GetMultiThreader();
 
   mt->ParallelizeImageRegion<TInputImage::ImageDimension>(
     requestedRegion,
-    [inputPtr, maskPointer, outputPtr, this](const OutputImageRegionType & region) {
+    [inputPtr, maskPointer, maskRuns, outputPtr, &functor, &exponential](const OutputImageRegionType & region) {
       typename InputImageType::PointType point;
 
       /* Setup iterator */
-      ImageRegionConstIteratorWithIndex<TInputImage> inputIt(inputPtr, region);
-      ImageRegionIterator<OutputImageType>           outputIt(outputPtr, region);
+      ImageScanlineConstIterator<TInputImage> inputIt(inputPtr, region);
+      ImageScanlineIterator<OutputImageType>  outputIt(outputPtr, region);
+      const SizeValueType                     lineLength = region.GetSize(0);
+
+      /* One array per eigenvalue */
+      std::vector<TReal> lambda(3 * lineLength);
+      TReal *            lambda1 = lambda.data();
+      TReal *            lambda2 = lambda1 + lineLength;
+      TReal *            lambda3 = lambda2 + lineLength;
 
       while (!inputIt.IsAtEnd())
       {
-        inputPtr->TransformIndexToPhysicalPoint(inputIt.GetIndex(), point);
-        if ((!maskPointer) || (maskPointer->IsInsideInObjectSpace(point)))
+        const InputImagePixelType * in = &(inputIt.Value());
+        OutputImagePixelType *      out = &(outputIt.Value());
+
+        /* Transpose and evaluate the pixels [offset, offset + length) of the scanline */
+        auto evaluate = [&](SizeValueType offset, SizeValueType length) {
+          for (SizeValueType x = 0; x < length; ++x)
+          {
+            lambda1[x] = static_cast<TReal>(in[offset + x][0]);
+            lambda2[x] = static_cast<TReal>(in[offset + x][1]);
+            lambda3[x] = static_cast<TReal>(in[offset + x][2]);
+          }
+          functor.Evaluate(lambda1, lambda2, lambda3, out + offset, length, exponential);
+        };
+
+        if (maskRuns)
         {
-          outputIt.Set(this->ProcessPixel(inputIt.Get()));
+          /* Only the runs inside of the mask are computed */
+          const IndexValueType lineFirst = inputIt.GetIndex()[0];
+          std::fill(out, out + lineLength, NumericTraits<OutputImagePixelType>::ZeroValue());
+          maskRuns->VisitRuns(inputIt.GetIndex(), lineLength, [&](IndexValueType start, SizeValueType length) {
+            evaluate(static_cast<SizeValueType>(start - lineFirst), length);
+          });
         }
         else
         {
-          outputIt.Set(NumericTraits<OutputImagePixelType>::Zero);
+          evaluate(0, lineLength);
+        }
+
+        if (maskPointer && !maskRuns)
+        {
+          typename InputImageType::IndexType index = inputIt.GetIndex();
+          for (SizeValueType x = 0; x < lineLength; ++x, ++index[0])
+          {
+            inputPtr->TransformIndexToPhysicalPoint(index, point);
+            if (!maskPointer->IsInsideInObjectSpace(point))
+            {
+              out[x] = NumericTraits<OutputImagePixelType>::ZeroValue();
+            }
+          }
         }
 
-        ++inputIt;
-        ++outputIt;
+        inputIt.NextLine();
+        outputIt.NextLine();
       }
     },
     nullptr);
@@ -78,6 +197,14 @@ EigenToMeasureImageFilter<TInputImage, TOutputImage>::GenerateData()
   this->AfterThreadedGenerateData();
 }
 
+template <typename TInputImage, typename TOutputImage>
+void
+EigenToMeasureImageFilter<TInputImage, TOutputImage>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "MeasurePrecision: " << static_cast<int>(m_MeasurePrecision) << std::endl;
+}
+
 } // namespace itk
 
 #endif /* itkEigenToMeasureImageFilter_hxx */
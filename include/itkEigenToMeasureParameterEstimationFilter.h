@@ -22,6 +22,8 @@
 #include "itkStreamingImageFilter.h"
 #include "itkSimpleDataObjectDecorator.h"
 #include "itkSpatialObject.h"
+#include "itkRunLengthMask.h"
+#include "itkDeterministicReduction.h"
 
 namespace itk
 {
@@ -40,7 +42,43 @@ namespace itk
  * The method GetParametersOutput can be used to insert this filter in a pipeline before
  * EigenToMeasureImageFilter.
  *
+ * By default the input is copied to the output image piece by piece so the filter
+ * can sit between the eigen-image and EigenToMeasureImageFilter. When only the
+ * parameters are needed, SetOutputMode( ParametersOnly ) skips allocating and
+ * filling the output image. This is what MultiScaleHessianEnhancementImageFilter
+ * uses when it runs the estimation as a separate pre-pass. SetOutputMode( GraftInput )
+ * requests the whole region from upstream in a single piece and grafts the input
+ * onto the output, so the eigen-image is passed through without a copy. This gives
+ * up streaming: the whole input and the whole of every image upstream of it are
+ * buffered at once, which usually takes more memory than the copy and one piece.
+ *
+ * By default every piece is updated upstream and then reduced before the next
+ * piece is requested. SetNumberOfPiecesInFlight( n ) with n > 1 pipelines the
+ * stream: once a piece is updated the reduction takes its buffer over from upstream,
+ * without a copy, and reduces it asynchronously while the next piece is produced,
+ * with at most n - 1 reductions pending. A MultiThreader runs one parallel section
+ * at a time, so every pending reduction gets a MultiThreader of its own with a share
+ * of 1 / n of the threads and work units of the MultiThreader of this filter, the
+ * rest being left to the upstream piece. GraftInput always reduces synchronously.
+ * Subclasses implement GeneratePieceData() and must only read the image they are
+ * given and parallelize on the MultiThreader they are given, since reductions of
+ * several pieces can run concurrently.
+ *
+ * Subclasses reduce without locks through ParallelizeLines( ), which visits every
+ * scanline of a piece with the slot of that scanline in the whole region. Storing one
+ * partial result per scanline in a DeterministicReduction and reducing it in
+ * AfterThreadedGenerateData() gives the same parameters whatever the number of threads,
+ * stream divisions or pieces in flight.
+ *
+ * SetSamplingStride( s ) with s > 1 estimates the parameters from a regular subsample:
+ * only every s-th scanline along every direction but the first is visited, about one
+ * pixel in s^(D-1). The subsampling is of the reduction only. Upstream still computes
+ * the hessian and eigenvalues of every pixel of the slabs of SetNumberOfStreamDivisions( ),
+ * so no sweep over the input is saved; a piece of a single slice would instead make
+ * upstream kernels of radius r convolve about (2r + 1) / s times over.
+ *
  * \sa StreamingImageFilter
+ * \sa DeterministicReduction
  * \sa MultiScaleHessianEnhancementImageFilter
  * \sa EigenToMeasureImageFilter
  *
@@ -79,6 +117,7 @@ public:
   /** Input Mask typedefs. */
   using MaskSpatialObjectType = SpatialObject<Self::ImageDimension>;
   using MaskSpatialObjectTypeConstPointer = typename MaskSpatialObjectType::ConstPointer;
+  using MaskRunsType = RunLengthMask<Self::ImageDimension>;
 
   /** Parameter typedefs. */
   using RealType = typename NumericTraits<PixelValueType>::RealType;
@@ -103,6 +142,37 @@ public:
   itkSetInputMacro(Mask, MaskSpatialObjectType);
   itkGetInputMacro(Mask, MaskSpatialObjectType);
 
+  /** Methods to set/get the mask rasterized onto the grid of the input. When set it
+   * is used instead of the mask and only the pixels inside of it are visited. */
+  itkSetInputMacro(MaskRuns, MaskRunsType);
+  itkGetInputMacro(MaskRuns, MaskRunsType);
+
+  /**\class OutputModeEnum
+   * What is produced in the output image.
+   * \ingroup BoneEnhancement
+   */
+  enum class OutputModeEnum : uint8_t
+  {
+    CopyInput = 1,
+    ParametersOnly,
+    GraftInput
+  };
+
+  /** Set/Get what is produced in the output image. Default is CopyInput. */
+  itkSetEnumMacro(OutputMode, OutputModeEnum);
+  itkGetEnumMacro(OutputMode, OutputModeEnum);
+
+  /** Set/Get the number of pieces held at the same time while streaming: the piece
+   * being produced upstream and the pieces still being reduced. Default is 1, which
+   * processes the pieces one after another. */
+  itkSetClampMacro(NumberOfPiecesInFlight, unsigned int, 1, NumericTraits<unsigned int>::max());
+  itkGetConstMacro(NumberOfPiecesInFlight, unsigned int);
+
+  /** Set/Get the stride between the scanlines reduced along every direction but the first. Default is 1,
+   * every pixel is reduced. Every pixel is still requested from upstream. */
+  itkSetClampMacro(SamplingStride, unsigned int, 1, NumericTraits<unsigned int>::max());
+  itkGetConstMacro(SamplingStride, unsigned int);
+
   /** Override UpdateOutputData() from StreamingImageFilter to divide
    * upstream updates into pieces. This filter does not have a GenerateData()
    * or ThreadedGenerateData() method.  Instead, all the work is done
@@ -122,8 +192,49 @@ protected:
   EigenToMeasureParameterEstimationFilter();
   ~EigenToMeasureParameterEstimationFilter() override = default;
 
+  /** Reduces the input of this filter over region. */
+  void
+  DynamicThreadedGenerateData(const OutputImageRegionType & region) override
+  {
+    this->GeneratePieceData(this->GetInput(), region, this->GetMultiThreader());
+  }
+
+  /** Accumulate the parameters over one piece on multiThreader. The image buffers at least region and
+   * has the geometry of the input. May be called concurrently for different pieces, each with its own
+   * multiThreader. */
+  virtual void
+  GeneratePieceData(const InputImageType *       input,
+                    const InputImageRegionType & region,
+                    MultiThreaderBase *          multiThreader) = 0;
+
+  /** Call visitor( const InputImagePixelType & ) for every pixel of region of input inside of the
+   * mask, or for every pixel when there is no mask. The rasterized mask is used when it is set. */
+  template <typename TVisitor>
+  void
+  VisitPixelsInMask(const InputImageType * input, const InputImageRegionType & region, TVisitor visitor) const;
+
+  /** Number of scanlines of the whole region being reduced, valid from BeforeThreadedGenerateData() on. */
+  SizeValueType
+  GetNumberOfLineSlots() const;
+
+  /** Call visitor( const InputImageRegionType & line, SizeValueType slot ) for every sampled scanline of
+   * region on multiThreader. The slot of a scanline is its position in the whole region being reduced,
+   * so it does not depend on how the region is streamed or on the threads. The slots of the scanlines
+   * skipped by the sampling stride are never visited. */
+  template <typename TLineVisitor>
+  void
+  ParallelizeLines(MultiThreaderBase * multiThreader, const InputImageRegionType & region, TLineVisitor visitor);
+
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  OutputModeEnum m_OutputMode{ OutputModeEnum::CopyInput };
+  unsigned int   m_NumberOfPiecesInFlight{ 1 };
+  unsigned int   m_SamplingStride{ 1 };
+
+  /** The whole region streamed through this update, which the line slots index */
+  InputImageRegionType m_ReductionRegion;
 }; // end class
 } // namespace itk
 
@@ -24,7 +24,11 @@
 #include "itkImageAlgorithm.h"
 #include "itkImageRegionSplitterSlowDimension.h"
 #include "itkImageRegionConstIteratorWithIndex.h"
-#include "itkImageRegionSplitterSlowDimension.h"
+#include "itkImageScanlineConstIterator.h"
+#include <algorithm>
+#include <deque>
+#include <future>
+#include <vector>
 
 namespace itk
 {
@@ -74,11 +78,14 @@ EigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::UpdateOutput
   this->UpdateProgress(0.0);
   this->m_Updating = true;
 
-  /** Allocate the output buffer. */
+  /** Allocate the output buffer, unless we only produce parameters. */
   OutputImageType *           outputPtr = this->GetOutput(0);
   const OutputImageRegionType outputRegion = outputPtr->GetRequestedRegion();
-  outputPtr->SetBufferedRegion(outputRegion);
-  outputPtr->Allocate();
+  if (m_OutputMode == OutputModeEnum::CopyInput)
+  {
+    outputPtr->SetBufferedRegion(outputRegion);
+    outputPtr->Allocate();
+  }
 
   /** Grab the input */
   auto * inputPtr = const_cast<InputImageType *>(this->GetInput(0));
@@ -98,6 +105,15 @@ EigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::UpdateOutput
     numDivisions = numDivisionsFromSplitter;
   }
 
+  /** The output shares the input buffer, so the input is produced in one piece. */
+  if (m_OutputMode == OutputModeEnum::GraftInput)
+  {
+    numDivisions = 1;
+  }
+
+  /** The line slots index the whole region, whatever the pieces are */
+  this->CallCopyOutputRegionToInputRegion(m_ReductionRegion, outputRegion);
+
   // Call a method that can be overridden by a subclass to perform
   // some calculations prior to splitting the main computations into
   // separate threads
@@ -105,24 +121,107 @@ EigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::UpdateOutput
 
   /**
    * Loop over the number of pieces, execute the upstream pipeline on each
-   * piece, and copy the results into the output image.
+   * piece, and copy the results into the output image. Pieces in flight are
+   * reduced asynchronously while the next piece is produced upstream.
    */
-  for (unsigned int piece = 0; piece < numDivisions && !this->GetAbortGenerateData(); piece++)
+  const unsigned int maximumPendingPieces =
+    (m_OutputMode == OutputModeEnum::GraftInput) ? 0 : m_NumberOfPiecesInFlight - 1;
+  std::deque<std::future<void>> pendingPieces;
+
+  /* Piece p takes the threader of piece p - maximumPendingPieces, which has been reduced by then */
+  const MultiThreaderBase *               filterThreader = this->GetMultiThreader();
+  std::vector<MultiThreaderBase::Pointer> pieceThreaders(maximumPendingPieces);
+  for (auto & pieceThreader : pieceThreaders)
+  {
+    pieceThreader = MultiThreaderBase::New();
+    pieceThreader->SetMaximumNumberOfThreads(
+      std::max(1u, filterThreader->GetMaximumNumberOfThreads() / m_NumberOfPiecesInFlight));
+    pieceThreader->SetNumberOfWorkUnits(
+      std::max(1u, filterThreader->GetNumberOfWorkUnits() / m_NumberOfPiecesInFlight));
+  }
+  try
   {
-    /* Determine the split region and calculate the input */
-    InputImageRegionType streamRegion;
-    this->CallCopyOutputRegionToInputRegion(streamRegion, outputRegion);
+    for (unsigned int piece = 0; piece < numDivisions && !this->GetAbortGenerateData(); piece++)
+    {
+      /* Determine the split region and calculate the input. The pieces are slabs whatever the sampling stride,
+       * since a piece of a few slices would pull the padding of the upstream kernels with every one of them. */
+      InputImageRegionType streamRegion;
+      this->CallCopyOutputRegionToInputRegion(streamRegion, outputRegion);
+      this->GetRegionSplitter()->GetSplit(piece, numDivisions, streamRegion);
+      inputPtr->SetRequestedRegion(streamRegion);
+      inputPtr->PropagateRequestedRegion();
+      inputPtr->UpdateOutputData();
+
+      if (maximumPendingPieces == 0)
+      {
+        /* Process this chunk */
+        this->ThreadedGenerateData(streamRegion, piece);
+
+        /* Pass the chunk through */
+        if (m_OutputMode == OutputModeEnum::CopyInput)
+        {
+          ImageAlgorithm::Copy(inputPtr, outputPtr, streamRegion, streamRegion);
+        }
+      }
+      else
+      {
+        /* Wait for the oldest piece when the pipeline is full */
+        while (pendingPieces.size() >= maximumPendingPieces)
+        {
+          pendingPieces.front().get();
+          pendingPieces.pop_front();
+        }
+
+        /* The reduction takes the upstream buffer over, the upstream then allocates the next piece anew */
+        InputImageConstPointer pieceImage = inputPtr;
+        if (inputPtr->GetSource())
+        {
+          InputImagePointer detached = InputImageType::New();
+          detached->Graft(inputPtr);
+          inputPtr->ReleaseData();
+          pieceImage = detached;
+        }
 
-    this->GetRegionSplitter()->GetSplit(piece, numDivisions, streamRegion);
-    inputPtr->SetRequestedRegion(streamRegion);
-    inputPtr->PropagateRequestedRegion();
-    inputPtr->UpdateOutputData();
+        /* Process and pass the chunk through while the next one is streamed */
+        MultiThreaderBase * pieceThreader = pieceThreaders[piece % maximumPendingPieces];
+        pendingPieces.push_back(
+          std::async(std::launch::async, [this, pieceImage, streamRegion, outputPtr, pieceThreader]() {
+            this->GeneratePieceData(pieceImage, streamRegion, pieceThreader);
+            if (m_OutputMode == OutputModeEnum::CopyInput)
+            {
+              ImageAlgorithm::Copy(pieceImage.GetPointer(), outputPtr, streamRegion, streamRegion);
+            }
+          }));
+      }
 
-    /* Process this chunk */
-    this->ThreadedGenerateData(streamRegion, piece);
+      /* Update progress and stream another chunk */
+      this->UpdateProgress(static_cast<float>(piece) / static_cast<float>(numDivisions));
+    }
+
+    /* Drain the pipeline */
+    for (; !pendingPieces.empty(); pendingPieces.pop_front())
+    {
+      pendingPieces.front().get();
+    }
+  }
+  catch (...)
+  {
+    /* No reduction may outlive this call */
+    for (auto & pendingPiece : pendingPieces)
+    {
+      if (pendingPiece.valid())
+      {
+        pendingPiece.wait();
+      }
+    }
+    this->m_Updating = false;
+    throw;
+  }
 
-    /* Update progress and stream another chunk */
-    this->UpdateProgress(static_cast<float>(piece) / static_cast<float>(numDivisions));
+  /** Pass the input through without a copy */
+  if (m_OutputMode == OutputModeEnum::GraftInput)
+  {
+    outputPtr->Graft(inputPtr);
   }
 
   // Call a method that can be overridden by a subclass to perform
@@ -157,6 +256,119 @@ EigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::UpdateOutput
   this->m_Updating = false;
 }
 
+template <typename TInputImage, typename TOutputImage>
+template <typename TVisitor>
+void
+EigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::VisitPixelsInMask(
+  const InputImageType *       input,
+  const InputImageRegionType & region,
+  TVisitor                     visitor) const
+{
+  const MaskSpatialObjectType * maskPointer = this->GetMask();
+  const MaskRunsType *          maskRuns = this->GetMaskRuns();
+
+  if (maskRuns || !maskPointer)
+  {
+    /* Walk the scanlines, only through the runs inside of the mask if there is one */
+    ImageScanlineConstIterator<TInputImage> inputIt(input, region);
+    const SizeValueType                     lineLength = region.GetSize(0);
+    while (!inputIt.IsAtEnd())
+    {
+      const InputImagePixelType * in = &(inputIt.Value());
+      if (maskRuns)
+      {
+        const IndexValueType lineFirst = inputIt.GetIndex()[0];
+        maskRuns->VisitRuns(inputIt.GetIndex(), lineLength, [&](IndexValueType start, SizeValueType length) {
+          const InputImagePixelType * run = in + (start - lineFirst);
+          for (SizeValueType x = 0; x < length; ++x)
+          {
+            visitor(run[x]);
+          }
+        });
+      }
+      else
+      {
+        for (SizeValueType x = 0; x < lineLength; ++x)
+        {
+          visitor(in[x]);
+        }
+      }
+      inputIt.NextLine();
+    }
+    return;
+  }
+
+  /* Test every pixel against the spatial object */
+  typename InputImageType::PointType             point;
+  ImageRegionConstIteratorWithIndex<TInputImage> inputIt(input, region);
+  for (; !inputIt.IsAtEnd(); ++inputIt)
+  {
+    input->TransformIndexToPhysicalPoint(inputIt.GetIndex(), point);
+    if (maskPointer->IsInsideInObjectSpace(point))
+    {
+      visitor(inputIt.Get());
+    }
+  }
+}
+
+template <typename TInputImage, typename TOutputImage>
+SizeValueType
+EigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::GetNumberOfLineSlots() const
+{
+  SizeValueType numberOfLines = (m_ReductionRegion.GetSize(0) > 0) ? 1 : 0;
+  for (unsigned int d = 1; d < ImageDimension; ++d)
+  {
+    numberOfLines *= m_ReductionRegion.GetSize(d);
+  }
+  return numberOfLines;
+}
+
+template <typename TInputImage, typename TOutputImage>
+template <typename TLineVisitor>
+void
+EigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::ParallelizeLines(
+  MultiThreaderBase *          multiThreader,
+  const InputImageRegionType & region,
+  TLineVisitor                 visitor)
+{
+  /* The sampled positions of region along every direction but the first, on the grid of the whole region */
+  const InputImageRegionType reductionRegion = m_ReductionRegion;
+  const auto                 samplingStride = static_cast<IndexValueType>(m_SamplingStride);
+  IndexValueType             firstSample[ImageDimension];
+  SizeValueType              numberOfSamples[ImageDimension];
+  SizeValueType              numberOfLines = (region.GetSize(0) > 0) ? 1 : 0;
+  for (unsigned int d = 1; d < ImageDimension; ++d)
+  {
+    const IndexValueType offset = region.GetIndex(d) - reductionRegion.GetIndex(d);
+    const IndexValueType end = offset + static_cast<IndexValueType>(region.GetSize(d));
+    firstSample[d] = ((offset + samplingStride - 1) / samplingStride) * samplingStride;
+    numberOfSamples[d] = (end > firstSample[d]) ? static_cast<SizeValueType>(
+                                                    (end - firstSample[d] + samplingStride - 1) / samplingStride)
+                                                : 0;
+    numberOfLines *= numberOfSamples[d];
+  }
+
+  auto visitLine = [&](SizeValueType line) {
+    /* The scanline of region and its position in the whole region */
+    InputImageRegionType lineRegion = region;
+    SizeValueType        remainder = line;
+    SizeValueType        slot = 0;
+    SizeValueType        stride = 1;
+    for (unsigned int d = 1; d < ImageDimension; ++d)
+    {
+      const IndexValueType index = reductionRegion.GetIndex(d) + firstSample[d] +
+                                   static_cast<IndexValueType>(remainder % numberOfSamples[d]) * samplingStride;
+      remainder /= numberOfSamples[d];
+      lineRegion.SetIndex(d, index);
+      lineRegion.SetSize(d, 1);
+      slot += static_cast<SizeValueType>(index - reductionRegion.GetIndex(d)) * stride;
+      stride *= reductionRegion.GetSize(d);
+    }
+    visitor(lineRegion, slot);
+  };
+  multiThreader->ParallelizeArray(0, numberOfLines, visitLine, nullptr);
+}
+
 template <typename TInputImage, typename TOutputImage>
 typename EigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::ParameterDecoratedType *
 EigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::GetParametersOutput()
@@ -176,6 +388,9 @@ void
 EigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::PrintSelf(std::ostream & os, Indent indent) const
 {
   Superclass::PrintSelf(os, indent);
+  os << indent << "OutputMode: " << static_cast<int>(m_OutputMode) << std::endl;
+  os << indent << "NumberOfPiecesInFlight: " << m_NumberOfPiecesInFlight << std::endl;
+  os << indent << "SamplingStride: " << m_SamplingStride << std::endl;
 }
 
 } // end namespace itk
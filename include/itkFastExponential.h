@@ -0,0 +1,106 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkFastExponential_h
+#define itkFastExponential_h
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace itk
+{
+namespace Functor
+{
+/** \class FastExponential
+ * \brief Single precision exponential without branches.
+ *
+ * Computes exp(x) by writing x = n log(2) + g with |g| <= log(2)/2, evaluating a degree six
+ * polynomial for exp(g) and building 2^n directly in the exponent bits. The coefficients are
+ * the ones of the Cephes expf routine and the relative error is below 2e-7. Results smaller
+ * than about 1e-38 are flushed to zero and results larger than about 3e38 are infinite.
+ *
+ * The range checks are done with integer masks instead of comparisons and branches. With
+ * the default floating point flags compilers will not if-convert floating point arithmetic,
+ * so this is what allows a loop of calls to be vectorized.
+ *
+ * \author: Bryce Besler
+ * \ingroup BoneEnhancement
+ */
+struct FastExponential
+{
+  inline float
+  operator()(float x) const
+  {
+    /* n = floor(x / log(2) + 1/2), kept inside [-150, 150] so the conversion to int is defined */
+    const float        t = Select(x * 1.44269504088896341f + 0.5f, -150.0f, 150.0f);
+    const auto         truncated = static_cast<std::int32_t>(t);
+    const std::int32_t unbounded = truncated - static_cast<std::int32_t>(t < static_cast<float>(truncated));
+    const std::int32_t k = std::min(std::max(unbounded, -126), 127);
+    const auto         n = static_cast<float>(k);
+
+    /* x = n log(2) + g, with log(2) split in two for accuracy */
+    const float g = (x - n * 0.693359375f) + n * 2.12194440e-4f;
+
+    /* exp(g) on [-log(2)/2, log(2)/2] */
+    float p = 1.9875691500e-4f;
+    p = p * g + 1.3981999507e-3f;
+    p = p * g + 8.3334519073e-3f;
+    p = p * g + 4.1665795894e-2f;
+    p = p * g + 1.6666665459e-1f;
+    p = p * g + 5.0000001201e-1f;
+    p = p * g * g + g + 1.0f;
+
+    /* exp(g) 2^n, or zero and infinity outside of the range */
+    const std::int32_t underflow = -static_cast<std::int32_t>(unbounded < -126);
+    const std::int32_t overflow = -static_cast<std::int32_t>(unbounded > 127);
+    const std::int32_t bits = AsBits(p * AsFloat((k + 127) << 23));
+    return AsFloat((bits & ~(underflow | overflow)) | (AsBits(std::numeric_limits<float>::infinity()) & overflow));
+  }
+
+private:
+  /** Clamp value to [lower, upper] by masking the bits. NaN goes to upper. */
+  static inline float
+  Select(float value, float lower, float upper)
+  {
+    const std::int32_t below = -static_cast<std::int32_t>(value < lower);
+    const std::int32_t above = -static_cast<std::int32_t>(!(value <= upper));
+    return AsFloat((AsBits(value) & ~(below | above)) | (AsBits(lower) & below) | (AsBits(upper) & above));
+  }
+
+  static inline std::int32_t
+  AsBits(float value)
+  {
+    std::int32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  }
+
+  static inline float
+  AsFloat(std::int32_t bits)
+  {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+};
+} // namespace Functor
+} // end namespace itk
+
+#endif // itkFastExponential_h
@@ -0,0 +1,178 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkGaussianKernelBank_h
+#define itkGaussianKernelBank_h
+
+#include "itkGaussianDerivativeOperator.h"
+#include "itkGaussianOperator.h"
+#include "itkIntTypes.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+namespace itk
+{
+/** \class GaussianKernelBank
+ * \brief Process wide cache of the coefficients of one dimensional Gaussian kernels.
+ *
+ * Building a GaussianOperator or a GaussianDerivativeOperator evaluates modified Bessel functions for
+ * every coefficient, and a pipeline asks for the same kernels again and again: once for the radius of
+ * the requested region, once per component of the hessian and once per update. The bank builds each
+ * kernel once, the first time it is asked for, and returns the same coefficients for every later
+ * request with the same parameters. The coefficients are those of the operator with TCoefficient
+ * values, so filters using the bank compute exactly what they computed with their own operators.
+ *
+ * Kernels are shared and never modified. GetInstance( ) is safe to call from any thread and the bank
+ * can be used by many threads at once. Entries live until Clear( ), so a process visiting very many
+ * distinct sigma values should clear the bank from time to time.
+ *
+ * \sa HessianGaussianImageFilter
+ * \sa KrcahPreprocessingImageToImageFilter
+ *
+ * \author: Bryce Besler
+ * \ingroup BoneEnhancement
+ */
+template <typename TCoefficient = double>
+class GaussianKernelBank
+{
+public:
+  using CoefficientType = TCoefficient;
+  using KernelType = std::vector<double>;
+  using KernelPointer = std::shared_ptr<const KernelType>;
+
+  /** The bank of this coefficient type shared by the whole process */
+  static GaussianKernelBank &
+  GetInstance()
+  {
+    static GaussianKernelBank bank;
+    return bank;
+  }
+
+  /** Coefficients of the GaussianDerivativeOperator of the given order. The variance is measured in the units
+   * of the spacing, as in GaussianDerivativeOperator::SetVariance( ). */
+  KernelPointer
+  GetDerivativeKernel(unsigned int order,
+                      double       variance,
+                      double       spacing,
+                      double       maximumError,
+                      unsigned int maximumKernelWidth,
+                      bool         normalizeAcrossScale)
+  {
+    const KeyType key{ true, order, variance, spacing, maximumError, maximumKernelWidth, normalizeAcrossScale };
+    return this->FindOrBuild(key, [&key]() {
+      GaussianDerivativeOperator<CoefficientType, 1> oper;
+      oper.SetDirection(0);
+      oper.SetOrder(key.Order);
+      oper.SetSpacing(key.Spacing);
+      oper.SetVariance(key.Variance);
+      oper.SetMaximumError(key.MaximumError);
+      oper.SetMaximumKernelWidth(key.MaximumKernelWidth);
+      oper.SetNormalizeAcrossScale(key.NormalizeAcrossScale);
+      oper.CreateDirectional();
+      return KernelType(oper.Begin(), oper.End());
+    });
+  }
+
+  /** Coefficients of the GaussianOperator. The variance is measured in pixels. */
+  KernelPointer
+  GetGaussianKernel(double variance, double maximumError, unsigned int maximumKernelWidth)
+  {
+    const KeyType key{ false, 0, variance, 1.0, maximumError, maximumKernelWidth, false };
+    return this->FindOrBuild(key, [&key]() {
+      GaussianOperator<CoefficientType, 1> oper;
+      oper.SetDirection(0);
+      oper.SetVariance(key.Variance);
+      oper.SetMaximumError(key.MaximumError);
+      oper.SetMaximumKernelWidth(key.MaximumKernelWidth);
+      oper.CreateDirectional();
+      return KernelType(oper.Begin(), oper.End());
+    });
+  }
+
+  /** Number of kernels held */
+  SizeValueType
+  GetNumberOfKernels() const
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Kernels.size();
+  }
+
+  /** Forget every kernel. Kernels already handed out stay valid. */
+  void
+  Clear()
+  {
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    m_Kernels.clear();
+  }
+
+private:
+  GaussianKernelBank() = default;
+
+  struct KeyType
+  {
+    bool         Derivative;
+    unsigned int Order;
+    double       Variance;
+    double       Spacing;
+    double       MaximumError;
+    unsigned int MaximumKernelWidth;
+    bool         NormalizeAcrossScale;
+
+    bool
+    operator<(const KeyType & other) const
+    {
+      return std::tie(Derivative, Order, Variance, Spacing, MaximumError, MaximumKernelWidth, NormalizeAcrossScale) <
+             std::tie(other.Derivative,
+                      other.Order,
+                      other.Variance,
+                      other.Spacing,
+                      other.MaximumError,
+                      other.MaximumKernelWidth,
+                      other.NormalizeAcrossScale);
+    }
+  };
+
+  /** The kernel of key, built without holding the lock the first time. When two threads build the same
+   * kernel at once the first one inserted is kept, so every caller gets the same coefficients. */
+  template <typename TBuild>
+  KernelPointer
+  FindOrBuild(const KeyType & key, TBuild build)
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_Mutex);
+      const auto                  found = m_Kernels.find(key);
+      if (found != m_Kernels.end())
+      {
+        return found->second;
+      }
+    }
+
+    const KernelPointer         kernel = std::make_shared<const KernelType>(build());
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return m_Kernels.emplace(key, kernel).first->second;
+  }
+
+  mutable std::mutex               m_Mutex;
+  std::map<KeyType, KernelPointer> m_Kernels;
+};
+} // end namespace itk
+
+#endif // itkGaussianKernelBank_h
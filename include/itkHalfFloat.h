@@ -0,0 +1,276 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkHalfFloat_h
+#define itkHalfFloat_h
+
+#include "itkFixedArray.h"
+#include "itkNumericTraits.h"
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <ostream>
+
+namespace itk
+{
+/** \class HalfFloat
+ * \brief An IEEE 754 binary16 number used to store intermediate images.
+ *
+ * HalfFloat only stores values. Reading one converts it to float, so all arithmetic is done in
+ * single precision by the built in operators, and assigning a float or double rounds to the nearest
+ * binary16 number with ties to even. Numbers of magnitude 65520 and larger become infinite and
+ * numbers smaller than about 6e-8 become zero. The relative rounding error is at most 2^-11.
+ *
+ * Images of SymmetricSecondRankTensor< HalfFloat > or Vector< HalfFloat > take a quarter of the
+ * memory of their double counterparts, which is what MultiScaleHessianEnhancementImageFilter uses
+ * them for.
+ *
+ * \sa MultiScaleHessianEnhancementImageFilter
+ *
+ * \author: Bryce Besler
+ * \ingroup BoneEnhancement
+ */
+class HalfFloat
+{
+public:
+  HalfFloat() = default;
+
+  HalfFloat(float value)
+    : m_Bits(FromFloat(value))
+  {}
+
+  operator float() const { return ToFloat(m_Bits); }
+
+  /** The stored binary16 encoding. */
+  std::uint16_t
+  GetBits() const
+  {
+    return m_Bits;
+  }
+  static HalfFloat
+  FromBits(std::uint16_t bits)
+  {
+    HalfFloat value;
+    value.m_Bits = bits;
+    return value;
+  }
+
+  /** Round to the nearest binary16 number, ties to even. */
+  static inline std::uint16_t
+  FromFloat(float value)
+  {
+    std::uint32_t       bits = AsBits(value);
+    const std::uint32_t sign = (bits >> 16) & 0x8000u;
+    bits &= 0x7fffffffu;
+
+    std::uint32_t half;
+    if (bits >= 0x47800000u)
+    {
+      /* Overflow goes to infinity and NaN stays a quiet NaN */
+      half = (bits > 0x7f800000u) ? 0x7e00u : 0x7c00u;
+    }
+    else if (bits < 0x38800000u)
+    {
+      /* Subnormal, adding 0.5 lines the mantissa up with the binary16 one and rounds it */
+      half = AsBits(AsFloat(bits) + 0.5f) - 0x3f000000u;
+    }
+    else
+    {
+      /* Rebias the exponent and round the dropped 13 bits to even */
+      const std::uint32_t odd = (bits >> 13) & 1u;
+      half = (bits + 0xc8000fffu + odd) >> 13;
+    }
+    return static_cast<std::uint16_t>(half | sign);
+  }
+
+  /** Exact conversion of a binary16 number to float. */
+  static inline float
+  ToFloat(std::uint16_t half)
+  {
+    const std::uint32_t sign = static_cast<std::uint32_t>(half & 0x8000u) << 16;
+    std::uint32_t       bits = static_cast<std::uint32_t>(half & 0x7fffu) << 13;
+    const std::uint32_t exponent = bits & 0x0f800000u;
+    bits += 0x38000000u;
+    if (exponent == 0x0f800000u)
+    {
+      /* Infinity and NaN */
+      bits += 0x38000000u;
+    }
+    else if (exponent == 0)
+    {
+      /* Zero and subnormal numbers are scaled by the smallest normal binary16 number */
+      bits = AsBits(AsFloat(bits + 0x00800000u) - AsFloat(0x38800000u));
+    }
+    return AsFloat(bits | sign);
+  }
+
+private:
+  static inline std::uint32_t
+  AsBits(float value)
+  {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+  }
+
+  static inline float
+  AsFloat(std::uint32_t bits)
+  {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  std::uint16_t m_Bits{ 0 };
+};
+
+inline std::ostream &
+operator<<(std::ostream & os, const HalfFloat & value)
+{
+  return os << static_cast<float>(value);
+}
+
+/** \class NumericTraits< HalfFloat >
+ * \brief Numeric traits of HalfFloat. Computations are done in float and accumulations in double.
+ * \ingroup BoneEnhancement
+ */
+template <>
+class NumericTraits<HalfFloat>
+{
+public:
+  using ValueType = HalfFloat;
+  using PrintType = float;
+  using AbsType = HalfFloat;
+  using AccumulateType = double;
+  using FloatType = float;
+  using RealType = double;
+  using ScalarRealType = double;
+  using MeasurementVectorType = FixedArray<ValueType, 1>;
+
+  static constexpr bool IsSigned = true;
+  static constexpr bool IsInteger = false;
+  static constexpr bool IsComplex = false;
+
+  static HalfFloat
+  ZeroValue()
+  {
+    return HalfFloat::FromBits(0x0000u);
+  }
+  static HalfFloat
+  OneValue()
+  {
+    return HalfFloat::FromBits(0x3c00u);
+  }
+  static HalfFloat
+  ZeroValue(const HalfFloat &)
+  {
+    return ZeroValue();
+  }
+  static HalfFloat
+  OneValue(const HalfFloat &)
+  {
+    return OneValue();
+  }
+
+  /** Smallest positive normal number, largest finite number and the most negative finite number. */
+  static HalfFloat
+  min()
+  {
+    return HalfFloat::FromBits(0x0400u);
+  }
+  static HalfFloat
+  max()
+  {
+    return HalfFloat::FromBits(0x7bffu);
+  }
+  static HalfFloat
+  min(const HalfFloat &)
+  {
+    return min();
+  }
+  static HalfFloat
+  max(const HalfFloat &)
+  {
+    return max();
+  }
+  static HalfFloat
+  NonpositiveMin()
+  {
+    return HalfFloat::FromBits(0xfbffu);
+  }
+  static HalfFloat
+  NonpositiveMin(const HalfFloat &)
+  {
+    return NonpositiveMin();
+  }
+  static HalfFloat
+  epsilon()
+  {
+    return HalfFloat::FromBits(0x1400u);
+  }
+
+  static bool
+  IsPositive(HalfFloat value)
+  {
+    return static_cast<float>(value) > 0.0f;
+  }
+  static bool
+  IsNonpositive(HalfFloat value)
+  {
+    return static_cast<float>(value) <= 0.0f;
+  }
+  static bool
+  IsNegative(HalfFloat value)
+  {
+    return static_cast<float>(value) < 0.0f;
+  }
+  static bool
+  IsNonnegative(HalfFloat value)
+  {
+    return static_cast<float>(value) >= 0.0f;
+  }
+
+  static unsigned int
+  GetLength(const HalfFloat &)
+  {
+    return 1;
+  }
+  static unsigned int
+  GetLength()
+  {
+    return 1;
+  }
+  static void
+  SetLength(HalfFloat & value, const unsigned int length)
+  {
+    if (length != 1)
+    {
+      itkGenericExceptionMacro(<< "Cannot set the size of a scalar to " << length);
+    }
+    value = ZeroValue();
+  }
+  template <typename TArray>
+  static void
+  AssignToArray(const HalfFloat & value, TArray & array)
+  {
+    array[0] = value;
+  }
+};
+} // end namespace itk
+
+#endif // itkHalfFloat_h
@@ -20,7 +20,13 @@
 #define itkHessianGaussianImageFilter_h
 
 #include "itkDiscreteGaussianDerivativeImageFilter.h"
+#include "itkHessianRecursiveGaussianImageFilter.h"
+#include "itkRealToHalfHermitianForwardFFTImageFilter.h"
+#include "itkHalfHermitianToRealInverseFFTImageFilter.h"
+#include "itkGaussianDerivativeOperator.h"
+#include "itkGaussianKernelBank.h"
 #include "itkNthElementImageAdaptor.h"
+#include "itkSeparableConvolutionAlgorithm.h"
 #include "itkImage.h"
 #include "itkSymmetricSecondRankTensor.h"
 #include "itkPixelTraits.h"
@@ -40,7 +46,51 @@ namespace itk
  * This class is an exact copy of HessianRecursiveGaussianImageFilter
  * but with streaming.
  *
+ * Two ways of computing the components are available through
+ * SetHessianComputation( ). IndependentComponents runs a
+ * DiscreteGaussianDerivativeImageFilter for each of the D(D+1)/2 components,
+ * convolving the input along every axis each time. SharedSeparablePasses
+ * computes every distinct partial convolution once and reuses it for all the
+ * components sharing it. For instance, the smoothing, first derivative and
+ * second derivative along axis 0 are computed once and reused for Ixx, Ixy
+ * and Ixz. The last pass writes directly into the output tensor. In 3D this
+ * is 15 one dimensional convolutions instead of 18, the first three of which
+ * read the input directly, and no scalar derivative image is copied through
+ * an adaptor. At most one intermediate image per axis is alive at a time.
+ *
+ * RecursiveGaussian runs HessianRecursiveGaussianImageFilter instead. Its
+ * Deriche IIR filters cost the same per pixel whatever sigma is, so they pay
+ * off for sigmas of several pixels. They are less accurate than the kernels
+ * above for sigmas near a pixel, and they need whole lines of the input, so
+ * the whole input is requested and the whole output is computed.
+ *
+ * FourierTransform multiplies the spectrum of the input by the analytic
+ * spectra of the derivatives of the Gaussian and runs one inverse transform
+ * per component. The cost does not depend on sigma either, and the spectrum
+ * can be kept with CacheInputSpectrumOn( ) and reused by later updates with
+ * another sigma. The input is padded by the radius of the discrete kernels
+ * with the zero flux Neumann boundary condition, and up to a size the FFT
+ * implementation supports, so the transform does not wrap around. The
+ * derivatives are exact for the continuous Gaussian instead of the sampled
+ * kernels, which differ by a few percent for sigmas of about a pixel.
+ *
+ * If the input has already been smoothed by a Gaussian, SetInputSigma( ) tells the
+ * filter so. By the semigroup property G(sigma) = G(inputSigma) * G(sqrt(sigma^2 - inputSigma^2)),
+ * so only the residual sigma is convolved with, using much smaller kernels. With
+ * NormalizeAcrossScaleOn( ) the components are still normalized at sigma. The input
+ * sigma must be smaller than sigma.
+ *
+ * SetUnsharpMaskScalingConstant( ) computes the Hessian of the unsharp masked input
+ * I + k (I - G(sigmaP) * I) of KrcahPreprocessingImageToImageFilter without computing
+ * that image. The convolutions are linear, so this is (1 + k) D * G(sigma) * I minus
+ * k D * G(sqrt(sigma^2 + sigmaP^2)) * I, where sigmaP is set with SetUnsharpMaskSigma( ).
+ * SharedSeparablePasses runs its passes once per Gaussian and adds the second run into
+ * the output. FourierTransform multiplies the spectrum by the difference of the two
+ * Gaussians. IndependentComponents and RecursiveGaussian have no such combination and
+ * use SharedSeparablePasses instead while the constant is not zero.
+ *
  * \sa HessianRecursiveGaussianImageFilter.
+ * \sa GaussianKernelBank
  *
  * \author: Bryce Besler
  * \ingroup BoneEnhancement
@@ -89,6 +139,15 @@ public:
   /**  Pointer to a gaussian filter.  */
   using DerivativeFilterPointer = typename DerivativeFilterType::Pointer;
 
+  /**  Recursive filter used by the RecursiveGaussian computation */
+  using RecursiveFilterType = HessianRecursiveGaussianImageFilter<InputImageType, TOutputImage>;
+  using RecursiveFilterPointer = typename RecursiveFilterType::Pointer;
+
+  /**  Transforms used by the FourierTransform computation */
+  using ComplexImageType = Image<std::complex<InternalRealType>, TInputImage::ImageDimension>;
+  using ForwardFFTFilterType = RealToHalfHermitianForwardFFTImageFilter<RealImageType, ComplexImageType>;
+  using InverseFFTFilterType = HalfHermitianToRealInverseFFTImageFilter<ComplexImageType, RealImageType>;
+
   /**  Pointer to the Output Image */
   using OutputImagePointer = typename TOutputImage::Pointer;
 
@@ -96,6 +155,29 @@ public:
   using OutputImageType = TOutputImage;
   using OutputPixelType = typename OutputImageType::PixelType;
   using OutputComponentType = typename PixelTraits<OutputPixelType>::ValueType;
+  using OutputImageRegionType = typename OutputImageType::RegionType;
+
+  /** Geometry typedefs */
+  using InputImageRegionType = typename TInputImage::RegionType;
+  using SizeType = typename TInputImage::SizeType;
+  using SpacingType = typename TInputImage::SpacingType;
+
+  /** One dimensional kernels */
+  using OperatorType = GaussianDerivativeOperator<InternalRealType, ImageDimension>;
+  using KernelType = SeparableConvolutionAlgorithm::KernelType;
+  using KernelBankType = GaussianKernelBank<InternalRealType>;
+
+  /**\class HessianComputationEnum
+   * Selects how the components of the Hessian are computed.
+   * \ingroup BoneEnhancement
+   */
+  enum class HessianComputationEnum : uint8_t
+  {
+    IndependentComponents = 1,
+    SharedSeparablePasses,
+    RecursiveGaussian,
+    FourierTransform
+  };
 
   /** Run-time type information (and related methods). */
   itkTypeMacro(HessianGaussianImageFilter, ImageToImageFilter);
@@ -109,6 +191,11 @@ public:
   RealType
   GetSigma() const;
 
+  /** Set/Get the sigma of the Gaussian the input has already been smoothed with. Sigma is measured
+   * in the units of image spacing. Default is 0, the input is not smoothed. */
+  itkSetMacro(InputSigma, RealType);
+  itkGetConstMacro(InputSigma, RealType);
+
   /** Define which normalization factor will be used for the Gaussian
    *  \sa  DiscreteGaussianDerivativeImageFilter::SetNormalizeAcrossScale
    */
@@ -118,6 +205,47 @@ public:
   GetNormalizeAcrossScale() const;
   itkBooleanMacro(NormalizeAcrossScale);
 
+  /** Set/Get how the components are computed. Default is IndependentComponents. */
+  itkSetEnumMacro(HessianComputation, HessianComputationEnum);
+  itkGetEnumMacro(HessianComputation, HessianComputationEnum);
+
+  /** Set/Get whether the FourierTransform computation keeps the spectrum of the input for the next
+   * update. It is reused as long as the input, the requested region and the padding do not change.
+   * Default is off. */
+  itkSetMacro(CacheInputSpectrum, bool);
+  itkGetConstMacro(CacheInputSpectrum, bool);
+  itkBooleanMacro(CacheInputSpectrum);
+
+  /** Set/Get the sigma the input is padded for before its transform when larger than Sigma. Setting
+   * it to the largest of the sigmas about to be computed lets all of them share one cached spectrum.
+   * Default is 0. */
+  itkSetMacro(SpectrumPaddingSigma, RealType);
+  itkGetConstMacro(SpectrumPaddingSigma, RealType);
+
+  /** Set/Get the sigma of the Gaussian subtracted by the unsharp mask. Sigma is measured in the units
+   * of image spacing. Default is 1. */
+  itkSetMacro(UnsharpMaskSigma, RealType);
+  itkGetConstMacro(UnsharpMaskSigma, RealType);
+
+  /** Set/Get the constant k of the unsharp mask I + k (I - G * I) applied to the input before the
+   * derivatives. Default is 0, the input is not masked. */
+  itkSetMacro(UnsharpMaskScalingConstant, RealType);
+  itkGetConstMacro(UnsharpMaskScalingConstant, RealType);
+
+  /** Release the cached spectrum of the input */
+  void
+  ReleaseInputSpectrum();
+
+  /** Radius of the widest kernel (smoothing, first or second derivative) used
+   * at sigma along each axis of an image with the given spacing. */
+  SizeType
+  ComputeKernelRadius(RealType sigma, const SpacingType & spacing) const;
+
+  /** Coefficients of the kernel of the given order at sigma along direction of an image with the
+   * given spacing. Order zero is the smoothing kernel used by this filter. */
+  KernelType
+  ComputeKernel(unsigned int direction, unsigned int order, RealType sigma, const SpacingType & spacing) const;
+
   /** As opposed to HessianRecursiveGaussianImageFilter, HessianGaussianImageFilter
    * doe not need all of the input to produce an output. However, it does need to
    * expand the InputRequestedRegion region to account for the support of the
@@ -144,10 +272,97 @@ protected:
   void
   GenerateData() override;
 
+  /** Compute each component with its own DiscreteGaussianDerivativeImageFilter */
+  void
+  GenerateDataWithIndependentComponents();
+
+  /** Compute the components sharing the one dimensional passes */
+  void
+  GenerateDataWithSharedSeparablePasses();
+
+  /** Compute the components with HessianRecursiveGaussianImageFilter */
+  void
+  GenerateDataWithRecursiveGaussian();
+
+  /** Compute the components from the spectrum of the input */
+  void
+  GenerateDataWithFourierTransform();
+
+  /** Pad the input, transform it and store the spectrum, unless the cached one is for the same region */
+  void
+  ComputeInputSpectrum(const InputImageRegionType & dataRegion, const SizeType & radius);
+
+  /** The kernel of the given order along direction, shared through the kernel bank */
+  typename KernelBankType::KernelPointer
+  FindKernel(unsigned int direction, unsigned int order, double variance, const SpacingType & spacing) const;
+
+  /** Sigma of the kernels actually convolved with, sqrt(sigma^2 - inputSigma^2) */
+  RealType
+  GetResidualSigma() const;
+
+  /** Factor restoring the normalization at sigma when only the residual sigma is convolved with */
+  double
+  GetNormalizationCorrection() const;
+
+  /** Residual sigma of the Gaussian of the unsharp mask, sqrt(sigma^2 + unsharpMaskSigma^2 - inputSigma^2) */
+  RealType
+  GetUnsharpMaskResidualSigma() const;
+
+  /** The computation actually run, SharedSeparablePasses when the requested one cannot apply the unsharp mask */
+  HessianComputationEnum
+  GetEffectiveHessianComputation() const;
+
 private:
+  /** Derivative order along every axis */
+  using OrderArrayType = FixedArray<unsigned int, ImageDimension>;
+
+  /** True if n only has prime factors up to greatestPrimeFactor */
+  static bool
+  HasOnlySmallPrimeFactors(SizeValueType n, SizeValueType greatestPrimeFactor);
+
+  /** True if a component has the given orders along the axes [0, direction] */
+  static bool
+  HasComponentWithPrefix(const OrderArrayType & orders, unsigned int direction);
+
+  /** Convolve image along direction with every order a component needs, recursing
+   * into the next direction or writing into the output at the last one. The components are
+   * multiplied by scale and added to the output when accumulate is true. */
+  template <typename TImage>
+  void
+  ConvolveSharedPasses(const TImage *               image,
+                       unsigned int                 direction,
+                       OrderArrayType &             orders,
+                       const InputImageRegionType & paddedRegion,
+                       SizeValueType &              passes,
+                       SizeValueType                totalPasses,
+                       double                       scale,
+                       bool                         accumulate);
+
   /** Internal filters **/
   DerivativeFilterPointer   m_DerivativeFilter;
   OutputImageAdaptorPointer m_ImageAdaptor;
+  RecursiveFilterPointer    m_RecursiveFilter;
+
+  /** Kernels for the orders 0, 1 and 2 along each axis */
+  KernelType m_Kernels[ImageDimension][3];
+
+  HessianComputationEnum m_HessianComputation{ HessianComputationEnum::IndependentComponents };
+
+  RealType m_Sigma{ 1.0 };
+  RealType m_InputSigma{ 0.0 };
+
+  /** Unsharp mask applied to the input */
+  RealType m_UnsharpMaskSigma{ 1.0 };
+  RealType m_UnsharpMaskScalingConstant{ 0.0 };
+
+  /** Spectrum of the padded input and what it was computed from */
+  bool                               m_CacheInputSpectrum{ false };
+  RealType                           m_SpectrumPaddingSigma{ 0.0 };
+  typename ComplexImageType::Pointer m_InputSpectrum;
+  InputImageRegionType               m_InputSpectrumRegion;
+  const InputImageType *             m_InputSpectrumSource{ nullptr };
+  ModifiedTimeType                   m_InputSpectrumTime{ 0 };
+  bool                               m_InputSpectrumXDimensionIsOdd{ false };
 }; // end class
 } // namespace itk
 
@@ -21,9 +21,15 @@
 
 #include "itkHessianGaussianImageFilter.h"
 #include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionIterator.h"
 #include "itkProgressAccumulator.h"
 #include "itkGaussianDerivativeOperator.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
 #include "itkMath.h"
+#include <algorithm>
+#include <functional>
+#include <vector>
 
 namespace itk
 {
@@ -54,6 +60,7 @@ template <typename TInputImage, typename TOutputImage>
 void
 HessianGaussianImageFilter<TInputImage, TOutputImage>::SetSigma(RealType sigma)
 {
+  m_Sigma = sigma;
   m_DerivativeFilter->SetVariance(sigma * sigma);
 
   this->Modified();
@@ -66,7 +73,53 @@ template <typename TInputImage, typename TOutputImage>
 typename HessianGaussianImageFilter<TInputImage, TOutputImage>::RealType
 HessianGaussianImageFilter<TInputImage, TOutputImage>::GetSigma() const
 {
-  return sqrt(m_DerivativeFilter->GetVariance()[0]);
+  return m_Sigma;
+}
+
+template <typename TInputImage, typename TOutputImage>
+typename HessianGaussianImageFilter<TInputImage, TOutputImage>::RealType
+HessianGaussianImageFilter<TInputImage, TOutputImage>::GetResidualSigma() const
+{
+  if (m_InputSigma < 0.0 || m_InputSigma >= m_Sigma)
+  {
+    itkExceptionMacro(<< "InputSigma must be in [0, Sigma). Given InputSigma " << m_InputSigma << " and Sigma "
+                      << m_Sigma);
+  }
+  return std::sqrt(m_Sigma * m_Sigma - m_InputSigma * m_InputSigma);
+}
+
+template <typename TInputImage, typename TOutputImage>
+double
+HessianGaussianImageFilter<TInputImage, TOutputImage>::GetNormalizationCorrection() const
+{
+  /* Every component is of total order two, so the operators normalized by (residual/spacing)^order
+   * are off by (sigma/residual)^2 whatever the spacing */
+  if (!this->GetNormalizeAcrossScale())
+  {
+    return 1.0;
+  }
+  const RealType residualSigma = this->GetResidualSigma();
+  return (m_Sigma * m_Sigma) / (residualSigma * residualSigma);
+}
+
+template <typename TInputImage, typename TOutputImage>
+typename HessianGaussianImageFilter<TInputImage, TOutputImage>::RealType
+HessianGaussianImageFilter<TInputImage, TOutputImage>::GetUnsharpMaskResidualSigma() const
+{
+  const RealType residualSigma = this->GetResidualSigma();
+  return std::sqrt(residualSigma * residualSigma + m_UnsharpMaskSigma * m_UnsharpMaskSigma);
+}
+
+template <typename TInputImage, typename TOutputImage>
+typename HessianGaussianImageFilter<TInputImage, TOutputImage>::HessianComputationEnum
+HessianGaussianImageFilter<TInputImage, TOutputImage>::GetEffectiveHessianComputation() const
+{
+  if (m_UnsharpMaskScalingConstant != 0.0 && (m_HessianComputation == HessianComputationEnum::IndependentComponents ||
+                                              m_HessianComputation == HessianComputationEnum::RecursiveGaussian))
+  {
+    return HessianComputationEnum::SharedSeparablePasses;
+  }
+  return m_HessianComputation;
 }
 
 /**
@@ -91,6 +144,58 @@ HessianGaussianImageFilter<TInputImage, TOutputImage>::GetNormalizeAcrossScale()
   return m_DerivativeFilter->GetNormalizeAcrossScale();
 }
 
+template <typename TInputImage, typename TOutputImage>
+typename HessianGaussianImageFilter<TInputImage, TOutputImage>::KernelBankType::KernelPointer
+HessianGaussianImageFilter<TInputImage, TOutputImage>::FindKernel(unsigned int        direction,
+                                                                  unsigned int        order,
+                                                                  double              variance,
+                                                                  const SpacingType & spacing) const
+{
+  if (spacing[direction] == 0.0)
+  {
+    itkExceptionMacro(<< "Pixel spacing cannot be zero");
+  }
+
+  // The coefficients of the GaussianDerivativeOperator, built once per process
+  return KernelBankType::GetInstance().GetDerivativeKernel(order,
+                                                           variance,
+                                                           spacing[direction],
+                                                           this->m_DerivativeFilter->GetMaximumError()[direction],
+                                                           this->m_DerivativeFilter->GetMaximumKernelWidth(),
+                                                           this->m_DerivativeFilter->GetNormalizeAcrossScale());
+}
+
+template <typename TInputImage, typename TOutputImage>
+typename HessianGaussianImageFilter<TInputImage, TOutputImage>::SizeType
+HessianGaussianImageFilter<TInputImage, TOutputImage>::ComputeKernelRadius(RealType            sigma,
+                                                                           const SpacingType & spacing) const
+{
+  // The second derivative is usually the widest, but take every order we convolve with.
+  SizeType radius;
+  radius.Fill(0);
+
+  for (unsigned int i = 0; i < ImageDimension; i++)
+  {
+    for (unsigned int order = 0; order <= 2; ++order)
+    {
+      const SizeValueType kernelRadius = this->FindKernel(i, order, sigma * sigma, spacing)->size() / 2;
+      radius[i] = std::max(radius[i], kernelRadius);
+    }
+  }
+
+  return radius;
+}
+
+template <typename TInputImage, typename TOutputImage>
+typename HessianGaussianImageFilter<TInputImage, TOutputImage>::KernelType
+HessianGaussianImageFilter<TInputImage, TOutputImage>::ComputeKernel(unsigned int        direction,
+                                                                     unsigned int        order,
+                                                                     RealType            sigma,
+                                                                     const SpacingType & spacing) const
+{
+  return *this->FindKernel(direction, order, sigma * sigma, spacing);
+}
+
 template <typename TInputImage, typename TOutputImage>
 void
 HessianGaussianImageFilter<TInputImage, TOutputImage>::GenerateInputRequestedRegion()
@@ -107,33 +212,22 @@ HessianGaussianImageFilter<TInputImage, TOutputImage>::GenerateInputRequestedReg
     return;
   }
 
-  // Build an operator so that we can determine the kernel size
-  GaussianDerivativeOperator<InternalRealType, ImageDimension> oper;
-  typename TInputImage::SizeType                               radius;
-
-  for (unsigned int i = 0; i < TInputImage::ImageDimension; i++)
+  /* The recursive filters run along whole lines */
+  const HessianComputationEnum computation = this->GetEffectiveHessianComputation();
+  if (computation == HessianComputationEnum::RecursiveGaussian)
   {
-    // Determine the size of the operator in this dimension.  Note that the
-    // Gaussian is built as a 1D operator in each of the specified directions.
-    oper.SetDirection(i);
-    if (this->GetInput()->GetSpacing()[i] == 0.0)
-    {
-      itkExceptionMacro(<< "Pixel spacing cannot be zero");
-    }
-    else
-    {
-      oper.SetSpacing(this->GetInput()->GetSpacing()[i]);
-    }
-
-    // GaussianDerivativeOperator modifies the variance when setting image
-    // spacing
-    oper.SetVariance(this->m_DerivativeFilter->GetVariance()[i]);
-    oper.SetMaximumError(this->m_DerivativeFilter->GetMaximumError()[i]);
-    oper.SetMaximumKernelWidth(this->m_DerivativeFilter->GetMaximumKernelWidth());
-    oper.CreateDirectional();
+    inputPtr->SetRequestedRegionToLargestPossibleRegion();
+    return;
+  }
 
-    radius[i] = oper.GetRadius(i);
+  /* The transform is padded for the spectrum padding sigma too, the unsharp mask widens the kernels */
+  RealType radiusSigma =
+    (m_UnsharpMaskScalingConstant != 0.0) ? this->GetUnsharpMaskResidualSigma() : this->GetResidualSigma();
+  if (computation == HessianComputationEnum::FourierTransform)
+  {
+    radiusSigma = std::max(radiusSigma, m_SpectrumPaddingSigma);
   }
+  const SizeType radius = this->ComputeKernelRadius(radiusSigma, inputPtr->GetSpacing());
 
   // get a copy of the input requested region (should equal the output
   // requested region)
@@ -172,6 +266,29 @@ HessianGaussianImageFilter<TInputImage, TOutputImage>::GenerateInputRequestedReg
 template <typename TInputImage, typename TOutputImage>
 void
 HessianGaussianImageFilter<TInputImage, TOutputImage>::GenerateData()
+{
+  switch (this->GetEffectiveHessianComputation())
+  {
+    case HessianComputationEnum::IndependentComponents:
+      this->GenerateDataWithIndependentComponents();
+      break;
+    case HessianComputationEnum::SharedSeparablePasses:
+      this->GenerateDataWithSharedSeparablePasses();
+      break;
+    case HessianComputationEnum::RecursiveGaussian:
+      this->GenerateDataWithRecursiveGaussian();
+      break;
+    case HessianComputationEnum::FourierTransform:
+      this->GenerateDataWithFourierTransform();
+      break;
+    default:
+      itkExceptionMacro(<< "Have bad HessianComputation enumeration " << static_cast<int>(m_HessianComputation));
+  }
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+HessianGaussianImageFilter<TInputImage, TOutputImage>::GenerateDataWithIndependentComponents()
 {
   itkDebugMacro(<< "HessianGaussianImageFilter generating data ");
 
@@ -190,6 +307,11 @@ HessianGaussianImageFilter<TInputImage, TOutputImage>::GenerateData()
 
   const typename TInputImage::ConstPointer inputImage(this->GetInput());
 
+  /* Only the residual is convolved with when the input is already smoothed */
+  const RealType residualSigma = this->GetResidualSigma();
+  const double   correction = this->GetNormalizationCorrection();
+  m_DerivativeFilter->SetVariance(residualSigma * residualSigma);
+
   // Setup Image Adaptor
   m_ImageAdaptor->SetImage(this->GetOutput());
 
@@ -239,7 +361,7 @@ HessianGaussianImageFilter<TInputImage, TOutputImage>::GenerateData()
       const RealType spacingA = inputImage->GetSpacing()[dima];
       const RealType spacingB = inputImage->GetSpacing()[dimb];
 
-      const RealType factor = spacingA * spacingB;
+      const RealType factor = spacingA * spacingB / correction;
 
       it.GoToBegin();
       ot.GoToBegin();
@@ -255,12 +377,528 @@ HessianGaussianImageFilter<TInputImage, TOutputImage>::GenerateData()
   }
 }
 
+template <typename TInputImage, typename TOutputImage>
+void
+HessianGaussianImageFilter<TInputImage, TOutputImage>::GenerateDataWithSharedSeparablePasses()
+{
+  itkDebugMacro(<< "HessianGaussianImageFilter generating data with shared separable passes");
+
+  const TInputImage * inputImage = this->GetInput();
+  OutputImageType *   outputImage = this->GetOutput();
+
+  /* Allocate the output, the last pass writes into it */
+  outputImage->SetBufferedRegion(outputImage->GetRequestedRegion());
+  outputImage->Allocate();
+  const OutputImageRegionType outputRegion = outputImage->GetBufferedRegion();
+  if (outputRegion.GetNumberOfPixels() == 0)
+  {
+    return;
+  }
+
+  /* Count passes for progress reporting. Each distinct prefix of orders is a pass. */
+  SizeValueType  totalPasses = 0;
+  OrderArrayType orders;
+  orders.Fill(0);
+  std::function<void(unsigned int)> countPasses = [&](unsigned int direction) {
+    for (unsigned int order = 0; order <= 2; ++order)
+    {
+      orders[direction] = order;
+      if (HasComponentWithPrefix(orders, direction))
+      {
+        ++totalPasses;
+        if (direction + 1 < ImageDimension)
+        {
+          countPasses(direction + 1);
+        }
+      }
+    }
+    orders[direction] = 0;
+  };
+  countPasses(0);
+
+  /* The unsharp mask adds the passes of its wider Gaussian, weighted by -k, to the passes at sigma */
+  const bool         unsharpMask = (m_UnsharpMaskScalingConstant != 0.0);
+  const unsigned int numberOfTerms = unsharpMask ? 2 : 1;
+  const double       correction = this->GetNormalizationCorrection();
+  const double       sigma2 = m_Sigma * m_Sigma;
+  totalPasses *= numberOfTerms;
+
+  SizeValueType passes = 0;
+  this->UpdateProgress(0.0f);
+  const SpacingType spacing = inputImage->GetSpacing();
+  for (unsigned int term = 0; term < numberOfTerms && !this->GetAbortGenerateData(); ++term)
+  {
+    const RealType residualSigma = (term == 0) ? this->GetResidualSigma() : this->GetUnsharpMaskResidualSigma();
+    double         scale = correction;
+    if (unsharpMask)
+    {
+      const double termCorrection = this->GetNormalizeAcrossScale() ? sigma2 / (residualSigma * residualSigma) : 1.0;
+      scale = (term == 0) ? (1.0 + m_UnsharpMaskScalingConstant) * correction
+                          : -m_UnsharpMaskScalingConstant * termCorrection;
+    }
+
+    /* Build one kernel per axis and order */
+    for (unsigned int direction = 0; direction < ImageDimension; ++direction)
+    {
+      for (unsigned int order = 0; order <= 2; ++order)
+      {
+        m_Kernels[direction][order] = this->ComputeKernel(direction, order, residualSigma, spacing);
+      }
+    }
+
+    /* Region of the input we need, the support of the kernels around the output */
+    InputImageRegionType paddedRegion = outputRegion;
+    paddedRegion.PadByRadius(this->ComputeKernelRadius(residualSigma, spacing));
+    paddedRegion.Crop(inputImage->GetBufferedRegion());
+
+    /* Walk the tree of passes depth first, starting from the input */
+    this->ConvolveSharedPasses(inputImage, 0, orders, paddedRegion, passes, totalPasses, scale, term > 0);
+  }
+  this->UpdateProgress(1.0f);
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+HessianGaussianImageFilter<TInputImage, TOutputImage>::GenerateDataWithRecursiveGaussian()
+{
+  itkDebugMacro(<< "HessianGaussianImageFilter generating data with recursive gaussians");
+
+  if (!m_RecursiveFilter)
+  {
+    m_RecursiveFilter = RecursiveFilterType::New();
+  }
+
+  ProgressAccumulator::Pointer progress = ProgressAccumulator::New();
+  progress->SetMiniPipelineFilter(this);
+  progress->RegisterInternalFilter(m_RecursiveFilter, 1.0f);
+
+  /* The recursive filter produces the whole output, which may be more than requested */
+  const double correction = this->GetNormalizationCorrection();
+  m_RecursiveFilter->SetInput(this->GetInput());
+  m_RecursiveFilter->SetSigma(this->GetResidualSigma());
+  m_RecursiveFilter->SetNormalizeAcrossScale(this->GetNormalizeAcrossScale());
+  m_RecursiveFilter->GetOutput()->SetRequestedRegion(this->GetOutput()->GetRequestedRegion());
+  if (correction != 1.0)
+  {
+    // The correction is applied in place, so the output cannot be reused
+    m_RecursiveFilter->Modified();
+  }
+  m_RecursiveFilter->Update();
+  this->GraftOutput(m_RecursiveFilter->GetOutput());
+
+  if (correction != 1.0)
+  {
+    OutputImageType * outputImage = this->GetOutput();
+    this->GetMultiThreader()->template ParallelizeImageRegion<ImageDimension>(
+      outputImage->GetRequestedRegion(),
+      [outputImage, correction](const OutputImageRegionType & region) {
+        ImageRegionIterator<OutputImageType> it(outputImage, region);
+        for (; !it.IsAtEnd(); ++it)
+        {
+          OutputPixelType pixel = it.Get();
+          for (unsigned int i = 0; i < OutputPixelType::Length; ++i)
+          {
+            pixel[i] = static_cast<OutputComponentType>(pixel[i] * correction);
+          }
+          it.Set(pixel);
+        }
+      },
+      nullptr);
+  }
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+HessianGaussianImageFilter<TInputImage, TOutputImage>::GenerateDataWithFourierTransform()
+{
+  itkDebugMacro(<< "HessianGaussianImageFilter generating data with the fourier transform");
+
+  const TInputImage * inputImage = this->GetInput();
+  OutputImageType *   outputImage = this->GetOutput();
+
+  outputImage->SetBufferedRegion(outputImage->GetRequestedRegion());
+  outputImage->Allocate();
+  const OutputImageRegionType outputRegion = outputImage->GetBufferedRegion();
+  if (outputRegion.GetNumberOfPixels() == 0)
+  {
+    return;
+  }
+
+  /* The input the output depends on, padded again before the transform */
+  const SpacingType spacing = inputImage->GetSpacing();
+  const RealType    residualSigma = this->GetResidualSigma();
+  const bool        unsharpMask = (m_UnsharpMaskScalingConstant != 0.0);
+  const RealType    unsharpMaskSigma = unsharpMask ? this->GetUnsharpMaskResidualSigma() : residualSigma;
+  const SizeType    radius = this->ComputeKernelRadius(std::max(unsharpMaskSigma, m_SpectrumPaddingSigma), spacing);
+
+  InputImageRegionType dataRegion = outputRegion;
+  dataRegion.PadByRadius(radius);
+  dataRegion.Crop(inputImage->GetBufferedRegion());
+
+  const unsigned int numberOfComponents = ImageDimension * (ImageDimension + 1) / 2;
+  this->UpdateProgress(0.0f);
+  this->ComputeInputSpectrum(dataRegion, radius);
+  this->UpdateProgress(1.0f / static_cast<float>(numberOfComponents + 1));
+
+  /* Angular frequency and gaussian of every bin along every direction. The first direction only has
+   * the non-negative frequencies of the half hermitian spectrum. */
+  const typename ComplexImageType::RegionType spectrumRegion = m_InputSpectrum->GetLargestPossibleRegion();
+  std::vector<double>                         frequencies[ImageDimension];
+  std::vector<double>                         gaussians[ImageDimension];
+  std::vector<double>                         unsharpMaskGaussians[ImageDimension];
+  for (unsigned int d = 0; d < ImageDimension; ++d)
+  {
+    const auto n = static_cast<OffsetValueType>(m_InputSpectrumRegion.GetSize(d));
+    frequencies[d].resize(spectrumRegion.GetSize(d));
+    gaussians[d].resize(spectrumRegion.GetSize(d));
+    unsharpMaskGaussians[d].resize(spectrumRegion.GetSize(d));
+    for (OffsetValueType k = 0; k < static_cast<OffsetValueType>(spectrumRegion.GetSize(d)); ++k)
+    {
+      const OffsetValueType bin = (k <= n / 2) ? k : k - n;
+      const double          omega = 2.0 * Math::pi * static_cast<double>(bin) / (static_cast<double>(n) * spacing[d]);
+      frequencies[d][k] = omega;
+      gaussians[d][k] = std::exp(-0.5 * residualSigma * residualSigma * omega * omega);
+      unsharpMaskGaussians[d][k] = std::exp(-0.5 * unsharpMaskSigma * unsharpMaskSigma * omega * omega);
+    }
+  }
+  const double normalization = this->GetNormalizeAcrossScale() ? m_Sigma * m_Sigma : 1.0;
+  const double scalingConstant = m_UnsharpMaskScalingConstant;
+
+  /* Where the first pixel of the padded region is in the transforms */
+  const typename ComplexImageType::IndexType spectrumStart = spectrumRegion.GetIndex();
+
+  unsigned int element = 0;
+  for (unsigned int dima = 0; dima < ImageDimension && !this->GetAbortGenerateData(); dima++)
+  {
+    for (unsigned int dimb = dima; dimb < ImageDimension; dimb++, element++)
+    {
+      /* Multiply by the spectrum of the second derivative of the gaussian */
+      typename ComplexImageType::Pointer filtered = ComplexImageType::New();
+      filtered->CopyInformation(m_InputSpectrum);
+      filtered->SetRegions(spectrumRegion);
+      filtered->Allocate();
+
+      const ComplexImageType * spectrum = m_InputSpectrum.GetPointer();
+      ComplexImageType *       filteredPointer = filtered.GetPointer();
+      this->GetMultiThreader()->template ParallelizeImageRegion<ImageDimension>(
+        spectrumRegion,
+        [&, spectrum, filteredPointer](const typename ComplexImageType::RegionType & region) {
+          ImageRegionConstIteratorWithIndex<ComplexImageType> inIt(spectrum, region);
+          ImageRegionIterator<ComplexImageType>               outIt(filteredPointer, region);
+          for (; !inIt.IsAtEnd(); ++inIt, ++outIt)
+          {
+            const typename ComplexImageType::IndexType index = inIt.GetIndex();
+            double                                     gaussian = 1.0;
+            double                                     unsharpMaskGaussian = 1.0;
+            for (unsigned int d = 0; d < ImageDimension; ++d)
+            {
+              gaussian *= gaussians[d][index[d] - spectrumStart[d]];
+              unsharpMaskGaussian *= unsharpMaskGaussians[d][index[d] - spectrumStart[d]];
+            }
+            double weight =
+              -normalization * ((1.0 + scalingConstant) * gaussian - scalingConstant * unsharpMaskGaussian);
+            weight *= frequencies[dima][index[dima] - spectrumStart[dima]];
+            weight *= frequencies[dimb][index[dimb] - spectrumStart[dimb]];
+            outIt.Set(inIt.Get() * static_cast<InternalRealType>(weight));
+          }
+        },
+        nullptr);
+
+      typename InverseFFTFilterType::Pointer inverse = InverseFFTFilterType::New();
+      inverse->SetInput(filtered);
+      inverse->SetActualXDimensionIsOdd(m_InputSpectrumXDimensionIsOdd);
+      inverse->Update();
+      filtered = nullptr;
+
+      /* Copy the component into the output */
+      const RealImageType *                   derivative = inverse->GetOutput();
+      const typename RealImageType::IndexType derivativeStart = derivative->GetLargestPossibleRegion().GetIndex();
+      const InputImageRegionType              paddedRegion = m_InputSpectrumRegion;
+      const unsigned int                      component = element;
+      this->GetMultiThreader()->template ParallelizeImageRegion<ImageDimension>(
+        outputRegion,
+        [outputImage, derivative, derivativeStart, paddedRegion, component](const OutputImageRegionType & region) {
+          typename RealImageType::RegionType derivativeRegion = region;
+          for (unsigned int d = 0; d < ImageDimension; ++d)
+          {
+            derivativeRegion.SetIndex(d, derivativeStart[d] + region.GetIndex(d) - paddedRegion.GetIndex(d));
+          }
+          ImageRegionConstIterator<RealImageType> inIt(derivative, derivativeRegion);
+          ImageRegionIterator<OutputImageType>    outIt(outputImage, region);
+          for (; !inIt.IsAtEnd(); ++inIt, ++outIt)
+          {
+            OutputPixelType & pixel = outIt.Value();
+            pixel[component] = static_cast<OutputComponentType>(inIt.Get());
+          }
+        },
+        nullptr);
+
+      this->UpdateProgress(static_cast<float>(element + 2) / static_cast<float>(numberOfComponents + 1));
+    }
+  }
+
+  if (!m_CacheInputSpectrum)
+  {
+    this->ReleaseInputSpectrum();
+  }
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+HessianGaussianImageFilter<TInputImage, TOutputImage>::ComputeInputSpectrum(const InputImageRegionType & dataRegion,
+                                                                           const SizeType &             radius)
+{
+  const TInputImage * inputImage = this->GetInput();
+
+  /* Pad by the radius, so the transform does not wrap around, and up to a supported size */
+  typename ForwardFFTFilterType::Pointer forward = ForwardFFTFilterType::New();
+  const SizeValueType                    greatestPrimeFactor =
+    std::min(forward->GetSizeGreatestPrimeFactor(), InverseFFTFilterType::New()->GetSizeGreatestPrimeFactor());
+
+  InputImageRegionType paddedRegion = dataRegion;
+  paddedRegion.PadByRadius(radius);
+  for (unsigned int d = 0; d < ImageDimension; ++d)
+  {
+    SizeValueType size = paddedRegion.GetSize(d);
+    while (!HasOnlySmallPrimeFactors(size, greatestPrimeFactor))
+    {
+      ++size;
+    }
+    paddedRegion.SetSize(d, size);
+  }
+
+  /* Reuse the cached spectrum when it was computed from the same data */
+  const ModifiedTimeType inputTime = std::max(inputImage->GetMTime(), inputImage->GetUpdateMTime());
+  if (m_InputSpectrum && m_InputSpectrumSource == inputImage && m_InputSpectrumRegion == paddedRegion &&
+      m_InputSpectrumTime == inputTime)
+  {
+    return;
+  }
+
+  /* Zero flux Neumann padding, the padded image starts at the origin of the index space */
+  typename RealImageType::Pointer    padded = RealImageType::New();
+  typename RealImageType::RegionType paddedImageRegion;
+  paddedImageRegion.SetSize(paddedRegion.GetSize());
+  padded->SetRegions(paddedImageRegion);
+  padded->SetSpacing(inputImage->GetSpacing());
+  padded->Allocate();
+
+  RealImageType * paddedPointer = padded.GetPointer();
+  this->GetMultiThreader()->template ParallelizeImageRegion<ImageDimension>(
+    paddedImageRegion,
+    [inputImage, paddedPointer, &paddedRegion, &dataRegion](const typename RealImageType::RegionType & region) {
+      ImageRegionIteratorWithIndex<RealImageType> it(paddedPointer, region);
+      typename InputImageType::IndexType          index;
+      for (; !it.IsAtEnd(); ++it)
+      {
+        for (unsigned int d = 0; d < ImageDimension; ++d)
+        {
+          const IndexValueType first = dataRegion.GetIndex(d);
+          const IndexValueType last = first + static_cast<IndexValueType>(dataRegion.GetSize(d)) - 1;
+          index[d] = std::min(std::max(paddedRegion.GetIndex(d) + it.GetIndex()[d], first), last);
+        }
+        it.Set(static_cast<InternalRealType>(inputImage->GetPixel(index)));
+      }
+    },
+    nullptr);
+
+  forward->SetInput(padded);
+  forward->Update();
+
+  m_InputSpectrum = forward->GetOutput();
+  m_InputSpectrum->DisconnectPipeline();
+  m_InputSpectrumRegion = paddedRegion;
+  m_InputSpectrumSource = inputImage;
+  m_InputSpectrumTime = inputTime;
+  m_InputSpectrumXDimensionIsOdd = (paddedRegion.GetSize(0) % 2 == 1);
+}
+
+template <typename TInputImage, typename TOutputImage>
+void
+HessianGaussianImageFilter<TInputImage, TOutputImage>::ReleaseInputSpectrum()
+{
+  m_InputSpectrum = nullptr;
+  m_InputSpectrumRegion = InputImageRegionType();
+  m_InputSpectrumSource = nullptr;
+  m_InputSpectrumTime = 0;
+}
+
+template <typename TInputImage, typename TOutputImage>
+bool
+HessianGaussianImageFilter<TInputImage, TOutputImage>::HasOnlySmallPrimeFactors(SizeValueType n,
+                                                                                SizeValueType greatestPrimeFactor)
+{
+  for (SizeValueType factor = 2; factor <= greatestPrimeFactor && n > 1; ++factor)
+  {
+    while (n % factor == 0)
+    {
+      n /= factor;
+    }
+  }
+  return n == 1;
+}
+
+template <typename TInputImage, typename TOutputImage>
+bool
+HessianGaussianImageFilter<TInputImage, TOutputImage>::HasComponentWithPrefix(const OrderArrayType & orders,
+                                                                              unsigned int           direction)
+{
+  for (unsigned int dima = 0; dima < ImageDimension; dima++)
+  {
+    for (unsigned int dimb = dima; dimb < ImageDimension; dimb++)
+    {
+      bool matches = true;
+      for (unsigned int k = 0; k <= direction && matches; ++k)
+      {
+        const unsigned int expected = (k == dima ? 1 : 0) + (k == dimb ? 1 : 0);
+        matches = (orders[k] == expected);
+      }
+      if (matches)
+      {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+template <typename TInputImage, typename TOutputImage>
+template <typename TImage>
+void
+HessianGaussianImageFilter<TInputImage, TOutputImage>::ConvolveSharedPasses(const TImage *               image,
+                                                                            unsigned int                 direction,
+                                                                            OrderArrayType &             orders,
+                                                                            const InputImageRegionType & paddedRegion,
+                                                                            SizeValueType &              passes,
+                                                                            SizeValueType                totalPasses,
+                                                                            double                       scale,
+                                                                            bool                         accumulate)
+{
+  using IndexType = typename TImage::IndexType;
+
+  OutputImageType *           outputImage = this->GetOutput();
+  const OutputImageRegionType outputRegion = outputImage->GetBufferedRegion();
+
+  /* Directions already convolved, and this one, only need to cover the output.
+   * The remaining directions still need the support of their kernels. */
+  InputImageRegionType region = paddedRegion;
+  for (unsigned int k = 0; k <= direction; ++k)
+  {
+    region.SetIndex(k, outputRegion.GetIndex(k));
+    region.SetSize(k, outputRegion.GetSize(k));
+  }
+
+  for (unsigned int order = 0; order <= 2 && !this->GetAbortGenerateData(); ++order)
+  {
+    orders[direction] = order;
+    if (!HasComponentWithPrefix(orders, direction))
+    {
+      continue;
+    }
+
+    if (direction + 1 == ImageDimension)
+    {
+      /* Last pass, find the component and write it into the output */
+      unsigned int element = 0;
+      double       weight = 1.0;
+      bool         found = false;
+      for (unsigned int dima = 0; dima < ImageDimension && !found; dima++)
+      {
+        for (unsigned int dimb = dima; dimb < ImageDimension && !found; dimb++)
+        {
+          found = true;
+          for (unsigned int k = 0; k < ImageDimension && found; ++k)
+          {
+            found = (orders[k] == (k == dima ? 1u : 0u) + (k == dimb ? 1u : 0u));
+          }
+          if (found)
+          {
+            weight = scale / (image->GetSpacing()[dima] * image->GetSpacing()[dimb]);
+          }
+          else
+          {
+            ++element;
+          }
+        }
+      }
+
+      OutputPixelType *     buffer = outputImage->GetBufferPointer();
+      const OffsetValueType stride = outputImage->GetOffsetTable()[direction];
+      SeparableConvolutionAlgorithm::ConvolveLines(
+        image,
+        region,
+        direction,
+        m_Kernels[direction][order],
+        [outputImage, buffer, stride, element, weight, accumulate](
+          const IndexType & lineStart, const double * values, SizeValueType length) {
+          OutputPixelType * pixel = buffer + outputImage->ComputeOffset(lineStart);
+          if (accumulate)
+          {
+            for (SizeValueType i = 0; i < length; ++i, pixel += stride)
+            {
+              (*pixel)[element] = static_cast<OutputComponentType>((*pixel)[element] + values[i] * weight);
+            }
+          }
+          else
+          {
+            for (SizeValueType i = 0; i < length; ++i, pixel += stride)
+            {
+              (*pixel)[element] = static_cast<OutputComponentType>(values[i] * weight);
+            }
+          }
+        },
+        this->GetMultiThreader());
+      ++passes;
+    }
+    else
+    {
+      /* Intermediate pass, shared by every component with this prefix */
+      typename RealImageType::Pointer intermediate = RealImageType::New();
+      intermediate->CopyInformation(image);
+      intermediate->SetRegions(region);
+      intermediate->Allocate();
+
+      InternalRealType *    buffer = intermediate->GetBufferPointer();
+      const OffsetValueType stride = intermediate->GetOffsetTable()[direction];
+      RealImageType *       intermediatePointer = intermediate.GetPointer();
+      SeparableConvolutionAlgorithm::ConvolveLines(
+        image,
+        region,
+        direction,
+        m_Kernels[direction][order],
+        [intermediatePointer, buffer, stride](const IndexType & lineStart, const double * values, SizeValueType length) {
+          InternalRealType * pixel = buffer + intermediatePointer->ComputeOffset(lineStart);
+          for (SizeValueType i = 0; i < length; ++i, pixel += stride)
+          {
+            *pixel = static_cast<InternalRealType>(values[i]);
+          }
+        },
+        this->GetMultiThreader());
+      ++passes;
+      this->UpdateProgress(static_cast<float>(passes) / static_cast<float>(totalPasses));
+
+      /* Descend, the intermediate is released when we return */
+      this->ConvolveSharedPasses(
+        intermediatePointer, direction + 1, orders, paddedRegion, passes, totalPasses, scale, accumulate);
+    }
+    this->UpdateProgress(static_cast<float>(passes) / static_cast<float>(totalPasses));
+  }
+  orders[direction] = 0;
+}
+
 template <typename TInputImage, typename TOutputImage>
 void
 HessianGaussianImageFilter<TInputImage, TOutputImage>::PrintSelf(std::ostream & os, Indent indent) const
 {
   Superclass::PrintSelf(os, indent);
   os << "DerivativeFilter: " << m_DerivativeFilter << std::endl;
+  os << indent << "HessianComputation: " << static_cast<int>(m_HessianComputation) << std::endl;
+  os << indent << "Sigma: " << m_Sigma << std::endl;
+  os << indent << "InputSigma: " << m_InputSigma << std::endl;
+  os << indent << "CacheInputSpectrum: " << m_CacheInputSpectrum << std::endl;
+  os << indent << "SpectrumPaddingSigma: " << m_SpectrumPaddingSigma << std::endl;
+  os << indent << "UnsharpMaskSigma: " << m_UnsharpMaskSigma << std::endl;
+  os << indent << "UnsharpMaskScalingConstant: " << m_UnsharpMaskScalingConstant << std::endl;
 }
 
 } // end namespace itk
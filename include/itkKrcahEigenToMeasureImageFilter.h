@@ -21,9 +21,141 @@
 
 #include "itkEigenToMeasureImageFilter.h"
 #include "itkMath.h"
+#include "itkFastExponential.h"
 
 namespace itk
 {
+namespace Functor
+{
+/** \class KrcahEigenToMeasure
+ * \brief Compute the Krcah et al. sheetness of one eigenvalue triple.
+ *
+ * The parameters are unpacked once on construction so the measure can be inlined
+ * into the loop of KrcahEigenToMeasureImageFilter. See that class for the equation.
+ *
+ * \sa KrcahEigenToMeasureImageFilter
+ *
+ * \author: Bryce Besler
+ * \ingroup BoneEnhancement
+ */
+template <typename TInputPixel, typename TOutputPixel>
+class KrcahEigenToMeasure
+{
+public:
+  KrcahEigenToMeasure() = default;
+
+  KrcahEigenToMeasure(double alpha, double beta, double gamma, double enhanceType)
+    : m_Alpha2(alpha * alpha)
+    , m_Beta2(beta * beta)
+    , m_Gamma2(gamma * gamma)
+    , m_EnhanceType(enhanceType)
+  {}
+
+  ~KrcahEigenToMeasure() = default;
+
+  bool
+  operator!=(const KrcahEigenToMeasure & other) const
+  {
+    return Math::NotExactlyEquals(m_Alpha2, other.m_Alpha2) || Math::NotExactlyEquals(m_Beta2, other.m_Beta2) ||
+           Math::NotExactlyEquals(m_Gamma2, other.m_Gamma2) ||
+           Math::NotExactlyEquals(m_EnhanceType, other.m_EnhanceType);
+  }
+
+  bool
+  operator==(const KrcahEigenToMeasure & other) const
+  {
+    return !(*this != other);
+  }
+
+  inline TOutputPixel
+  operator()(const TInputPixel & pixel) const
+  {
+    /* Grab pixel values */
+    const auto   a1 = static_cast<double>(pixel[0]);
+    const auto   a2 = static_cast<double>(pixel[1]);
+    const auto   a3 = static_cast<double>(pixel[2]);
+    const double l1 = Math::abs(a1);
+    const double l2 = Math::abs(a2);
+    const double l3 = Math::abs(a3);
+
+    /* Avoid divisions by zero (or close to zero) */
+    if (l3 < Math::eps || l2 < Math::eps)
+    {
+      return static_cast<TOutputPixel>(0.0);
+    }
+
+    /**
+     * Compute sheet, noise, and tube like measures. Note that the average trace of the
+     * Hessian matrix is implicitly included in \f$ \gamma \f$ here.
+     */
+    const double Rsheet = l2 / l3;
+    const double Rnoise = (l1 + l2 + l3); // T implicite in m_Gamma
+    const double Rtube = l1 / (l2 * l3);
+
+    /* Multiply together to get sheetness */
+    double sheetness = (m_EnhanceType * a3 / l3);
+    sheetness *= std::exp(-(Rsheet * Rsheet) / m_Alpha2);
+    sheetness *= std::exp(-(Rtube * Rtube) / m_Beta2);
+    sheetness *= (1.0 - std::exp(-(Rnoise * Rnoise) / m_Gamma2));
+
+    return static_cast<TOutputPixel>(sheetness);
+  }
+
+  /** Evaluate the measure over length eigenvalue triples given as three arrays. TReal is the type
+   * of the arithmetic and exponential the function used for exp( ). Triples which would divide by
+   * (almost) zero are computed with a harmless denominator and then replaced by zero with a select,
+   * which never carries a NaN or a negative zero through, so the loop has no branches and can be
+   * vectorized. */
+  template <typename TReal, typename TExponential>
+  void
+  Evaluate(const TReal *        lambda1,
+           const TReal *        lambda2,
+           const TReal *        lambda3,
+           TOutputPixel *       output,
+           SizeValueType        length,
+           const TExponential & exponential) const
+  {
+    const auto  alpha2 = static_cast<TReal>(m_Alpha2);
+    const auto  beta2 = static_cast<TReal>(m_Beta2);
+    const auto  gamma2 = static_cast<TReal>(m_Gamma2);
+    const auto  enhanceType = static_cast<TReal>(m_EnhanceType);
+    const auto  eps = static_cast<TReal>(Math::eps);
+    const TReal one = 1;
+    const TReal zero = 0;
+
+    for (SizeValueType i = 0; i < length; ++i)
+    {
+      const TReal a3 = lambda3[i];
+      const TReal l1 = std::abs(lambda1[i]);
+      const TReal l2 = std::abs(lambda2[i]);
+      const TReal l3 = std::abs(a3);
+
+      /* The triples the scalar path does not return zero for */
+      const bool  valid = !(l3 < eps || l2 < eps);
+      const TReal safeL2 = valid ? l2 : one;
+      const TReal safeL3 = valid ? l3 : one;
+
+      const TReal Rsheet = l2 / safeL3;
+      const TReal Rnoise = (l1 + l2 + l3);
+      const TReal Rtube = l1 / (safeL2 * safeL3);
+
+      TReal sheetness = (enhanceType * a3 / safeL3);
+      sheetness *= exponential(-(Rsheet * Rsheet) / alpha2);
+      sheetness *= exponential(-(Rtube * Rtube) / beta2);
+      sheetness *= (one - exponential(-(Rnoise * Rnoise) / gamma2));
+
+      output[i] = static_cast<TOutputPixel>(valid ? sheetness : zero);
+    }
+  }
+
+private:
+  double m_Alpha2{ 0.25 };
+  double m_Beta2{ 0.25 };
+  double m_Gamma2{ 1.0 };
+  double m_EnhanceType{ -1.0 };
+}; // end of class
+} // namespace Functor
+
 /** \class KrcahEigenToMeasureImageFilter
  * \brief Convert eigenvalues into a measure of sheetness according to the method of Krcah et al.
  *
@@ -41,6 +173,12 @@ namespace itk
  *
  * The scaling by the average trace of the Hessian matrix is implicit in \f$ \gamma \f$.
  *
+ * The measure is evaluated with Functor::KrcahEigenToMeasure, which holds the parameters
+ * unpacked in BeforeThreadedGenerateData( ). With SetMeasurePrecision( FastSinglePrecision ) it is
+ * evaluated in float with Functor::FastExponential. The result is then within 1e-6 (absolute) of the
+ * double precision result.
+ *
+ * \sa Functor::KrcahEigenToMeasure
  * \sa KrcahEigenToMeasureParameterEstimationFilter
  * \sa EigenToMeasureImageFilter
  * \sa MultiScaleHessianEnhancementImageFilter
@@ -78,6 +216,9 @@ public:
   using ParameterArrayType = typename Superclass::ParameterArrayType;
   using ParameterDecoratedType = typename Superclass::ParameterDecoratedType;
 
+  /** Functor typedefs */
+  using FunctorType = Functor::KrcahEigenToMeasure<InputImagePixelType, OutputImagePixelType>;
+
   /** Method for creation through the object factory. */
   itkNewMacro(Self);
 
@@ -119,7 +260,12 @@ protected:
   OutputImagePixelType
   ProcessPixel(const InputImagePixelType & pixel) override;
 
-  /** Check the input has the right number of parameters. */
+  /** Evaluate the functor over each scanline instead of calling ProcessPixel( ), in the
+   * arithmetic selected with SetMeasurePrecision( ). */
+  void
+  GenerateData() override;
+
+  /** Check the input has the right number of parameters and unpack them into the functor. */
   void
   BeforeThreadedGenerateData() override;
 
@@ -128,7 +274,8 @@ protected:
 
 private:
   /* Member variables */
-  RealType m_EnhanceType;
+  RealType    m_EnhanceType;
+  FunctorType m_Functor;
 }; // end class
 } /* end namespace itk */
 
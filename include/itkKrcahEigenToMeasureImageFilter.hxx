@@ -20,8 +20,6 @@
 #define itkKrcahEigenToMeasureImageFilter_hxx
 
 #include "itkKrcahEigenToMeasureImageFilter.h"
-#include "itkImageRegionConstIteratorWithIndex.h"
-#include "itkImageRegionIterator.h"
 
 namespace itk
 {
@@ -40,48 +38,30 @@ KrcahEigenToMeasureImageFilter<TInputImage, TOutputImage>::BeforeThreadedGenerat
   {
     itkExceptionMacro(<< "Parameters must have size 3. Given array of size " << parameters.GetSize());
   }
+
+  /* Unpack the parameters once */
+  m_Functor = FunctorType(parameters[0], parameters[1], parameters[2], m_EnhanceType);
 }
 
 template <typename TInputImage, typename TOutputImage>
-typename KrcahEigenToMeasureImageFilter<TInputImage, TOutputImage>::OutputImagePixelType
-KrcahEigenToMeasureImageFilter<TInputImage, TOutputImage>::ProcessPixel(const InputImagePixelType & pixel)
+void
+KrcahEigenToMeasureImageFilter<TInputImage, TOutputImage>::GenerateData()
 {
-  /* Grab parameters */
-  ParameterArrayType parameters = this->GetParametersInput()->Get();
-  RealType           alpha = parameters[0];
-  RealType           beta = parameters[1];
-  RealType           gamma = parameters[2];
-
-  /* Grab pixel values */
-  double sheetness = 0.0;
-  auto   a1 = static_cast<double>(pixel[0]);
-  auto   a2 = static_cast<double>(pixel[1]);
-  auto   a3 = static_cast<double>(pixel[2]);
-  double l1 = Math::abs(a1);
-  double l2 = Math::abs(a2);
-  double l3 = Math::abs(a3);
-
-  /* Avoid divisions by zero (or close to zero) */
-  if (static_cast<double>(l3) < Math::eps || static_cast<double>(l2) < Math::eps)
+  if (this->GetMeasurePrecision() == Superclass::MeasurePrecisionEnum::FastSinglePrecision)
   {
-    return static_cast<OutputImagePixelType>(sheetness);
+    this->template GenerateDataUsingBatchFunctor<float>(m_Functor, Functor::FastExponential());
   }
+  else
+  {
+    this->template GenerateDataUsingBatchFunctor<double>(m_Functor, [](double x) { return std::exp(x); });
+  }
+}
 
-  /**
-   * Compute sheet, noise, and tube like measures. Note that the average trace of the
-   * Hessian matrix is implicitly included in \f$ \gamma \f$ here.
-   */
-  const double Rsheet = l2 / l3;
-  const double Rnoise = (l1 + l2 + l3); // T implicite in m_Gamma
-  const double Rtube = l1 / (l2 * l3);
-
-  /* Multiply together to get sheetness */
-  sheetness = (m_EnhanceType * a3 / l3);
-  sheetness *= std::exp(-(Rsheet * Rsheet) / (alpha * alpha));
-  sheetness *= std::exp(-(Rtube * Rtube) / (beta * beta));
-  sheetness *= (1.0 - std::exp(-(Rnoise * Rnoise) / (gamma * gamma)));
-
-  return static_cast<OutputImagePixelType>(sheetness);
+template <typename TInputImage, typename TOutputImage>
+typename KrcahEigenToMeasureImageFilter<TInputImage, TOutputImage>::OutputImagePixelType
+KrcahEigenToMeasureImageFilter<TInputImage, TOutputImage>::ProcessPixel(const InputImagePixelType & pixel)
+{
+  return m_Functor(pixel);
 }
 
 template <typename TInputImage, typename TOutputImage>
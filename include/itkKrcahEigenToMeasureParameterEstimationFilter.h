@@ -21,7 +21,6 @@
 
 #include "itkMath.h"
 #include "itkEigenToMeasureParameterEstimationFilter.h"
-#include <mutex>
 #include "itkCompensatedSummation.h"
 
 namespace itk
@@ -166,9 +165,11 @@ protected:
   void
   AfterThreadedGenerateData() override;
 
-  /** Multi-thread version GenerateData. */
+  /** Accumulate over one piece of the input. */
   void
-  DynamicThreadedGenerateData(const OutputImageRegionType & outputRegionForThread) override;
+  GeneratePieceData(const InputImageType *       input,
+                    const InputImageRegionType & region,
+                    MultiThreaderBase *          multiThreader) override;
 
   /** Calculation of \f$ T \f$ changes depending on the implementation */
   inline RealType
@@ -180,12 +181,16 @@ protected:
   PrintSelf(std::ostream & os, Indent indent) const override;
 
 private:
-  /* Member variables */
-  KrcahImplementationEnum        m_ParameterSet;
-  CompensatedSummation<RealType> m_ThreadCount;
-  CompensatedSummation<RealType> m_ThreadAccumulatedTrace;
+  /** Compensated sum of the traces and number of pixels of one scanline */
+  struct TraceAccumulatorType
+  {
+    RealType      Trace;
+    SizeValueType Count;
+  };
 
-  std::mutex m_Mutex;
+  /* Member variables */
+  KrcahImplementationEnum                      m_ParameterSet;
+  DeterministicReduction<TraceAccumulatorType> m_TraceReduction;
 }; // end class
 } // namespace itk
 
@@ -41,8 +41,8 @@ template <typename TInputImage, typename TOutputImage>
 void
 KrcahEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::BeforeThreadedGenerateData()
 {
-  m_ThreadAccumulatedTrace = NumericTraits<RealType>::ZeroValue();
-  m_ThreadCount = NumericTraits<RealType>::ZeroValue();
+  m_TraceReduction.Initialize(this->GetNumberOfLineSlots(),
+                              TraceAccumulatorType{ NumericTraits<RealType>::ZeroValue(), 0 });
 }
 
 template <typename TInputImage, typename TOutputImage>
@@ -68,9 +68,15 @@ KrcahEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::AfterTh
       break;
   }
 
+  /* Merge the scanlines pairwise, in the same order whatever the threads were */
+  const TraceAccumulatorType total =
+    m_TraceReduction.Reduce([](const TraceAccumulatorType & a, const TraceAccumulatorType & b) {
+      return TraceAccumulatorType{ a.Trace + b.Trace, a.Count + b.Count };
+    });
+
   /* Do derived measures */
-  const RealType accum(m_ThreadAccumulatedTrace);
-  const RealType count(m_ThreadCount);
+  const RealType accum = total.Trace;
+  const auto     count = static_cast<RealType>(total.Count);
   if (count > 0)
   {
     RealType averageTrace = accum / count;
@@ -92,11 +98,13 @@ KrcahEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::AfterTh
 
 template <typename TInputImage, typename TOutputImage>
 void
-KrcahEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::DynamicThreadedGenerateData(
-  const OutputImageRegionType & outputRegionForThread)
+KrcahEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::GeneratePieceData(
+  const InputImageType *       input,
+  const InputImageRegionType & region,
+  MultiThreaderBase *          multiThreader)
 {
   /* If size is zero, return */
-  const SizeValueType size0 = outputRegionForThread.GetSize(0);
+  const SizeValueType size0 = region.GetSize(0);
   if (size0 == 0)
   {
     return;
@@ -117,60 +125,22 @@ KrcahEigenToMeasureParameterEstimationFilter<TInputImage, TOutputImage>::Dynamic
       break;
   }
 
-  /* Get input and mask pointer */
-  InputImageConstPointer            inputPointer = this->GetInput();
-  MaskSpatialObjectTypeConstPointer maskPointer = this->GetMask();
-
-  OutputImageType * outputPtr = this->GetOutput(0);
-
-  // Define the portion of the input to walk for this thread, using
-  // the CallCopyOutputRegionToInputRegion method allows for the input
-  // and output images to be different dimensions
-  InputImageRegionType inputRegionForThread;
-
-  this->CallCopyOutputRegionToInputRegion(inputRegionForThread, outputRegionForThread);
-
-  MultiThreaderBase::Pointer mt = this->GetMultiThreader();
-
-  mt->ParallelizeImageRegion<TInputImage::ImageDimension>(
-    outputRegionForThread,
-    [inputPointer, maskPointer, outputPtr, this, traceFunction](const OutputImageRegionType region) {
-      /* Keep track of the current accumulation */
-      RealType accum = NumericTraits<RealType>::ZeroValue();
-      RealType count = NumericTraits<RealType>::ZeroValue();
-
-      typename InputImageType::PointType point;
-
-      /* Setup iterator */
-      ImageRegionConstIteratorWithIndex<TInputImage> inputIt(inputPointer, region);
-      ImageRegionIterator<OutputImageType>           outputIt(outputPtr, region);
-
-      /* Iterate and count */
-      while (!inputIt.IsAtEnd())
-      {
-        // Process point
-        inputPointer->TransformIndexToPhysicalPoint(inputIt.GetIndex(), point);
-        if ((!maskPointer) || (maskPointer->IsInsideInObjectSpace(point)))
-        {
-          /* Compute trace */
-          count++;
-          accum += (this->*traceFunction)(inputIt.Get());
-        }
-
-        // Set
-        outputIt.Set(static_cast<OutputImagePixelType>(inputIt.Get()));
-
-        // Increment
-        ++inputIt;
-        ++outputIt;
-      }
-
-      /* Block and store */
-      std::lock_guard<std::mutex> mutexHolder(m_Mutex);
-      m_ThreadCount += count;
-      m_ThreadAccumulatedTrace += accum;
-    },
-    nullptr);
+  auto visitLine = [input, this, traceFunction](const InputImageRegionType & line, SizeValueType slot) {
+    /* Keep track of the current accumulation */
+    CompensatedSummation<RealType> accum;
+    SizeValueType                  count = 0;
+
+    /* Iterate and count */
+    this->VisitPixelsInMask(input, line, [&](const InputImagePixelType & pixel) {
+      /* Compute trace */
+      count++;
+      accum += (this->*traceFunction)(pixel);
+    });
+
+    /* Every scanline has its own slot, nothing to lock */
+    m_TraceReduction[slot] = TraceAccumulatorType{ accum.GetSum(), count };
+  };
+  this->ParallelizeLines(multiThreader, region, visitLine);
 }
 
 template <typename TInputImage, typename TOutputImage>
@@ -20,10 +20,8 @@
 #define itkKrcahPreprocessingImageToImageFilter_h
 
 #include "itkImageToImageFilter.h"
-#include "itkDiscreteGaussianImageFilter.h"
-#include "itkSubtractImageFilter.h"
-#include "itkMultiplyImageFilter.h"
-#include "itkAddImageFilter.h"
+#include "itkImage.h"
+#include "itkSeparableConvolutionAlgorithm.h"
 
 namespace itk
 {
@@ -40,13 +38,22 @@ namespace itk
  * filter has smoothing parameter \f$ s = 1 mm \f$. A user can modify
  * these defaults using the appropriate setter methods.
  *
- * Additionally, this filter provides the ReleaseInternalFilterData
- * flag. When this flag is set, the internal filters used to compute
- * the unsharp filter will release their data after processing. This
- * conserves memory at the expense of computation time if ScalingConstant
- * or Sigma are changed. This flag is on by default.
+ * The filter is computed in one pipeline stage. The Gaussian is applied as separable passes
+ * with the kernels of DiscreteGaussianImageFilter (see SetMaximumError( ),
+ * SetMaximumKernelWidth( ) and SetUseImageSpacing( )) and the zero flux Neumann boundary
+ * condition. All but the last pass go through one single precision image, smoothed in
+ * place. The last pass combines each smoothed line with the input and writes J directly,
+ * so no image of I*G, I-I*G or k(I-I*G) is ever stored. The arithmetic is done in double
+ * precision and the result is clamped to the range of the output pixel type.
+ *
+ * Only the requested region of the output is computed, from the input padded by the radius
+ * of the kernels, so the filter can be streamed.
+ *
+ * The ReleaseInternalFilterData flag is kept for backwards compatibility. The smoothed
+ * image is always released at the end of GenerateData( ).
  *
  * \sa KrcahEigenToScalarImageFilter
+ * \sa GaussianKernelBank
  *
  * \author: Thomas Fitze
  * \ingroup BoneEnhancement
@@ -79,32 +86,43 @@ public:
   using RealType = typename NumericTraits<PixelType>::RealType;
   using OutputPixelValueType = typename NumericTraits<OutputPixelType>::ValueType;
   using InputImageConstPointer = typename TInputImage::ConstPointer;
+  using InputImageType = TInputImage;
+  using OutputImageType = TOutputImage;
+  using OutputImageRegionType = typename TOutputImage::RegionType;
+  using SpacingType = typename TInputImage::SpacingType;
 
-  /** Typedefs for internal filters */
-  using GaussianFilterType = DiscreteGaussianImageFilter<TInputImage, TInputImage>;
-  using SubstractFilterType = SubtractImageFilter<TInputImage, TInputImage, TInputImage>;
-  using MultiplyFilterType = MultiplyImageFilter<TInputImage, TInputImage, TInputImage>;
-  using AddFilterType = AddImageFilter<TInputImage, TInputImage, TOutputImage>;
+  /** Single precision image holding the partially smoothed input, as in HessianGaussianImageFilter */
+  using InternalRealType = float;
+  using InternalImageType = Image<InternalRealType, TInputImage::ImageDimension>;
+  using KernelType = SeparableConvolutionAlgorithm::KernelType;
 
   /** Flag to release data or not */
   itkSetMacro(ReleaseInternalFilterData, bool);
   itkGetConstMacro(ReleaseInternalFilterData, bool);
   itkBooleanMacro(ReleaseInternalFilterData);
 
-  /** Flag to release data or not */
+  /** Standard deviation of the Gaussian */
   itkSetMacro(Sigma, RealType);
   itkGetConstMacro(Sigma, RealType);
 
-  /** Flag to release data or not */
+  /** The constant k */
   itkSetMacro(ScalingConstant, RealType);
   itkGetConstMacro(ScalingConstant, RealType);
 
-  /** DiscreteGaussianImageFilter needs a larger input requested region
-   * than the output requested region (larger by the size of the
-   * Gaussian kernel).  As such, DiscreteGaussianImageFilter needs to
-   * provide an implementation for GenerateInputRequestedRegion() in
-   * order to inform the pipeline execution model.
-   * \sa ImageToImageFilter::GenerateInputRequestedRegion() */
+  /** Truncation of the Gaussian kernels, as in DiscreteGaussianImageFilter */
+  itkSetMacro(MaximumError, double);
+  itkGetConstMacro(MaximumError, double);
+  itkSetMacro(MaximumKernelWidth, unsigned int);
+  itkGetConstMacro(MaximumKernelWidth, unsigned int);
+  itkSetMacro(UseImageSpacing, bool);
+  itkGetConstMacro(UseImageSpacing, bool);
+  itkBooleanMacro(UseImageSpacing);
+
+  /** Normalized Gaussian kernel along direction for an image of the given spacing */
+  KernelType
+  ComputeKernel(unsigned int direction, const SpacingType & spacing) const;
+
+  /** The output requested region padded by the radius of the kernels. */
   void
   GenerateInputRequestedRegion() override;
 
@@ -117,7 +135,7 @@ public:
 protected:
   KrcahPreprocessingImageToImageFilter();
 
-  /** Single threaded since we are connecting data */
+  /** Each pass is multithreaded over the lines of the image */
   void
   GenerateData() override;
 
@@ -126,15 +144,12 @@ protected:
 
 private:
   /* Internal member variables */
-  RealType m_Sigma;
-  RealType m_ScalingConstant;
-  bool     m_ReleaseInternalFilterData{ true };
-
-  /* Filter member variables */
-  typename GaussianFilterType::Pointer  m_GaussianFilter;
-  typename SubstractFilterType::Pointer m_SubtractFilter;
-  typename MultiplyFilterType::Pointer  m_MultiplyFilter;
-  typename AddFilterType::Pointer       m_AddFilter;
+  RealType     m_Sigma;
+  RealType     m_ScalingConstant;
+  double       m_MaximumError{ 0.01 };
+  unsigned int m_MaximumKernelWidth{ 32 };
+  bool         m_UseImageSpacing{ true };
+  bool         m_ReleaseInternalFilterData{ true };
 }; // end class
 } // namespace itk
 
@@ -20,8 +20,10 @@
 #define itkKrcahPreprocessingImageToImageFilter_hxx
 
 #include "itkKrcahPreprocessingImageToImageFilter.h"
-#include "itkGaussianOperator.h"
+#include "itkGaussianKernelBank.h"
 #include "itkMath.h"
+#include <algorithm>
+#include <vector>
 
 namespace itk
 {
@@ -30,72 +32,145 @@ KrcahPreprocessingImageToImageFilter<TInputImage, TOutputImage>::KrcahPreprocess
   : m_Sigma(1.0f)
   , m_ScalingConstant(10.0f)
 
+{}
+
+template <typename TInputImage, typename TOutputImage>
+typename KrcahPreprocessingImageToImageFilter<TInputImage, TOutputImage>::KernelType
+KrcahPreprocessingImageToImageFilter<TInputImage, TOutputImage>::ComputeKernel(unsigned int        direction,
+                                                                               const SpacingType & spacing) const
 {
-  /* Instantiate all filters */
-  m_GaussianFilter = GaussianFilterType::New();
-  m_SubtractFilter = SubstractFilterType::New();
-  m_MultiplyFilter = MultiplyFilterType::New();
-  m_AddFilter = AddFilterType::New();
+  // The kernel is built the same way DiscreteGaussianImageFilter builds it, once per process.
+  const double variance = Math::squared_magnitude(this->GetSigma());
+  const double pixelSpacing = m_UseImageSpacing ? spacing[direction] : 1.0;
+  return *GaussianKernelBank<double>::GetInstance().GetGaussianKernel(
+    variance / (pixelSpacing * pixelSpacing), m_MaximumError, m_MaximumKernelWidth);
 }
 
 template <typename TInputImage, typename TOutputImage>
 void
 KrcahPreprocessingImageToImageFilter<TInputImage, TOutputImage>::GenerateInputRequestedRegion()
 {
-  // Gaussian filter needs expanding around kernel. Since this filter is typically used
-  // with the Kcrah enhancing filter, we just expand everything.
+  // Gaussian filter needs expanding around kernel.
   Superclass::GenerateInputRequestedRegion();
   auto * input = const_cast<TInputImage *>(this->GetInput());
-  if (input)
+  if (!input)
   {
-    input->SetRequestedRegionToLargestPossibleRegion();
+    return;
   }
+
+  typename TInputImage::SizeType radius;
+  for (unsigned int d = 0; d < TInputImage::ImageDimension; ++d)
+  {
+    radius[d] = this->ComputeKernel(d, input->GetSpacing()).size() / 2;
+  }
+
+  typename TInputImage::RegionType inputRequestedRegion = input->GetRequestedRegion();
+  inputRequestedRegion.PadByRadius(radius);
+  inputRequestedRegion.Crop(input->GetLargestPossibleRegion());
+  input->SetRequestedRegion(inputRequestedRegion);
 }
 
 template <typename TInputImage, typename TOutputImage>
 void
 KrcahPreprocessingImageToImageFilter<TInputImage, TOutputImage>::GenerateData()
 {
-  /* Get Input */
-  InputImageConstPointer input = this->GetInput();
+  using IndexType = typename TInputImage::IndexType;
+  using RegionType = typename TInputImage::RegionType;
 
-  /* I*G */
-  m_GaussianFilter->SetInput(input);
-  m_GaussianFilter->SetVariance(Math::squared_magnitude(this->GetSigma()));
+  const InputImageType * input = this->GetInput();
+  OutputImageType *      output = this->GetOutput();
 
-  /* I - I*G */
-  m_SubtractFilter->SetInput1(input);
-  m_SubtractFilter->SetInput2(m_GaussianFilter->GetOutput());
+  this->AllocateOutputs();
 
-  /* k(I-(I*G)) */
-  m_MultiplyFilter->SetInput(m_SubtractFilter->GetOutput());
-  m_MultiplyFilter->SetConstant(this->GetScalingConstant());
+  const OutputImageRegionType outputRegion = output->GetRequestedRegion();
+  if (outputRegion.GetNumberOfPixels() == 0)
+  {
+    return;
+  }
+
+  MultiThreaderBase *            multiThreader = this->GetMultiThreader();
+  std::vector<KernelType>        kernels(ImageDimension);
+  typename TInputImage::SizeType radius;
+  for (unsigned int d = 0; d < ImageDimension; ++d)
+  {
+    kernels[d] = this->ComputeKernel(d, input->GetSpacing());
+    radius[d] = kernels[d].size() / 2;
+  }
 
-  /* I+k*(I-(I*G)) */
-  m_AddFilter->SetInput1(input);
-  m_AddFilter->SetInput2(m_MultiplyFilter->GetOutput());
+  /* The last pass writes J = I + k(I - I*G) straight into the output */
+  const unsigned int    lastDirection = ImageDimension - 1;
+  const PixelType *     inputBuffer = input->GetBufferPointer();
+  OutputPixelType *     outputBuffer = output->GetBufferPointer();
+  const OffsetValueType inputStride = input->GetOffsetTable()[lastDirection];
+  const OffsetValueType outputStride = output->GetOffsetTable()[lastDirection];
+  const auto            scalingConstant = static_cast<double>(m_ScalingConstant);
+  const auto            lower = static_cast<double>(NumericTraits<OutputPixelType>::NonpositiveMin());
+  const auto            upper = static_cast<double>(NumericTraits<OutputPixelType>::max());
+  auto combine = [&](const IndexType & lineStart, const double * values, SizeValueType length) {
+    const PixelType * inputPixel = inputBuffer + input->ComputeOffset(lineStart);
+    OutputPixelType * outputPixel = outputBuffer + output->ComputeOffset(lineStart);
+    for (SizeValueType i = 0; i < length; ++i, inputPixel += inputStride, outputPixel += outputStride)
+    {
+      const auto value = static_cast<double>(*inputPixel);
+      const double sharpened = value + scalingConstant * (value - values[i]);
+      *outputPixel = static_cast<OutputPixelType>(std::min(std::max(sharpened, lower), upper));
+    }
+  };
+
+  if (ImageDimension == 1)
+  {
+    SeparableConvolutionAlgorithm::ConvolveLines(input, outputRegion, 0, kernels[0], combine, multiThreader);
+    this->UpdateProgress(1.0f);
+    return;
+  }
 
-  /* Release data if asked */
-  if (this->GetReleaseInternalFilterData())
+  /*
+   * The other passes smooth one image in place. ConvolveLines gathers a whole line before handing
+   * it to the writer and no two lines overlap, so every pass can read and write the same buffer.
+   * Directions already convolved only need to cover the output, the others need the support of
+   * their kernels.
+   */
+  RegionType region = outputRegion;
+  region.PadByRadius(radius);
+  region.Crop(input->GetBufferedRegion());
+  region.SetIndex(0, outputRegion.GetIndex(0));
+  region.SetSize(0, outputRegion.GetSize(0));
+
+  typename InternalImageType::Pointer smoothed = InternalImageType::New();
+  smoothed->CopyInformation(input);
+  smoothed->SetRegions(region);
+  smoothed->Allocate();
+
+  InternalImageType * smoothedPointer = smoothed.GetPointer();
+  InternalRealType *  smoothedBuffer = smoothed->GetBufferPointer();
+  for (unsigned int d = 0; d < lastDirection && !this->GetAbortGenerateData(); ++d)
   {
-    m_GaussianFilter->ReleaseDataFlagOn();
-    m_SubtractFilter->ReleaseDataFlagOn();
-    m_MultiplyFilter->ReleaseDataFlagOn();
-    m_AddFilter->ReleaseDataFlagOn();
+    region.SetIndex(d, outputRegion.GetIndex(d));
+    region.SetSize(d, outputRegion.GetSize(d));
+
+    const OffsetValueType stride = smoothed->GetOffsetTable()[d];
+    auto store = [&](const IndexType & lineStart, const double * values, SizeValueType length) {
+      InternalRealType * pixel = smoothedBuffer + smoothedPointer->ComputeOffset(lineStart);
+      for (SizeValueType i = 0; i < length; ++i, pixel += stride)
+      {
+        *pixel = static_cast<InternalRealType>(values[i]);
+      }
+    };
+
+    if (d == 0)
+    {
+      SeparableConvolutionAlgorithm::ConvolveLines(input, region, d, kernels[d], store, multiThreader);
+    }
+    else
+    {
+      SeparableConvolutionAlgorithm::ConvolveLines(smoothedPointer, region, d, kernels[d], store, multiThreader);
+    }
+    this->UpdateProgress(static_cast<float>(d + 1) / static_cast<float>(ImageDimension));
   }
 
-  /* Setup progress reporter */
-  ProgressAccumulator::Pointer progress = ProgressAccumulator::New();
-  progress->SetMiniPipelineFilter(this);
-  progress->RegisterInternalFilter(m_GaussianFilter, 0.25f);
-  progress->RegisterInternalFilter(m_SubtractFilter, 0.25f);
-  progress->RegisterInternalFilter(m_MultiplyFilter, 0.25f);
-  progress->RegisterInternalFilter(m_AddFilter, 0.25f);
-
-  /* Graft Output */
-  m_AddFilter->GraftOutput(this->GetOutput());
-  m_AddFilter->Update();
-  this->GraftOutput(m_AddFilter->GetOutput());
+  SeparableConvolutionAlgorithm::ConvolveLines(
+    smoothedPointer, outputRegion, lastDirection, kernels[lastDirection], combine, multiThreader);
+  this->UpdateProgress(1.0f);
 }
 
 template <typename TInputImage, typename TOutputImage>
@@ -103,12 +178,11 @@ void
 KrcahPreprocessingImageToImageFilter<TInputImage, TOutputImage>::PrintSelf(std::ostream & os, Indent indent) const
 {
   Superclass::PrintSelf(os, indent);
-  os << indent << "GaussianFilter: " << m_GaussianFilter.GetPointer() << std::endl;
-  os << indent << "SubtractFilter: " << m_SubtractFilter.GetPointer() << std::endl;
-  os << indent << "MultiplyFilter: " << m_MultiplyFilter.GetPointer() << std::endl;
-  os << indent << "AddFilter: " << m_AddFilter.GetPointer() << std::endl;
   os << indent << "Sigma: " << GetSigma() << std::endl;
   os << indent << "ScalingConstant: " << GetScalingConstant() << std::endl;
+  os << indent << "MaximumError: " << GetMaximumError() << std::endl;
+  os << indent << "MaximumKernelWidth: " << GetMaximumKernelWidth() << std::endl;
+  os << indent << "UseImageSpacing: " << GetUseImageSpacing() << std::endl;
   os << indent << "ReleaseInternalFilterData: " << GetReleaseInternalFilterData() << std::endl;
 }
 
@@ -0,0 +1,113 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkMultiScaleHessianEnhancementBatchProcessor_h
+#define itkMultiScaleHessianEnhancementBatchProcessor_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include <functional>
+
+namespace itk
+{
+/** \class MultiScaleHessianEnhancementBatchProcessor
+ * \brief Run many volumes through one configured enhancement filter.
+ *
+ * Building a multiscale pipeline for every volume of a cohort reconstructs every internal filter and repeats
+ * the configuration. This class instead holds one configured filter, usually a
+ * MultiScaleHessianEnhancementImageFilter, and runs every volume given by a reader function through it. Each
+ * result is disconnected from the filter and handed to a writer function.
+ *
+ * With OverlapInputOutputOn( ), the default, the reader of volume N+1 and the writer of volume N-1 run on
+ * their own threads while volume N is enhanced. They must therefore not touch the filter. Volumes are read,
+ * enhanced and written in order, and at most one read and one write are pending at any time. An exception
+ * thrown by the reader, the filter or the writer stops the batch and is rethrown by Process( ).
+ *
+ * \sa MultiScaleHessianEnhancementImageFilter
+ *
+ * \author: Bryce Besler
+ * \ingroup BoneEnhancement
+ */
+template <typename TEnhancementFilter>
+class ITK_TEMPLATE_EXPORT MultiScaleHessianEnhancementBatchProcessor : public Object
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(MultiScaleHessianEnhancementBatchProcessor);
+
+  /** Standard Self typedef */
+  using Self = MultiScaleHessianEnhancementBatchProcessor;
+  using Superclass = Object;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(MultiScaleHessianEnhancementBatchProcessor, Object);
+
+  /** Filter related typedefs. */
+  using EnhancementFilterType = TEnhancementFilter;
+  using InputImageType = typename EnhancementFilterType::InputImageType;
+  using InputImagePointer = typename InputImageType::Pointer;
+  using OutputImageType = typename EnhancementFilterType::OutputImageType;
+  using OutputImagePointer = typename OutputImageType::Pointer;
+
+  /** The reader returns the input of a volume and the writer takes the enhanced volume. */
+  using ReaderType = std::function<InputImagePointer(SizeValueType)>;
+  using WriterType = std::function<void(SizeValueType, OutputImageType *)>;
+
+  /** Set/Get the configured filter every volume is run through. */
+  itkSetObjectMacro(EnhancementFilter, EnhancementFilterType);
+  itkGetModifiableObjectMacro(EnhancementFilter, EnhancementFilterType);
+
+  /** Set/Get whether reading and writing overlap with the enhancement of the volume in between. Default is on. */
+  itkSetMacro(OverlapInputOutput, bool);
+  itkGetConstMacro(OverlapInputOutput, bool);
+  itkBooleanMacro(OverlapInputOutput);
+
+  /** Read, enhance and write numberOfVolumes volumes in order. */
+  void
+  Process(SizeValueType numberOfVolumes, const ReaderType & reader, const WriterType & writer);
+
+  /** Number of volumes written by the last call to Process( ). */
+  itkGetConstMacro(NumberOfProcessedVolumes, SizeValueType);
+
+protected:
+  MultiScaleHessianEnhancementBatchProcessor() = default;
+  ~MultiScaleHessianEnhancementBatchProcessor() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+  /** Run one volume through the filter and take its output away from it */
+  OutputImagePointer
+  EnhanceVolume(SizeValueType volume, InputImageType * input);
+
+private:
+  typename EnhancementFilterType::Pointer m_EnhancementFilter;
+  bool                                    m_OverlapInputOutput{ true };
+  SizeValueType                           m_NumberOfProcessedVolumes{ 0 };
+}; // end class
+} // namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkMultiScaleHessianEnhancementBatchProcessor.hxx"
+#endif
+
+#endif // itkMultiScaleHessianEnhancementBatchProcessor_h
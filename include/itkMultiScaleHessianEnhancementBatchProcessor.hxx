@@ -0,0 +1,116 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkMultiScaleHessianEnhancementBatchProcessor_hxx
+#define itkMultiScaleHessianEnhancementBatchProcessor_hxx
+
+#include "itkMultiScaleHessianEnhancementBatchProcessor.h"
+#include <future>
+
+namespace itk
+{
+
+template <typename TEnhancementFilter>
+void
+MultiScaleHessianEnhancementBatchProcessor<TEnhancementFilter>::Process(SizeValueType      numberOfVolumes,
+                                                                        const ReaderType & reader,
+                                                                        const WriterType & writer)
+{
+  if (!m_EnhancementFilter)
+  {
+    itkExceptionMacro(<< "An enhancement filter is required.");
+  }
+  if (!reader || !writer)
+  {
+    itkExceptionMacro(<< "A reader and a writer are required.");
+  }
+
+  m_NumberOfProcessedVolumes = 0;
+  if (!m_OverlapInputOutput)
+  {
+    for (SizeValueType volume = 0; volume < numberOfVolumes; ++volume)
+    {
+      const InputImagePointer input = reader(volume);
+      writer(volume, this->EnhanceVolume(volume, input).GetPointer());
+      ++m_NumberOfProcessedVolumes;
+    }
+    return;
+  }
+
+  /* Read the next volume and write the previous one while this one is enhanced */
+  std::future<InputImagePointer> pendingInput;
+  std::future<void>              pendingOutput;
+  if (numberOfVolumes > 0)
+  {
+    pendingInput = std::async(std::launch::async, reader, SizeValueType{ 0 });
+  }
+  for (SizeValueType volume = 0; volume < numberOfVolumes; ++volume)
+  {
+    const InputImagePointer input = pendingInput.get();
+    if (volume + 1 < numberOfVolumes)
+    {
+      pendingInput = std::async(std::launch::async, reader, volume + 1);
+    }
+
+    const OutputImagePointer output = this->EnhanceVolume(volume, input);
+    if (pendingOutput.valid())
+    {
+      pendingOutput.get();
+      ++m_NumberOfProcessedVolumes;
+    }
+    pendingOutput =
+      std::async(std::launch::async, [&writer, volume, output]() { writer(volume, output.GetPointer()); });
+  }
+  if (pendingOutput.valid())
+  {
+    pendingOutput.get();
+    ++m_NumberOfProcessedVolumes;
+  }
+}
+
+template <typename TEnhancementFilter>
+typename MultiScaleHessianEnhancementBatchProcessor<TEnhancementFilter>::OutputImagePointer
+MultiScaleHessianEnhancementBatchProcessor<TEnhancementFilter>::EnhanceVolume(SizeValueType    volume,
+                                                                              InputImageType * input)
+{
+  if (!input)
+  {
+    itkExceptionMacro(<< "The reader returned no image for volume " << volume << ".");
+  }
+
+  /* The filter makes itself a new output, so the next volume does not write over this one */
+  m_EnhancementFilter->SetInput(input);
+  m_EnhancementFilter->Update();
+  OutputImagePointer output = m_EnhancementFilter->GetOutput();
+  output->DisconnectPipeline();
+  return output;
+}
+
+template <typename TEnhancementFilter>
+void
+MultiScaleHessianEnhancementBatchProcessor<TEnhancementFilter>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "EnhancementFilter: " << m_EnhancementFilter.GetPointer() << std::endl;
+  os << indent << "OverlapInputOutput: " << m_OverlapInputOutput << std::endl;
+  os << indent << "NumberOfProcessedVolumes: " << m_NumberOfProcessedVolumes << std::endl;
+}
+
+} // namespace itk
+
+#endif // itkMultiScaleHessianEnhancementBatchProcessor_hxx
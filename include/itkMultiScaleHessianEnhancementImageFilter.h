@@ -20,13 +20,20 @@
 
 #include "itkImageToImageFilter.h"
 #include "itkHessianGaussianImageFilter.h"
-#include "itkSymmetricEigenAnalysisImageFilter.h"
-#include "itkMaximumAbsoluteValueImageFilter.h"
+#include "itkAnalyticSymmetricEigenValueImageFilter.h"
+#include "itkHalfFloat.h"
 #include "itkNumericTraits.h"
 #include "itkArray.h"
 #include "itkSpatialObject.h"
+#include "itkRunLengthMask.h"
 #include "itkEigenToMeasureImageFilter.h"
 #include "itkEigenToMeasureParameterEstimationFilter.h"
+#include <chrono>
+#include <ctime>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
 
 namespace itk
 {
@@ -36,9 +43,9 @@ namespace itk
  * This class enhances an image using many of the bone image enhancement filters. Other filters based
  * on a functional of the eigenvalues can be written using this class by extending EigenToMeasureImageFilter.
  * This class works by computing the second derivative and cross derivatives usign HessianRecursiveGaussianImageFilter.
- * The hessian matrix is decomposed into the eigenvalues using SymmetricEigenAnalysisImageFilter. By setting a filter
- * using SetEigenToMeasureImageFilter( ), a filter is used to convert eigenvalues back into a scalar values. This is
- * repeated at multiple scales and the maximum response (in an absolute sense) is taken over all scales.
+ * The hessian matrix is decomposed into the eigenvalues using AnalyticSymmetricEigenValueImageFilter. By setting a
+ * filter using SetEigenToMeasureImageFilter( ), a filter is used to convert eigenvalues back into a scalar values. This
+ * is repeated at multiple scales and the maximum response (in an absolute sense) is taken over all scales.
  *
  * To enhance the bone image, call SetEigenToMeasureImageFilter( ) with an appropriate class derived from the
  * EigenToMeasureImageFilter. This filter should be constructed outside of this class. You will also need
@@ -47,21 +54,144 @@ namespace itk
  * generate naturally spaced sigma values. Note that you still need to pass the array to SetSigmaArray( ).
  * Otherwise, an explicit SigmaArrayType can be passed to SetSigmaArray( ).
  *
- * The maximum response from SetEigenToMeasureImageFilter( ) is taken over all sigma values using
- * MaximumAbsoluteValueImageFilter. This is valid for filters which enhance both the positive and negative
- * second derivatives.
+ * The maximum response from SetEigenToMeasureImageFilter( ) is taken over all sigma values in the sense of
+ * Functor::MaximumAbsoluteValue. This is valid for filters which enhance both the positive and negative
+ * second derivatives. Each response is folded into the output as it is produced, so no image is allocated
+ * for the maximum. With GenerateScaleOutputOn( ) the index of the sigma value giving the maximum is written
+ * to GetScaleOutput( ). When two scales give the same magnitude, the larger index wins.
+ *
+ * By default each scale is computed in stages: the parameter estimation filter streams the hessian and eigenvalue
+ * images piece by piece and copies the eigenvalues into its output, which the measure then reads. With
+ * GraftEigenValuesOn( ) the estimation requests the whole eigenvalue image at once and grafts it onto its output
+ * instead. That saves the copy and its sweep, but gives up the streaming: the whole hessian and eigenvalue images
+ * are held together, which takes more memory than the copy and one piece. With UseTiledExecutionOn( )
+ * the parameters are first estimated in a streamed pre-pass which produces no image. Then the measure is
+ * computed tile by tile (see SetTileSize( )), so the hessian and eigenvalue images only ever hold one padded
+ * tile. This trades a second hessian computation for a much smaller peak memory. With UseTileMajorOrderOn( ) the
+ * parameters of every scale are estimated first and each tile is then carried through all of the scales before
+ * the next one, so the padded tile of the input, the scale-space and the spectrum of the tile stay in cache and
+ * are reused by every scale instead of being rebuilt over the whole image once per scale.
+ *
+ * The first update normally requests the whole input, since the parameters are estimated over all of it. With
+ * UseOutOfCoreExecutionOn( ) only the requested region padded by the kernels is requested and the estimation
+ * pre-pass pulls the input from upstream one streamed piece at a time. With a reader which can stream upstream,
+ * a writer which streams downstream and tiled execution, no image of the whole volume is then ever held, so the
+ * size of a volume is limited by the disk rather than the memory. Each region is read twice, once for the
+ * estimation and once for the output. The incremental scale-space smooths the buffered input directly and
+ * cannot be combined with it. The Automatic backend then never selects the recursive filters, which need all of
+ * the input.
+ *
+ * With CollectProfileOn( ) every update records the wall time, the CPU time and the bytes read and allocated of
+ * every run of each stage (hessian, scale-space, resample, eigenanalysis, parameter estimation, measure and fold)
+ * along with the scale it ran for. GetProfile( ) returns the records, WriteProfile( ) writes them as JSON with the
+ * bandwidth and the totals of every stage, and WriteProfileTraceEvents( ) writes them as trace events for Perfetto.
+ * The stages are timed by observing the StartEvent and EndEvent of the internal filters. The parameter estimation
+ * streams its input, so its run includes the hessian and eigenanalysis of every piece it pulled.
+ *
+ * With CacheScalesOn( ) the eigenvalues of every scale over the whole image and its estimated parameters are kept
+ * between updates, keyed by sigma. Adding a sigma to the array then only computes the hessian of that scale, and
+ * changing the mask or the parameter estimation filter only estimates the parameters and computes the measure of
+ * every scale again. The eigenvalues are recomputed when the input or the hessian settings change, and the sigma
+ * values no longer in the array are forgotten. Each scale keeps an EigenValueImageType of the whole image, so
+ * this trades memory for interactive edits. The cache is only used when the whole output is computed in stages,
+ * so it is bypassed and freed with tiles, with out-of-core execution and with the incremental scale-space. The
+ * cache counts towards the memory budget: only the first scales whose eigenvalues fit in it are kept, the others
+ * are computed again every update, and the cache is freed before tiles are used to stay within the budget.
+ *
+ * SetMemoryBudget( ) bounds the memory of the internal images and the outputs. Each update then estimates
+ * the peak memory of every stage from the size of the region, the pixel types and the kernel radii, and picks
+ * the first plan which fits: staged execution, then tiles halved along their longest direction until they fit.
+ * The number of divisions of the streamed parameter estimation is raised along with it. Every intermediate
+ * image is released as soon as it has been read. GetExecutionPlan( ) reports the plan and its estimated peak.
+ * The estimates cover the images of this module only and not the temporaries of the ITK filters it runs.
+ *
+ * With SetImageMask( ) the mask is rasterized once per update into a RunLengthMask on the grid of the input.
+ * Both the parameter estimation and the measure then only visit the runs inside of the mask, and the output is
+ * zero outside of it. The hessian, eigenanalysis, estimation and measure only run over the bounding box of the
+ * mask (the hessian reads the input padded by its kernel radius) and the output is zero outside of the box.
+ *
+ * The filter can be streamed, for instance by a StreamingImageFilter downstream. The parameters of every scale
+ * are estimated over the whole image (or the bounding box of the mask) by a streamed pre-pass the first time
+ * and cached. Every region of the output is then computed from the cached parameters and only needs the input
+ * padded by the radius of the widest hessian kernel. The cache is invalidated when this filter, the input
+ * pipeline, the mask or the parameter estimation filter are modified.
+ *
+ * With UseIncrementalScaleSpaceOn( ) the sigma values are visited as a Gaussian scale-space. The image at a
+ * scale is the image at the previous scale smoothed by sqrt(sigma_i^2 - sigma_{i-1}^2), and the hessian
+ * only convolves it with the derivative kernels of the smallest sigma, normalized at the sigma of the scale.
+ * Since G(a) * G(b) = G(sqrt(a^2 + b^2)), this is the same response up to kernel truncation, but the wide
+ * kernels of the large sigma values are replaced by a few small smoothing passes. One smoothed image of
+ * the processed region is kept while looping over the scales. The sigma array has to be sorted
+ * ascending.
+ *
+ * SetHessianBackend( ) chooses how the hessian is convolved. DiscreteGaussian uses FIR kernels truncated at
+ * the maximum error of HessianGaussianImageFilter, whose cost grows with sigma. RecursiveGaussian uses the
+ * Deriche IIR filters of HessianRecursiveGaussianImageFilter, whose cost does not depend on sigma. They are
+ * less accurate for sigmas of about a pixel and need the whole input, so the whole hessian is computed
+ * even when only a tile or a streamed region is needed. FourierTransform transforms the input once and
+ * computes every component of every scale from that one spectrum, padded for the largest sigma. Its cost
+ * does not depend on sigma either, but a tile or a streamed region is transformed with its own padding,
+ * so the spectrum is only shared by the scales when the whole image, or a tile with UseTileMajorOrderOn( ),
+ * is computed at once. Automatic uses the recursive
+ * filters for the scales whose sigma is at least RecursiveSigmaThreshold pixels along the finest direction,
+ * as long as the whole image is computed without tiles, and the FIR kernels otherwise.
+ *
+ * THessianValue and TEigenValue are the component types used to store the hessian and eigenvalue images.
+ * They default to the real and float types of the input pixel, so for most inputs every hessian pixel takes
+ * 48 bytes in 3D. Setting both to HalfFloat stores the intermediates as binary16 numbers, which are computed
+ * in single precision and rounded on writing, with a relative error of at most 2^-11 per value. That is a
+ * quarter of the memory traffic of the double tensors. Hessian values of magnitude 65520 or larger overflow,
+ * so inputs with very large intensities should be rescaled first. The measure filters then have to be
+ * instantiated with the matching EigenValueImageType.
+ *
+ * With UsePreprocessingOn( ) the unsharp mask I + k (I - G(sigmaP) * I) of KrcahPreprocessingImageToImageFilter
+ * is folded into the hessian kernels of every scale instead of being run as a stage of its own. Both are
+ * linear, so every scale convolves the input with (1 + k) D * G(sigma) - k D * G(sqrt(sigma^2 + sigmaP^2)).
+ * This saves the full size preprocessed image whenever it does not need to be written. The kernels are
+ * wider by sigmaP, and unlike the preprocessing filter the masked image is never clamped or cast to the
+ * input pixel type, so the response differs slightly from the two stage pipeline.
+ *
+ * SetMaximumKernelRadius( ) bounds the number of taps of the hessian kernels. The kernels of a sigma given in
+ * physical units are widest along the finest direction, so with 0.3 mm pixels and 1.5 mm slices a large sigma
+ * convolves hundreds of pixels in-plane and only a few through the slices. A scale whose kernels are wider than
+ * the maximum along a direction is computed on a working grid which bins the input along that direction by the
+ * smallest integer factor bringing its kernels within the maximum, so the working grid gets closer to isotropic
+ * as sigma grows. The hessian, eigenanalysis, parameter estimation and measure of that scale then run over all
+ * of the working grid, with the mask rasterized onto it, and the measure is linearly interpolated back onto the
+ * output grid before it is folded in. The binning adds a box of the factor to the smoothing, so a smaller maximum
+ * is faster and less accurate. The working grids need all of the input, are computed again for every streamed
+ * region and are not counted by the memory budget. They cannot be combined with the incremental scale-space or
+ * with out-of-core execution. A scale whose working grid misses every pixel of the mask stays on the input grid.
+ *
+ * With SetPreallocatedOutput( ) the output shares the buffer of the given image instead of allocating its own.
+ * Together with an input which is itself a view, such as the images of itk.image_view_from_array( ) in Python,
+ * an update reads and writes arrays of the caller without copying either. The caller keeps both buffers alive
+ * for as long as the output is used. Several filters can run on different arrays from different threads, as far
+ * as the wrapping releases the interpreter lock during Update( ).
+ *
+ * The hessian, scale-space hessian and eigenanalysis filters are created through the object factory when this
+ * filter is constructed, and the measure and estimation filters are given by the user. An implementation of a
+ * stage on another device, for instance a subclass built on the GPU filters of ITK, is used in place of the
+ * host one by registering a factory which overrides HessianFilterType, ScaleSpaceHessianFilterType or
+ * EigenAnalysisFilterType before this filter is created. The stages still exchange host images, so such a stage
+ * reads its input from and writes its output to the host on every scale.
  *
  * This class is heavily derived from \see MultiScaleHessianBasedMeasureImageFilter
  *
- * \sa MaximumAbsoluteValueImageFilter
+ * \sa Functor::MaximumAbsoluteValue
  * \sa EigenToMeasureImageFilter
- * \sa SymmetricEigenAnalysisImageFilter
+ * \sa AnalyticSymmetricEigenValueImageFilter
+ * \sa KrcahPreprocessingImageToImageFilter
+ * \sa HalfFloat
  * \sa HessianRecursiveGaussianImageFilter
  *
  * \author: Bryce Besler
  * \ingroup BoneEnhancement
  */
-template <typename TInputImage, typename TOutputImage = TInputImage>
+template <typename TInputImage,
+          typename TOutputImage = TInputImage,
+          typename THessianValue = typename NumericTraits<typename TInputImage::PixelType>::RealType,
+          typename TEigenValue = typename NumericTraits<typename TInputImage::PixelType>::FloatType>
 class ITK_TEMPLATE_EXPORT MultiScaleHessianEnhancementImageFilter : public ImageToImageFilter<TInputImage, TOutputImage>
 {
 public:
@@ -97,6 +227,7 @@ public:
   /** Mask related typedefs. */
   using MaskSpatialObjectType = SpatialObject<ImageDimension>;
   using MaskSpatialObjectTypeConstPointer = typename MaskSpatialObjectType::ConstPointer;
+  using MaskRunsType = RunLengthMask<ImageDimension>;
 
   /** Methods to set/get the mask image */
   itkSetInputMacro(ImageMask, MaskSpatialObjectType);
@@ -104,26 +235,34 @@ public:
 
   /** Hessian related typedefs. */
   // using HessianFilterType = HessianRecursiveGaussianImageFilter< TInputImage >;
-  using HessianFilterType = HessianGaussianImageFilter<TInputImage>;
+  using HessianFilterType = HessianGaussianImageFilter<
+    TInputImage,
+    Image<SymmetricSecondRankTensor<THessianValue, TInputImage::ImageDimension>, TInputImage::ImageDimension>>;
   using HessianImageType = typename HessianFilterType::OutputImageType;
   using HessianPixelType = typename HessianImageType::PixelType;
   using InternalRealType = typename HessianFilterType::InternalRealType;
 
+  /** Scale-space related typedefs. The smoothed images are stored in the internal type of the hessian. */
+  using ScaleSpaceImageType = typename HessianFilterType::RealImageType;
+  using ScaleSpaceHessianFilterType = HessianGaussianImageFilter<ScaleSpaceImageType, HessianImageType>;
+
   /** Eigenvalue analysis related type alias. The ITK python wrapping usually wraps floating types
-   * and not double types. For this reason, the eigenvalues are of type float.
+   * and not double types. For this reason, the eigenvalues are of type float unless TEigenValue is given.
    */
   using RealType = typename NumericTraits<InputImagePixelType>::RealType;
   using FloatType = typename NumericTraits<InputImagePixelType>::FloatType;
-  using EigenValueArrayType = Vector<FloatType, HessianPixelType::Dimension>;
+  using EigenValueArrayType = Vector<TEigenValue, HessianPixelType::Dimension>;
   using EigenValueImageType = Image<EigenValueArrayType, TInputImage::ImageDimension>;
-  using EigenAnalysisFilterType = SymmetricEigenAnalysisImageFilter<HessianImageType, EigenValueImageType>;
+  using EigenAnalysisFilterType = AnalyticSymmetricEigenValueImageFilter<HessianImageType, EigenValueImageType>;
 
-  /** Maximum over scale related type alias. */
-  using MaximumAbsoluteValueFilterType = MaximumAbsoluteValueImageFilter<TOutputImage>;
+  /** Scale of the maximum response related type alias. */
+  using ScalePixelType = unsigned char;
+  using ScaleImageType = Image<ScalePixelType, TInputImage::ImageDimension>;
 
   /** Eigenvalue image to measure image related typedefs */
   using EigenToMeasureImageFilterType = EigenToMeasureImageFilter<EigenValueImageType, TOutputImage>;
   using EigenToMeasureParameterEstimationFilterType = EigenToMeasureParameterEstimationFilter<EigenValueImageType>;
+  using ParameterArrayType = typename EigenToMeasureImageFilterType::ParameterArrayType;
 
   /** Need some types to determine how to order the eigenvalues */
   using InternalEigenValueOrderType = SymmetricEigenAnalysisEnums::EigenValueOrder;
@@ -137,6 +276,12 @@ public:
   itkSetObjectMacro(EigenToMeasureParameterEstimationFilter, EigenToMeasureParameterEstimationFilterType);
   itkGetModifiableObjectMacro(EigenToMeasureParameterEstimationFilter, EigenToMeasureParameterEstimationFilterType);
 
+  /** Set/Get an image whose buffer the output is written into instead of a buffer of its own, for instance a view
+   * of a NumPy array from itk.image_view_from_array( ). Its buffered region has to be the requested region of the
+   * output. Default is none. */
+  itkSetObjectMacro(PreallocatedOutput, OutputImageType);
+  itkGetModifiableObjectMacro(PreallocatedOutput, OutputImageType);
+
   /** Sigma values. */
   using SigmaType = RealType;
   using SigmaArrayType = Array<SigmaType>;
@@ -159,6 +304,181 @@ public:
   itkSetMacro(SigmaArray, SigmaArrayType);
   itkGetConstMacro(SigmaArray, SigmaArrayType);
 
+  /** Set/Get whether each scale is computed tile by tile instead of in whole-image stages. Default is off. */
+  itkSetMacro(UseTiledExecution, bool);
+  itkGetConstMacro(UseTiledExecution, bool);
+  itkBooleanMacro(UseTiledExecution);
+
+  /** Set/Get whether, with UseTiledExecutionOn( ), every scale of a tile is computed before the next tile instead
+   * of every tile of a scale before the next scale. Default is off. */
+  itkSetMacro(UseTileMajorOrder, bool);
+  itkGetConstMacro(UseTileMajorOrder, bool);
+  itkBooleanMacro(UseTileMajorOrder);
+
+  /** Set/Get whether staged execution grafts the whole eigenvalue image through the parameter estimation instead
+   * of streaming a copy of it. This saves the copy but holds the whole hessian and eigenvalue images at once.
+   * Default is off. */
+  itkSetMacro(GraftEigenValues, bool);
+  itkGetConstMacro(GraftEigenValues, bool);
+  itkBooleanMacro(GraftEigenValues);
+
+  /** Set/Get whether the input is only ever requested piece by piece, never all of it at once. Default is off. */
+  itkSetMacro(UseOutOfCoreExecution, bool);
+  itkGetConstMacro(UseOutOfCoreExecution, bool);
+  itkBooleanMacro(UseOutOfCoreExecution);
+
+  /** Set/Get the size of the tiles used with UseTiledExecutionOn( ). A size of zero along a direction
+   * uses the whole extent of the output. Default is 64 along every direction. */
+  using TileSizeType = typename OutputImageRegionType::SizeType;
+  itkSetMacro(TileSize, TileSizeType);
+  itkGetConstMacro(TileSize, TileSizeType);
+
+  /** Set/Get the number of bytes the internal images and the outputs may take, the input not included. With a
+   * budget every update plans its execution to stay within it, overriding UseTiledExecution and TileSize, and
+   * throws when even the smallest tiles do not fit. Default is 0, no budget. */
+  itkSetMacro(MemoryBudget, SizeValueType);
+  itkGetConstMacro(MemoryBudget, SizeValueType);
+
+  /** How an update is executed and the peak memory, in bytes, it is estimated to take */
+  struct ExecutionPlanType
+  {
+    bool          UseTiledExecution{ false };
+    TileSizeType  TileSize;
+    unsigned int  NumberOfEstimationDivisions{ 1 };
+    bool          ReleaseIntermediateData{ false };
+    SizeValueType NumberOfCachedScales{ 0 };
+    SizeValueType EstimatedPeakMemory{ 0 };
+  };
+
+  /** The plan followed by the last update */
+  const ExecutionPlanType &
+  GetExecutionPlan() const
+  {
+    return m_ExecutionPlan;
+  }
+
+  /** Set/Get whether the eigenvalues and the parameters of every scale are kept for the next update. Default is
+   * off. */
+  itkSetMacro(CacheScales, bool);
+  itkGetConstMacro(CacheScales, bool);
+  itkBooleanMacro(CacheScales);
+
+  /** Number of scales whose eigenvalues are kept */
+  SizeValueType
+  GetNumberOfCachedScales() const
+  {
+    return m_ScaleCache.size();
+  }
+
+  /** Free the eigenvalues and the parameters kept for every scale */
+  void
+  ReleaseScaleCache()
+  {
+    m_ScaleCache.clear();
+  }
+
+  /** Set/Get whether every update records how long each stage took. Default is off. */
+  itkSetMacro(CollectProfile, bool);
+  itkGetConstMacro(CollectProfile, bool);
+  itkBooleanMacro(CollectProfile);
+
+  /** One run of a stage during an update. Start is in seconds since the update began, the CPU time is summed
+   * over every thread and the bytes are those of the region the stage produced, the padding not included. */
+  struct StageProfileType
+  {
+    std::string    Stage;
+    SigmaStepsType ScaleLevel{ 0 };
+    SigmaType      Sigma{ 0.0 };
+    double         Start{ 0.0 };
+    double         WallTime{ 0.0 };
+    double         CPUTime{ 0.0 };
+    SizeValueType  BytesRead{ 0 };
+    SizeValueType  BytesAllocated{ 0 };
+  };
+  using ProfileType = std::vector<StageProfileType>;
+
+  /** The stages run by the last update, in the order they finished */
+  const ProfileType &
+  GetProfile() const
+  {
+    return m_Profile;
+  }
+
+  /** Write the profile of the last update as JSON, with the bandwidth and the totals of every stage */
+  void
+  WriteProfile(std::ostream & os) const;
+
+  /** Write the profile of the last update as Chrome trace events, which Perfetto and chrome://tracing open */
+  void
+  WriteProfileTraceEvents(std::ostream & os) const;
+
+  /**\class HessianBackendEnum
+   * Selects how the hessian is convolved at each scale.
+   * \ingroup BoneEnhancement
+   */
+  enum class HessianBackendEnum : uint8_t
+  {
+    DiscreteGaussian = 0,
+    RecursiveGaussian = 1,
+    Automatic = 2,
+    FourierTransform = 3
+  };
+
+  /** Set/Get how the hessian is convolved. Default is DiscreteGaussian. */
+  itkSetEnumMacro(HessianBackend, HessianBackendEnum);
+  itkGetEnumMacro(HessianBackend, HessianBackendEnum);
+
+  /** Set/Get the sigma, in pixels along the finest direction, from which the Automatic backend uses the
+   * recursive filters. Default is 4. */
+  itkSetMacro(RecursiveSigmaThreshold, double);
+  itkGetConstMacro(RecursiveSigmaThreshold, double);
+
+  /** Set/Get whether the scales are computed from an incrementally smoothed scale-space instead of
+   * from the input. Requires an ascending sigma array. Default is off. */
+  itkSetMacro(UseIncrementalScaleSpace, bool);
+  itkGetConstMacro(UseIncrementalScaleSpace, bool);
+  itkBooleanMacro(UseIncrementalScaleSpace);
+
+  /** Set/Get whether the index of the sigma value giving the maximum response is written to
+   * GetScaleOutput( ). At most 256 sigma values can be indexed. Default is off. */
+  itkSetMacro(GenerateScaleOutput, bool);
+  itkGetConstMacro(GenerateScaleOutput, bool);
+  itkBooleanMacro(GenerateScaleOutput);
+
+  /** Set/Get whether the unsharp mask of KrcahPreprocessingImageToImageFilter is applied by the hessian
+   * kernels. Default is off. */
+  itkSetMacro(UsePreprocessing, bool);
+  itkGetConstMacro(UsePreprocessing, bool);
+  itkBooleanMacro(UsePreprocessing);
+
+  /** Set/Get the sigma and the constant k of the unsharp mask, as in KrcahPreprocessingImageToImageFilter.
+   * Defaults are 1 and 10. */
+  itkSetMacro(PreprocessingSigma, SigmaType);
+  itkGetConstMacro(PreprocessingSigma, SigmaType);
+  itkSetMacro(PreprocessingScalingConstant, double);
+  itkGetConstMacro(PreprocessingScalingConstant, double);
+
+  /** Set/Get the largest radius, in pixels, of the hessian kernels before a scale is computed on a coarser
+   * working grid. Default is 0, every scale is computed on the grid of the input. */
+  itkSetMacro(MaximumKernelRadius, SizeValueType);
+  itkGetConstMacro(MaximumKernelRadius, SizeValueType);
+
+  /** Integer factors by which the working grid of a scale bins the input along each direction */
+  using ShrinkFactorsType = FixedArray<unsigned int, ImageDimension>;
+
+  /** The factors of the working grid of sigma for an input of the given spacing and size. Every factor is one
+   * when the scale is computed on the input grid. */
+  ShrinkFactorsType
+  ComputeWorkingGridShrinkFactors(SigmaType                                    sigma,
+                                  const typename InputImageType::SpacingType & spacing,
+                                  const typename InputImageType::SizeType &    size) const;
+
+  /** Get the image of the index of the sigma value giving the maximum response. */
+  ScaleImageType *
+  GetScaleOutput();
+  const ScaleImageType *
+  GetScaleOutput() const;
+
   /**
    * Static methods for generating an array of sigma values. Note that these still need to be passed
    * into the class using SetSigmaArray. Implementation taken from itkMultiScaleHessianBasedMeasureImageFilter.
@@ -189,24 +509,144 @@ protected:
   void
   GenerateData() override;
 
-  /** Internal function to generate the response at a scale */
-  inline typename TOutputImage::Pointer
-  generateResponseAtScale(SigmaStepsType scaleLevel);
+  /** Create the measure output and the scale output */
+  using DataObjectPointer = ProcessObject::DataObjectPointer;
+  using DataObjectPointerArraySizeType = ProcessObject::DataObjectPointerArraySizeType;
+  using Superclass::MakeOutput;
+  DataObjectPointer
+  MakeOutput(DataObjectPointerArraySizeType idx) override;
+
+  /** Internal function to generate the response at a scale and fold it into the output. With estimateParameters
+   * the parameters are not cached: tiles estimate them in a pre-pass, stages through the estimation filter. */
+  inline void
+  generateResponseAtScale(SigmaStepsType scaleLevel, const OutputImageRegionType & region, bool estimateParameters);
+
+  /** Internal function to generate the response at a scale one tile at a time. With estimateParameters the
+   * parameters are first estimated over region in a streamed pre-pass, once for every tile. */
+  void
+  generateTiledResponseAtScale(SigmaStepsType               scaleLevel,
+                               const OutputImageRegionType & region,
+                               bool                          estimateParameters);
+
+  /** Internal function to generate the response of every scale one tile at a time, from the cached parameters */
+  void
+  generateTileMajorResponse(const OutputImageRegionType & region);
+
+  /** Internal function to generate the response of every scale from the eigenvalues and parameters kept for its
+   * sigma, computing only those which are missing or out of date. With estimationModified every parameter is. */
+  void
+  generateCachedResponse(const OutputImageRegionType & region, bool estimationModified);
+
+  /** Set the sigma of scaleLevel on the hessian and connect the eigenanalysis to it. With an
+   * incremental scale-space the scale-space is first smoothed up to scaleLevel over region. */
+  void
+  PrepareHessianAtScale(SigmaStepsType scaleLevel, const OutputImageRegionType & region);
+
+  /** How a hessian convolving the input with sigma computes its components given the backend */
+  typename HessianFilterType::HessianComputationEnum
+  SelectHessianComputation(SigmaType sigma) const;
+
+  /** Smooth the scale-space image, or the input when there is none, to scaleSpaceSigma over region */
+  void
+  AdvanceScaleSpace(SigmaType scaleSpaceSigma, const InputImageRegionType & region);
+
+  /** Convolve region of image along direction with the smoothing kernel of sigma into a new image */
+  template <typename TImage>
+  typename ScaleSpaceImageType::Pointer
+  SmoothAlongDirection(const TImage *               image,
+                       unsigned int                 direction,
+                       SigmaType                    sigma,
+                       const InputImageRegionType & region);
+
+  /** True when some scale of the sigma array is computed on a working grid of the input */
+  bool
+  UsesWorkingGrids() const;
+
+  /** True when scaleLevel is computed on a working grid of the input */
+  bool
+  IsComputedOnWorkingGrid(SigmaStepsType scaleLevel) const;
+
+  /** Compute the measure of every scale with a working grid over all of that grid, with its own parameters */
+  void
+  ComputeWorkingGridResponses();
+
+  /** Interpolate the measure of a scale computed on its working grid onto region of the output and fold it in.
+   * False, and nothing is done, when the scale is computed on the input grid. */
+  bool
+  FoldWorkingGridResponse(SigmaStepsType scaleLevel, const OutputImageRegionType & region);
+
+  /** Radius of the input needed around an output region to compute every scale */
+  typename InputImageType::SizeType
+  ComputeInputRadius(const typename InputImageType::SpacingType & spacing) const;
+
+  /** Fold the response at a scale into the maximum over scales held by the output */
+  void
+  FoldResponseAtScale(const TOutputImage * response, const OutputImageRegionType & region, SigmaStepsType scaleLevel);
+
+  /** The plan of an update of requestedRegion: the settings of the filter, or with a memory budget the plan
+   * with the fewest tiles and estimation divisions and the most cached scales which fits in it. Needs the
+   * rasterized mask. */
+  ExecutionPlanType
+  PlanExecution(const OutputImageRegionType & requestedRegion) const;
+
+  /** Peak memory of the internal images and the outputs of an update of requestedRegion following plan */
+  SizeValueType
+  EstimatePeakMemory(const OutputImageRegionType & requestedRegion, const ExecutionPlanType & plan) const;
+
+  /** Memory of the temporary images the hessian convolves through for a padded region of paddedPixels */
+  SizeValueType
+  EstimateHessianWorkspace(SizeValueType paddedPixels, bool tiled) const;
+
+  /** Wall and CPU clocks at the start of a stage */
+  struct StageClockType
+  {
+    std::chrono::steady_clock::time_point Wall;
+    std::clock_t                          CPU;
+  };
+
+  /** Read the clocks, when profiling */
+  StageClockType
+  StartStage() const;
+
+  /** Record a stage started at start for the current scale, when profiling */
+  void
+  EndStage(const char * stage, const StageClockType & start, SizeValueType bytesRead, SizeValueType bytesAllocated);
+
+  /** Record every run of filter as stage, until the end of the update */
+  template <typename TFilter>
+  void
+  ObserveStage(TFilter * filter, const char * stage, bool allocatesOutput);
+
+  /** Split a region into tiles of at most the tile size of the execution plan */
+  std::vector<OutputImageRegionType>
+  SplitIntoTiles(const OutputImageRegionType & region) const;
 
   /** Internal function to convert types for EigenValueOrder */
   InternalEigenValueOrderType
   ConvertType(ExternalEigenValueOrderType order);
 
-  /** Override since the filter needs all the data for the algorithm */
+  /** The parameters are estimated over the whole image, so the first update needs all of the
+   * input. Once they are cached, a region of the output needs the input padded by the radius of the
+   * widest hessian kernel. */
   void
   GenerateInputRequestedRegion() override;
 
+  /** The region the internal pipeline runs over: the requested output region, cropped to the
+   * bounding box of the rasterized mask when there is a mask. Empty when the mask is empty. */
   OutputImageRegionType
   GetOutputRegion();
 
-  /** Override since the filter produces all of its output */
+  /** Crop region to the bounding box of the rasterized mask when there is a mask */
+  OutputImageRegionType
+  CropToMask(const OutputImageRegionType & region) const;
+
+  /** Estimate the parameters of every scale over region and cache them */
   void
-  EnlargeOutputRequestedRegion(DataObject * data) override;
+  EstimateParameters(const OutputImageRegionType & region);
+
+  /** True when the cached parameters are newer than everything they depend on */
+  bool
+  IsParameterCacheValid() const;
 
   void
   PrintSelf(std::ostream & os, Indent indent) const override;
@@ -215,13 +655,93 @@ private:
   /** Internal filters. */
   typename HessianFilterType::Pointer                           m_HessianFilter;
   typename EigenAnalysisFilterType::Pointer                     m_EigenAnalysisFilter;
-  typename MaximumAbsoluteValueFilterType::Pointer              m_MaximumAbsoluteValueFilter;
   typename EigenToMeasureImageFilterType::Pointer               m_EigenToMeasureImageFilter;
   typename EigenToMeasureParameterEstimationFilterType::Pointer m_EigenToMeasureParameterEstimationFilter;
 
+  /** The image whose buffer the output shares, when there is one. */
+  typename OutputImageType::Pointer m_PreallocatedOutput;
+
+  /** Hessian of the scale-space image and the scale-space image with the sigma it is smoothed with. */
+  typename ScaleSpaceHessianFilterType::Pointer m_ScaleSpaceHessianFilter;
+  typename ScaleSpaceImageType::Pointer         m_ScaleSpaceImage;
+  SigmaType                                     m_ScaleSpaceSigma{ 0.0 };
+
+  /** The mask rasterized onto the grid of the input, shared by every stage, with the mask, its MTime and the
+   * geometry of the input it was rasterized from. The mask is only compared by address, never dereferenced. */
+  typename MaskRunsType::Pointer         m_MaskRuns;
+  const MaskSpatialObjectType *          m_MaskRunsMask{ nullptr };
+  ModifiedTimeType                       m_MaskRunsMaskTime{ 0 };
+  typename InputImageType::PointType     m_MaskRunsOrigin;
+  typename InputImageType::SpacingType   m_MaskRunsSpacing;
+  typename InputImageType::DirectionType m_MaskRunsDirection;
+
+  /** Parameters estimated over the whole image for every scale, reused by every streamed region. */
+  std::vector<ParameterArrayType> m_ParameterCache;
+  TimeStamp                       m_ParameterCacheTime;
+
   /** Sigma member variables. */
   SigmaArrayType m_SigmaArray;
 
+  /** The eigenvalues over the whole image and the parameters of a scale, with the mask they were estimated in */
+  struct ScaleCacheEntryType
+  {
+    typename EigenValueImageType::Pointer EigenValues;
+    TimeStamp                             EigenValuesTime;
+    ParameterArrayType                    Parameters;
+    TimeStamp                             ParametersTime;
+    const MaskSpatialObjectType *         Mask{ nullptr };
+    bool                                  HasParameters{ false };
+  };
+
+  /** Everything besides the sigma and the input the eigenvalues of a scale depend on */
+  using HessianSettingsType =
+    std::tuple<HessianBackendEnum, double, bool, SigmaType, double, InternalEigenValueOrderType>;
+
+  /** Scale cache member variables, keyed by sigma. */
+  bool                                     m_CacheScales{ false };
+  std::map<SigmaType, ScaleCacheEntryType> m_ScaleCache;
+  HessianSettingsType                      m_ScaleCacheSettings;
+  ModifiedTimeType                         m_ScaleCacheEstimationTime{ 0 };
+
+  /** Staged execution member variables. */
+  bool m_GraftEigenValues{ false };
+
+  /** Tiled execution member variables. */
+  bool         m_UseTiledExecution{ false };
+  TileSizeType m_TileSize;
+  bool         m_UseTileMajorOrder{ false };
+  bool         m_UseOutOfCoreExecution{ false };
+
+  /** Memory budget member variables. */
+  SizeValueType     m_MemoryBudget{ 0 };
+  ExecutionPlanType m_ExecutionPlan;
+
+  /** Profiling member variables. The scale level is the one the stages are currently run for. */
+  bool                                            m_CollectProfile{ false };
+  ProfileType                                     m_Profile;
+  std::chrono::steady_clock::time_point           m_ProfileStart;
+  SigmaStepsType                                  m_ProfileScaleLevel{ 0 };
+  std::vector<std::pair<Object *, unsigned long>> m_ProfileObservers;
+
+  /** Scale output member variables. */
+  bool m_GenerateScaleOutput{ false };
+
+  /** Scale-space member variables. */
+  bool m_UseIncrementalScaleSpace{ false };
+
+  /** Hessian backend member variables. */
+  HessianBackendEnum m_HessianBackend{ HessianBackendEnum::DiscreteGaussian };
+  double             m_RecursiveSigmaThreshold{ 4.0 };
+
+  /** Working grid member variables. The measure of every scale computed on a working grid, null for the others. */
+  SizeValueType                               m_MaximumKernelRadius{ 0 };
+  std::vector<typename TOutputImage::Pointer> m_WorkingGridResponses;
+
+  /** Preprocessing member variables. */
+  bool      m_UsePreprocessing{ false };
+  SigmaType m_PreprocessingSigma{ 1.0 };
+  double    m_PreprocessingScalingConstant{ 10.0 };
+
 }; // end of class
 } // end namespace itk
 
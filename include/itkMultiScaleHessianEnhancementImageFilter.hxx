@@ -21,29 +21,77 @@
 #include "itkMultiScaleHessianEnhancementImageFilter.h"
 #include "itkMath.h"
 #include "itkProgressAccumulator.h"
+#include "itkBinShrinkImageFilter.h"
+#include "itkLinearInterpolateImageFunction.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageRegionIterator.h"
+#include "itkSeparableConvolutionAlgorithm.h"
+#include <algorithm>
+#include <memory>
 
 namespace itk
 {
-template <typename TInputImage, typename TOutputImage>
-MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::MultiScaleHessianEnhancementImageFilter()
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  MultiScaleHessianEnhancementImageFilter()
 {
   /* Sigma member variables */
   m_SigmaArray.SetSize(0);
 
+  /* Tiled execution member variables */
+  m_TileSize.Fill(64);
+  m_ExecutionPlan.TileSize = m_TileSize;
+
   /* Instantiate filters. */
   m_HessianFilter = HessianFilterType::New();
+  m_ScaleSpaceHessianFilter = ScaleSpaceHessianFilterType::New();
   m_EigenAnalysisFilter = EigenAnalysisFilterType::New();
-  m_MaximumAbsoluteValueFilter = MaximumAbsoluteValueFilterType::New();
   m_EigenToMeasureImageFilter = nullptr;               // has to be provided by the user.
   m_EigenToMeasureParameterEstimationFilter = nullptr; // has to be provided by the user.
+  m_MaskRuns = MaskRunsType::New();
 
   /* We require an input image */
   this->SetNumberOfRequiredInputs(1);
+
+  /* The second output holds the scale of the maximum response */
+  this->SetNumberOfRequiredOutputs(2);
+  this->SetNthOutput(1, this->MakeOutput(1));
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  DataObjectPointer
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::MakeOutput(
+  DataObjectPointerArraySizeType idx)
+{
+  if (idx == 1)
+  {
+    return ScaleImageType::New().GetPointer();
+  }
+  return Superclass::MakeOutput(idx);
 }
 
-template <typename TInputImage, typename TOutputImage>
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  ScaleImageType *
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::GetScaleOutput()
+{
+  return dynamic_cast<ScaleImageType *>(this->ProcessObject::GetOutput(1));
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+const typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  ScaleImageType *
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::GetScaleOutput() const
+{
+  return dynamic_cast<const ScaleImageType *>(this->ProcessObject::GetOutput(1));
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
 void
-MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::GenerateInputRequestedRegion()
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  GenerateInputRequestedRegion()
 {
   Superclass::GenerateInputRequestedRegion();
 
@@ -55,51 +103,25 @@ MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::GenerateInpu
     return;
   }
 
-  inputPtr->SetRequestedRegionToLargestPossibleRegion();
+  /* The parameters have to be estimated over the whole image first, unless the estimation streams the input
+   * itself, and the recursive filters and the working grids need all of it */
+  if ((!this->IsParameterCacheValid() && !m_UseOutOfCoreExecution) ||
+      m_HessianBackend == HessianBackendEnum::RecursiveGaussian || this->UsesWorkingGrids())
+  {
+    inputPtr->SetRequestedRegionToLargestPossibleRegion();
+    return;
+  }
+
+  /* Pad the output requested region by the support of every scale */
+  typename TInputImage::RegionType inputRequestedRegion = inputPtr->GetRequestedRegion();
+  inputRequestedRegion.PadByRadius(this->ComputeInputRadius(inputPtr->GetSpacing()));
+  inputRequestedRegion.Crop(inputPtr->GetLargestPossibleRegion());
+  inputPtr->SetRequestedRegion(inputRequestedRegion);
 }
 
-template <typename TInputImage, typename TOutputImage>
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
 void
-MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::EnlargeOutputRequestedRegion(DataObject * data)
-{
-  Superclass::EnlargeOutputRequestedRegion(data);
-  OutputImagePointer imgData = dynamic_cast<TOutputImage *>(data);
-
-  // if ( this->GetInput() )
-  // {
-  //   OutputImageRegionType region = this->GetOutputRegion();
-  //   // crop the input requested region at the input's largest possible region
-  //   if ( region.Crop( imgData->GetLargestPossibleRegion() ) )
-  //   {
-  //     imgData->SetRequestedRegion(region);
-  //     return;
-  //   }
-  //   else
-  //   {
-  //     // Couldn't crop the region (requested region is outside the largest
-  //     // possible region).  Throw an exception.
-
-  //     // store what we tried to request (prior to trying to crop)
-  //     imgData->SetRequestedRegion(region);
-
-  //     // build an exception
-  //     InvalidRequestedRegionError e(__FILE__, __LINE__);
-  //     e.SetLocation(ITK_LOCATION);
-  //     e.SetDescription("Requested region is (at least partially) outside the largest possible region.");
-  //     e.SetDataObject(imgData);
-  //     throw e;
-  //   }
-  // }
-  // else
-  if (imgData)
-  {
-    imgData->SetRequestedRegionToLargestPossibleRegion();
-  }
-}
-
-template <typename TInputImage, typename TOutputImage>
-void
-MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::GenerateData()
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::GenerateData()
 {
   /* Test all inputs are set */
   if (!m_EigenToMeasureImageFilter)
@@ -118,141 +140,1525 @@ MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::GenerateData
                       << m_SigmaArray.GetSize());
   }
 
+  if (m_GenerateScaleOutput &&
+      m_SigmaArray.GetSize() > static_cast<SizeValueType>(NumericTraits<ScalePixelType>::max()) + 1)
+  {
+    itkExceptionMacro(<< "The scale output can index at most " << NumericTraits<ScalePixelType>::max() + 1
+                      << " sigma values. Given array of size " << m_SigmaArray.GetSize());
+  }
+
+  if (m_PreallocatedOutput && m_PreallocatedOutput->GetBufferedRegion() != this->GetOutput()->GetRequestedRegion())
+  {
+    itkExceptionMacro(<< "The PreallocatedOutput buffers " << m_PreallocatedOutput->GetBufferedRegion()
+                      << " instead of the requested region " << this->GetOutput()->GetRequestedRegion());
+  }
+
+  /* Every update rewires the estimation filter, so only a change made since the last one invalidates the cached
+   * parameters of the scales */
+  const bool estimationModified = (m_EigenToMeasureParameterEstimationFilter->GetMTime() != m_ScaleCacheEstimationTime);
+
+  if (m_UseIncrementalScaleSpace && m_UseOutOfCoreExecution)
+  {
+    itkExceptionMacro(<< "UseIncrementalScaleSpace cannot be combined with UseOutOfCoreExecution.");
+  }
+
+  if (m_MaximumKernelRadius > 0 && (m_UseIncrementalScaleSpace || m_UseOutOfCoreExecution))
+  {
+    itkExceptionMacro(<< "MaximumKernelRadius cannot be combined with UseIncrementalScaleSpace or "
+                      << "UseOutOfCoreExecution.");
+  }
+
+  if (m_UseIncrementalScaleSpace)
+  {
+    for (SigmaStepsType i = 1; i < m_SigmaArray.GetSize(); ++i)
+    {
+      if (m_SigmaArray.GetElement(i) < m_SigmaArray.GetElement(i - 1))
+      {
+        itkExceptionMacro(<< "UseIncrementalScaleSpace requires an ascending SigmaArray. Given " << m_SigmaArray);
+      }
+    }
+  }
+
   /* Set filters parameters */
   m_HessianFilter->SetNormalizeAcrossScale(true);
-  m_EigenAnalysisFilter->SetDimension(ImageDimension);
-  m_EigenAnalysisFilter->OrderEigenValuesBy(this->ConvertType(m_EigenToMeasureImageFilter->GetEigenValueOrder()));
+  m_EigenAnalysisFilter->SetEigenValueOrder(this->ConvertType(m_EigenToMeasureImageFilter->GetEigenValueOrder()));
+  m_ScaleSpaceHessianFilter->SetNormalizeAcrossScale(true);
+
+  /* The unsharp mask is applied by the hessian kernels */
+  const double scalingConstant = m_UsePreprocessing ? m_PreprocessingScalingConstant : 0.0;
+  m_HessianFilter->SetUnsharpMaskSigma(m_PreprocessingSigma);
+  m_HessianFilter->SetUnsharpMaskScalingConstant(scalingConstant);
+  m_ScaleSpaceHessianFilter->SetUnsharpMaskSigma(m_PreprocessingSigma);
+  m_ScaleSpaceHessianFilter->SetUnsharpMaskScalingConstant(scalingConstant);
+
+  /* Every scale of the input shares one spectrum, padded for the largest sigma */
+  const bool useFourierTransform = (m_HessianBackend == HessianBackendEnum::FourierTransform);
+  SigmaType  maximumSigma = m_SigmaArray.GetElement(0);
+  for (SigmaStepsType i = 1; i < m_SigmaArray.GetSize(); ++i)
+  {
+    maximumSigma = std::max(maximumSigma, m_SigmaArray.GetElement(i));
+  }
+  if (m_UsePreprocessing)
+  {
+    maximumSigma = std::sqrt(maximumSigma * maximumSigma + m_PreprocessingSigma * m_PreprocessingSigma);
+  }
+  m_HessianFilter->SetCacheInputSpectrum(useFourierTransform);
+  m_HessianFilter->SetSpectrumPaddingSigma(useFourierTransform ? maximumSigma : 0.0);
+
+  /* Observe every stage while profiling, the observers are removed however the update ends */
+  struct ObserverGuard
+  {
+    std::vector<std::pair<Object *, unsigned long>> & Observers;
+    ~ObserverGuard()
+    {
+      for (const auto & observer : Observers)
+      {
+        observer.first->RemoveObserver(observer.second);
+      }
+      Observers.clear();
+    }
+  } observerGuard{ m_ProfileObservers };
+
+  m_Profile.clear();
+  m_ProfileStart = std::chrono::steady_clock::now();
+  if (m_CollectProfile)
+  {
+    this->ObserveStage(m_HessianFilter.GetPointer(), "Hessian", true);
+    this->ObserveStage(m_ScaleSpaceHessianFilter.GetPointer(), "Hessian", true);
+    this->ObserveStage(m_EigenAnalysisFilter.GetPointer(), "EigenAnalysis", true);
+    this->ObserveStage(m_EigenToMeasureParameterEstimationFilter.GetPointer(), "ParameterEstimation", false);
+    this->ObserveStage(m_EigenToMeasureImageFilter.GetPointer(), "Measure", true);
+  }
 
   /* Connect filters */
   m_HessianFilter->SetInput(this->GetInput());
   m_EigenAnalysisFilter->SetInput(m_HessianFilter->GetOutput());
   m_EigenToMeasureParameterEstimationFilter->SetInput(m_EigenAnalysisFilter->GetOutput());
-  m_EigenToMeasureImageFilter->SetInput(m_EigenToMeasureParameterEstimationFilter->GetOutput());
-  m_EigenToMeasureImageFilter->SetParametersInput(m_EigenToMeasureParameterEstimationFilter->GetParametersOutput());
 
-  /* Set the mask */
+  /* Rasterize the mask once over the whole image, the stages then only walk the runs inside of it. The runs are
+   * in the index space of the input, so another mask, even an older one, or another geometry needs new runs. */
   MaskSpatialObjectTypeConstPointer mask = this->GetImageMask();
+  const InputImageType *            input = this->GetInput();
+  const OutputImageRegionType       largestRegion = this->GetOutput()->GetLargestPossibleRegion();
   if (mask)
   {
-    m_EigenToMeasureParameterEstimationFilter->SetMask(mask);
-    m_EigenToMeasureParameterEstimationFilter->SetMask(mask);
+    if (mask.GetPointer() != m_MaskRunsMask || mask->GetMTime() != m_MaskRunsMaskTime ||
+        m_MaskRuns->GetRegion() != largestRegion || input->GetOrigin() != m_MaskRunsOrigin ||
+        input->GetSpacing() != m_MaskRunsSpacing || input->GetDirection() != m_MaskRunsDirection)
+    {
+      m_MaskRuns->Rasterize(mask, input, largestRegion, this->GetMultiThreader());
+      m_MaskRunsMask = mask.GetPointer();
+      m_MaskRunsMaskTime = mask->GetMTime();
+      m_MaskRunsOrigin = input->GetOrigin();
+      m_MaskRunsSpacing = input->GetSpacing();
+      m_MaskRunsDirection = input->GetDirection();
+    }
+    m_EigenToMeasureParameterEstimationFilter->SetMaskRuns(m_MaskRuns);
+    m_EigenToMeasureImageFilter->SetMaskRuns(m_MaskRuns);
+  }
+  else
+  {
+    m_MaskRuns->Initialize();
+    m_MaskRunsMask = nullptr;
+    m_EigenToMeasureParameterEstimationFilter->SetMaskRuns(nullptr);
+    m_EigenToMeasureImageFilter->SetMaskRuns(nullptr);
   }
 
-  /* After executing we want to release data to save memory */
-  // m_HessianFilter->ReleaseDataFlagOn();
-  // m_EigenAnalysisFilter->ReleaseDataFlagOn();
-  // m_EigenToMeasureImageFilter->ReleaseDataFlagOn();
-  // m_EigenToMeasureParameterEstimationFilter->ReleaseDataFlagOn();
-  // m_MaximumAbsoluteValueFilter->ReleaseDataFlagOn();
+  /* Choose how to execute, within the memory budget when there is one */
+  m_ExecutionPlan = this->PlanExecution(this->GetOutput()->GetRequestedRegion());
+  itkDebugMacro(<< "executing " << (m_ExecutionPlan.UseTiledExecution ? "tiled" : "staged") << " with tiles of "
+                << m_ExecutionPlan.TileSize << " and " << m_ExecutionPlan.NumberOfEstimationDivisions
+                << " estimation divisions, estimated peak memory " << m_ExecutionPlan.EstimatedPeakMemory << " bytes");
+  if (m_MemoryBudget > 0)
+  {
+    m_EigenToMeasureParameterEstimationFilter->SetNumberOfStreamDivisions(
+      m_ExecutionPlan.NumberOfEstimationDivisions);
+  }
+
+  /* Each intermediate image is released once the next stage has read it */
+  m_HessianFilter->SetReleaseDataFlag(m_ExecutionPlan.ReleaseIntermediateData);
+  m_ScaleSpaceHessianFilter->SetReleaseDataFlag(m_ExecutionPlan.ReleaseIntermediateData);
+  m_EigenAnalysisFilter->SetReleaseDataFlag(m_ExecutionPlan.ReleaseIntermediateData);
+
+  /* Only the bounding box of the mask is processed, the rest of the output is zero */
+  const OutputImageRegionType processedRegion = this->GetOutputRegion();
+  const bool                  croppedToMask = (processedRegion != this->GetOutput()->GetRequestedRegion());
+
+  /*
+   * When only part of the image is requested, the tiles are visited before the scales or the input is streamed,
+   * the parameters come from a pre-pass over the whole image. Otherwise they are estimated along the way and
+   * cached for later requests. The streamed pre-pass pulls each piece of the input through the hessian.
+   */
+  const bool tileMajor = m_ExecutionPlan.UseTiledExecution && m_UseTileMajorOrder;
+  const bool useScaleCache = (m_ExecutionPlan.NumberOfCachedScales > 0);
+  const bool useParameterCache = this->IsParameterCacheValid() || tileMajor || m_UseOutOfCoreExecution ||
+                                 (this->GetOutput()->GetRequestedRegion() != largestRegion);
+
+  /* A cache the plan does not keep is freed before anything is computed */
+  if (!useScaleCache)
+  {
+    m_ScaleCache.clear();
+  }
+
+  /* The scales on a working grid are computed over all of it first, with their own parameters */
+  m_WorkingGridResponses.clear();
+  if (processedRegion.GetNumberOfPixels() > 0)
+  {
+    this->ComputeWorkingGridResponses();
+  }
+
+  if (!this->IsParameterCacheValid() && useParameterCache)
+  {
+    this->EstimateParameters(this->CropToMask(largestRegion));
+  }
+
+  /* With a scale cache, generateCachedResponse( ) wires the measure to the cached eigenvalues of every scale */
+  if (!useScaleCache && useParameterCache)
+  {
+    /* The measure reads the eigenvalues directly, with the cached parameters */
+    m_EigenToMeasureImageFilter->SetInput(m_EigenAnalysisFilter->GetOutput());
+  }
+  else if (!useScaleCache && m_ExecutionPlan.UseTiledExecution)
+  {
+    /* The estimation is a pre-pass and the measure reads the eigenvalues of each tile directly. The parameters
+     * are given as values, since a tile regenerating the eigenvalues would otherwise run the pre-pass again. */
+    m_EigenToMeasureParameterEstimationFilter->SetOutputMode(
+      EigenToMeasureParameterEstimationFilterType::OutputModeEnum::ParametersOnly);
+    m_EigenToMeasureImageFilter->SetInput(m_EigenAnalysisFilter->GetOutput());
+  }
+  else if (!useScaleCache)
+  {
+    /* The estimation streams a copy of the eigen-image on to the measure, or passes all of it without a copy. The
+     * mode is chosen for every scale by generateResponseAtScale( ). */
+    m_EigenToMeasureImageFilter->SetParametersInput(m_EigenToMeasureParameterEstimationFilter->GetParametersOutput());
+    m_EigenToMeasureImageFilter->SetInput(m_EigenToMeasureParameterEstimationFilter->GetOutput());
+  }
 
   /* Setup progress reporter */
   ProgressAccumulator::Pointer progress = ProgressAccumulator::New();
   progress->SetMiniPipelineFilter(this);
 
   /*
-   * We checked that m_SigmaArray.GetSize() > 0 above and do not need to repeat the check. However,
-   * if we are only given one sigma value we do not need to take the maximum over scales.
-   *
    * Two filters, ran m_SigmaArray.GetSize() times
-   * One filter, ran (m_SigmaArray.GetSize() - 1) times
    *
    * We do not count the hessian or eigenanalysis filters since they will be streamed many times.
    */
-  float numberOfFiltersToProcess = 2 * m_SigmaArray.GetSize() + 1 * (m_SigmaArray.GetSize() - 1);
+  float numberOfFiltersToProcess = 2 * m_SigmaArray.GetSize();
   float perFilterProccessPercentage = 1.0 / numberOfFiltersToProcess;
   itkDebugMacro(<< "each filter accounts for " << perFilterProccessPercentage * 100.0 << "% of processing");
 
-
   progress->RegisterInternalFilter(m_EigenToMeasureParameterEstimationFilter,
                                    1.5 * m_SigmaArray.GetSize() * perFilterProccessPercentage);
   progress->RegisterInternalFilter(m_EigenToMeasureImageFilter,
                                    0.5 * m_SigmaArray.GetSize() * perFilterProccessPercentage);
 
-  /* Check if we need to run the MaximumAbsoluteValueFilter at all */
-  if (m_SigmaArray.GetSize() > 1)
+  /* The maximum over scales is accumulated in place in the output */
+  OutputImageType * outputPtr = this->GetOutput();
+  outputPtr->SetBufferedRegion(outputPtr->GetRequestedRegion());
+  if (m_PreallocatedOutput)
   {
-    progress->RegisterInternalFilter(m_MaximumAbsoluteValueFilter,
-                                     (m_SigmaArray.GetSize() - 1) * perFilterProccessPercentage);
+    outputPtr->SetPixelContainer(m_PreallocatedOutput->GetPixelContainer());
+    if (croppedToMask)
+    {
+      outputPtr->FillBuffer(NumericTraits<OutputImagePixelType>::ZeroValue());
+    }
   }
   else
   {
-    itkDebugMacro(<< "maximumAbsoluteValueFilter is not being used");
+    outputPtr->Allocate(croppedToMask);
+  }
+
+  ScaleImageType * scalePtr = this->GetScaleOutput();
+  if (m_GenerateScaleOutput)
+  {
+    scalePtr->SetBufferedRegion(outputPtr->GetRequestedRegion());
+    scalePtr->Allocate(croppedToMask);
   }
 
-  /* We store a single pointer that we will graft to the output */
-  typename TOutputImage::Pointer outputImagePointer;
+  if (processedRegion.GetNumberOfPixels() > 0 && useScaleCache)
+  {
+    this->generateCachedResponse(processedRegion, estimationModified);
+  }
+  else if (processedRegion.GetNumberOfPixels() > 0 && tileMajor)
+  {
+    this->generateTileMajorResponse(processedRegion);
+  }
+  else if (processedRegion.GetNumberOfPixels() > 0)
+  {
+    /* Fold every scale into the output */
+    m_ParameterCache.resize(m_SigmaArray.GetSize());
+    for (SigmaStepsType scaleLevel = 0; scaleLevel < m_SigmaArray.GetSize(); ++scaleLevel)
+    {
+      if (this->FoldWorkingGridResponse(scaleLevel, processedRegion))
+      {
+        continue;
+      }
+      if (useParameterCache)
+      {
+        m_EigenToMeasureImageFilter->SetParameters(m_ParameterCache[scaleLevel]);
+      }
+      this->generateResponseAtScale(scaleLevel, processedRegion, !useParameterCache);
+      if (!useParameterCache)
+      {
+        m_ParameterCache[scaleLevel] = m_EigenToMeasureParameterEstimationFilter->GetParameters();
+      }
+    }
+  }
 
-  /* Process the first scale */
-  outputImagePointer = generateResponseAtScale((SigmaStepsType)0);
+  if (!useParameterCache)
+  {
+    m_ParameterCacheTime.Modified();
+  }
+
+  /* Release the scale-space, the working grids and the spectrum */
+  m_ScaleSpaceImage = nullptr;
+  m_WorkingGridResponses.clear();
+  m_ScaleSpaceSigma = 0.0;
+  m_HessianFilter->ReleaseInputSpectrum();
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+void
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::EstimateParameters(
+  const OutputImageRegionType & region)
+{
+  /* Stream the estimation over region for every scale, no image is produced */
+  m_EigenToMeasureParameterEstimationFilter->SetOutputMode(
+    EigenToMeasureParameterEstimationFilterType::OutputModeEnum::ParametersOnly);
 
-  /* Process the remaining sigma values */
-  for (SigmaStepsType scaleLevel = 1; scaleLevel < m_SigmaArray.GetSize(); ++scaleLevel)
+  m_ParameterCache.resize(m_SigmaArray.GetSize());
+  for (SigmaStepsType scaleLevel = 0; scaleLevel < m_SigmaArray.GetSize(); ++scaleLevel)
   {
-    /* Calculate next response value */
-    typename TOutputImage::Pointer tempResponseImagePointer = generateResponseAtScale(scaleLevel);
+    /* The parameters of a working grid were estimated on it */
+    if (scaleLevel < m_WorkingGridResponses.size() && m_WorkingGridResponses[scaleLevel])
+    {
+      continue;
+    }
+    if (region.GetNumberOfPixels() > 0)
+    {
+      this->PrepareHessianAtScale(scaleLevel, region);
+      m_EigenToMeasureParameterEstimationFilter->GetOutput()->SetRequestedRegion(region);
+      m_EigenToMeasureParameterEstimationFilter->Update();
+    }
+    m_ParameterCache[scaleLevel] = m_EigenToMeasureParameterEstimationFilter->GetParameters();
+  }
+
+  m_ParameterCacheTime.Modified();
+}
 
-    /* Take absolute value maximum */
-    m_MaximumAbsoluteValueFilter->SetInput1(outputImagePointer);
-    m_MaximumAbsoluteValueFilter->SetInput2(tempResponseImagePointer);
-    // m_MaximumAbsoluteValueFilter->GetOutput()->SetRequestedRegion(this->GetOutputRegion());
-    m_MaximumAbsoluteValueFilter->Update();
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+bool
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  IsParameterCacheValid() const
+{
+  const InputImageType * input = this->GetInput();
+  if (!input || !m_EigenToMeasureParameterEstimationFilter || m_ParameterCache.size() != m_SigmaArray.GetSize())
+  {
+    return false;
+  }
 
-    /* Save max and go to next sigma value */
-    outputImagePointer = m_MaximumAbsoluteValueFilter->GetOutput();
+  /* Regenerating regions of a pipeline input changes its MTime, but not its pipeline MTime */
+  ModifiedTimeType dependencies = std::max(this->GetMTime(), m_EigenToMeasureParameterEstimationFilter->GetMTime());
+  dependencies = std::max(dependencies, input->GetSource() ? input->GetPipelineMTime() : input->GetMTime());
+  if (const MaskSpatialObjectType * mask = this->GetImageMask())
+  {
+    dependencies = std::max(dependencies, mask->GetMTime());
   }
 
-  /* Graft output and we're done! */
-  this->GraftOutput(outputImagePointer);
+  return m_ParameterCacheTime.GetMTime() > dependencies;
 }
 
-template <typename TInputImage, typename TOutputImage>
-typename TOutputImage::Pointer
-MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::generateResponseAtScale(SigmaStepsType scaleLevel)
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+void
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::generateResponseAtScale(
+  SigmaStepsType                scaleLevel,
+  const OutputImageRegionType & region,
+  bool                          estimateParameters)
 {
-  /* Get this sigma value */
-  SigmaType thisSigma = m_SigmaArray.GetElement(scaleLevel);
+  if (m_ExecutionPlan.UseTiledExecution)
+  {
+    this->generateTiledResponseAtScale(scaleLevel, region, estimateParameters);
+    return;
+  }
 
-  /* Process pipeline and return */
-  m_HessianFilter->SetSigma(thisSigma);
-  // m_EigenToMeasureImageFilter->GetOutput()->SetRequestedRegion(this->GetOutputRegion());
+  /* Process pipeline and fold into the output */
+  this->PrepareHessianAtScale(scaleLevel, region);
+  if (estimateParameters)
+  {
+    /* The recursive filters compute the whole image for any piece, so their eigenvalues are not streamed */
+    const bool      fromScaleSpace = (m_EigenAnalysisFilter->GetInput() == m_ScaleSpaceHessianFilter->GetOutput());
+    const SigmaType hessianSigma = m_SigmaArray.GetElement(fromScaleSpace ? 0 : scaleLevel);
+    const bool      recursive =
+      (this->SelectHessianComputation(hessianSigma) == HessianFilterType::HessianComputationEnum::RecursiveGaussian);
+    m_EigenToMeasureParameterEstimationFilter->SetOutputMode(
+      (m_GraftEigenValues || recursive) ? EigenToMeasureParameterEstimationFilterType::OutputModeEnum::GraftInput
+                                        : EigenToMeasureParameterEstimationFilterType::OutputModeEnum::CopyInput);
+  }
+  m_EigenToMeasureImageFilter->GetOutput()->SetRequestedRegion(region);
   m_EigenToMeasureImageFilter->Update();
-  return m_EigenToMeasureImageFilter->GetOutput();
+  this->FoldResponseAtScale(m_EigenToMeasureImageFilter->GetOutput(), region, scaleLevel);
 }
 
-template <typename TInputImage, typename TOutputImage>
-typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::OutputImageRegionType
-MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::GetOutputRegion()
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+void
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  generateTiledResponseAtScale(
+  SigmaStepsType                scaleLevel,
+  const OutputImageRegionType & region,
+  bool                          estimateParameters)
 {
-  /* Create region */
-  OutputImageRegionType region;
+  this->PrepareHessianAtScale(scaleLevel, region);
 
-  /* Get and test input */
-  InputImagePointer inputPtr = const_cast<TInputImage *>(this->GetInput());
+  /* Estimate the parameters over the whole region once, unless they are cached. This streams and produces no
+   * image. */
+  if (estimateParameters)
+  {
+    m_EigenToMeasureParameterEstimationFilter->GetOutput()->SetRequestedRegion(region);
+    m_EigenToMeasureParameterEstimationFilter->Update();
+    m_EigenToMeasureImageFilter->SetParameters(m_EigenToMeasureParameterEstimationFilter->GetParameters());
+  }
 
-  if (!inputPtr)
+  /* Run hessian, eigenanalysis and measure for one tile at a time and fold each tile into the output */
+  TOutputImage * measure = m_EigenToMeasureImageFilter->GetOutput();
+  for (const OutputImageRegionType & tile : this->SplitIntoTiles(region))
+  {
+    measure->SetRequestedRegion(tile);
+    measure->Update();
+    this->FoldResponseAtScale(measure, tile, scaleLevel);
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+void
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  generateTileMajorResponse(const OutputImageRegionType & region)
+{
+  /*
+   * Run every scale over one tile before moving on. The scale-space is built over the padded tile and advanced
+   * from scale to scale, and the spectrum of the padded tile is shared by every scale.
+   */
+  TOutputImage * measure = m_EigenToMeasureImageFilter->GetOutput();
+  for (const OutputImageRegionType & tile : this->SplitIntoTiles(region))
+  {
+    for (SigmaStepsType scaleLevel = 0; scaleLevel < m_SigmaArray.GetSize(); ++scaleLevel)
+    {
+      if (this->FoldWorkingGridResponse(scaleLevel, tile))
+      {
+        continue;
+      }
+      m_EigenToMeasureImageFilter->SetParameters(m_ParameterCache[scaleLevel]);
+      this->PrepareHessianAtScale(scaleLevel, tile);
+      measure->SetRequestedRegion(tile);
+      measure->Update();
+      this->FoldResponseAtScale(measure, tile, scaleLevel);
+    }
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+void
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  generateCachedResponse(const OutputImageRegionType & region, bool estimationModified)
+{
+  const InputImageType *        input = this->GetInput();
+  const MaskSpatialObjectType * mask = this->GetImageMask();
+  const OutputImageRegionType   largestRegion = this->GetOutput()->GetLargestPossibleRegion();
+  const ModifiedTimeType        inputTime = input->GetSource() ? input->GetPipelineMTime() : input->GetMTime();
+
+  /* Eigenvalues computed with other hessian settings are of no use */
+  const HessianSettingsType settings(m_HessianBackend,
+                                     m_RecursiveSigmaThreshold,
+                                     m_UsePreprocessing,
+                                     m_PreprocessingSigma,
+                                     m_PreprocessingScalingConstant,
+                                     m_EigenAnalysisFilter->GetEigenValueOrder());
+  if (settings != m_ScaleCacheSettings)
+  {
+    m_ScaleCache.clear();
+    m_ScaleCacheSettings = settings;
+  }
+
+  /* Forget the sigma values which are no longer in the array, and those beyond the scales the plan keeps */
+  std::map<SigmaType, ScaleCacheEntryType> cache;
+  SizeValueType                            keptScales = 0;
+  for (SigmaStepsType scaleLevel = 0; scaleLevel < m_SigmaArray.GetSize(); ++scaleLevel)
+  {
+    if (this->IsComputedOnWorkingGrid(scaleLevel) || keptScales++ >= m_ExecutionPlan.NumberOfCachedScales)
+    {
+      continue;
+    }
+    auto entry = m_ScaleCache.find(m_SigmaArray.GetElement(scaleLevel));
+    if (entry != m_ScaleCache.end())
+    {
+      cache.insert(*entry);
+    }
+  }
+  m_ScaleCache.swap(cache);
+  keptScales = 0;
+
+  m_EigenToMeasureParameterEstimationFilter->SetOutputMode(
+    EigenToMeasureParameterEstimationFilterType::OutputModeEnum::ParametersOnly);
+  m_ParameterCache.resize(m_SigmaArray.GetSize());
+  for (SigmaStepsType scaleLevel = 0; scaleLevel < m_SigmaArray.GetSize(); ++scaleLevel)
+  {
+    m_ProfileScaleLevel = scaleLevel;
+    if (this->FoldWorkingGridResponse(scaleLevel, region))
+    {
+      /* Recomputed on its working grid every update */
+      m_ScaleCache.erase(m_SigmaArray.GetElement(scaleLevel));
+      continue;
+    }
+    ScaleCacheEntryType & entry = m_ScaleCache[m_SigmaArray.GetElement(scaleLevel)];
+
+    /* The eigenvalues are computed over the whole image, so a new mask never needs the hessian */
+    if (!entry.EigenValues || entry.EigenValuesTime.GetMTime() < inputTime ||
+        !entry.EigenValues->GetBufferedRegion().IsInside(largestRegion))
+    {
+      this->PrepareHessianAtScale(scaleLevel, largestRegion);
+      m_EigenAnalysisFilter->GetOutput()->SetRequestedRegion(largestRegion);
+      m_EigenAnalysisFilter->Update();
+      entry.EigenValues = m_EigenAnalysisFilter->GetOutput();
+      entry.EigenValues->DisconnectPipeline();
+      entry.EigenValues->ReleaseDataFlagOff();
+      entry.EigenValuesTime.Modified();
+      entry.HasParameters = false;
+    }
+
+    if (!entry.HasParameters || estimationModified || entry.Mask != mask ||
+        (mask && entry.ParametersTime.GetMTime() < mask->GetMTime()))
+    {
+      m_EigenToMeasureParameterEstimationFilter->SetInput(entry.EigenValues);
+      m_EigenToMeasureParameterEstimationFilter->GetOutput()->SetRequestedRegion(region);
+      m_EigenToMeasureParameterEstimationFilter->Update();
+      entry.Parameters = m_EigenToMeasureParameterEstimationFilter->GetParameters();
+      entry.ParametersTime.Modified();
+      entry.Mask = mask;
+      entry.HasParameters = true;
+    }
+    m_ParameterCache[scaleLevel] = entry.Parameters;
+
+    /* Only the measure and the fold run for every scale */
+    m_EigenToMeasureImageFilter->SetInput(entry.EigenValues);
+    m_EigenToMeasureImageFilter->SetParameters(entry.Parameters);
+    m_EigenToMeasureImageFilter->GetOutput()->SetRequestedRegion(region);
+    m_EigenToMeasureImageFilter->Update();
+    this->FoldResponseAtScale(m_EigenToMeasureImageFilter->GetOutput(), region, scaleLevel);
+
+    /* The scales beyond those which fit in the memory budget are not kept */
+    if (this->IsComputedOnWorkingGrid(scaleLevel) || keptScales++ >= m_ExecutionPlan.NumberOfCachedScales)
+    {
+      m_EigenToMeasureImageFilter->SetInput(m_EigenAnalysisFilter->GetOutput());
+      m_EigenToMeasureParameterEstimationFilter->SetInput(m_EigenAnalysisFilter->GetOutput());
+      m_ScaleCache.erase(m_SigmaArray.GetElement(scaleLevel));
+    }
+  }
+  m_ScaleCacheEstimationTime = m_EigenToMeasureParameterEstimationFilter->GetMTime();
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+void
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::PrepareHessianAtScale(
+  SigmaStepsType                scaleLevel,
+  const OutputImageRegionType & region)
+{
+  const SigmaType thisSigma = m_SigmaArray.GetElement(scaleLevel);
+  const SigmaType smallestSigma = m_SigmaArray.GetElement(0);
+  m_ProfileScaleLevel = scaleLevel;
+
+  /* The scale-space image at this scale leaves the derivative kernels of the smallest sigma to the hessian */
+  const SigmaType scaleSpaceSigma =
+    m_UseIncrementalScaleSpace ? std::sqrt(std::max(0.0, thisSigma * thisSigma - smallestSigma * smallestSigma))
+                               : 0.0;
+  if (scaleSpaceSigma > 0.0)
+  {
+    /* Every scale reads through the same padded region, start over for another region or a smaller sigma */
+    const InputImageType * input = this->GetInput();
+    InputImageRegionType   paddedRegion = region;
+    paddedRegion.PadByRadius(this->ComputeInputRadius(input->GetSpacing()));
+    paddedRegion.Crop(input->GetBufferedRegion());
+    if (!m_ScaleSpaceImage || m_ScaleSpaceSigma > scaleSpaceSigma ||
+        m_ScaleSpaceImage->GetBufferedRegion() != paddedRegion)
+    {
+      m_ScaleSpaceImage = nullptr;
+      m_ScaleSpaceSigma = 0.0;
+    }
+    if (scaleSpaceSigma > m_ScaleSpaceSigma)
+    {
+      this->AdvanceScaleSpace(scaleSpaceSigma, paddedRegion);
+    }
+
+    m_ScaleSpaceHessianFilter->SetInput(m_ScaleSpaceImage);
+    m_ScaleSpaceHessianFilter->SetSigma(thisSigma);
+    m_ScaleSpaceHessianFilter->SetInputSigma(m_ScaleSpaceSigma);
+    m_ScaleSpaceHessianFilter->SetHessianComputation(
+      static_cast<typename ScaleSpaceHessianFilterType::HessianComputationEnum>(
+        this->SelectHessianComputation(smallestSigma)));
+    m_EigenAnalysisFilter->SetInput(m_ScaleSpaceHessianFilter->GetOutput());
+  }
+  else
+  {
+    m_HessianFilter->SetSigma(thisSigma);
+    m_HessianFilter->SetHessianComputation(this->SelectHessianComputation(thisSigma));
+    m_EigenAnalysisFilter->SetInput(m_HessianFilter->GetOutput());
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  HessianFilterType::HessianComputationEnum
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  SelectHessianComputation(SigmaType sigma) const
+{
+  using HessianComputationEnum = typename HessianFilterType::HessianComputationEnum;
+
+  const HessianComputationEnum discrete = m_ExecutionPlan.UseTiledExecution
+                                            ? HessianComputationEnum::SharedSeparablePasses
+                                            : HessianComputationEnum::IndependentComponents;
+  switch (m_HessianBackend)
+  {
+    case HessianBackendEnum::DiscreteGaussian:
+      return discrete;
+    case HessianBackendEnum::RecursiveGaussian:
+      return HessianComputationEnum::RecursiveGaussian;
+    case HessianBackendEnum::FourierTransform:
+      return HessianComputationEnum::FourierTransform;
+    case HessianBackendEnum::Automatic:
+    {
+      /* The recursive filters compute the whole image, which only pays off when all of it is needed */
+      const OutputImageType * outputPtr = this->GetOutput();
+      if (m_ExecutionPlan.UseTiledExecution || m_UseOutOfCoreExecution ||
+          outputPtr->GetRequestedRegion() != outputPtr->GetLargestPossibleRegion())
+      {
+        return discrete;
+      }
+
+      double finestSpacing = this->GetInput()->GetSpacing()[0];
+      for (unsigned int d = 1; d < ImageDimension; ++d)
+      {
+        finestSpacing = std::min(finestSpacing, static_cast<double>(this->GetInput()->GetSpacing()[d]));
+      }
+      return (sigma / finestSpacing >= m_RecursiveSigmaThreshold) ? HessianComputationEnum::RecursiveGaussian
+                                                                 : discrete;
+    }
+    default:
+      itkExceptionMacro(<< "Have bad HessianBackend enumeration " << static_cast<int>(m_HessianBackend));
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+void
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::AdvanceScaleSpace(
+  SigmaType                    scaleSpaceSigma,
+  const InputImageRegionType & region)
+{
+  const StageClockType start = this->StartStage();
+  const SigmaType      incrementalSigma =
+    std::sqrt(scaleSpaceSigma * scaleSpaceSigma - m_ScaleSpaceSigma * m_ScaleSpaceSigma);
+
+  /* One pass along every direction, each into a new image of the region */
+  typename ScaleSpaceImageType::Pointer smoothed =
+    m_ScaleSpaceImage ? this->SmoothAlongDirection(m_ScaleSpaceImage.GetPointer(), 0, incrementalSigma, region)
+                      : this->SmoothAlongDirection(this->GetInput(), 0, incrementalSigma, region);
+  for (unsigned int direction = 1; direction < ImageDimension; ++direction)
   {
-    itkExceptionMacro(<< "Input image must be set to run this filter.");
+    smoothed = this->SmoothAlongDirection(smoothed.GetPointer(), direction, incrementalSigma, region);
   }
-  region = inputPtr->GetLargestPossibleRegion();
+
+  const SizeValueType inputBytes =
+    m_ScaleSpaceImage ? sizeof(typename ScaleSpaceImageType::PixelType) : sizeof(typename InputImageType::PixelType);
+  m_ScaleSpaceImage = smoothed;
+  m_ScaleSpaceSigma = scaleSpaceSigma;
+  this->EndStage("ScaleSpace",
+                 start,
+                 region.GetNumberOfPixels() * inputBytes,
+                 region.GetNumberOfPixels() * sizeof(typename ScaleSpaceImageType::PixelType));
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+template <typename TImage>
+typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  ScaleSpaceImageType::Pointer
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::SmoothAlongDirection(
+  const TImage *               image,
+  unsigned int                 direction,
+  SigmaType                    sigma,
+  const InputImageRegionType & region)
+{
+  using IndexType = typename ScaleSpaceImageType::IndexType;
+
+  typename ScaleSpaceImageType::Pointer smoothed = ScaleSpaceImageType::New();
+  smoothed->CopyInformation(this->GetInput());
+  smoothed->SetBufferedRegion(region);
+  smoothed->SetRequestedRegion(region);
+  smoothed->Allocate();
+
+  InternalRealType *          buffer = smoothed->GetBufferPointer();
+  const OffsetValueType       stride = smoothed->GetOffsetTable()[direction];
+  const ScaleSpaceImageType * smoothedPointer = smoothed.GetPointer();
+  SeparableConvolutionAlgorithm::ConvolveLines(
+    image,
+    region,
+    direction,
+    m_HessianFilter->ComputeKernel(direction, 0, sigma, image->GetSpacing()),
+    [smoothedPointer, buffer, stride](const IndexType & lineStart, const double * values, SizeValueType length) {
+      InternalRealType * pixel = buffer + smoothedPointer->ComputeOffset(lineStart);
+      for (SizeValueType i = 0; i < length; ++i, pixel += stride)
+      {
+        *pixel = static_cast<InternalRealType>(values[i]);
+      }
+    },
+    this->GetMultiThreader());
+
+  return smoothed;
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  ShrinkFactorsType
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  ComputeWorkingGridShrinkFactors(SigmaType                                    sigma,
+                                  const typename InputImageType::SpacingType & spacing,
+                                  const typename InputImageType::SizeType &    size) const
+{
+  ShrinkFactorsType factors;
+  factors.Fill(1);
+  if (m_MaximumKernelRadius == 0)
+  {
+    return factors;
+  }
+
+  /* The unsharp mask widens the kernels by its sigma */
+  const SigmaType preprocessingSigma2 = m_UsePreprocessing ? m_PreprocessingSigma * m_PreprocessingSigma : 0.0;
+  const SigmaType kernelSigma = std::sqrt(sigma * sigma + preprocessingSigma2);
+
+  /* The radius is about inversely proportional to the spacing, so start from that guess and bin by one more
+   * pixel along every direction which still does not fit. A direction is never binned into less than a pixel. */
+  typename InputImageType::SizeType radius = m_HessianFilter->ComputeKernelRadius(kernelSigma, spacing);
+  for (unsigned int d = 0; d < ImageDimension; ++d)
+  {
+    if (radius[d] > m_MaximumKernelRadius)
+    {
+      factors[d] = static_cast<unsigned int>(std::min<SizeValueType>(
+        std::max<SizeValueType>(1, size[d]), (radius[d] + m_MaximumKernelRadius - 1) / m_MaximumKernelRadius));
+    }
+  }
+
+  for (bool coarsened = true; coarsened;)
+  {
+    typename InputImageType::SpacingType workingSpacing = spacing;
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      workingSpacing[d] *= factors[d];
+    }
+    radius = m_HessianFilter->ComputeKernelRadius(kernelSigma, workingSpacing);
+
+    coarsened = false;
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      if (radius[d] > m_MaximumKernelRadius && factors[d] < size[d])
+      {
+        ++factors[d];
+        coarsened = true;
+      }
+    }
+  }
+  return factors;
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+bool
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::UsesWorkingGrids()
+  const
+{
+  for (SigmaStepsType scaleLevel = 0; scaleLevel < m_SigmaArray.GetSize(); ++scaleLevel)
+  {
+    if (this->IsComputedOnWorkingGrid(scaleLevel))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+bool
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  IsComputedOnWorkingGrid(SigmaStepsType scaleLevel) const
+{
+  const InputImageType * input = this->GetInput();
+  if (!input || m_MaximumKernelRadius == 0)
+  {
+    return false;
+  }
+
+  const ShrinkFactorsType factors = this->ComputeWorkingGridShrinkFactors(
+    m_SigmaArray.GetElement(scaleLevel), input->GetSpacing(), input->GetLargestPossibleRegion().GetSize());
+  for (unsigned int d = 0; d < ImageDimension; ++d)
+  {
+    if (factors[d] > 1)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+void
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  ComputeWorkingGridResponses()
+{
+  using ShrinkFilterType = BinShrinkImageFilter<InputImageType, ScaleSpaceImageType>;
+  using HessianComputationEnum = typename ScaleSpaceHessianFilterType::HessianComputationEnum;
+
+  const InputImageType *        input = this->GetInput();
+  const MaskSpatialObjectType * mask = this->GetImageMask();
+  m_WorkingGridResponses.assign(m_SigmaArray.GetSize(), nullptr);
+  m_ParameterCache.resize(m_SigmaArray.GetSize());
+  if (!this->UsesWorkingGrids())
+  {
+    return;
+  }
+
+  typename MaskRunsType::Pointer workingGridMask = MaskRunsType::New();
+  for (SigmaStepsType scaleLevel = 0; scaleLevel < m_SigmaArray.GetSize(); ++scaleLevel)
+  {
+    const SigmaType         sigma = m_SigmaArray.GetElement(scaleLevel);
+    const ShrinkFactorsType factors = this->ComputeWorkingGridShrinkFactors(
+      sigma, input->GetSpacing(), input->GetLargestPossibleRegion().GetSize());
+    bool coarsened = false;
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      coarsened = coarsened || (factors[d] > 1);
+    }
+    if (!coarsened)
+    {
+      continue;
+    }
+
+    /* Bin the input onto the working grid, each pixel is the mean of its bin */
+    m_ProfileScaleLevel = scaleLevel;
+    const StageClockType               start = this->StartStage();
+    typename ShrinkFilterType::Pointer shrink = ShrinkFilterType::New();
+    shrink->SetInput(input);
+    shrink->SetShrinkFactors(factors);
+    shrink->Update();
+    typename ScaleSpaceImageType::Pointer workingGrid = shrink->GetOutput();
+    workingGrid->DisconnectPipeline();
+    InputImageRegionType workingRegion = workingGrid->GetLargestPossibleRegion();
+    this->EndStage("Resample",
+                   start,
+                   input->GetLargestPossibleRegion().GetNumberOfPixels() * sizeof(InputImagePixelType),
+                   workingRegion.GetNumberOfPixels() * sizeof(typename ScaleSpaceImageType::PixelType));
+
+    /* Only the bounding box of the mask on the working grid is computed */
+    if (mask)
+    {
+      workingGridMask->Rasterize(mask, workingGrid, workingRegion, this->GetMultiThreader());
+      if (workingGridMask->GetNumberOfInsidePixels() == 0)
+      {
+        continue;
+      }
+      workingRegion = workingGridMask->GetBoundingRegion();
+    }
+    m_EigenToMeasureParameterEstimationFilter->SetMaskRuns(mask ? workingGridMask.GetPointer() : nullptr);
+    m_EigenToMeasureImageFilter->SetMaskRuns(mask ? workingGridMask.GetPointer() : nullptr);
+
+    /* The kernels fit on the working grid, so the automatic backend has no use for the recursive filters */
+    m_ScaleSpaceHessianFilter->SetInput(workingGrid);
+    m_ScaleSpaceHessianFilter->SetSigma(sigma);
+    m_ScaleSpaceHessianFilter->SetInputSigma(0.0);
+    m_ScaleSpaceHessianFilter->SetHessianComputation(
+      m_HessianBackend == HessianBackendEnum::Automatic
+        ? HessianComputationEnum::IndependentComponents
+        : static_cast<HessianComputationEnum>(this->SelectHessianComputation(sigma)));
+    m_EigenAnalysisFilter->SetInput(m_ScaleSpaceHessianFilter->GetOutput());
+
+    /* Estimate the parameters over the working grid, then compute the measure with them */
+    m_EigenToMeasureParameterEstimationFilter->SetInput(m_EigenAnalysisFilter->GetOutput());
+    m_EigenToMeasureParameterEstimationFilter->SetOutputMode(
+      EigenToMeasureParameterEstimationFilterType::OutputModeEnum::ParametersOnly);
+    m_EigenToMeasureParameterEstimationFilter->GetOutput()->SetRequestedRegion(workingRegion);
+    m_EigenToMeasureParameterEstimationFilter->Update();
+    m_ParameterCache[scaleLevel] = m_EigenToMeasureParameterEstimationFilter->GetParameters();
+
+    m_EigenToMeasureImageFilter->SetInput(m_EigenAnalysisFilter->GetOutput());
+    m_EigenToMeasureImageFilter->SetParameters(m_ParameterCache[scaleLevel]);
+    m_EigenToMeasureImageFilter->GetOutput()->SetRequestedRegion(workingRegion);
+    m_EigenToMeasureImageFilter->Update();
+    m_WorkingGridResponses[scaleLevel] = m_EigenToMeasureImageFilter->GetOutput();
+    m_WorkingGridResponses[scaleLevel]->DisconnectPipeline();
+  }
+
+  /* Back to the input grid for the other scales */
+  m_ScaleSpaceHessianFilter->GetOutput()->ReleaseData();
+  m_EigenToMeasureParameterEstimationFilter->SetInput(m_EigenAnalysisFilter->GetOutput());
+  m_EigenToMeasureParameterEstimationFilter->SetMaskRuns(mask ? m_MaskRuns.GetPointer() : nullptr);
+  m_EigenToMeasureImageFilter->SetMaskRuns(mask ? m_MaskRuns.GetPointer() : nullptr);
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+bool
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  FoldWorkingGridResponse(SigmaStepsType scaleLevel, const OutputImageRegionType & region)
+{
+  using InterpolatorType = LinearInterpolateImageFunction<TOutputImage, double>;
+  using ContinuousIndexType = typename InterpolatorType::ContinuousIndexType;
+  using IndexType = typename OutputImageType::IndexType;
+
+  if (scaleLevel >= m_WorkingGridResponses.size() || !m_WorkingGridResponses[scaleLevel])
+  {
+    return false;
+  }
+
+  const TOutputImage *               workingResponse = m_WorkingGridResponses[scaleLevel];
+  const OutputImageRegionType        workingRegion = workingResponse->GetBufferedRegion();
+  typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
+  interpolator->SetInputImage(workingResponse);
+  const InterpolatorType * interpolatorPointer = interpolator.GetPointer();
+  const MaskRunsType *     maskRuns = this->GetImageMask() ? m_MaskRuns.GetPointer() : nullptr;
+
+  /* One tile at a time when tiled, so no image of the whole output is allocated */
+  const std::vector<OutputImageRegionType> tiles = m_ExecutionPlan.UseTiledExecution
+                                                     ? this->SplitIntoTiles(region)
+                                                     : std::vector<OutputImageRegionType>(1, region);
+  for (const OutputImageRegionType & tile : tiles)
+  {
+    m_ProfileScaleLevel = scaleLevel;
+    const StageClockType start = this->StartStage();
+
+    typename TOutputImage::Pointer response = TOutputImage::New();
+    response->CopyInformation(this->GetOutput());
+    response->SetBufferedRegion(tile);
+    response->SetRequestedRegion(tile);
+    response->Allocate(true);
+
+    /* Interpolate at the physical point of every pixel inside the mask, clamped to the working grid */
+    TOutputImage * responsePointer = response.GetPointer();
+    this->GetMultiThreader()->template ParallelizeImageRegion<ImageDimension>(
+      tile,
+      [responsePointer, workingResponse, workingRegion, interpolatorPointer, maskRuns](
+        const OutputImageRegionType & subRegion) {
+        OutputImageRegionType lines = subRegion;
+        lines.SetSize(0, 1);
+        ImageRegionConstIteratorWithIndex<TOutputImage> lineIt(responsePointer, lines);
+        for (; !lineIt.IsAtEnd(); ++lineIt)
+        {
+          const IndexType lineStart = lineIt.GetIndex();
+          auto            interpolateRun = [&](IndexValueType first, SizeValueType length) {
+            IndexType                       index = lineStart;
+            typename TOutputImage::PointType point;
+            ContinuousIndexType             workingIndex;
+            for (SizeValueType x = 0; x < length; ++x)
+            {
+              index[0] = first + static_cast<IndexValueType>(x);
+              responsePointer->TransformIndexToPhysicalPoint(index, point);
+              workingResponse->TransformPhysicalPointToContinuousIndex(point, workingIndex);
+              for (unsigned int d = 0; d < ImageDimension; ++d)
+              {
+                const double lower = static_cast<double>(workingRegion.GetIndex(d));
+                const double upper = lower + static_cast<double>(workingRegion.GetSize(d)) - 1.0;
+                workingIndex[d] = std::min(std::max(workingIndex[d], lower), upper);
+              }
+              responsePointer->SetPixel(
+                index, static_cast<OutputImagePixelType>(interpolatorPointer->EvaluateAtContinuousIndex(workingIndex)));
+            }
+          };
+
+          if (maskRuns)
+          {
+            maskRuns->VisitRuns(lineStart, subRegion.GetSize(0), interpolateRun);
+          }
+          else
+          {
+            interpolateRun(lineStart[0], subRegion.GetSize(0));
+          }
+        }
+      },
+      nullptr);
+    this->EndStage("Resample",
+                   start,
+                   workingRegion.GetNumberOfPixels() * sizeof(OutputImagePixelType),
+                   tile.GetNumberOfPixels() * sizeof(OutputImagePixelType));
+
+    this->FoldResponseAtScale(response, tile, scaleLevel);
+  }
+  return true;
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  InputImageType::SizeType
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::ComputeInputRadius(
+  const typename InputImageType::SpacingType & spacing) const
+{
+  using SizeType = typename InputImageType::SizeType;
+
+  /* The unsharp mask widens the derivative kernels by its sigma */
+  const SigmaType preprocessingSigma2 = m_UsePreprocessing ? m_PreprocessingSigma * m_PreprocessingSigma : 0.0;
+  if (!m_UseIncrementalScaleSpace)
+  {
+    /* The widest kernel */
+    SigmaType maximumSigma = m_SigmaArray.GetElement(0);
+    for (SigmaStepsType i = 1; i < m_SigmaArray.GetSize(); ++i)
+    {
+      maximumSigma = std::max(maximumSigma, m_SigmaArray.GetElement(i));
+    }
+    return m_HessianFilter->ComputeKernelRadius(std::sqrt(maximumSigma * maximumSigma + preprocessingSigma2), spacing);
+  }
+
+  /* The derivative kernels of the smallest sigma after every smoothing pass */
+  const SigmaType smallestSigma = m_SigmaArray.GetElement(0);
+  SizeType        radius =
+    m_HessianFilter->ComputeKernelRadius(std::sqrt(smallestSigma * smallestSigma + preprocessingSigma2), spacing);
+  for (SigmaStepsType i = 1; i < m_SigmaArray.GetSize(); ++i)
+  {
+    const SigmaType previous = m_SigmaArray.GetElement(i - 1);
+    const SigmaType current = m_SigmaArray.GetElement(i);
+    if (current > previous)
+    {
+      radius += m_HessianFilter->ComputeKernelRadius(std::sqrt(current * current - previous * previous), spacing);
+    }
+  }
+  return radius;
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+void
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::FoldResponseAtScale(
+  const TOutputImage *          response,
+  const OutputImageRegionType & region,
+  SigmaStepsType                scaleLevel)
+{
+  const StageClockType start = this->StartStage();
+  OutputImageType *    outputPtr = this->GetOutput();
+  ScaleImageType *     scalePtr = m_GenerateScaleOutput ? this->GetScaleOutput() : nullptr;
+  const auto           scaleIndex = static_cast<ScalePixelType>(scaleLevel);
+  const bool           firstScale = (scaleLevel == 0);
+  m_ProfileScaleLevel = scaleLevel;
+
+  this->GetMultiThreader()->template ParallelizeImageRegion<ImageDimension>(
+    region,
+    [response, outputPtr, scalePtr, scaleIndex, firstScale](const OutputImageRegionType & subRegion) {
+      ImageRegionConstIterator<TOutputImage> responseIt(response, subRegion);
+      ImageRegionIterator<TOutputImage>      outputIt(outputPtr, subRegion);
+      ImageRegionIterator<ScaleImageType>    scaleIt;
+      if (scalePtr)
+      {
+        scaleIt = ImageRegionIterator<ScaleImageType>(scalePtr, subRegion);
+      }
+
+      /* Same rule as Functor::MaximumAbsoluteValue, ties go to the newer scale */
+      for (; !responseIt.IsAtEnd(); ++responseIt, ++outputIt)
+      {
+        const OutputImagePixelType value = responseIt.Get();
+        const bool keep = !firstScale && (Math::abs(outputIt.Get()) > Math::abs(value));
+        if (!keep)
+        {
+          outputIt.Set(value);
+        }
+        if (scalePtr)
+        {
+          if (!keep)
+          {
+            scaleIt.Set(scaleIndex);
+          }
+          ++scaleIt;
+        }
+      }
+    },
+    nullptr);
+
+  /* The response and the maximum so far are read, nothing is allocated */
+  this->EndStage("Fold", start, 2 * region.GetNumberOfPixels() * sizeof(OutputImagePixelType), 0);
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::StageClockType
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::StartStage() const
+{
+  StageClockType clock{};
+  if (m_CollectProfile)
+  {
+    clock.Wall = std::chrono::steady_clock::now();
+    clock.CPU = std::clock();
+  }
+  return clock;
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+void
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::EndStage(
+  const char *           stage,
+  const StageClockType & start,
+  SizeValueType          bytesRead,
+  SizeValueType          bytesAllocated)
+{
+  if (!m_CollectProfile)
+  {
+    return;
+  }
+
+  const std::clock_t                          cpu = std::clock();
+  const std::chrono::steady_clock::time_point wall = std::chrono::steady_clock::now();
+
+  StageProfileType record;
+  record.Stage = stage;
+  record.ScaleLevel = m_ProfileScaleLevel;
+  record.Sigma = m_SigmaArray.GetElement(m_ProfileScaleLevel);
+  record.Start = std::chrono::duration<double>(start.Wall - m_ProfileStart).count();
+  record.WallTime = std::chrono::duration<double>(wall - start.Wall).count();
+  record.CPUTime = static_cast<double>(cpu - start.CPU) / CLOCKS_PER_SEC;
+  record.BytesRead = bytesRead;
+  record.BytesAllocated = bytesAllocated;
+  m_Profile.push_back(record);
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+template <typename TFilter>
+void
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::ObserveStage(
+  TFilter *    filter,
+  const char * stage,
+  bool         allocatesOutput)
+{
+  using InputPixelType = typename TFilter::InputImageType::PixelType;
+  using OutputPixelType = typename TFilter::OutputImageType::PixelType;
+
+  /* A filter may be run many times per update, each run is timed from its StartEvent to its EndEvent */
+  std::shared_ptr<StageClockType> start = std::make_shared<StageClockType>();
+  m_ProfileObservers.emplace_back(
+    filter, filter->AddObserver(StartEvent(), [this, start](const EventObject &) { *start = this->StartStage(); }));
+  m_ProfileObservers.emplace_back(
+    filter, filter->AddObserver(EndEvent(), [this, filter, stage, allocatesOutput, start](const EventObject &) {
+      const SizeValueType pixels = filter->GetOutput()->GetRequestedRegion().GetNumberOfPixels();
+      this->EndStage(
+        stage, *start, pixels * sizeof(InputPixelType), allocatesOutput ? pixels * sizeof(OutputPixelType) : 0);
+    }));
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+void
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::WriteProfile(
+  std::ostream & os) const
+{
+  /* Bytes read and allocated per second */
+  auto bandwidth = [](SizeValueType bytesRead, SizeValueType bytesAllocated, double wallTime) -> double {
+    return wallTime > 0.0 ? static_cast<double>(bytesRead + bytesAllocated) / wallTime : 0.0;
+  };
+
+  /* Totals of every stage, in the order the stages first finished */
+  std::vector<StageProfileType> totals;
+  for (const StageProfileType & record : m_Profile)
+  {
+    auto total = std::find_if(totals.begin(), totals.end(), [&record](const StageProfileType & candidate) {
+      return candidate.Stage == record.Stage;
+    });
+    if (total == totals.end())
+    {
+      StageProfileType empty;
+      empty.Stage = record.Stage;
+      total = totals.insert(totals.end(), empty);
+    }
+    total->WallTime += record.WallTime;
+    total->CPUTime += record.CPUTime;
+    total->BytesRead += record.BytesRead;
+    total->BytesAllocated += record.BytesAllocated;
+  }
+
+  const std::streamsize precision = os.precision(9);
+  os << "{\n  \"stages\": [";
+  for (SizeValueType i = 0; i < m_Profile.size(); ++i)
+  {
+    const StageProfileType & record = m_Profile[i];
+    os << (i > 0 ? "," : "") << "\n    { \"stage\": \"" << record.Stage << "\", \"scaleLevel\": " << record.ScaleLevel
+       << ", \"sigma\": " << record.Sigma << ", \"start\": " << record.Start
+       << ", \"wallTime\": " << record.WallTime << ", \"cpuTime\": " << record.CPUTime
+       << ", \"bytesRead\": " << record.BytesRead << ", \"bytesAllocated\": " << record.BytesAllocated
+       << ", \"bandwidth\": " << bandwidth(record.BytesRead, record.BytesAllocated, record.WallTime) << " }";
+  }
+  os << "\n  ],\n  \"totals\": [";
+  for (SizeValueType i = 0; i < totals.size(); ++i)
+  {
+    const StageProfileType & total = totals[i];
+    os << (i > 0 ? "," : "") << "\n    { \"stage\": \"" << total.Stage << "\", \"wallTime\": " << total.WallTime
+       << ", \"cpuTime\": " << total.CPUTime << ", \"bytesRead\": " << total.BytesRead
+       << ", \"bytesAllocated\": " << total.BytesAllocated
+       << ", \"bandwidth\": " << bandwidth(total.BytesRead, total.BytesAllocated, total.WallTime) << " }";
+  }
+  os << "\n  ]\n}\n";
+  os.precision(precision);
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+void
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  WriteProfileTraceEvents(std::ostream & os) const
+{
+  /* Complete events in microseconds, the stages nest the way they ran on the thread of the update */
+  const std::streamsize precision = os.precision(12);
+  os << "{\"traceEvents\":[";
+  for (SizeValueType i = 0; i < m_Profile.size(); ++i)
+  {
+    const StageProfileType & record = m_Profile[i];
+    os << (i > 0 ? "," : "") << "\n{\"name\":\"" << record.Stage << "\",\"cat\":\"BoneEnhancement\",\"ph\":\"X\""
+       << ",\"ts\":" << 1e6 * record.Start << ",\"dur\":" << 1e6 * record.WallTime << ",\"pid\":0,\"tid\":0"
+       << ",\"args\":{\"scaleLevel\":" << record.ScaleLevel
+       << ",\"sigma\":" << record.Sigma << ",\"cpuTime\":" << record.CPUTime
+       << ",\"bytesRead\":" << record.BytesRead << ",\"bytesAllocated\":" << record.BytesAllocated << "}}";
+  }
+  os << "\n]}\n";
+  os.precision(precision);
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+std::vector<typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  OutputImageRegionType>
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::SplitIntoTiles(
+  const OutputImageRegionType & region) const
+{
+  /* Number of tiles along each direction */
+  TileSizeType  tileSize;
+  TileSizeType  numberOfTiles;
+  SizeValueType totalNumberOfTiles = 1;
+  for (unsigned int d = 0; d < ImageDimension; ++d)
+  {
+    const SizeValueType extent = region.GetSize(d);
+    const SizeValueType planned = m_ExecutionPlan.TileSize[d];
+    tileSize[d] = (planned > 0) ? std::min(planned, extent) : extent;
+    numberOfTiles[d] = (tileSize[d] > 0) ? (extent + tileSize[d] - 1) / tileSize[d] : 0;
+    totalNumberOfTiles *= numberOfTiles[d];
+  }
+
+  /* Enumerate them with the first direction fastest, like the image buffer */
+  std::vector<OutputImageRegionType> tiles;
+  tiles.reserve(totalNumberOfTiles);
+  for (SizeValueType t = 0; t < totalNumberOfTiles; ++t)
+  {
+    OutputImageRegionType tile;
+    SizeValueType         remainder = t;
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      const SizeValueType  position = remainder % numberOfTiles[d];
+      const IndexValueType start = region.GetIndex(d) + static_cast<IndexValueType>(position * tileSize[d]);
+      remainder /= numberOfTiles[d];
+
+      tile.SetIndex(d, start);
+      tile.SetSize(d, std::min(tileSize[d], region.GetSize(d) - position * tileSize[d]));
+    }
+    tiles.push_back(tile);
+  }
+
+  return tiles;
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  ExecutionPlanType
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::PlanExecution(
+  const OutputImageRegionType & requestedRegion) const
+{
+  ExecutionPlanType plan;
+  plan.UseTiledExecution = m_UseTiledExecution;
+  plan.TileSize = m_TileSize;
+  plan.NumberOfEstimationDivisions = m_EigenToMeasureParameterEstimationFilter->GetNumberOfStreamDivisions();
+
+  /* The scales on the input grid can keep their eigenvalues when the whole output is computed in stages */
+  SizeValueType cacheableScales = 0;
+  if (m_CacheScales && !m_UseOutOfCoreExecution && !m_UseIncrementalScaleSpace &&
+      requestedRegion == this->GetOutput()->GetLargestPossibleRegion())
+  {
+    for (SigmaStepsType scaleLevel = 0; scaleLevel < m_SigmaArray.GetSize(); ++scaleLevel)
+    {
+      cacheableScales += this->IsComputedOnWorkingGrid(scaleLevel) ? 0 : 1;
+    }
+  }
+
+  if (m_MemoryBudget == 0)
+  {
+    plan.NumberOfCachedScales = plan.UseTiledExecution ? 0 : cacheableScales;
+    plan.EstimatedPeakMemory = this->EstimatePeakMemory(requestedRegion, plan);
+    return plan;
+  }
+
+  /* The estimation is split along the last direction, one slice at most per division */
+  const OutputImageRegionType estimatedRegion = this->CropToMask(this->GetOutput()->GetLargestPossibleRegion());
+  const auto                  maximumDivisions =
+    static_cast<unsigned int>(std::max<SizeValueType>(1, estimatedRegion.GetSize(ImageDimension - 1)));
+
+  /* The fewest estimation divisions keeping candidate within the budget */
+  auto fitsBudget = [this, &requestedRegion, maximumDivisions](ExecutionPlanType & candidate) -> bool {
+    for (unsigned int divisions = 1;; divisions = std::min(2 * divisions, maximumDivisions))
+    {
+      candidate.NumberOfEstimationDivisions = divisions;
+      candidate.EstimatedPeakMemory = this->EstimatePeakMemory(requestedRegion, candidate);
+      if (candidate.EstimatedPeakMemory <= m_MemoryBudget)
+      {
+        return true;
+      }
+      if (divisions >= maximumDivisions)
+      {
+        return false;
+      }
+    }
+  };
+
+  /* Staged execution computes each hessian once, so it is the first choice, keeping as many scales as fit */
+  plan.ReleaseIntermediateData = true;
+  plan.UseTiledExecution = false;
+  for (plan.NumberOfCachedScales = cacheableScales;; --plan.NumberOfCachedScales)
+  {
+    if (fitsBudget(plan))
+    {
+      return plan;
+    }
+    if (plan.NumberOfCachedScales == 0)
+    {
+      break;
+    }
+  }
+
+  /* Otherwise the largest tiles which fit, halving the longest direction of the tile each time */
+  plan.UseTiledExecution = true;
+  plan.TileSize = this->CropToMask(requestedRegion).GetSize();
+  while (!fitsBudget(plan))
+  {
+    unsigned int longest = 0;
+    for (unsigned int d = 1; d < ImageDimension; ++d)
+    {
+      longest = (plan.TileSize[d] > plan.TileSize[longest]) ? d : longest;
+    }
+    if (plan.TileSize[longest] <= 1)
+    {
+      itkExceptionMacro(<< "No execution plan fits in the memory budget of " << m_MemoryBudget
+                        << " bytes, the smallest tiles need " << plan.EstimatedPeakMemory << " bytes.");
+    }
+    plan.TileSize[longest] = (plan.TileSize[longest] + 1) / 2;
+  }
+  return plan;
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+SizeValueType
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::EstimatePeakMemory(
+  const OutputImageRegionType & requestedRegion,
+  const ExecutionPlanType &     plan) const
+{
+  const InputImageType *                  input = this->GetInput();
+  const InputImageRegionType              inputRegion = input->GetLargestPossibleRegion();
+  const typename InputImageType::SizeType radius = this->ComputeInputRadius(input->GetSpacing());
+  const bool useScaleSpace = m_UseIncrementalScaleSpace && m_SigmaArray.GetSize() > 1;
+
+  /* Pixels of the input a region of the output is computed from */
+  auto padded = [&radius, &inputRegion](OutputImageRegionType region) -> SizeValueType {
+    if (region.GetNumberOfPixels() == 0)
+    {
+      return 0;
+    }
+    region.PadByRadius(radius);
+    region.Crop(inputRegion);
+    return region.GetNumberOfPixels();
+  };
+
+  /* One scale over region: the scale-space, the hessian with its temporaries, the eigenvalues and the measure */
+  auto scalePeak = [this, &plan, &padded, useScaleSpace](const OutputImageRegionType & region,
+                                                         const OutputImageRegionType & scaleSpaceRegion)
+    -> SizeValueType {
+    const SizeValueType pixels = region.GetNumberOfPixels();
+    const SizeValueType hessian = pixels * sizeof(HessianPixelType);
+    const SizeValueType eigen = pixels * sizeof(EigenValueArrayType);
+    const SizeValueType measure = pixels * sizeof(OutputImagePixelType);
+    const SizeValueType workspace = this->EstimateHessianWorkspace(padded(region), plan.UseTiledExecution);
+    const SizeValueType scaleSpace = useScaleSpace ? 2 * padded(scaleSpaceRegion) * sizeof(InternalRealType) : 0;
+
+    /* A released hessian is gone before the measure is computed, the measure lingers until the next scale */
+    if (plan.ReleaseIntermediateData)
+    {
+      return scaleSpace + std::max(workspace + hessian, hessian + eigen) + measure;
+    }
+    return scaleSpace + workspace + hessian + eigen + measure;
+  };
+
+  /* The outputs and the scales, over the whole processed region or one tile of it */
+  const OutputImageRegionType processedRegion = this->CropToMask(requestedRegion);
+  SizeValueType               outputs = requestedRegion.GetNumberOfPixels() * sizeof(OutputImagePixelType);
+  if (m_GenerateScaleOutput)
+  {
+    outputs += requestedRegion.GetNumberOfPixels() * sizeof(ScalePixelType);
+  }
+
+  /* The measure of every scale on a working grid is kept from before the outputs are allocated until the end of
+   * the update. Each is computed from the input binned onto its grid, with a hessian and eigenvalues of that size. */
+  const typename InputImageType::SizeType inputSize = inputRegion.GetSize();
+  SizeValueType                           workingResponses = 0;
+  SizeValueType                           workingScalePeak = 0;
+  bool                                    computesInputGridScales = false;
+  for (SigmaStepsType scaleLevel = 0; scaleLevel < m_SigmaArray.GetSize(); ++scaleLevel)
+  {
+    if (!this->IsComputedOnWorkingGrid(scaleLevel))
+    {
+      computesInputGridScales = true;
+      continue;
+    }
+    const ShrinkFactorsType factors =
+      this->ComputeWorkingGridShrinkFactors(m_SigmaArray.GetElement(scaleLevel), input->GetSpacing(), inputSize);
+    SizeValueType workingPixels = 1;
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      workingPixels *= inputSize[d] / factors[d];
+    }
+    workingResponses += workingPixels * sizeof(OutputImagePixelType);
+    workingScalePeak = std::max(workingScalePeak,
+                                this->EstimateHessianWorkspace(workingPixels, false) +
+                                  workingPixels * (sizeof(typename ScaleSpaceImageType::PixelType) +
+                                                   sizeof(HessianPixelType) + sizeof(EigenValueArrayType) +
+                                                   sizeof(OutputImagePixelType)));
+  }
+
+  /* One stream of the estimation over region: the pieces in flight with their hessian, temporaries and eigenvalues */
+  const unsigned int divisions = std::max(1u, plan.NumberOfEstimationDivisions);
+  auto streamPeak = [this, &padded, &plan, divisions](const OutputImageRegionType & region) -> SizeValueType {
+    const unsigned int    last = ImageDimension - 1;
+    OutputImageRegionType piece = region;
+    piece.SetSize(last, (region.GetSize(last) + divisions - 1) / divisions);
+    const SizeValueType workspace = this->EstimateHessianWorkspace(padded(piece), plan.UseTiledExecution);
+    const SizeValueType hessian = piece.GetNumberOfPixels() * sizeof(HessianPixelType);
+    const SizeValueType eigen = piece.GetNumberOfPixels() * sizeof(EigenValueArrayType);
+    const SizeValueType perPiece =
+      plan.ReleaseIntermediateData ? std::max(workspace + hessian, hessian + eigen) : workspace + hessian + eigen;
+    return m_EigenToMeasureParameterEstimationFilter->GetNumberOfPiecesInFlight() * perPiece;
+  };
+
+  /* The region of one scale, the whole processed region or one tile of it */
+  OutputImageRegionType tile = processedRegion;
+  if (plan.UseTiledExecution)
+  {
+    for (unsigned int d = 0; d < ImageDimension; ++d)
+    {
+      const SizeValueType extent = processedRegion.GetSize(d);
+      tile.SetSize(d, (plan.TileSize[d] > 0) ? std::min<SizeValueType>(plan.TileSize[d], extent) : extent);
+    }
+  }
+
+  /* The cached scales keep their eigenvalues over the whole image, which every scale is computed over. A scale on
+   * a working grid is interpolated into an image of the region of one scale instead. */
+  const OutputImageRegionType largestRegion = this->GetOutput()->GetLargestPossibleRegion();
+  SizeValueType               inputGridScalePeak = 0;
+  if (processedRegion.GetNumberOfPixels() > 0 && computesInputGridScales && plan.NumberOfCachedScales > 0)
+  {
+    inputGridScalePeak = plan.NumberOfCachedScales * largestRegion.GetNumberOfPixels() * sizeof(EigenValueArrayType) +
+                         scalePeak(largestRegion, largestRegion);
+  }
+  else if (processedRegion.GetNumberOfPixels() > 0 && computesInputGridScales && !plan.UseTiledExecution &&
+           !m_GraftEigenValues && m_HessianBackend != HessianBackendEnum::RecursiveGaussian &&
+           !m_UseOutOfCoreExecution && requestedRegion == largestRegion && !this->IsParameterCacheValid())
+  {
+    /* The stages stream the estimation and its copy of the eigenvalues, which the measure reads */
+    const SizeValueType pixels = processedRegion.GetNumberOfPixels();
+    const SizeValueType scaleSpace = useScaleSpace ? 2 * padded(processedRegion) * sizeof(InternalRealType) : 0;
+    inputGridScalePeak = scaleSpace + streamPeak(processedRegion) +
+                         pixels * (sizeof(EigenValueArrayType) + sizeof(OutputImagePixelType));
+
+    /* The automatic backend grafts the scales it computes with the recursive filters */
+    if (m_HessianBackend == HessianBackendEnum::Automatic)
+    {
+      inputGridScalePeak = std::max(inputGridScalePeak, scalePeak(processedRegion, processedRegion));
+    }
+  }
+  else if (processedRegion.GetNumberOfPixels() > 0 && computesInputGridScales)
+  {
+    inputGridScalePeak = scalePeak(tile, (plan.UseTiledExecution && !m_UseTileMajorOrder) ? processedRegion : tile);
+  }
+  const SizeValueType interpolated =
+    (workingResponses > 0) ? tile.GetNumberOfPixels() * sizeof(OutputImagePixelType) : 0;
+  SizeValueType peak = outputs + workingResponses + std::max(inputGridScalePeak, interpolated);
+  if (processedRegion.GetNumberOfPixels() > 0)
+  {
+    peak = std::max(peak, workingResponses + workingScalePeak);
+  }
+
+  /* The streamed estimation over the whole image runs before the outputs are allocated */
+  const OutputImageRegionType estimatedRegion = this->CropToMask(largestRegion);
+  if (estimatedRegion.GetNumberOfPixels() > 0 && computesInputGridScales &&
+      (plan.UseTiledExecution || requestedRegion != largestRegion))
+  {
+    const SizeValueType scaleSpace = useScaleSpace ? 2 * padded(estimatedRegion) * sizeof(InternalRealType) : 0;
+    peak = std::max(peak, workingResponses + scaleSpace + streamPeak(estimatedRegion));
+  }
+  return peak;
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+SizeValueType
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  EstimateHessianWorkspace(SizeValueType paddedPixels, bool tiled) const
+{
+  /* The images of InternalRealType each computation convolves through */
+  const SizeValueType realImage = paddedPixels * sizeof(InternalRealType);
+  const SizeValueType independent = 2 * realImage;
+  const SizeValueType shared = std::max(1u, ImageDimension - 1) * realImage;
+  switch (m_HessianBackend)
+  {
+    case HessianBackendEnum::FourierTransform:
+      /* The padded input, its half spectrum of complex values and one component with its spectrum */
+      return 4 * realImage;
+    case HessianBackendEnum::RecursiveGaussian:
+    case HessianBackendEnum::Automatic:
+    {
+      /* The recursive filters compute their own hessian of the whole image, through one smoothed image per
+       * direction */
+      const SizeValueType wholePixels = this->GetInput()->GetLargestPossibleRegion().GetNumberOfPixels();
+      const SizeValueType recursive =
+        wholePixels * (sizeof(HessianPixelType) + (ImageDimension + 1) * sizeof(InternalRealType));
+      if (m_HessianBackend == HessianBackendEnum::RecursiveGaussian)
+      {
+        return recursive;
+      }
+      return tiled ? shared : std::max(recursive, independent);
+    }
+    default:
+      return tiled ? shared : independent;
+  }
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  OutputImageRegionType
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::GetOutputRegion()
+{
+  return this->CropToMask(this->GetOutput()->GetRequestedRegion());
+}
+
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  OutputImageRegionType
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::CropToMask(
+  const OutputImageRegionType & region) const
+{
+  OutputImageRegionType croppedRegion = region;
 
   /* Grab the mask pointer */
   MaskSpatialObjectTypeConstPointer mask = this->GetImageMask();
   if (!mask)
   {
-    // No mask was set so we need to estimate parameters across the whole image
-    return region;
+    // No mask was set so we need to process the whole region
+    return croppedRegion;
   }
 
-  /* Crop the region */
-  typename MaskSpatialObjectType::RegionType maskRegion = mask->GetAxisAlignedBoundingBoxRegion();
-  region.Crop(maskRegion);
+  /* Crop to the bounding box of the rasterized mask */
+  if (m_MaskRuns->GetNumberOfInsidePixels() == 0 || !croppedRegion.Crop(m_MaskRuns->GetBoundingRegion()))
+  {
+    typename OutputImageRegionType::SizeType emptySize;
+    emptySize.Fill(0);
+    croppedRegion.SetSize(emptySize);
+  }
 
-  return region;
+  return croppedRegion;
 }
 
-template <typename TInputImage, typename TOutputImage>
-typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::SigmaArrayType
-MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::GenerateSigmaArray(
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::SigmaArrayType
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::GenerateSigmaArray(
   SigmaType           SigmaMinimum,
   SigmaType           SigmaMaximum,
   SigmaStepsType      NumberOfSigmaSteps,
@@ -313,9 +1719,10 @@ MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::GenerateSigm
   return sigmaArray;
 }
 
-template <typename TInputImage, typename TOutputImage>
-typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::SigmaArrayType
-MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::GenerateEquispacedSigmaArray(
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::SigmaArrayType
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  GenerateEquispacedSigmaArray(
   SigmaType      SigmaMinimum,
   SigmaType      SigmaMaximum,
   SigmaStepsType NumberOfSigmaSteps)
@@ -324,9 +1731,10 @@ MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::GenerateEqui
     SigmaMinimum, SigmaMaximum, NumberOfSigmaSteps, Self::SigmaStepMethodEnum::EquispacedSigmaSteps);
 }
 
-template <typename TInputImage, typename TOutputImage>
-typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::SigmaArrayType
-MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::GenerateLogarithmicSigmaArray(
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::SigmaArrayType
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  GenerateLogarithmicSigmaArray(
   SigmaType      SigmaMinimum,
   SigmaType      SigmaMaximum,
   SigmaStepsType NumberOfSigmaSteps)
@@ -335,9 +1743,11 @@ MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::GenerateLoga
     SigmaMinimum, SigmaMaximum, NumberOfSigmaSteps, Self::SigmaStepMethodEnum::LogarithmicSigmaSteps);
 }
 
-template <typename TInputImage, typename TOutputImage>
-typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::InternalEigenValueOrderType
-MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::ConvertType(ExternalEigenValueOrderType order)
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
+typename MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::
+  InternalEigenValueOrderType
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::ConvertType(
+  ExternalEigenValueOrderType order)
 {
   switch (order)
   {
@@ -352,18 +1762,44 @@ MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::ConvertType(
   }
 }
 
-template <typename TInputImage, typename TOutputImage>
+template <typename TInputImage, typename TOutputImage, typename THessianValue, typename TEigenValue>
 void
-MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage>::PrintSelf(std::ostream & os, Indent indent) const
+MultiScaleHessianEnhancementImageFilter<TInputImage, TOutputImage, THessianValue, TEigenValue>::PrintSelf(
+  std::ostream & os, Indent indent) const
 {
   Superclass::PrintSelf(os, indent);
   os << indent << "HessianFilter: " << m_HessianFilter.GetPointer() << std::endl;
   os << indent << "EigenAnalysisFilter: " << m_EigenAnalysisFilter.GetPointer() << std::endl;
-  os << indent << "MaximumAbsoluteValueFilter: " << m_MaximumAbsoluteValueFilter.GetPointer() << std::endl;
   os << indent << "EigenToMeasureImageFilter: " << m_EigenToMeasureImageFilter.GetPointer() << std::endl;
   os << indent << "EigenToMeasureParameterEstimationFilter: " << m_EigenToMeasureParameterEstimationFilter.GetPointer()
      << std::endl;
+  os << indent << "PreallocatedOutput: " << m_PreallocatedOutput.GetPointer() << std::endl;
   os << indent << "SigmaArray: " << m_SigmaArray << std::endl;
+  os << indent << "GraftEigenValues: " << m_GraftEigenValues << std::endl;
+  os << indent << "UseTiledExecution: " << m_UseTiledExecution << std::endl;
+  os << indent << "TileSize: " << m_TileSize << std::endl;
+  os << indent << "UseTileMajorOrder: " << m_UseTileMajorOrder << std::endl;
+  os << indent << "UseOutOfCoreExecution: " << m_UseOutOfCoreExecution << std::endl;
+  os << indent << "MemoryBudget: " << m_MemoryBudget << std::endl;
+  os << indent << "ExecutionPlan: " << (m_ExecutionPlan.UseTiledExecution ? "Tiled" : "Staged") << std::endl;
+  os << indent.GetNextIndent() << "TileSize: " << m_ExecutionPlan.TileSize << std::endl;
+  os << indent.GetNextIndent() << "NumberOfEstimationDivisions: " << m_ExecutionPlan.NumberOfEstimationDivisions
+     << std::endl;
+  os << indent.GetNextIndent() << "ReleaseIntermediateData: " << m_ExecutionPlan.ReleaseIntermediateData
+     << std::endl;
+  os << indent.GetNextIndent() << "EstimatedPeakMemory: " << m_ExecutionPlan.EstimatedPeakMemory << std::endl;
+  os << indent << "CacheScales: " << m_CacheScales << std::endl;
+  os << indent << "NumberOfCachedScales: " << m_ScaleCache.size() << std::endl;
+  os << indent << "CollectProfile: " << m_CollectProfile << std::endl;
+  os << indent << "NumberOfProfiledStages: " << m_Profile.size() << std::endl;
+  os << indent << "GenerateScaleOutput: " << m_GenerateScaleOutput << std::endl;
+  os << indent << "UseIncrementalScaleSpace: " << m_UseIncrementalScaleSpace << std::endl;
+  os << indent << "HessianBackend: " << static_cast<int>(m_HessianBackend) << std::endl;
+  os << indent << "RecursiveSigmaThreshold: " << m_RecursiveSigmaThreshold << std::endl;
+  os << indent << "MaximumKernelRadius: " << m_MaximumKernelRadius << std::endl;
+  os << indent << "UsePreprocessing: " << m_UsePreprocessing << std::endl;
+  os << indent << "PreprocessingSigma: " << m_PreprocessingSigma << std::endl;
+  os << indent << "PreprocessingScalingConstant: " << m_PreprocessingScalingConstant << std::endl;
 }
 
 } // end namespace itk
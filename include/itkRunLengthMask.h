@@ -0,0 +1,143 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkRunLengthMask_h
+#define itkRunLengthMask_h
+
+#include "itkDataObject.h"
+#include "itkImageBase.h"
+#include "itkMultiThreaderBase.h"
+#include "itkSpatialObject.h"
+#include <vector>
+
+namespace itk
+{
+/** \class RunLengthMask
+ * \brief A mask rasterized onto an image grid and stored as runs along each scanline.
+ *
+ * Testing a SpatialObject for every pixel means a transform to physical space and a
+ * lookup in the object for each test. Filters which visit the same grid many times can
+ * instead rasterize the mask once with Rasterize( ) and walk the inside runs of each
+ * scanline with VisitRuns( ). Pixels outside of the mask are never visited and pixels
+ * inside of it need no geometry at all.
+ *
+ * The mask is stored in the index space of the image given to Rasterize( ). It can only
+ * be used with images sharing that index space, as the images of a pipeline fed by that
+ * image do. Pixels outside of GetRegion( ) are outside of the mask.
+ *
+ * \sa SpatialObject
+ * \sa MultiScaleHessianEnhancementImageFilter
+ *
+ * \author: Bryce Besler
+ * \ingroup BoneEnhancement
+ */
+template <unsigned int VDimension>
+class ITK_TEMPLATE_EXPORT RunLengthMask : public DataObject
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(RunLengthMask);
+
+  /** Standard Self typedef */
+  using Self = RunLengthMask;
+  using Superclass = DataObject;
+  using Pointer = SmartPointer<Self>;
+  using ConstPointer = SmartPointer<const Self>;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Run-time type information (and related methods). */
+  itkTypeMacro(RunLengthMask, DataObject);
+
+  /** Geometry typedefs. */
+  itkStaticConstMacro(ImageDimension, unsigned int, VDimension);
+  using RegionType = ImageRegion<VDimension>;
+  using IndexType = Index<VDimension>;
+  using SizeType = Size<VDimension>;
+  using ImageBaseType = ImageBase<VDimension>;
+  using SpatialObjectType = SpatialObject<VDimension>;
+
+  /** A run of inside pixels along the first direction: the index of the first pixel and the number of pixels. */
+  struct RunType
+  {
+    IndexValueType Start;
+    SizeValueType  Length;
+  };
+
+  /** Test every pixel of region of image against mask once and store the result. The multithreader
+   * is optional. */
+  void
+  Rasterize(const SpatialObjectType * mask,
+            const ImageBaseType *     image,
+            const RegionType &        region,
+            MultiThreaderBase *       multiThreader = nullptr);
+
+  /** Call visitor( IndexValueType start, SizeValueType length ) for every run of inside pixels of the
+   * scanline with first pixel lineStart and length pixels along the first direction. The runs are
+   * clipped to the scanline and visited in order. */
+  template <typename TVisitor>
+  void
+  VisitRuns(const IndexType & lineStart, SizeValueType length, TVisitor visitor) const;
+
+  /** Test a single index. */
+  bool
+  IsInside(const IndexType & index) const;
+
+  /** The region which was rasterized. */
+  itkGetConstReferenceMacro(Region, RegionType);
+
+  /** The smallest region holding every inside pixel. Empty when nothing is inside. */
+  itkGetConstReferenceMacro(BoundingRegion, RegionType);
+
+  /** Number of runs and number of inside pixels. */
+  SizeValueType
+  GetNumberOfRuns() const
+  {
+    return m_Runs.size();
+  }
+  itkGetConstMacro(NumberOfInsidePixels, SizeValueType);
+
+  /** Remove every run. */
+  void
+  Initialize() override;
+
+protected:
+  RunLengthMask() = default;
+  ~RunLengthMask() override = default;
+
+  void
+  PrintSelf(std::ostream & os, Indent indent) const override;
+
+private:
+  /** Position of the scanline holding index in m_LineStarts, or -1 when it is outside of the region */
+  OffsetValueType
+  ComputeLine(const IndexType & index) const;
+
+  RegionType                 m_Region;
+  RegionType                 m_BoundingRegion;
+  SizeValueType              m_NumberOfInsidePixels{ 0 };
+  std::vector<RunType>       m_Runs;
+  std::vector<SizeValueType> m_LineStarts;
+}; // end class
+} // namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkRunLengthMask.hxx"
+#endif
+
+#endif // itkRunLengthMask_h
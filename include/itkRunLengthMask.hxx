@@ -0,0 +1,231 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkRunLengthMask_hxx
+#define itkRunLengthMask_hxx
+
+#include "itkRunLengthMask.h"
+#include <algorithm>
+
+namespace itk
+{
+
+template <unsigned int VDimension>
+void
+RunLengthMask<VDimension>::Rasterize(const SpatialObjectType * mask,
+                                     const ImageBaseType *     image,
+                                     const RegionType &        region,
+                                     MultiThreaderBase *       multiThreader)
+{
+  if (!mask || !image)
+  {
+    itkExceptionMacro(<< "A mask and an image are required to rasterize.");
+  }
+
+  this->Initialize();
+  m_Region = region;
+
+  /* Every scanline of the region along the first direction */
+  SizeValueType numberOfLines = 1;
+  for (unsigned int d = 1; d < VDimension; ++d)
+  {
+    numberOfLines *= region.GetSize(d);
+  }
+
+  /* Runs of each scanline, found independently */
+  std::vector<std::vector<RunType>> lineRuns(numberOfLines);
+  auto                              rasterizeLine = [&](SizeValueType line) {
+    IndexType     index = region.GetIndex();
+    SizeValueType remainder = line;
+    for (unsigned int d = 1; d < VDimension; ++d)
+    {
+      index[d] += static_cast<IndexValueType>(remainder % region.GetSize(d));
+      remainder /= region.GetSize(d);
+    }
+
+    typename SpatialObjectType::PointType point;
+    std::vector<RunType> &                runs = lineRuns[line];
+    bool                                  inRun = false;
+    for (SizeValueType x = 0; x < region.GetSize(0); ++x, ++index[0])
+    {
+      image->TransformIndexToPhysicalPoint(index, point);
+      if (mask->IsInsideInObjectSpace(point))
+      {
+        if (!inRun)
+        {
+          runs.push_back(RunType{ index[0], 0 });
+          inRun = true;
+        }
+        ++runs.back().Length;
+      }
+      else
+      {
+        inRun = false;
+      }
+    }
+  };
+
+  if (multiThreader)
+  {
+    multiThreader->ParallelizeArray(0, numberOfLines, rasterizeLine, nullptr);
+  }
+  else
+  {
+    for (SizeValueType line = 0; line < numberOfLines; ++line)
+    {
+      rasterizeLine(line);
+    }
+  }
+
+  /* Concatenate the scanlines and find the bounding region */
+  IndexType lower;
+  IndexType upper;
+  lower.Fill(NumericTraits<IndexValueType>::max());
+  upper.Fill(NumericTraits<IndexValueType>::NonpositiveMin());
+
+  m_LineStarts.resize(numberOfLines + 1);
+  for (SizeValueType line = 0; line < numberOfLines; ++line)
+  {
+    m_LineStarts[line] = m_Runs.size();
+    if (lineRuns[line].empty())
+    {
+      continue;
+    }
+
+    SizeValueType remainder = line;
+    for (unsigned int d = 1; d < VDimension; ++d)
+    {
+      const IndexValueType position =
+        region.GetIndex(d) + static_cast<IndexValueType>(remainder % region.GetSize(d));
+      remainder /= region.GetSize(d);
+      lower[d] = std::min(lower[d], position);
+      upper[d] = std::max(upper[d], position);
+    }
+    lower[0] = std::min(lower[0], lineRuns[line].front().Start);
+    upper[0] = std::max(upper[0],
+                        lineRuns[line].back().Start + static_cast<IndexValueType>(lineRuns[line].back().Length) - 1);
+
+    for (const RunType & run : lineRuns[line])
+    {
+      m_NumberOfInsidePixels += run.Length;
+      m_Runs.push_back(run);
+    }
+  }
+  m_LineStarts[numberOfLines] = m_Runs.size();
+
+  if (m_NumberOfInsidePixels > 0)
+  {
+    for (unsigned int d = 0; d < VDimension; ++d)
+    {
+      m_BoundingRegion.SetIndex(d, lower[d]);
+      m_BoundingRegion.SetSize(d, static_cast<SizeValueType>(upper[d] - lower[d] + 1));
+    }
+  }
+
+  this->Modified();
+}
+
+template <unsigned int VDimension>
+template <typename TVisitor>
+void
+RunLengthMask<VDimension>::VisitRuns(const IndexType & lineStart, SizeValueType length, TVisitor visitor) const
+{
+  const OffsetValueType line = this->ComputeLine(lineStart);
+  if (line < 0)
+  {
+    return;
+  }
+
+  const IndexValueType first = lineStart[0];
+  const IndexValueType last = first + static_cast<IndexValueType>(length);
+  for (SizeValueType i = m_LineStarts[line]; i < m_LineStarts[line + 1]; ++i)
+  {
+    const RunType & run = m_Runs[i];
+    if (run.Start >= last)
+    {
+      break;
+    }
+
+    const IndexValueType begin = std::max(run.Start, first);
+    const IndexValueType end = std::min(run.Start + static_cast<IndexValueType>(run.Length), last);
+    if (end > begin)
+    {
+      visitor(begin, static_cast<SizeValueType>(end - begin));
+    }
+  }
+}
+
+template <unsigned int VDimension>
+bool
+RunLengthMask<VDimension>::IsInside(const IndexType & index) const
+{
+  bool inside = false;
+  this->VisitRuns(index, 1, [&inside](IndexValueType, SizeValueType) { inside = true; });
+  return inside;
+}
+
+template <unsigned int VDimension>
+OffsetValueType
+RunLengthMask<VDimension>::ComputeLine(const IndexType & index) const
+{
+  if (m_LineStarts.empty())
+  {
+    return -1;
+  }
+
+  OffsetValueType line = 0;
+  OffsetValueType stride = 1;
+  for (unsigned int d = 1; d < VDimension; ++d)
+  {
+    const OffsetValueType position = index[d] - m_Region.GetIndex(d);
+    if (position < 0 || position >= static_cast<OffsetValueType>(m_Region.GetSize(d)))
+    {
+      return -1;
+    }
+    line += position * stride;
+    stride *= static_cast<OffsetValueType>(m_Region.GetSize(d));
+  }
+  return line;
+}
+
+template <unsigned int VDimension>
+void
+RunLengthMask<VDimension>::Initialize()
+{
+  Superclass::Initialize();
+  m_Region = RegionType();
+  m_BoundingRegion = RegionType();
+  m_NumberOfInsidePixels = 0;
+  m_Runs.clear();
+  m_LineStarts.clear();
+}
+
+template <unsigned int VDimension>
+void
+RunLengthMask<VDimension>::PrintSelf(std::ostream & os, Indent indent) const
+{
+  Superclass::PrintSelf(os, indent);
+  os << indent << "Region: " << m_Region << std::endl;
+  os << indent << "BoundingRegion: " << m_BoundingRegion << std::endl;
+  os << indent << "NumberOfRuns: " << m_Runs.size() << std::endl;
+  os << indent << "NumberOfInsidePixels: " << m_NumberOfInsidePixels << std::endl;
+}
+
+} // namespace itk
+
+#endif // itkRunLengthMask_hxx
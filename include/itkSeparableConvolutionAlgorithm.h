@@ -0,0 +1,71 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkSeparableConvolutionAlgorithm_h
+#define itkSeparableConvolutionAlgorithm_h
+
+#include "itkMultiThreaderBase.h"
+#include <vector>
+
+namespace itk
+{
+/** \class SeparableConvolutionAlgorithm
+ * \brief Correlate the lines of an image with a one dimensional kernel.
+ *
+ * This is the building block for filters that want to run the individual
+ * passes of a separable convolution themselves instead of chaining
+ * NeighborhoodOperatorImageFilter instances. Each line of the region along
+ * the requested direction is gathered, correlated with the kernel and handed
+ * to a writer, so the caller decides where the result goes (an intermediate
+ * image, one component of a tensor, a combination with another image, ...).
+ *
+ * The kernel has an odd number of taps and is applied as an inner product,
+ * like NeighborhoodOperatorImageFilter does. Reads outside of the buffered
+ * region of the input are clamped to its boundary, which is the zero flux
+ * Neumann boundary condition whenever the buffered region touches the edge
+ * of the image.
+ *
+ * \author: Bryce Besler
+ * \ingroup BoneEnhancement
+ */
+struct SeparableConvolutionAlgorithm
+{
+  using KernelType = std::vector<double>;
+
+  /** Correlate every line of region along direction with kernel. The writer is
+   * called once per line with the index of the first pixel of the line, a pointer
+   * to the values and the number of values:
+   *    writer(const IndexType & lineStart, const double * values, SizeValueType length)
+   * The writer is invoked concurrently for different lines. The region must be
+   * inside the buffered region of the input. */
+  template <typename TInputImage, typename TLineWriter>
+  static void
+  ConvolveLines(const TInputImage *                       input,
+                const typename TInputImage::RegionType & region,
+                unsigned int                             direction,
+                const KernelType &                       kernel,
+                TLineWriter                              writer,
+                MultiThreaderBase *                      multiThreader);
+};
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#  include "itkSeparableConvolutionAlgorithm.hxx"
+#endif
+
+#endif // itkSeparableConvolutionAlgorithm_h
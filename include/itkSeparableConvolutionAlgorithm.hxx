@@ -0,0 +1,106 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#ifndef itkSeparableConvolutionAlgorithm_hxx
+#define itkSeparableConvolutionAlgorithm_hxx
+
+#include "itkSeparableConvolutionAlgorithm.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include <algorithm>
+
+namespace itk
+{
+
+template <typename TInputImage, typename TLineWriter>
+void
+SeparableConvolutionAlgorithm::ConvolveLines(const TInputImage *                       input,
+                                             const typename TInputImage::RegionType & region,
+                                             unsigned int                             direction,
+                                             const KernelType &                       kernel,
+                                             TLineWriter                              writer,
+                                             MultiThreaderBase *                      multiThreader)
+{
+  using RegionType = typename TInputImage::RegionType;
+  using IndexType = typename TInputImage::IndexType;
+  using PixelType = typename TInputImage::PixelType;
+
+  if (region.GetNumberOfPixels() == 0 || kernel.empty())
+  {
+    return;
+  }
+
+  /* Everything needed to read a line straight out of the buffer */
+  const RegionType      bufferedRegion = input->GetBufferedRegion();
+  const IndexValueType  bufferStart = bufferedRegion.GetIndex(direction);
+  const IndexValueType  bufferEnd = bufferStart + static_cast<IndexValueType>(bufferedRegion.GetSize(direction)) - 1;
+  const OffsetValueType stride = input->GetOffsetTable()[direction];
+  const PixelType *     buffer = input->GetBufferPointer();
+
+  const auto          radius = static_cast<IndexValueType>(kernel.size() / 2);
+  const SizeValueType length = region.GetSize(direction);
+  const SizeValueType taps = kernel.size();
+
+  multiThreader->ParallelizeImageRegionRestrictDirection<TInputImage::ImageDimension>(
+    direction,
+    region,
+    [&](const RegionType & threadRegion) {
+      /* Scratch space for one line, including the kernel support on both sides */
+      std::vector<double> line(length + 2 * radius);
+      std::vector<double> values(length);
+
+      /* Visit the first pixel of every line */
+      RegionType lineStartRegion = threadRegion;
+      lineStartRegion.SetSize(direction, 1);
+      ImageRegionConstIteratorWithIndex<TInputImage> it(input, lineStartRegion);
+
+      for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+      {
+        const IndexType lineStart = it.GetIndex();
+
+        /* Gather the line, clamping at the buffered region */
+        IndexType bufferIndex = lineStart;
+        bufferIndex[direction] = bufferStart;
+        const PixelType *    origin = buffer + input->ComputeOffset(bufferIndex);
+        const IndexValueType first = lineStart[direction] - radius;
+        for (IndexValueType i = 0; i < static_cast<IndexValueType>(line.size()); ++i)
+        {
+          const IndexValueType position = std::min(std::max(first + i, bufferStart), bufferEnd);
+          line[i] = static_cast<double>(origin[(position - bufferStart) * stride]);
+        }
+
+        /* Inner product with the kernel */
+        for (SizeValueType x = 0; x < length; ++x)
+        {
+          const double * support = line.data() + x;
+          double         sum = 0.0;
+          for (SizeValueType k = 0; k < taps; ++k)
+          {
+            sum += kernel[k] * support[k];
+          }
+          values[x] = sum;
+        }
+
+        writer(lineStart, values.data(), length);
+      }
+    },
+    nullptr);
+}
+
+} // end namespace itk
+
+#endif // itkSeparableConvolutionAlgorithm_hxx
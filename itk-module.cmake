@@ -17,6 +17,9 @@ itk_module(BoneEnhancement
     ITKStatistics
     ITKImageFilterBase
     ITKImageFeature
+    ITKFFT
+    ITKImageFunction
+    ITKImageGrid
     ITKSpatialObjects
   COMPILE_DEPENDS
     ITKImageSources
@@ -0,0 +1,203 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkGTest.h"
+#include "itkAnalyticSymmetricEigenValueImageFilter.h"
+#include "itkSymmetricEigenAnalysisImageFilter.h"
+#include "itkImage.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIterator.h"
+#include "itkTestingMacros.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace
+{
+template <unsigned int VDimension>
+class itkAnalyticSymmetricEigenValueImageFilterUnitTest
+{
+public:
+  using TensorType = itk::SymmetricSecondRankTensor<double, VDimension>;
+  using TensorImageType = itk::Image<TensorType, VDimension>;
+  using EigenValueImageType = itk::Image<itk::Vector<float, VDimension>, VDimension>;
+  using FilterType = itk::AnalyticSymmetricEigenValueImageFilter<TensorImageType, EigenValueImageType>;
+  using ReferenceFilterType = itk::SymmetricEigenAnalysisImageFilter<TensorImageType, EigenValueImageType>;
+  using EigenValueOrderEnum = typename FilterType::EigenValueOrderEnum;
+
+  /* Random tensors of mixed magnitude, with degenerate tensors in the first pixels */
+  explicit itkAnalyticSymmetricEigenValueImageFilterUnitTest(const std::vector<TensorType> & specialTensors)
+  {
+    typename TensorImageType::SizeType size;
+    size.Fill(11);
+    m_Image = TensorImageType::New();
+    m_Image->SetRegions(size);
+    m_Image->Allocate();
+
+    std::mt19937                           generator(42);
+    std::uniform_real_distribution<double> component(-1.0, 1.0);
+    std::uniform_int_distribution<int>     exponent(-4, 4);
+
+    itk::ImageRegionIterator<TensorImageType> it(m_Image, m_Image->GetLargestPossibleRegion());
+    typename std::vector<TensorType>::size_type special = 0;
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+      if (special < specialTensors.size())
+      {
+        it.Set(specialTensors[special++]);
+        continue;
+      }
+
+      TensorType   tensor;
+      const double scale = std::pow(10.0, exponent(generator));
+      for (unsigned int i = 0; i < TensorType::InternalDimension; ++i)
+      {
+        tensor[i] = scale * component(generator);
+      }
+      it.Set(tensor);
+    }
+  }
+
+  /* Compare against the QL decomposition, relative to the largest eigenvalue of each pixel */
+  void
+  ExpectMatchesReference(EigenValueOrderEnum order) const
+  {
+    typename FilterType::Pointer filter = FilterType::New();
+    filter->SetInput(m_Image);
+    filter->SetEigenValueOrder(order);
+    EXPECT_EQ(order, filter->GetEigenValueOrder());
+    ASSERT_NO_THROW(filter->Update());
+
+    typename ReferenceFilterType::Pointer reference = ReferenceFilterType::New();
+    reference->SetInput(m_Image);
+    reference->SetDimension(VDimension);
+    reference->OrderEigenValuesBy(order);
+    ASSERT_NO_THROW(reference->Update());
+
+    itk::ImageRegionConstIterator<EigenValueImageType> it(filter->GetOutput(),
+                                                          filter->GetOutput()->GetLargestPossibleRegion());
+    itk::ImageRegionConstIterator<EigenValueImageType> referenceIt(reference->GetOutput(),
+                                                                   reference->GetOutput()->GetLargestPossibleRegion());
+    for (it.GoToBegin(), referenceIt.GoToBegin(); !it.IsAtEnd(); ++it, ++referenceIt)
+    {
+      double largest = 0.0;
+      for (unsigned int d = 0; d < VDimension; ++d)
+      {
+        largest = std::max(largest, static_cast<double>(std::abs(referenceIt.Get()[d])));
+      }
+      for (unsigned int d = 0; d < VDimension; ++d)
+      {
+        ASSERT_NEAR(referenceIt.Get()[d], it.Get()[d], 1e-5 * largest) << it.GetIndex() << " " << d;
+      }
+    }
+  }
+
+private:
+  typename TensorImageType::Pointer m_Image;
+};
+
+template <unsigned int VDimension>
+itk::SymmetricSecondRankTensor<double, VDimension>
+MakeTensor(const std::vector<double> & components)
+{
+  itk::SymmetricSecondRankTensor<double, VDimension> tensor;
+  for (unsigned int i = 0; i < tensor.Size(); ++i)
+  {
+    tensor[i] = components[i];
+  }
+  return tensor;
+}
+} // namespace
+
+TEST(itkAnalyticSymmetricEigenValueImageFilterUnitTest, ExerciseBasicMethods)
+{
+  using FixtureType = itkAnalyticSymmetricEigenValueImageFilterUnitTest<3>;
+  FixtureType::FilterType::Pointer filter = FixtureType::FilterType::New();
+
+  // if not wrapped in a lambda, produces error C2562: 'void' function returning a value
+  int basicMethods = [=]() -> int {
+    ITK_EXERCISE_BASIC_OBJECT_METHODS(filter, AnalyticSymmetricEigenValueImageFilter, ImageToImageFilter);
+    return EXIT_SUCCESS;
+  }();
+  ASSERT_EQ(basicMethods, EXIT_SUCCESS);
+
+  EXPECT_EQ(FixtureType::EigenValueOrderEnum::OrderByValue, filter->GetEigenValueOrder());
+  filter->OrderEigenValuesBy(FixtureType::EigenValueOrderEnum::OrderByMagnitude);
+  EXPECT_EQ(FixtureType::EigenValueOrderEnum::OrderByMagnitude, filter->GetEigenValueOrder());
+}
+
+TEST(itkAnalyticSymmetricEigenValueImageFilterUnitTest, MatchesReferenceIn3D)
+{
+  /* Components a00, a01, a02, a11, a12, a22 */
+  const std::vector<itk::SymmetricSecondRankTensor<double, 3>> specialTensors = {
+    MakeTensor<3>({ 0, 0, 0, 0, 0, 0 }),
+    MakeTensor<3>({ 5, 0, 0, 5, 0, 5 }),
+    MakeTensor<3>({ 1, 0, 0, -2, 0, 3 }),
+    MakeTensor<3>({ 3, 0, 0, -3, 0, 0 }),
+    MakeTensor<3>({ 1, 0, 0, 1, 0, 2 }),
+    MakeTensor<3>({ 3, 1, 1, 3, 1, 3 }),
+    MakeTensor<3>({ -1, -1, -1, -1, -1, -1 }),
+    MakeTensor<3>({ 1, 1e-9, 0, 1, 0, -4 }),
+    MakeTensor<3>({ 1e-6, 2, 0, 1e-6, 0, 1e6 }),
+  };
+
+  const itkAnalyticSymmetricEigenValueImageFilterUnitTest<3> fixture(specialTensors);
+  fixture.ExpectMatchesReference(itk::SymmetricEigenAnalysisEnums::EigenValueOrder::OrderByValue);
+  fixture.ExpectMatchesReference(itk::SymmetricEigenAnalysisEnums::EigenValueOrder::OrderByMagnitude);
+}
+
+TEST(itkAnalyticSymmetricEigenValueImageFilterUnitTest, MatchesReferenceIn2D)
+{
+  /* Components a00, a01, a11 */
+  const std::vector<itk::SymmetricSecondRankTensor<double, 2>> specialTensors = {
+    MakeTensor<2>({ 0, 0, 0 }), MakeTensor<2>({ 2, 0, 2 }), MakeTensor<2>({ 1, 0, -3 }), MakeTensor<2>({ 1, 1, 1 })
+  };
+
+  const itkAnalyticSymmetricEigenValueImageFilterUnitTest<2> fixture(specialTensors);
+  fixture.ExpectMatchesReference(itk::SymmetricEigenAnalysisEnums::EigenValueOrder::OrderByValue);
+  fixture.ExpectMatchesReference(itk::SymmetricEigenAnalysisEnums::EigenValueOrder::OrderByMagnitude);
+}
+
+TEST(itkAnalyticSymmetricEigenValueImageFilterUnitTest, DegeneratePixelsAreFlagged)
+{
+  using FilterType = itkAnalyticSymmetricEigenValueImageFilterUnitTest<3>::FilterType;
+
+  /* A double eigenvalue, a triple eigenvalue and well separated eigenvalues */
+  const std::vector<double> components = { 3, 5, 1, /* a00 */
+                                           1, 0, 0, /* a01 */
+                                           1, 0, 0, /* a02 */
+                                           3, 5, 2, /* a11 */
+                                           1, 0, 0, /* a12 */
+                                           3, 5, 4 /* a22 */ };
+  std::vector<double>        eigenValues(9);
+  std::vector<unsigned char> degenerate(3);
+  FilterType::ComputeEigenValues3x3(components.data(), eigenValues.data(), degenerate.data(), 3, false);
+
+  EXPECT_EQ(1, degenerate[0]);
+  EXPECT_EQ(0, degenerate[1]);
+  EXPECT_EQ(0, degenerate[2]);
+  EXPECT_NEAR(2.0, eigenValues[0], 1e-6);
+  EXPECT_NEAR(2.0, eigenValues[3], 1e-6);
+  EXPECT_NEAR(5.0, eigenValues[6], 1e-6);
+  for (unsigned int d = 0; d < 3; ++d)
+  {
+    EXPECT_EQ(5.0, eigenValues[3 * d + 1]);
+    EXPECT_NEAR(d + 1.0, eigenValues[3 * d + 2], 1e-12);
+  }
+}
@@ -0,0 +1,293 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+/*
+ * Throughput of every filter of the module on synthetic volumes. Each benchmark takes the edge length of a cubic
+ * volume and the number of threads, and the ones which take a mask whether the volume is masked. The multiscale
+ * pipeline also takes the number of sigma values. Run with
+ *
+ *   BoneEnhancementBenchmarks --benchmark_out=results.json --benchmark_out_format=json
+ *
+ * to keep a machine readable record. The items per second are voxels per second.
+ */
+
+#include "benchmark/benchmark.h"
+#include "itkMultiScaleHessianEnhancementImageFilter.h"
+#include "itkKrcahEigenToMeasureImageFilter.h"
+#include "itkKrcahEigenToMeasureParameterEstimationFilter.h"
+#include "itkDescoteauxEigenToMeasureImageFilter.h"
+#include "itkDescoteauxEigenToMeasureParameterEstimationFilter.h"
+#include "itkMaximumAbsoluteValueImageFilter.h"
+#include "itkKrcahPreprocessingImageToImageFilter.h"
+#include "itkImageMaskSpatialObject.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMultiThreaderBase.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+constexpr unsigned int DIMENSION = 3;
+using ImageType = itk::Image<float, DIMENSION>;
+using MaskImageType = itk::Image<unsigned char, DIMENSION>;
+using SpatialObjectType = itk::ImageMaskSpatialObject<DIMENSION>;
+using MultiScaleFilterType = itk::MultiScaleHessianEnhancementImageFilter<ImageType, ImageType>;
+using HessianFilterType = MultiScaleFilterType::HessianFilterType;
+using HessianImageType = MultiScaleFilterType::HessianImageType;
+using EigenAnalysisFilterType = MultiScaleFilterType::EigenAnalysisFilterType;
+using EigenValueImageType = MultiScaleFilterType::EigenValueImageType;
+using KrcahEstimationFilterType = itk::KrcahEigenToMeasureParameterEstimationFilter<EigenValueImageType>;
+using KrcahMeasureFilterType = itk::KrcahEigenToMeasureImageFilter<EigenValueImageType, ImageType>;
+using DescoteauxEstimationFilterType = itk::DescoteauxEigenToMeasureParameterEstimationFilter<EigenValueImageType>;
+using DescoteauxMeasureFilterType = itk::DescoteauxEigenToMeasureImageFilter<EigenValueImageType, ImageType>;
+using MaximumAbsoluteValueFilterType = itk::MaximumAbsoluteValueImageFilter<ImageType>;
+using PreprocessingFilterType = itk::KrcahPreprocessingImageToImageFilter<ImageType, ImageType>;
+
+/* A noisy oblique plate on a smooth background, about what a cortex looks like */
+ImageType::Pointer
+CreateVolume(itk::SizeValueType size, unsigned int seed)
+{
+  ImageType::SizeType volumeSize;
+  volumeSize.Fill(size);
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(volumeSize);
+  image->Allocate();
+
+  std::mt19937                    generator(seed);
+  std::normal_distribution<float> noise(0.0f, 20.0f);
+  const double                    center = 0.5 * static_cast<double>(size);
+  for (itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetLargestPossibleRegion()); !it.IsAtEnd(); ++it)
+  {
+    const ImageType::IndexType index = it.GetIndex();
+    const double               distance = 0.5 * index[0] + 0.3 * index[1] - index[2] + 0.2 * center;
+    it.Set(static_cast<float>(1000.0 * std::exp(-distance * distance / 8.0) + 2.0 * index[0]) + noise(generator));
+  }
+  return image;
+}
+
+/* A ball in the middle of the volume, holding about half of it with a radius of 0.985 of half the size */
+SpatialObjectType::Pointer
+CreateMask(const ImageType * image)
+{
+  MaskImageType::Pointer maskImage = MaskImageType::New();
+  maskImage->CopyInformation(image);
+  maskImage->SetRegions(image->GetLargestPossibleRegion());
+  maskImage->Allocate();
+
+  const double center = 0.5 * static_cast<double>(image->GetLargestPossibleRegion().GetSize(0));
+  for (itk::ImageRegionIteratorWithIndex<MaskImageType> it(maskImage, maskImage->GetLargestPossibleRegion());
+       !it.IsAtEnd();
+       ++it)
+  {
+    double radius2 = 0.0;
+    for (unsigned int d = 0; d < DIMENSION; ++d)
+    {
+      radius2 += (it.GetIndex()[d] - center) * (it.GetIndex()[d] - center);
+    }
+    it.Set(radius2 <= 0.97 * center * center ? 1 : 0);
+  }
+
+  SpatialObjectType::Pointer mask = SpatialObjectType::New();
+  mask->SetImage(maskImage);
+  mask->Update();
+  return mask;
+}
+
+/* The hessian and its eigenvalues at one sigma, the inputs of the later stages */
+HessianImageType::Pointer
+CreateHessian(const ImageType * image)
+{
+  HessianFilterType::Pointer hessian = HessianFilterType::New();
+  hessian->SetInput(image);
+  hessian->SetSigma(1.5);
+  hessian->Update();
+  return hessian->GetOutput();
+}
+
+EigenValueImageType::Pointer
+CreateEigenValues(const ImageType * image)
+{
+  EigenAnalysisFilterType::Pointer eigen = EigenAnalysisFilterType::New();
+  eigen->SetInput(CreateHessian(image));
+  eigen->Update();
+  return eigen->GetOutput();
+}
+
+/* The first two ranges are the size and the number of threads, which every filter created after this uses */
+itk::SizeValueType
+ConfigureThreads(const benchmark::State & state)
+{
+  itk::MultiThreaderBase::SetGlobalDefaultNumberOfThreads(static_cast<itk::ThreadIdType>(state.range(1)));
+  return static_cast<itk::SizeValueType>(state.range(0));
+}
+
+/* Update filter once per iteration and report the voxels of an image of size per second */
+template <typename TFilter>
+void
+RunFilter(benchmark::State & state, TFilter * filter, itk::SizeValueType size)
+{
+  for (auto _ : state)
+  {
+    filter->Modified();
+    filter->Update();
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(size * size * size));
+}
+
+void
+BM_HessianGaussianImageFilter(benchmark::State & state)
+{
+  const itk::SizeValueType   size = ConfigureThreads(state);
+  ImageType::Pointer         image = CreateVolume(size, 0);
+  HessianFilterType::Pointer filter = HessianFilterType::New();
+  filter->SetInput(image);
+  filter->SetSigma(1.5);
+  RunFilter(state, filter.GetPointer(), size);
+}
+
+void
+BM_AnalyticSymmetricEigenValueImageFilter(benchmark::State & state)
+{
+  const itk::SizeValueType         size = ConfigureThreads(state);
+  HessianImageType::Pointer        hessian = CreateHessian(CreateVolume(size, 0));
+  EigenAnalysisFilterType::Pointer filter = EigenAnalysisFilterType::New();
+  filter->SetInput(hessian);
+  RunFilter(state, filter.GetPointer(), size);
+}
+
+template <typename TEstimationFilter>
+void
+BM_ParameterEstimationFilter(benchmark::State & state)
+{
+  const itk::SizeValueType            size = ConfigureThreads(state);
+  ImageType::Pointer                  image = CreateVolume(size, 0);
+  EigenValueImageType::Pointer        eigen = CreateEigenValues(image);
+  typename TEstimationFilter::Pointer filter = TEstimationFilter::New();
+  filter->SetInput(eigen);
+  if (state.range(2))
+  {
+    filter->SetMask(CreateMask(image));
+  }
+  RunFilter(state, filter.GetPointer(), size);
+}
+
+template <typename TEstimationFilter, typename TMeasureFilter>
+void
+BM_MeasureFilter(benchmark::State & state)
+{
+  const itk::SizeValueType            size = ConfigureThreads(state);
+  ImageType::Pointer                  image = CreateVolume(size, 0);
+  EigenValueImageType::Pointer        eigen = CreateEigenValues(image);
+  typename TEstimationFilter::Pointer estimation = TEstimationFilter::New();
+  estimation->SetInput(eigen);
+  estimation->Update();
+
+  typename TMeasureFilter::Pointer filter = TMeasureFilter::New();
+  filter->SetInput(eigen);
+  filter->SetParameters(estimation->GetParameters());
+  if (state.range(2))
+  {
+    filter->SetMask(CreateMask(image));
+  }
+  RunFilter(state, filter.GetPointer(), size);
+}
+
+void
+BM_MaximumAbsoluteValueImageFilter(benchmark::State & state)
+{
+  const itk::SizeValueType                size = ConfigureThreads(state);
+  MaximumAbsoluteValueFilterType::Pointer filter = MaximumAbsoluteValueFilterType::New();
+  filter->SetInput1(CreateVolume(size, 0));
+  filter->SetInput2(CreateVolume(size, 1));
+  RunFilter(state, filter.GetPointer(), size);
+}
+
+void
+BM_KrcahPreprocessingImageToImageFilter(benchmark::State & state)
+{
+  const itk::SizeValueType         size = ConfigureThreads(state);
+  PreprocessingFilterType::Pointer filter = PreprocessingFilterType::New();
+  filter->SetInput(CreateVolume(size, 0));
+  RunFilter(state, filter.GetPointer(), size);
+}
+
+void
+BM_MultiScaleHessianEnhancementImageFilter(benchmark::State & state)
+{
+  const itk::SizeValueType      size = ConfigureThreads(state);
+  ImageType::Pointer            image = CreateVolume(size, 0);
+  MultiScaleFilterType::Pointer filter = MultiScaleFilterType::New();
+  filter->SetInput(image);
+  filter->SetEigenToMeasureImageFilter(KrcahMeasureFilterType::New());
+  filter->SetEigenToMeasureParameterEstimationFilter(KrcahEstimationFilterType::New());
+  filter->SetSigmaArray(
+    MultiScaleFilterType::GenerateEquispacedSigmaArray(1.0, 3.0, static_cast<unsigned int>(state.range(3))));
+  if (state.range(2))
+  {
+    filter->SetImageMask(CreateMask(image));
+  }
+  RunFilter(state, filter.GetPointer(), size);
+}
+
+/* Every size with one thread and with every thread of the machine, then every extra range */
+void
+SizesAndThreads(benchmark::internal::Benchmark * benchmark, const std::vector<std::vector<int64_t>> & extraRanges)
+{
+  const auto allThreads = static_cast<int64_t>(std::max(1u, std::thread::hardware_concurrency()));
+  std::vector<std::vector<int64_t>> ranges = { { 32, 64, 128 }, { 1, allThreads } };
+  ranges.insert(ranges.end(), extraRanges.begin(), extraRanges.end());
+  benchmark->ArgsProduct(ranges)->Unit(benchmark::kMillisecond)->UseRealTime();
+}
+
+void
+Unmasked(benchmark::internal::Benchmark * benchmark)
+{
+  benchmark->ArgNames({ "size", "threads" });
+  SizesAndThreads(benchmark, {});
+}
+
+void
+Masked(benchmark::internal::Benchmark * benchmark)
+{
+  benchmark->ArgNames({ "size", "threads", "masked" });
+  SizesAndThreads(benchmark, { { 0, 1 } });
+}
+
+void
+MaskedAndSigmas(benchmark::internal::Benchmark * benchmark)
+{
+  benchmark->ArgNames({ "size", "threads", "masked", "sigmas" });
+  SizesAndThreads(benchmark, { { 0, 1 }, { 1, 4 } });
+}
+} // namespace
+
+BENCHMARK(BM_HessianGaussianImageFilter)->Apply(Unmasked);
+BENCHMARK(BM_AnalyticSymmetricEigenValueImageFilter)->Apply(Unmasked);
+BENCHMARK_TEMPLATE(BM_ParameterEstimationFilter, KrcahEstimationFilterType)->Apply(Masked);
+BENCHMARK_TEMPLATE(BM_ParameterEstimationFilter, DescoteauxEstimationFilterType)->Apply(Masked);
+BENCHMARK_TEMPLATE(BM_MeasureFilter, KrcahEstimationFilterType, KrcahMeasureFilterType)->Apply(Masked);
+BENCHMARK_TEMPLATE(BM_MeasureFilter, DescoteauxEstimationFilterType, DescoteauxMeasureFilterType)->Apply(Masked);
+BENCHMARK(BM_MaximumAbsoluteValueImageFilter)->Apply(Unmasked);
+BENCHMARK(BM_KrcahPreprocessingImageToImageFilter)->Apply(Unmasked);
+BENCHMARK(BM_MultiScaleHessianEnhancementImageFilter)->Apply(MaskedAndSigmas);
+
+BENCHMARK_MAIN();
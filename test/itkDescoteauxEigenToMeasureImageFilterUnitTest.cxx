@@ -314,3 +314,22 @@ TYPED_TEST(itkDescoteauxEigenToMeasureImageFilterUnitTest, TestWithSpatialObject
     ++input;
   }
 }
+
+TYPED_TEST(itkDescoteauxEigenToMeasureImageFilterUnitTest, TestFunctor)
+{
+  using FunctorType = typename TestFixture::FilterType::FunctorType;
+
+  /* Bright sheet */
+  const FunctorType bright(0.5, 0.5, 0.25, -1.0);
+  EXPECT_NEAR((TypeParam)0.0913983433747, bright(this->m_NonZeroEigenPixel), 1e-6);
+  EXPECT_NEAR((TypeParam)0.0, bright(this->m_NonZeroDarkEigenPixel), 1e-6);
+  EXPECT_EQ((TypeParam)0.0, bright(this->m_ZeroEigenPixel));
+
+  /* Dark sheet */
+  const FunctorType dark(0.5, 0.5, 0.25, 1.0);
+  EXPECT_NEAR((TypeParam)0.0913983433747, dark(this->m_NonZeroDarkEigenPixel), 1e-6);
+  EXPECT_NEAR((TypeParam)0.0, dark(this->m_NonZeroEigenPixel), 1e-6);
+
+  EXPECT_TRUE(bright == FunctorType(0.5, 0.5, 0.25, -1.0));
+  EXPECT_TRUE(bright != dark);
+}
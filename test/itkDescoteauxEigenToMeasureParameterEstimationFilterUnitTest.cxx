@@ -21,6 +21,7 @@
 #include "itkImageMaskSpatialObject.h"
 #include "itkImage.h"
 #include "itkImageRegionIteratorWithIndex.h"
+#include <cmath>
 
 namespace
 {
@@ -240,3 +241,42 @@ TYPED_TEST(itkDescoteauxEigenToMeasureParameterEstimationFilterUnitTest, TestWit
   EXPECT_DOUBLE_EQ(0.5, this->m_Parameters[1]);
   EXPECT_NEAR(86.6025403784, this->m_Parameters[2], 1e-6); // sqrt(3) * 0.1
 }
+
+TYPED_TEST(itkDescoteauxEigenToMeasureParameterEstimationFilterUnitTest, TestPercentileIgnoresOutliers)
+{
+  using EigenImageType = typename TestFixture::EigenImageType;
+
+  /* Five bright pixels out of a thousand */
+  typename EigenImageType::Pointer image = EigenImageType::New();
+  image->SetRegions(this->m_Region);
+  image->Allocate();
+  image->FillBuffer(this->m_OneEigenPixel);
+  typename EigenImageType::PixelType outlier;
+  outlier.Fill(100);
+  for (itk::IndexValueType i = 0; i < 5; ++i)
+  {
+    typename EigenImageType::IndexType index;
+    index.Fill(i);
+    image->SetPixel(index, outlier);
+  }
+
+  EXPECT_EQ(100.0, this->m_Filter->GetFrobeniusNormPercentile());
+  this->m_Filter->SetFrobeniusNormPercentile(150.0);
+  EXPECT_EQ(100.0, this->m_Filter->GetFrobeniusNormPercentile());
+  this->m_Filter->SetInput(image);
+  EXPECT_NO_THROW(this->m_Filter->Update());
+  EXPECT_NEAR(86.6025403784, this->m_Filter->GetParameters()[2], 1e-4); // 0.5 * sqrt(3) * 100
+
+  /* The upper edge of the bin of sqrt(3) */
+  this->m_Filter->SetFrobeniusNormPercentile(99.0);
+  EXPECT_EQ(99.0, this->m_Filter->GetFrobeniusNormPercentile());
+  EXPECT_NO_THROW(this->m_Filter->Update());
+  const double c = this->m_Filter->GetParameters()[2];
+  EXPECT_GE(c, 0.5 * std::sqrt(3.0) * (1.0 - 1e-6));
+  EXPECT_LE(c, 0.5 * std::sqrt(3.0) * (1.0 + 1.0 / 64.0));
+
+  /* Above the ones, the percentile is the largest norm */
+  this->m_Filter->SetFrobeniusNormPercentile(99.9);
+  EXPECT_NO_THROW(this->m_Filter->Update());
+  EXPECT_NEAR(86.6025403784, this->m_Filter->GetParameters()[2], 1e-4);
+}
@@ -0,0 +1,68 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkGTest.h"
+#include "itkDeterministicReduction.h"
+#include "itkMultiThreaderBase.h"
+#include <string>
+
+TEST(itkDeterministicReductionUnitTest, EmptyReductionIsIdentity)
+{
+  itk::DeterministicReduction<double> reduction;
+  EXPECT_EQ(0u, reduction.GetNumberOfSlots());
+  reduction.Initialize(0, -1.0);
+  EXPECT_EQ(-1.0, reduction.Reduce([](double a, double b) { return a + b; }));
+}
+
+TEST(itkDeterministicReductionUnitTest, FixedTree)
+{
+  itk::DeterministicReduction<std::string> reduction;
+  reduction.Initialize(5, "");
+  EXPECT_EQ(5u, reduction.GetNumberOfSlots());
+  const std::string names = "abcde";
+  for (itk::SizeValueType i = 0; i < names.size(); ++i)
+  {
+    reduction[i] = names.substr(i, 1);
+  }
+
+  const std::string tree =
+    reduction.Reduce([](const std::string & a, const std::string & b) { return "(" + a + b + ")"; });
+  EXPECT_EQ("(((ab)(cd))e)", tree);
+}
+
+TEST(itkDeterministicReductionUnitTest, PairwiseSummation)
+{
+  /* Every partial sum of the tree is exact, while adding one after another drifts */
+  const itk::SizeValueType           numberOfSlots = 1 << 20;
+  itk::DeterministicReduction<float> reduction;
+  reduction.Initialize(numberOfSlots, 0.0f);
+
+  itk::MultiThreaderBase::Pointer threader = itk::MultiThreaderBase::New();
+  threader->ParallelizeArray(
+    0, numberOfSlots, [&reduction](itk::SizeValueType slot) { reduction[slot] = 0.1f; }, nullptr);
+
+  float sequential = 0.0f;
+  for (itk::SizeValueType i = 0; i < numberOfSlots; ++i)
+  {
+    sequential += reduction[i];
+  }
+
+  const float pairwise = reduction.Reduce([](float a, float b) { return a + b; });
+  EXPECT_EQ(0.1f * static_cast<float>(numberOfSlots), pairwise);
+  EXPECT_NE(pairwise, sequential);
+}
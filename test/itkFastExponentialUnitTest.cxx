@@ -0,0 +1,261 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkGTest.h"
+#include "itkFastExponential.h"
+#include "itkKrcahEigenToMeasureImageFilter.h"
+#include "itkDescoteauxEigenToMeasureImageFilter.h"
+#include "itkImage.h"
+#include "itkImageRegionConstIterator.h"
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace
+{
+/* Every combination of a small set of eigenvalues, in both signs */
+class EigenValueLattice
+{
+public:
+  EigenValueLattice()
+  {
+    const std::vector<double> magnitudes = { 0.0, 1e-6, 1e-3, 0.1, 0.5, 1.0, 2.5, 3.0, 10.0, 100.0 };
+    std::vector<double>       values;
+    for (double magnitude : magnitudes)
+    {
+      values.push_back(magnitude);
+      values.push_back(-magnitude);
+    }
+
+    for (double a1 : values)
+    {
+      for (double a2 : values)
+      {
+        for (double a3 : values)
+        {
+          m_Lambda1.push_back(static_cast<float>(a1));
+          m_Lambda2.push_back(static_cast<float>(a2));
+          m_Lambda3.push_back(static_cast<float>(a3));
+        }
+      }
+    }
+  }
+
+  /* Largest absolute difference between the fast and double precision evaluation */
+  template <typename TFunctor>
+  double
+  MaximumError(const TFunctor & functor) const
+  {
+    const itk::SizeValueType length = m_Lambda1.size();
+    std::vector<double>      lambda1(m_Lambda1.begin(), m_Lambda1.end());
+    std::vector<double>      lambda2(m_Lambda2.begin(), m_Lambda2.end());
+    std::vector<double>      lambda3(m_Lambda3.begin(), m_Lambda3.end());
+    std::vector<float>       fast(length);
+    std::vector<float>       exact(length);
+
+    functor.Evaluate(
+      m_Lambda1.data(), m_Lambda2.data(), m_Lambda3.data(), fast.data(), length, itk::Functor::FastExponential());
+    functor.Evaluate(
+      lambda1.data(), lambda2.data(), lambda3.data(), exact.data(), length, [](double x) { return std::exp(x); });
+
+    double maximumError = 0.0;
+    for (itk::SizeValueType i = 0; i < length; ++i)
+    {
+      maximumError = std::max(maximumError, static_cast<double>(std::abs(fast[i] - exact[i])));
+    }
+    return maximumError;
+  }
+
+  /* The double precision batch must agree exactly with the per pixel functor, down to the sign of zero */
+  template <typename TFunctor>
+  void
+  ExpectBatchMatchesPixel(const TFunctor & functor) const
+  {
+    using PixelType = itk::FixedArray<float, 3>;
+
+    const itk::SizeValueType length = m_Lambda1.size();
+    std::vector<double>      lambda1(m_Lambda1.begin(), m_Lambda1.end());
+    std::vector<double>      lambda2(m_Lambda2.begin(), m_Lambda2.end());
+    std::vector<double>      lambda3(m_Lambda3.begin(), m_Lambda3.end());
+    std::vector<float>       exact(length);
+    functor.Evaluate(
+      lambda1.data(), lambda2.data(), lambda3.data(), exact.data(), length, [](double x) { return std::exp(x); });
+
+    for (itk::SizeValueType i = 0; i < length; ++i)
+    {
+      PixelType pixel;
+      pixel[0] = m_Lambda1[i];
+      pixel[1] = m_Lambda2[i];
+      pixel[2] = m_Lambda3[i];
+      const float expected = functor(pixel);
+      ASSERT_FALSE(std::isnan(exact[i])) << pixel;
+      ASSERT_EQ(expected, exact[i]) << pixel;
+      ASSERT_EQ(std::signbit(expected), std::signbit(exact[i])) << pixel;
+    }
+  }
+
+private:
+  std::vector<float> m_Lambda1;
+  std::vector<float> m_Lambda2;
+  std::vector<float> m_Lambda3;
+};
+} // namespace
+
+TEST(itkFastExponentialUnitTest, RelativeError)
+{
+  const itk::Functor::FastExponential fastExp;
+  for (double x = -87.0; x <= 88.0; x += 1e-3)
+  {
+    const auto   xf = static_cast<float>(x);
+    const double expected = std::exp(static_cast<double>(xf));
+    ASSERT_LT(std::abs(fastExp(xf) - expected), 2e-7 * expected) << "x = " << xf;
+  }
+}
+
+TEST(itkFastExponentialUnitTest, OutOfRange)
+{
+  const itk::Functor::FastExponential fastExp;
+  EXPECT_EQ(1.0f, fastExp(0.0f));
+  EXPECT_EQ(0.0f, fastExp(-100.0f));
+  EXPECT_EQ(0.0f, fastExp(-1e30f));
+  EXPECT_EQ(0.0f, fastExp(-std::numeric_limits<float>::infinity()));
+  EXPECT_EQ(std::numeric_limits<float>::infinity(), fastExp(100.0f));
+  EXPECT_EQ(std::numeric_limits<float>::infinity(), fastExp(std::numeric_limits<float>::infinity()));
+}
+
+TEST(itkFastExponentialUnitTest, KrcahErrorBound)
+{
+  using PixelType = itk::FixedArray<float, 3>;
+  using FunctorType = itk::Functor::KrcahEigenToMeasure<PixelType, float>;
+
+  const EigenValueLattice lattice;
+  for (double gamma : { 0.0, 0.05, 0.25, 1.0, 2.0, 50.0 })
+  {
+    for (double alpha : { 0.25, 0.5, 1.0 })
+    {
+      for (double enhanceType : { -1.0, 1.0 })
+      {
+        const FunctorType functor(alpha, alpha, gamma, enhanceType);
+        EXPECT_LT(lattice.MaximumError(functor), 1e-6);
+        lattice.ExpectBatchMatchesPixel(functor);
+      }
+    }
+  }
+}
+
+TEST(itkFastExponentialUnitTest, DescoteauxErrorBound)
+{
+  using PixelType = itk::FixedArray<float, 3>;
+  using FunctorType = itk::Functor::DescoteauxEigenToMeasure<PixelType, float>;
+
+  const EigenValueLattice lattice;
+  for (double c : { 0.0, 0.05, 0.25, 1.0, 2.0, 50.0 })
+  {
+    for (double alpha : { 0.25, 0.5, 1.0 })
+    {
+      for (double enhanceType : { -1.0, 1.0 })
+      {
+        const FunctorType functor(alpha, alpha, c, enhanceType);
+        EXPECT_LT(lattice.MaximumError(functor), 1e-6);
+        lattice.ExpectBatchMatchesPixel(functor);
+      }
+    }
+  }
+}
+
+TEST(itkFastExponentialUnitTest, FilterPrecisionMode)
+{
+  using EigenImageType = itk::Image<itk::FixedArray<float, 3>, 3>;
+  using ImageType = itk::Image<float, 3>;
+  using FilterType = itk::DescoteauxEigenToMeasureImageFilter<EigenImageType, ImageType>;
+  using MeasurePrecisionEnum = FilterType::MeasurePrecisionEnum;
+
+  EigenImageType::SizeType size;
+  size.Fill(7);
+  EigenImageType::PixelType pixel;
+  pixel[0] = 0.25;
+  pixel[1] = 1;
+  pixel[2] = -1;
+
+  EigenImageType::Pointer image = EigenImageType::New();
+  image->SetRegions(size);
+  image->Allocate();
+  image->FillBuffer(pixel);
+
+  FilterType::ParameterArrayType parameters(3);
+  parameters[0] = 0.5;
+  parameters[1] = 0.5;
+  parameters[2] = 0.25;
+
+  FilterType::Pointer filter = FilterType::New();
+  EXPECT_EQ(MeasurePrecisionEnum::DoublePrecision, filter->GetMeasurePrecision());
+  filter->SetMeasurePrecision(MeasurePrecisionEnum::FastSinglePrecision);
+  EXPECT_EQ(MeasurePrecisionEnum::FastSinglePrecision, filter->GetMeasurePrecision());
+  filter->SetInput(image);
+  filter->SetParameters(parameters);
+  EXPECT_NO_THROW(filter->Update());
+
+  EigenImageType::IndexType index;
+  index.Fill(3);
+  EXPECT_NEAR(0.0913983433747, filter->GetOutput()->GetPixel(index), 1e-6);
+}
+
+TEST(itkFastExponentialUnitTest, ZeroParameterOnZeroEigenValues)
+{
+  using EigenImageType = itk::Image<itk::FixedArray<float, 3>, 3>;
+  using ImageType = itk::Image<float, 3>;
+  using KrcahFilterType = itk::KrcahEigenToMeasureImageFilter<EigenImageType, ImageType>;
+  using DescoteauxFilterType = itk::DescoteauxEigenToMeasureImageFilter<EigenImageType, ImageType>;
+
+  /* A flat image, whose estimated gamma and c are zero */
+  EigenImageType::SizeType size;
+  size.Fill(5);
+  EigenImageType::PixelType zero;
+  zero.Fill(0);
+
+  EigenImageType::Pointer image = EigenImageType::New();
+  image->SetRegions(size);
+  image->Allocate();
+  image->FillBuffer(zero);
+
+  KrcahFilterType::ParameterArrayType parameters(3);
+  parameters[0] = 0.5;
+  parameters[1] = 0.5;
+  parameters[2] = 0.0;
+
+  auto expectPositiveZeros = [](const ImageType * output) {
+    itk::ImageRegionConstIterator<ImageType> it(output, output->GetBufferedRegion());
+    for (; !it.IsAtEnd(); ++it)
+    {
+      ASSERT_EQ(0.0f, it.Get());
+      ASSERT_FALSE(std::signbit(it.Get()));
+    }
+  };
+
+  KrcahFilterType::Pointer krcah = KrcahFilterType::New();
+  krcah->SetInput(image);
+  krcah->SetParameters(parameters);
+  EXPECT_NO_THROW(krcah->Update());
+  expectPositiveZeros(krcah->GetOutput());
+
+  DescoteauxFilterType::Pointer descoteaux = DescoteauxFilterType::New();
+  descoteaux->SetInput(image);
+  descoteaux->SetParameters(parameters);
+  EXPECT_NO_THROW(descoteaux->Update());
+  expectPositiveZeros(descoteaux->GetOutput());
+}
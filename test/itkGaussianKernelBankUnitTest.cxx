@@ -0,0 +1,126 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkGTest.h"
+#include "itkGaussianKernelBank.h"
+#include "itkGaussianDerivativeOperator.h"
+#include "itkGaussianOperator.h"
+#include "itkMultiThreaderBase.h"
+#include <vector>
+
+TEST(itkGaussianKernelBankUnitTest, MatchesOperators)
+{
+  using BankType = itk::GaussianKernelBank<float>;
+  BankType & bank = BankType::GetInstance();
+  EXPECT_EQ(&bank, &BankType::GetInstance());
+
+  for (double sigma : { 0.5, 1.0, 2.5 })
+  {
+    for (double spacing : { 0.25, 1.0, 1.5 })
+    {
+      for (unsigned int order = 0; order <= 2; ++order)
+      {
+        for (bool normalizeAcrossScale : { false, true })
+        {
+          /* The same operator as in a three dimensional image, along the last direction */
+          itk::GaussianDerivativeOperator<float, 3> oper;
+          oper.SetDirection(2);
+          oper.SetOrder(order);
+          oper.SetSpacing(spacing);
+          oper.SetVariance(sigma * sigma);
+          oper.SetMaximumError(0.01);
+          oper.SetMaximumKernelWidth(32);
+          oper.SetNormalizeAcrossScale(normalizeAcrossScale);
+          oper.CreateDirectional();
+
+          const BankType::KernelPointer kernel =
+            bank.GetDerivativeKernel(order, sigma * sigma, spacing, 0.01, 32, normalizeAcrossScale);
+          EXPECT_EQ(std::vector<double>(oper.Begin(), oper.End()), *kernel);
+          EXPECT_EQ(kernel, bank.GetDerivativeKernel(order, sigma * sigma, spacing, 0.01, 32, normalizeAcrossScale));
+        }
+      }
+
+      itk::GaussianOperator<float, 2> oper;
+      oper.SetDirection(1);
+      oper.SetVariance(sigma * sigma / (spacing * spacing));
+      oper.SetMaximumError(0.01);
+      oper.SetMaximumKernelWidth(32);
+      oper.CreateDirectional();
+
+      const BankType::KernelPointer kernel = bank.GetGaussianKernel(sigma * sigma / (spacing * spacing), 0.01, 32);
+      EXPECT_EQ(std::vector<double>(oper.Begin(), oper.End()), *kernel);
+    }
+  }
+}
+
+TEST(itkGaussianKernelBankUnitTest, KeysAndClear)
+{
+  using BankType = itk::GaussianKernelBank<double>;
+  BankType & bank = BankType::GetInstance();
+  bank.Clear();
+  EXPECT_EQ(0u, bank.GetNumberOfKernels());
+
+  const BankType::KernelPointer kernel = bank.GetDerivativeKernel(2, 1.0, 1.0, 0.01, 32, true);
+  EXPECT_EQ(1u, bank.GetNumberOfKernels());
+  EXPECT_EQ(kernel, bank.GetDerivativeKernel(2, 1.0, 1.0, 0.01, 32, true));
+  EXPECT_EQ(1u, bank.GetNumberOfKernels());
+
+  /* Every parameter is part of the key */
+  EXPECT_NE(kernel, bank.GetDerivativeKernel(1, 1.0, 1.0, 0.01, 32, true));
+  EXPECT_NE(kernel, bank.GetDerivativeKernel(2, 2.0, 1.0, 0.01, 32, true));
+  EXPECT_NE(kernel, bank.GetDerivativeKernel(2, 1.0, 0.5, 0.01, 32, true));
+  EXPECT_NE(kernel, bank.GetDerivativeKernel(2, 1.0, 1.0, 0.001, 32, true));
+  EXPECT_NE(kernel, bank.GetDerivativeKernel(2, 1.0, 1.0, 0.01, 8, true));
+  EXPECT_NE(kernel, bank.GetDerivativeKernel(2, 1.0, 1.0, 0.01, 32, false));
+  EXPECT_NE(bank.GetDerivativeKernel(0, 1.0, 1.0, 0.01, 32, false), bank.GetGaussianKernel(1.0, 0.01, 32));
+  EXPECT_EQ(9u, bank.GetNumberOfKernels());
+
+  /* Kernels handed out outlive the bank entries */
+  const std::vector<double> coefficients = *kernel;
+  bank.Clear();
+  EXPECT_EQ(0u, bank.GetNumberOfKernels());
+  EXPECT_EQ(coefficients, *kernel);
+  EXPECT_NE(kernel, bank.GetDerivativeKernel(2, 1.0, 1.0, 0.01, 32, true));
+  EXPECT_EQ(coefficients, *bank.GetDerivativeKernel(2, 1.0, 1.0, 0.01, 32, true));
+}
+
+TEST(itkGaussianKernelBankUnitTest, SharedAcrossThreads)
+{
+  using BankType = itk::GaussianKernelBank<double>;
+  BankType & bank = BankType::GetInstance();
+  bank.Clear();
+
+  /* Many threads asking for a few kernels at once all get the same ones */
+  const itk::SizeValueType             numberOfRequests = 1000;
+  std::vector<BankType::KernelPointer> kernels(numberOfRequests);
+  itk::MultiThreaderBase::Pointer      threader = itk::MultiThreaderBase::New();
+  threader->SetNumberOfWorkUnits(8);
+  threader->ParallelizeArray(
+    0,
+    numberOfRequests,
+    [&bank, &kernels](itk::SizeValueType i) {
+      kernels[i] = bank.GetDerivativeKernel(i % 3, 1.0 + (i % 4), 1.0, 0.01, 32, true);
+    },
+    nullptr);
+
+  EXPECT_EQ(12u, bank.GetNumberOfKernels());
+  for (itk::SizeValueType i = 0; i < numberOfRequests; ++i)
+  {
+    ASSERT_EQ(kernels[i % 12], kernels[i]);
+  }
+}
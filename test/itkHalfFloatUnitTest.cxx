@@ -0,0 +1,103 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkGTest.h"
+#include "itkHalfFloat.h"
+#include "itkImage.h"
+#include "itkSymmetricSecondRankTensor.h"
+#include "itkVector.h"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+TEST(itkHalfFloatUnitTest, EveryEncodingRoundTrips)
+{
+  for (std::uint32_t bits = 0; bits <= 0xffffu; ++bits)
+  {
+    const itk::HalfFloat half = itk::HalfFloat::FromBits(static_cast<std::uint16_t>(bits));
+    const float          value = half;
+    if (std::isnan(value))
+    {
+      ASSERT_TRUE(std::isnan(static_cast<float>(itk::HalfFloat(value)))) << bits;
+      continue;
+    }
+    ASSERT_EQ(bits, static_cast<std::uint32_t>(itk::HalfFloat(value).GetBits())) << value;
+  }
+}
+
+TEST(itkHalfFloatUnitTest, KnownValues)
+{
+  EXPECT_EQ(0x3c00, itk::HalfFloat(1.0f).GetBits());
+  EXPECT_EQ(0xc200, itk::HalfFloat(-3.0f).GetBits());
+  EXPECT_EQ(0x7bff, itk::HalfFloat(65504.0f).GetBits());
+  EXPECT_EQ(0x0001, itk::HalfFloat(5.9604645e-8f).GetBits());
+  EXPECT_EQ(0x8000, itk::HalfFloat(-0.0f).GetBits());
+  EXPECT_EQ(0.0f, static_cast<float>(itk::HalfFloat(1e-8f)));
+  EXPECT_EQ(std::numeric_limits<float>::infinity(), static_cast<float>(itk::HalfFloat(65520.0f)));
+  EXPECT_EQ(-std::numeric_limits<float>::infinity(), static_cast<float>(itk::HalfFloat(-1e30f)));
+
+  /* Ties go to the even mantissa */
+  EXPECT_EQ(1.0f, static_cast<float>(itk::HalfFloat(1.0f + 0.00048828125f)));
+  EXPECT_EQ(1.001953125f, static_cast<float>(itk::HalfFloat(1.0f + 3 * 0.00048828125f)));
+}
+
+TEST(itkHalfFloatUnitTest, RelativeRoundingError)
+{
+  for (float value = 6.2e-5f; value < 65000.0f; value *= 1.0001f)
+  {
+    const float rounded = itk::HalfFloat(value);
+    ASSERT_LE(std::abs(rounded - value), std::ldexp(value, -11)) << value;
+    ASSERT_EQ(-rounded, static_cast<float>(itk::HalfFloat(-value)));
+  }
+}
+
+TEST(itkHalfFloatUnitTest, NumericTraitsAndPixels)
+{
+  using TraitsType = itk::NumericTraits<itk::HalfFloat>;
+  EXPECT_EQ(0.0f, static_cast<float>(TraitsType::ZeroValue()));
+  EXPECT_EQ(1.0f, static_cast<float>(TraitsType::OneValue()));
+  EXPECT_EQ(65504.0f, static_cast<float>(TraitsType::max()));
+  EXPECT_EQ(-65504.0f, static_cast<float>(TraitsType::NonpositiveMin()));
+  EXPECT_EQ(std::ldexp(1.0f, -14), static_cast<float>(TraitsType::min()));
+  EXPECT_EQ(std::ldexp(1.0f, -10), static_cast<float>(TraitsType::epsilon()));
+  const bool isSigned = TraitsType::IsSigned;
+  const bool isInteger = TraitsType::IsInteger;
+  EXPECT_TRUE(isSigned);
+  EXPECT_FALSE(isInteger);
+
+  /* Pixels of half floats are packed */
+  using TensorType = itk::SymmetricSecondRankTensor<itk::HalfFloat, 3>;
+  using EigenValueType = itk::Vector<itk::HalfFloat, 3>;
+  EXPECT_EQ(12u, sizeof(TensorType));
+  EXPECT_EQ(6u, sizeof(EigenValueType));
+
+  using ImageType = itk::Image<TensorType, 3>;
+  ImageType::SizeType size;
+  size.Fill(4);
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(size);
+  image->Allocate(true);
+
+  ImageType::IndexType index;
+  index.Fill(1);
+  TensorType tensor = image->GetPixel(index);
+  EXPECT_EQ(0.0f, static_cast<float>(tensor(1, 2)));
+  tensor(1, 2) = 0.1;
+  image->SetPixel(index, tensor);
+  EXPECT_NEAR(0.1, static_cast<double>(image->GetPixel(index)(2, 1)), 1e-4);
+}
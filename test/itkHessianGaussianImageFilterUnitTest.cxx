@@ -17,7 +17,12 @@
  *=========================================================================*/
 
 #include "itkHessianGaussianImageFilter.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkDiscreteGaussianImageFilter.h"
+#include "itkKrcahPreprocessingImageToImageFilter.h"
 #include "gtest/gtest.h"
+#include <algorithm>
+#include <cmath>
 
 TEST(itkHessianGaussianImageFilterTest, ExerciseBasicMethods)
 {
@@ -39,4 +44,437 @@ TEST(itkHessianGaussianImageFilterTest, ExerciseBasicMethods)
   EXPECT_EQ(false, hess_filter->GetNormalizeAcrossScale());
   hess_filter->NormalizeAcrossScaleOn();
   EXPECT_EQ(true, hess_filter->GetNormalizeAcrossScale());
+
+  EXPECT_EQ(HessianGaussianImageFilterType::HessianComputationEnum::IndependentComponents,
+            hess_filter->GetHessianComputation())
+    << "Initial value of HessianComputation should be IndependentComponents";
+  hess_filter->SetHessianComputation(HessianGaussianImageFilterType::HessianComputationEnum::SharedSeparablePasses);
+  EXPECT_EQ(HessianGaussianImageFilterType::HessianComputationEnum::SharedSeparablePasses,
+            hess_filter->GetHessianComputation());
+
+  EXPECT_EQ(0.0, hess_filter->GetInputSigma()) << "Initial value of InputSigma should be 0";
+  hess_filter->SetInputSigma(0.25);
+  EXPECT_EQ(0.25, hess_filter->GetInputSigma());
+}
+
+TEST(itkHessianGaussianImageFilterTest, SharedSeparablePassesMatchIndependentComponents)
+{
+  const unsigned int Dimension = 3;
+  using PixelType = short;
+  using ImageType = itk::Image<PixelType, Dimension>;
+  using HessianGaussianImageFilterType = itk::HessianGaussianImageFilter<ImageType>;
+  using HessianImageType = HessianGaussianImageFilterType::OutputImageType;
+
+  /* Smooth but non-separable test pattern on an anisotropic grid */
+  ImageType::SizeType size;
+  size[0] = 20;
+  size[1] = 16;
+  size[2] = 12;
+  ImageType::SpacingType spacing;
+  spacing[0] = 0.5;
+  spacing[1] = 0.75;
+  spacing[2] = 1.5;
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(ImageType::RegionType(size));
+  image->SetSpacing(spacing);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetLargestPossibleRegion());
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+  {
+    const ImageType::IndexType index = it.GetIndex();
+    const double               x = index[0] * spacing[0];
+    const double               y = index[1] * spacing[1];
+    const double               z = index[2] * spacing[2];
+    it.Set(static_cast<PixelType>(1000.0 * std::sin(0.7 * x + 0.3 * y) * std::cos(0.4 * z - 0.2 * x) + 50.0 * x * y));
+  }
+
+  HessianGaussianImageFilterType::Pointer independent = HessianGaussianImageFilterType::New();
+  independent->SetInput(image);
+  independent->SetSigma(1.25);
+  independent->NormalizeAcrossScaleOn();
+  EXPECT_NO_THROW(independent->Update());
+
+  HessianGaussianImageFilterType::Pointer shared = HessianGaussianImageFilterType::New();
+  shared->SetInput(image);
+  shared->SetSigma(1.25);
+  shared->NormalizeAcrossScaleOn();
+  shared->SetHessianComputation(HessianGaussianImageFilterType::HessianComputationEnum::SharedSeparablePasses);
+  EXPECT_NO_THROW(shared->Update());
+
+  EXPECT_TRUE(independent->GetOutput()->GetBufferedRegion() == shared->GetOutput()->GetBufferedRegion());
+
+  itk::ImageRegionIteratorWithIndex<HessianImageType> expected(independent->GetOutput(),
+                                                               independent->GetOutput()->GetBufferedRegion());
+  itk::ImageRegionIteratorWithIndex<HessianImageType> result(shared->GetOutput(),
+                                                             shared->GetOutput()->GetBufferedRegion());
+  for (expected.GoToBegin(), result.GoToBegin(); !expected.IsAtEnd(); ++expected, ++result)
+  {
+    for (unsigned int i = 0; i < HessianImageType::PixelType::Length; ++i)
+    {
+      ASSERT_NEAR(expected.Get()[i], result.Get()[i], 1e-3 * (1.0 + std::abs(expected.Get()[i])))
+        << "Component " << i << " differs at " << expected.GetIndex();
+    }
+  }
+}
+
+TEST(itkHessianGaussianImageFilterTest, InputSigmaMatchesDirectSmoothing)
+{
+  const unsigned int Dimension = 2;
+  using ImageType = itk::Image<float, Dimension>;
+  using HessianGaussianImageFilterType = itk::HessianGaussianImageFilter<ImageType>;
+  using HessianImageType = HessianGaussianImageFilterType::OutputImageType;
+  using GaussianFilterType = itk::DiscreteGaussianImageFilter<ImageType, ImageType>;
+
+  ImageType::SizeType size;
+  size.Fill(64);
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(ImageType::RegionType(size));
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetLargestPossibleRegion());
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+  {
+    const double x = it.GetIndex()[0];
+    const double y = it.GetIndex()[1];
+    it.Set(static_cast<float>(1000.0 * std::sin(0.3 * x + 0.2 * y) * std::cos(0.25 * y - 0.1 * x)));
+  }
+
+  /* The input smoothed to sigma 2, then the residual up to sigma 3 */
+  GaussianFilterType::Pointer gaussian = GaussianFilterType::New();
+  gaussian->SetInput(image);
+  gaussian->SetVariance(4.0);
+  gaussian->SetUseImageSpacing(true);
+
+  for (auto computation : { HessianGaussianImageFilterType::HessianComputationEnum::IndependentComponents,
+                            HessianGaussianImageFilterType::HessianComputationEnum::SharedSeparablePasses,
+                            HessianGaussianImageFilterType::HessianComputationEnum::RecursiveGaussian,
+                            HessianGaussianImageFilterType::HessianComputationEnum::FourierTransform })
+  {
+    HessianGaussianImageFilterType::Pointer direct = HessianGaussianImageFilterType::New();
+    direct->SetInput(image);
+    direct->SetSigma(3.0);
+    direct->NormalizeAcrossScaleOn();
+    direct->SetHessianComputation(computation);
+    EXPECT_NO_THROW(direct->Update());
+
+    HessianGaussianImageFilterType::Pointer residual = HessianGaussianImageFilterType::New();
+    residual->SetInput(gaussian->GetOutput());
+    residual->SetSigma(3.0);
+    residual->SetInputSigma(2.0);
+    residual->NormalizeAcrossScaleOn();
+    residual->SetHessianComputation(computation);
+    EXPECT_NO_THROW(residual->Update());
+
+    /* Away from the boundary, where the two are the same convolution */
+    ImageType::RegionType center;
+    center.SetIndex(0, 24);
+    center.SetIndex(1, 24);
+    center.SetSize(0, 16);
+    center.SetSize(1, 16);
+    itk::ImageRegionIteratorWithIndex<HessianImageType> expected(direct->GetOutput(), center);
+    itk::ImageRegionIteratorWithIndex<HessianImageType> result(residual->GetOutput(), center);
+    double                                              maximum = 0.0;
+    for (expected.GoToBegin(); !expected.IsAtEnd(); ++expected)
+    {
+      for (unsigned int i = 0; i < HessianImageType::PixelType::Length; ++i)
+      {
+        maximum = std::max(maximum, std::abs(static_cast<double>(expected.Get()[i])));
+      }
+    }
+    ASSERT_GT(maximum, 0.0);
+
+    /* Only the truncation of the kernels differs */
+    for (expected.GoToBegin(), result.GoToBegin(); !expected.IsAtEnd(); ++expected, ++result)
+    {
+      for (unsigned int i = 0; i < HessianImageType::PixelType::Length; ++i)
+      {
+        ASSERT_NEAR(expected.Get()[i], result.Get()[i], 3e-2 * maximum)
+          << "Component " << i << " differs at " << expected.GetIndex();
+      }
+    }
+
+    /* The input sigma has to be smaller than sigma */
+    residual->SetInputSigma(3.0);
+    EXPECT_ANY_THROW(residual->Update());
+  }
+}
+
+TEST(itkHessianGaussianImageFilterTest, RecursiveGaussianMatchesDiscreteGaussian)
+{
+  const unsigned int Dimension = 3;
+  using ImageType = itk::Image<float, Dimension>;
+  using HessianGaussianImageFilterType = itk::HessianGaussianImageFilter<ImageType>;
+  using HessianImageType = HessianGaussianImageFilterType::OutputImageType;
+
+  ImageType::SizeType size;
+  size.Fill(40);
+  ImageType::SpacingType spacing;
+  spacing[0] = 0.5;
+  spacing[1] = 0.5;
+  spacing[2] = 1.0;
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(ImageType::RegionType(size));
+  image->SetSpacing(spacing);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetLargestPossibleRegion());
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+  {
+    const double x = it.GetIndex()[0] * spacing[0];
+    const double y = it.GetIndex()[1] * spacing[1];
+    const double z = it.GetIndex()[2] * spacing[2];
+    it.Set(static_cast<float>(1000.0 * std::sin(0.4 * x + 0.2 * z) * std::cos(0.3 * y - 0.1 * x)));
+  }
+
+  HessianGaussianImageFilterType::Pointer discrete = HessianGaussianImageFilterType::New();
+  discrete->SetInput(image);
+  discrete->SetSigma(2.0);
+  discrete->NormalizeAcrossScaleOn();
+  EXPECT_NO_THROW(discrete->Update());
+
+  HessianGaussianImageFilterType::Pointer recursive = HessianGaussianImageFilterType::New();
+  recursive->SetInput(image);
+  recursive->SetSigma(2.0);
+  recursive->NormalizeAcrossScaleOn();
+  recursive->SetHessianComputation(HessianGaussianImageFilterType::HessianComputationEnum::RecursiveGaussian);
+  EXPECT_EQ(HessianGaussianImageFilterType::HessianComputationEnum::RecursiveGaussian,
+            recursive->GetHessianComputation());
+
+  /* Only part of the output is requested, the whole input is needed */
+  ImageType::RegionType center;
+  center.SetIndex(0, 16);
+  center.SetIndex(1, 16);
+  center.SetIndex(2, 16);
+  center.SetSize(0, 8);
+  center.SetSize(1, 8);
+  center.SetSize(2, 8);
+  recursive->GetOutput()->SetRequestedRegion(center);
+  EXPECT_NO_THROW(recursive->Update());
+  EXPECT_EQ(image->GetLargestPossibleRegion(), image->GetRequestedRegion());
+  EXPECT_TRUE(recursive->GetOutput()->GetBufferedRegion().IsInside(center));
+
+  itk::ImageRegionIteratorWithIndex<HessianImageType> expected(discrete->GetOutput(), center);
+  itk::ImageRegionIteratorWithIndex<HessianImageType> result(recursive->GetOutput(), center);
+  double                                              maximum = 0.0;
+  for (expected.GoToBegin(); !expected.IsAtEnd(); ++expected)
+  {
+    for (unsigned int i = 0; i < HessianImageType::PixelType::Length; ++i)
+    {
+      maximum = std::max(maximum, std::abs(static_cast<double>(expected.Get()[i])));
+    }
+  }
+  ASSERT_GT(maximum, 0.0);
+
+  /* The IIR filters approximate the gaussian */
+  for (expected.GoToBegin(), result.GoToBegin(); !expected.IsAtEnd(); ++expected, ++result)
+  {
+    for (unsigned int i = 0; i < HessianImageType::PixelType::Length; ++i)
+    {
+      ASSERT_NEAR(expected.Get()[i], result.Get()[i], 5e-2 * maximum)
+        << "Component " << i << " differs at " << expected.GetIndex();
+    }
+  }
+}
+
+TEST(itkHessianGaussianImageFilterTest, FourierTransformMatchesDiscreteGaussian)
+{
+  const unsigned int Dimension = 3;
+  using ImageType = itk::Image<short, Dimension>;
+  using HessianGaussianImageFilterType = itk::HessianGaussianImageFilter<ImageType>;
+  using HessianImageType = HessianGaussianImageFilterType::OutputImageType;
+
+  /* An odd size along the first direction exercises the half hermitian spectrum */
+  ImageType::SizeType size;
+  size[0] = 31;
+  size[1] = 28;
+  size[2] = 24;
+  ImageType::SpacingType spacing;
+  spacing[0] = 0.5;
+  spacing[1] = 0.75;
+  spacing[2] = 1.0;
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(ImageType::RegionType(size));
+  image->SetSpacing(spacing);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetLargestPossibleRegion());
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+  {
+    const double x = it.GetIndex()[0] * spacing[0];
+    const double y = it.GetIndex()[1] * spacing[1];
+    const double z = it.GetIndex()[2] * spacing[2];
+    it.Set(static_cast<short>(1000.0 * std::sin(0.4 * x + 0.2 * z) * std::cos(0.3 * y - 0.1 * x)));
+  }
+
+  HessianGaussianImageFilterType::Pointer fourier = HessianGaussianImageFilterType::New();
+  fourier->SetInput(image);
+  fourier->NormalizeAcrossScaleOn();
+  fourier->SetHessianComputation(HessianGaussianImageFilterType::HessianComputationEnum::FourierTransform);
+  EXPECT_FALSE(fourier->GetCacheInputSpectrum());
+  fourier->CacheInputSpectrumOn();
+  EXPECT_TRUE(fourier->GetCacheInputSpectrum());
+  fourier->SetSpectrumPaddingSigma(2.0);
+  EXPECT_EQ(2.0, fourier->GetSpectrumPaddingSigma());
+
+  for (double sigma : { 1.5, 2.0 })
+  {
+    HessianGaussianImageFilterType::Pointer discrete = HessianGaussianImageFilterType::New();
+    discrete->SetInput(image);
+    discrete->SetSigma(sigma);
+    discrete->NormalizeAcrossScaleOn();
+    EXPECT_NO_THROW(discrete->Update());
+
+    /* The second sigma reuses the spectrum of the first */
+    fourier->SetSigma(sigma);
+    EXPECT_NO_THROW(fourier->Update());
+    ASSERT_EQ(discrete->GetOutput()->GetBufferedRegion(), fourier->GetOutput()->GetBufferedRegion());
+
+    ImageType::RegionType center;
+    center.SetIndex(0, 10);
+    center.SetIndex(1, 9);
+    center.SetIndex(2, 8);
+    center.SetSize(0, 11);
+    center.SetSize(1, 10);
+    center.SetSize(2, 8);
+    itk::ImageRegionIteratorWithIndex<HessianImageType> expected(discrete->GetOutput(), center);
+    itk::ImageRegionIteratorWithIndex<HessianImageType> result(fourier->GetOutput(), center);
+    double                                              maximum = 0.0;
+    for (expected.GoToBegin(); !expected.IsAtEnd(); ++expected)
+    {
+      for (unsigned int i = 0; i < HessianImageType::PixelType::Length; ++i)
+      {
+        maximum = std::max(maximum, std::abs(static_cast<double>(expected.Get()[i])));
+      }
+    }
+    ASSERT_GT(maximum, 0.0);
+
+    /* The analytic spectra differ from the sampled kernels by a few percent */
+    for (expected.GoToBegin(), result.GoToBegin(); !expected.IsAtEnd(); ++expected, ++result)
+    {
+      for (unsigned int i = 0; i < HessianImageType::PixelType::Length; ++i)
+      {
+        ASSERT_NEAR(expected.Get()[i], result.Get()[i], 5e-2 * maximum)
+          << "Component " << i << " differs at " << expected.GetIndex() << " with sigma " << sigma;
+      }
+    }
+  }
+
+  /* A cached spectrum gives the same result as a new one */
+  HessianGaussianImageFilterType::Pointer uncached = HessianGaussianImageFilterType::New();
+  uncached->SetInput(image);
+  uncached->SetSigma(2.0);
+  uncached->NormalizeAcrossScaleOn();
+  uncached->SetSpectrumPaddingSigma(2.0);
+  uncached->SetHessianComputation(HessianGaussianImageFilterType::HessianComputationEnum::FourierTransform);
+  EXPECT_NO_THROW(uncached->Update());
+
+  itk::ImageRegionIteratorWithIndex<HessianImageType> expected(uncached->GetOutput(),
+                                                               uncached->GetOutput()->GetBufferedRegion());
+  itk::ImageRegionIteratorWithIndex<HessianImageType> result(fourier->GetOutput(),
+                                                             fourier->GetOutput()->GetBufferedRegion());
+  for (expected.GoToBegin(), result.GoToBegin(); !expected.IsAtEnd(); ++expected, ++result)
+  {
+    for (unsigned int i = 0; i < HessianImageType::PixelType::Length; ++i)
+    {
+      ASSERT_FLOAT_EQ(expected.Get()[i], result.Get()[i]) << "Component " << i << " differs at " << expected.GetIndex();
+    }
+  }
+  fourier->ReleaseInputSpectrum();
+}
+
+TEST(itkHessianGaussianImageFilterTest, UnsharpMaskMatchesKrcahPreprocessing)
+{
+  const unsigned int Dimension = 3;
+  using ImageType = itk::Image<double, Dimension>;
+  using HessianGaussianImageFilterType = itk::HessianGaussianImageFilter<ImageType>;
+  using HessianImageType = HessianGaussianImageFilterType::OutputImageType;
+  using HessianComputationEnum = HessianGaussianImageFilterType::HessianComputationEnum;
+  using PreprocessingFilterType = itk::KrcahPreprocessingImageToImageFilter<ImageType>;
+
+  ImageType::SizeType size;
+  size[0] = 30;
+  size[1] = 28;
+  size[2] = 24;
+  ImageType::SpacingType spacing;
+  spacing[0] = 0.5;
+  spacing[1] = 0.75;
+  spacing[2] = 1.0;
+
+  ImageType::Pointer image = ImageType::New();
+  image->SetRegions(ImageType::RegionType(size));
+  image->SetSpacing(spacing);
+  image->Allocate();
+
+  itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetLargestPossibleRegion());
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+  {
+    const double x = it.GetIndex()[0] * spacing[0];
+    const double y = it.GetIndex()[1] * spacing[1];
+    const double z = it.GetIndex()[2] * spacing[2];
+    it.Set(1000.0 * std::sin(0.6 * x + 0.3 * z) * std::cos(0.5 * y - 0.2 * x));
+  }
+
+  /* The two stage pipeline */
+  PreprocessingFilterType::Pointer preprocessing = PreprocessingFilterType::New();
+  preprocessing->SetInput(image);
+  preprocessing->SetSigma(1.0);
+  preprocessing->SetScalingConstant(10.0);
+
+  HessianGaussianImageFilterType::Pointer twoStages = HessianGaussianImageFilterType::New();
+  twoStages->SetInput(preprocessing->GetOutput());
+  twoStages->SetSigma(1.5);
+  twoStages->NormalizeAcrossScaleOn();
+  twoStages->SetHessianComputation(HessianComputationEnum::SharedSeparablePasses);
+  EXPECT_NO_THROW(twoStages->Update());
+
+  ImageType::RegionType center;
+  center.SetIndex(0, 10);
+  center.SetIndex(1, 9);
+  center.SetIndex(2, 8);
+  center.SetSize(0, 10);
+  center.SetSize(1, 10);
+  center.SetSize(2, 8);
+  itk::ImageRegionIteratorWithIndex<HessianImageType> expected(twoStages->GetOutput(), center);
+  double                                              maximum = 0.0;
+  for (expected.GoToBegin(); !expected.IsAtEnd(); ++expected)
+  {
+    for (unsigned int i = 0; i < HessianImageType::PixelType::Length; ++i)
+    {
+      maximum = std::max(maximum, std::abs(static_cast<double>(expected.Get()[i])));
+    }
+  }
+  ASSERT_GT(maximum, 0.0);
+
+  /* IndependentComponents falls back to the shared passes. The analytic spectra differ from the kernels. */
+  for (HessianComputationEnum computation : { HessianComputationEnum::IndependentComponents,
+                                              HessianComputationEnum::SharedSeparablePasses,
+                                              HessianComputationEnum::FourierTransform })
+  {
+    HessianGaussianImageFilterType::Pointer folded = HessianGaussianImageFilterType::New();
+    EXPECT_EQ(1.0, folded->GetUnsharpMaskSigma());
+    EXPECT_EQ(0.0, folded->GetUnsharpMaskScalingConstant());
+    folded->SetInput(image);
+    folded->SetSigma(1.5);
+    folded->NormalizeAcrossScaleOn();
+    folded->SetUnsharpMaskSigma(1.0);
+    folded->SetUnsharpMaskScalingConstant(10.0);
+    folded->SetHessianComputation(computation);
+    EXPECT_NO_THROW(folded->Update());
+
+    const double tolerance = (computation == HessianComputationEnum::FourierTransform) ? 1e-1 : 2e-2;
+    itk::ImageRegionIteratorWithIndex<HessianImageType> result(folded->GetOutput(), center);
+    for (expected.GoToBegin(), result.GoToBegin(); !expected.IsAtEnd(); ++expected, ++result)
+    {
+      for (unsigned int i = 0; i < HessianImageType::PixelType::Length; ++i)
+      {
+        ASSERT_NEAR(expected.Get()[i], result.Get()[i], tolerance * maximum)
+          << "Component " << i << " differs at " << expected.GetIndex() << " with computation "
+          << static_cast<int>(computation);
+      }
+    }
+  }
 }
@@ -19,8 +19,12 @@
 #include "itkGTest.h"
 #include "itkKrcahEigenToMeasureParameterEstimationFilter.h"
 #include "itkImageMaskSpatialObject.h"
+#include "itkCastImageFilter.h"
+#include "itkPipelineMonitorImageFilter.h"
 #include "itkImage.h"
 #include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionConstIterator.h"
+#include <cmath>
 
 namespace
 {
@@ -276,3 +280,250 @@ TYPED_TEST(itkKrcahEigenToMeasureParameterEstimationFilterUnitTest, TestWithSpat
   EXPECT_DOUBLE_EQ(0.5, this->m_Parameters[1]);
   EXPECT_NEAR(75.0, this->m_Parameters[2], 1e-6); // 0.25 *  300
 }
+
+TYPED_TEST(itkKrcahEigenToMeasureParameterEstimationFilterUnitTest, TestParametersOnlyOutputMode)
+{
+  using OutputModeEnum = typename TestFixture::FilterType::OutputModeEnum;
+  EXPECT_EQ(OutputModeEnum::CopyInput, this->m_Filter->GetOutputMode());
+
+  this->m_Filter->SetInput(this->m_MaskingEigenImage);
+  this->m_Filter->SetMask(this->m_SpatialObject);
+  this->m_Filter->SetOutputMode(OutputModeEnum::ParametersOnly);
+  EXPECT_EQ(OutputModeEnum::ParametersOnly, this->m_Filter->GetOutputMode());
+  EXPECT_NO_THROW(this->m_Filter->Update());
+  EXPECT_EQ(0u, this->m_Filter->GetOutput()->GetBufferedRegion().GetNumberOfPixels());
+
+  this->m_Parameters = this->m_Filter->GetParameters();
+  EXPECT_DOUBLE_EQ(0.70710678118654757, this->m_Parameters[0]);
+  EXPECT_DOUBLE_EQ(0.70710678118654757, this->m_Parameters[1]);
+  EXPECT_NEAR(212.132034356, this->m_Parameters[2], 1e-6); // sqrt(2) * 0.5 *  300
+}
+
+TYPED_TEST(itkKrcahEigenToMeasureParameterEstimationFilterUnitTest, TestPiecesInFlight)
+{
+  using EigenImageType = typename TestFixture::EigenImageType;
+  using CastFilterType = itk::CastImageFilter<EigenImageType, EigenImageType>;
+  using OutputModeEnum = typename TestFixture::FilterType::OutputModeEnum;
+
+  EXPECT_EQ(1u, this->m_Filter->GetNumberOfPiecesInFlight());
+  this->m_Filter->SetNumberOfPiecesInFlight(0);
+  EXPECT_EQ(1u, this->m_Filter->GetNumberOfPiecesInFlight());
+
+  /* Stream through a filter so every piece has its own upstream buffer */
+  typename CastFilterType::Pointer upstream = CastFilterType::New();
+  upstream->SetInput(this->m_MaskingEigenImage);
+  upstream->InPlaceOff();
+
+  for (unsigned int piecesInFlight : { 2u, 3u, 10u })
+  {
+    for (OutputModeEnum outputMode : { OutputModeEnum::CopyInput, OutputModeEnum::ParametersOnly })
+    {
+      this->m_Filter->SetInput(upstream->GetOutput());
+      this->m_Filter->SetMask(this->m_SpatialObject);
+      this->m_Filter->SetNumberOfPiecesInFlight(piecesInFlight);
+      this->m_Filter->SetOutputMode(outputMode);
+      EXPECT_EQ(piecesInFlight, this->m_Filter->GetNumberOfPiecesInFlight());
+      EXPECT_NO_THROW(this->m_Filter->Update());
+
+      this->m_Parameters = this->m_Filter->GetParameters();
+      EXPECT_DOUBLE_EQ(0.70710678118654757, this->m_Parameters[0]);
+      EXPECT_DOUBLE_EQ(0.70710678118654757, this->m_Parameters[1]);
+      EXPECT_NEAR(212.132034356, this->m_Parameters[2], 1e-6); // sqrt(2) * 0.5 *  300
+
+      if (outputMode == OutputModeEnum::CopyInput)
+      {
+        ASSERT_EQ(this->m_Region, this->m_Filter->GetOutput()->GetBufferedRegion());
+        itk::ImageRegionConstIterator<EigenImageType> expectedIt(this->m_MaskingEigenImage, this->m_Region);
+        itk::ImageRegionConstIterator<EigenImageType> outputIt(this->m_Filter->GetOutput(), this->m_Region);
+        for (; !expectedIt.IsAtEnd(); ++expectedIt, ++outputIt)
+        {
+          ASSERT_EQ(expectedIt.Get(), outputIt.Get());
+        }
+      }
+    }
+  }
+}
+
+TYPED_TEST(itkKrcahEigenToMeasureParameterEstimationFilterUnitTest, TestPiecesInFlightOnPlatformThreader)
+{
+  using EigenImageType = typename TestFixture::EigenImageType;
+  using CastFilterType = itk::CastImageFilter<EigenImageType, EigenImageType>;
+  using ThreaderType = itk::MultiThreaderBase::ThreaderType;
+
+  /* The platform threader runs one parallel section at a time, which concurrent reductions must not share */
+  const ThreaderType previousThreader = itk::MultiThreaderBase::GetGlobalDefaultThreader();
+  itk::MultiThreaderBase::SetGlobalDefaultThreader(ThreaderType::Platform);
+
+  typename CastFilterType::Pointer upstream = CastFilterType::New();
+  upstream->SetInput(this->m_MaskingEigenImage);
+  upstream->InPlaceOff();
+
+  for (unsigned int piecesInFlight : { 2u, 4u })
+  {
+    typename TestFixture::FilterType::Pointer filter = TestFixture::FilterType::New();
+    filter->SetInput(upstream->GetOutput());
+    filter->SetMask(this->m_SpatialObject);
+    filter->GetMultiThreader()->SetNumberOfWorkUnits(4);
+    filter->SetNumberOfPiecesInFlight(piecesInFlight);
+    EXPECT_NO_THROW(filter->Update());
+
+    this->m_Parameters = filter->GetParameters();
+    EXPECT_DOUBLE_EQ(0.70710678118654757, this->m_Parameters[0]);
+    EXPECT_DOUBLE_EQ(0.70710678118654757, this->m_Parameters[1]);
+    EXPECT_NEAR(212.132034356, this->m_Parameters[2], 1e-6); // sqrt(2) * 0.5 *  300
+  }
+
+  itk::MultiThreaderBase::SetGlobalDefaultThreader(previousThreader);
+}
+
+TYPED_TEST(itkKrcahEigenToMeasureParameterEstimationFilterUnitTest, TestGraftInputOutputMode)
+{
+  using OutputModeEnum = typename TestFixture::FilterType::OutputModeEnum;
+
+  this->m_Filter->SetInput(this->m_MaskingEigenImage);
+  this->m_Filter->SetMask(this->m_SpatialObject);
+  this->m_Filter->SetOutputMode(OutputModeEnum::GraftInput);
+  EXPECT_EQ(OutputModeEnum::GraftInput, this->m_Filter->GetOutputMode());
+  EXPECT_NO_THROW(this->m_Filter->Update());
+  EXPECT_EQ(this->m_Region, this->m_Filter->GetOutput()->GetBufferedRegion());
+  EXPECT_EQ(this->m_MaskingEigenImage->GetBufferPointer(), this->m_Filter->GetOutput()->GetBufferPointer());
+
+  this->m_Parameters = this->m_Filter->GetParameters();
+  EXPECT_DOUBLE_EQ(0.70710678118654757, this->m_Parameters[0]);
+  EXPECT_DOUBLE_EQ(0.70710678118654757, this->m_Parameters[1]);
+  EXPECT_NEAR(212.132034356, this->m_Parameters[2], 1e-6); // sqrt(2) * 0.5 *  300
+}
+
+TYPED_TEST(itkKrcahEigenToMeasureParameterEstimationFilterUnitTest, TestWithMaskRuns)
+{
+  using MaskRunsType = typename TestFixture::FilterType::MaskRunsType;
+
+  typename MaskRunsType::Pointer maskRuns = MaskRunsType::New();
+  maskRuns->Rasterize(this->m_SpatialObject, this->m_MaskingEigenImage, this->m_Region);
+
+  this->m_Filter->SetInput(this->m_MaskingEigenImage);
+  this->m_Filter->SetMaskRuns(maskRuns);
+  EXPECT_NO_THROW(this->m_Filter->Update());
+
+  this->m_Parameters = this->m_Filter->GetParameters();
+  EXPECT_DOUBLE_EQ(0.70710678118654757, this->m_Parameters[0]);
+  EXPECT_DOUBLE_EQ(0.70710678118654757, this->m_Parameters[1]);
+  EXPECT_NEAR(212.132034356, this->m_Parameters[2], 1e-6); // sqrt(2) * 0.5 *  300
+}
+
+TYPED_TEST(itkKrcahEigenToMeasureParameterEstimationFilterUnitTest, TestReproducibleAcrossThreads)
+{
+  using EigenImageType = typename TestFixture::EigenImageType;
+  using EigenValueArrayType = typename TestFixture::EigenValueArrayType;
+  using CastFilterType = itk::CastImageFilter<EigenImageType, EigenImageType>;
+
+  /* Values whose sum rounds differently in every order */
+  typename EigenImageType::Pointer image = EigenImageType::New();
+  image->SetRegions(this->m_Region);
+  image->Allocate();
+  itk::ImageRegionIteratorWithIndex<EigenImageType> it(image, this->m_Region);
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+  {
+    const typename EigenImageType::IndexType index = it.GetIndex();
+    EigenValueArrayType                      pixel;
+    for (unsigned int i = 0; i < pixel.Length; ++i)
+    {
+      pixel[i] = static_cast<TypeParam>(1000.0 * std::sin(0.37 * index[0] + 1.3 * index[1] + 0.71 * index[2] + i));
+    }
+    it.Set(pixel);
+  }
+
+  typename CastFilterType::Pointer upstream = CastFilterType::New();
+  upstream->SetInput(image);
+  upstream->InPlaceOff();
+
+  this->m_Filter->SetInput(image);
+  this->m_Filter->GetMultiThreader()->SetNumberOfWorkUnits(1);
+  this->m_Filter->SetNumberOfStreamDivisions(1);
+  EXPECT_NO_THROW(this->m_Filter->Update());
+  const double gamma = this->m_Filter->GetParameters()[2];
+  EXPECT_GT(gamma, 0.0);
+
+  for (unsigned int workUnits : { 3u, 7u, 16u })
+  {
+    for (unsigned int divisions : { 1u, 3u, 10u })
+    {
+      for (unsigned int piecesInFlight : { 1u, 3u })
+      {
+        typename TestFixture::FilterType::Pointer filter = TestFixture::FilterType::New();
+        filter->SetInput(upstream->GetOutput());
+        filter->GetMultiThreader()->SetNumberOfWorkUnits(workUnits);
+        filter->SetNumberOfStreamDivisions(divisions);
+        filter->SetNumberOfPiecesInFlight(piecesInFlight);
+        EXPECT_NO_THROW(filter->Update());
+        ASSERT_EQ(gamma, filter->GetParameters()[2])
+          << "With " << workUnits << " work units, " << divisions << " divisions and " << piecesInFlight
+          << " pieces in flight";
+      }
+    }
+  }
+}
+
+TYPED_TEST(itkKrcahEigenToMeasureParameterEstimationFilterUnitTest, TestSamplingStride)
+{
+  using EigenImageType = typename TestFixture::EigenImageType;
+  using EigenValueArrayType = typename TestFixture::EigenValueArrayType;
+  using CastFilterType = itk::CastImageFilter<EigenImageType, EigenImageType>;
+  using OutputModeEnum = typename TestFixture::FilterType::OutputModeEnum;
+
+  typename EigenImageType::Pointer image = EigenImageType::New();
+  image->SetRegions(this->m_Region);
+  image->Allocate();
+  itk::ImageRegionIteratorWithIndex<EigenImageType> it(image, this->m_Region);
+  double                                            sampledTrace = 0.0;
+  double                                            sampledCount = 0.0;
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+  {
+    const typename EigenImageType::IndexType index = it.GetIndex();
+    EigenValueArrayType                      pixel;
+    double                                   trace = 0.0;
+    for (unsigned int i = 0; i < pixel.Length; ++i)
+    {
+      pixel[i] = static_cast<TypeParam>(10.0 * index[1] + index[2] + i);
+      trace += std::abs(static_cast<double>(pixel[i]));
+    }
+    it.Set(pixel);
+    if (index[1] % 3 == 0 && index[2] % 3 == 0)
+    {
+      sampledTrace += trace;
+      sampledCount += 1.0;
+    }
+  }
+
+  typename CastFilterType::Pointer upstream = CastFilterType::New();
+  upstream->SetInput(image);
+  upstream->InPlaceOff();
+
+  EXPECT_EQ(1u, this->m_Filter->GetSamplingStride());
+  this->m_Filter->SetSamplingStride(0);
+  EXPECT_EQ(1u, this->m_Filter->GetSamplingStride());
+  this->m_Filter->SetSamplingStride(3);
+  EXPECT_EQ(3u, this->m_Filter->GetSamplingStride());
+  this->m_Filter->SetInput(upstream->GetOutput());
+  EXPECT_NO_THROW(this->m_Filter->Update());
+  const double gamma = this->m_Filter->GetParameters()[2];
+  EXPECT_NEAR(0.70710678118654757 * sampledTrace / sampledCount, gamma, 1e-6 * gamma);
+
+  /* Without an output the same scanlines are reduced, from slabs which request every pixel once */
+  using MonitorFilterType = itk::PipelineMonitorImageFilter<EigenImageType>;
+  typename MonitorFilterType::Pointer monitor = MonitorFilterType::New();
+  monitor->SetInput(upstream->GetOutput());
+  this->m_Filter->SetInput(monitor->GetOutput());
+  this->m_Filter->SetOutputMode(OutputModeEnum::ParametersOnly);
+  this->m_Filter->SetNumberOfStreamDivisions(2);
+  EXPECT_NO_THROW(this->m_Filter->Update());
+  EXPECT_EQ(gamma, this->m_Filter->GetParameters()[2]);
+
+  itk::SizeValueType requestedPixels = 0;
+  for (const auto & region : monitor->GetOutputRequestedRegions())
+  {
+    requestedPixels += region.GetNumberOfPixels();
+  }
+  EXPECT_EQ(2u, monitor->GetOutputRequestedRegions().size());
+  EXPECT_EQ(this->m_Region.GetNumberOfPixels(), requestedPixels);
+}
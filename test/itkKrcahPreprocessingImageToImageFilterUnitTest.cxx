@@ -0,0 +1,181 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkGTest.h"
+#include "itkKrcahPreprocessingImageToImageFilter.h"
+#include "itkAddImageFilter.h"
+#include "itkDiscreteGaussianImageFilter.h"
+#include "itkImage.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMultiplyImageFilter.h"
+#include "itkStreamingImageFilter.h"
+#include "itkSubtractImageFilter.h"
+#include "itkTestingMacros.h"
+#include <cmath>
+
+namespace
+{
+class itkKrcahPreprocessingImageToImageFilterUnitTest : public ::testing::Test
+{
+public:
+  /* Useful typedefs */
+  static const unsigned int DIMENSION = 3;
+  using InputImageType = itk::Image<short, DIMENSION>;
+  using RealImageType = itk::Image<double, DIMENSION>;
+  using FilterType = itk::KrcahPreprocessingImageToImageFilter<InputImageType, RealImageType>;
+
+  itkKrcahPreprocessingImageToImageFilterUnitTest()
+  {
+    InputImageType::SizeType size;
+    size[0] = 21;
+    size[1] = 16;
+    size[2] = 13;
+
+    InputImageType::SpacingType spacing;
+    spacing[0] = 0.5;
+    spacing[1] = 0.8;
+    spacing[2] = 1.25;
+
+    m_Image = InputImageType::New();
+    m_Image->SetRegions(size);
+    m_Image->SetSpacing(spacing);
+    m_Image->Allocate();
+
+    /* A bright sphere on a ramp, in the range of CT intensities */
+    itk::ImageRegionIteratorWithIndex<InputImageType> it(m_Image, m_Image->GetLargestPossibleRegion());
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+      const InputImageType::IndexType index = it.GetIndex();
+      const double                    x = (index[0] - 10.0) * spacing[0];
+      const double                    y = (index[1] - 7.0) * spacing[1];
+      const double                    z = (index[2] - 6.0) * spacing[2];
+      const bool                      inside = (x * x + y * y + z * z < 12.0);
+      it.Set(static_cast<short>((inside ? 1200 : -800) + 7 * index[0] - 5 * index[2]));
+    }
+  }
+  ~itkKrcahPreprocessingImageToImageFilterUnitTest() override = default;
+
+protected:
+  void
+  SetUp() override
+  {}
+  void
+  TearDown() override
+  {}
+
+  static void
+  ExpectImagesNear(const RealImageType * expected, const RealImageType * actual, double tolerance)
+  {
+    ASSERT_EQ(expected->GetBufferedRegion(), actual->GetBufferedRegion());
+    itk::ImageRegionConstIterator<RealImageType> expectedIt(expected, expected->GetBufferedRegion());
+    itk::ImageRegionConstIterator<RealImageType> actualIt(actual, actual->GetBufferedRegion());
+    for (; !expectedIt.IsAtEnd(); ++expectedIt, ++actualIt)
+    {
+      ASSERT_NEAR(expectedIt.Get(), actualIt.Get(), tolerance);
+    }
+  }
+
+  InputImageType::Pointer m_Image;
+};
+} // namespace
+
+TEST_F(itkKrcahPreprocessingImageToImageFilterUnitTest, ExerciseBasicMethods)
+{
+  FilterType::Pointer filter = FilterType::New();
+
+  // if not wrapped in a lambda, produces error C2562: 'void' function returning a value
+  int basicMethods = [=]() -> int {
+    ITK_EXERCISE_BASIC_OBJECT_METHODS(filter, KrcahPreprocessingImageToImageFilter, ImageToImageFilter);
+    return EXIT_SUCCESS;
+  }();
+  ASSERT_EQ(basicMethods, EXIT_SUCCESS);
+
+  EXPECT_EQ(1.0, filter->GetSigma());
+  EXPECT_EQ(10.0, filter->GetScalingConstant());
+  EXPECT_EQ(0.01, filter->GetMaximumError());
+  EXPECT_EQ(32u, filter->GetMaximumKernelWidth());
+  EXPECT_TRUE(filter->GetUseImageSpacing());
+  EXPECT_TRUE(filter->GetReleaseInternalFilterData());
+}
+
+TEST_F(itkKrcahPreprocessingImageToImageFilterUnitTest, MatchesFilterChain)
+{
+  /* J = I + k(I - I*G), computed by the filters the fused implementation replaces */
+  using CastGaussianType = itk::DiscreteGaussianImageFilter<InputImageType, RealImageType>;
+  using SubtractType = itk::SubtractImageFilter<InputImageType, RealImageType, RealImageType>;
+  using MultiplyType = itk::MultiplyImageFilter<RealImageType, RealImageType, RealImageType>;
+  using AddType = itk::AddImageFilter<InputImageType, RealImageType, RealImageType>;
+
+  for (double sigma : { 0.6, 1.0, 2.5 })
+  {
+    CastGaussianType::Pointer gaussian = CastGaussianType::New();
+    gaussian->SetInput(m_Image);
+    gaussian->SetVariance(sigma * sigma);
+    SubtractType::Pointer subtract = SubtractType::New();
+    subtract->SetInput1(m_Image);
+    subtract->SetInput2(gaussian->GetOutput());
+    MultiplyType::Pointer multiply = MultiplyType::New();
+    multiply->SetInput(subtract->GetOutput());
+    multiply->SetConstant(7.0);
+    AddType::Pointer add = AddType::New();
+    add->SetInput1(m_Image);
+    add->SetInput2(multiply->GetOutput());
+    ASSERT_NO_THROW(add->Update());
+
+    FilterType::Pointer filter = FilterType::New();
+    filter->SetInput(m_Image);
+    filter->SetSigma(sigma);
+    filter->SetScalingConstant(7.0);
+    ASSERT_NO_THROW(filter->Update());
+
+    /* The smoothed image is stored in single precision, about 1e-7 of the 2000 range times k */
+    ExpectImagesNear(add->GetOutput(), filter->GetOutput(), 1e-2);
+  }
+}
+
+TEST_F(itkKrcahPreprocessingImageToImageFilterUnitTest, StreamedMatchesWholeImage)
+{
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput(m_Image);
+  ASSERT_NO_THROW(filter->Update());
+
+  FilterType::Pointer streamedFilter = FilterType::New();
+  streamedFilter->SetInput(m_Image);
+
+  using StreamerType = itk::StreamingImageFilter<RealImageType, RealImageType>;
+  StreamerType::Pointer streamer = StreamerType::New();
+  streamer->SetInput(streamedFilter->GetOutput());
+  streamer->SetNumberOfStreamDivisions(5);
+  ASSERT_NO_THROW(streamer->Update());
+
+  ExpectImagesNear(filter->GetOutput(), streamer->GetOutput(), 1e-6);
+
+  /* Only the requested region is computed */
+  RealImageType::RegionType region = m_Image->GetLargestPossibleRegion();
+  region.SetIndex(2, 4);
+  region.SetSize(2, 3);
+  streamedFilter->GetOutput()->SetRequestedRegion(region);
+  ASSERT_NO_THROW(streamedFilter->Update());
+  EXPECT_EQ(region, streamedFilter->GetOutput()->GetBufferedRegion());
+  itk::ImageRegionConstIterator<RealImageType> it(streamedFilter->GetOutput(), region);
+  for (; !it.IsAtEnd(); ++it)
+  {
+    ASSERT_NEAR(filter->GetOutput()->GetPixel(it.GetIndex()), it.Get(), 1e-6);
+  }
+}
@@ -0,0 +1,189 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkGTest.h"
+#include "itkMultiScaleHessianEnhancementBatchProcessor.h"
+#include "itkMultiScaleHessianEnhancementImageFilter.h"
+#include "itkKrcahEigenToMeasureImageFilter.h"
+#include "itkKrcahEigenToMeasureParameterEstimationFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+class itkMultiScaleHessianEnhancementBatchProcessorUnitTest : public ::testing::Test
+{
+public:
+  /* Useful typedefs */
+  static const unsigned int DIMENSION = 3;
+  using ImageType = itk::Image<float, DIMENSION>;
+  using FilterType = itk::MultiScaleHessianEnhancementImageFilter<ImageType, ImageType>;
+  using EigenValueImageType = FilterType::EigenValueImageType;
+  using MeasureFilterType = itk::KrcahEigenToMeasureImageFilter<EigenValueImageType, ImageType>;
+  using EstimationFilterType = itk::KrcahEigenToMeasureParameterEstimationFilter<EigenValueImageType>;
+  using BatchProcessorType = itk::MultiScaleHessianEnhancementBatchProcessor<FilterType>;
+
+  itkMultiScaleHessianEnhancementBatchProcessorUnitTest()
+  {
+    /* Volumes of different sizes and contents */
+    const unsigned int sizes[3][DIMENSION] = { { 23, 17, 11 }, { 15, 19, 9 }, { 23, 17, 11 } };
+    for (unsigned int volume = 0; volume < 3; ++volume)
+    {
+      ImageType::SizeType size;
+      for (unsigned int d = 0; d < DIMENSION; ++d)
+      {
+        size[d] = sizes[volume][d];
+      }
+
+      ImageType::Pointer image = ImageType::New();
+      image->SetRegions(size);
+      image->Allocate();
+
+      /* A bright oblique plate on a smooth background */
+      itk::ImageRegionIteratorWithIndex<ImageType> it(image, image->GetLargestPossibleRegion());
+      for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+      {
+        const ImageType::IndexType index = it.GetIndex();
+        const double               distance = 0.5 * index[0] + 0.3 * index[1] - index[2] - 1.0 - volume;
+        it.Set(static_cast<float>((1000.0 + 100.0 * volume) * std::exp(-distance * distance / 4.0) + 10.0 * index[0]));
+      }
+      m_Images.push_back(image);
+    }
+
+    m_SigmaArray = FilterType::GenerateEquispacedSigmaArray(0.75, 1.5, 2);
+  }
+  ~itkMultiScaleHessianEnhancementBatchProcessorUnitTest() override = default;
+
+protected:
+  void
+  SetUp() override
+  {}
+  void
+  TearDown() override
+  {}
+
+  FilterType::Pointer
+  CreateFilter() const
+  {
+    FilterType::Pointer filter = FilterType::New();
+    filter->SetSigmaArray(m_SigmaArray);
+    filter->SetEigenToMeasureImageFilter(MeasureFilterType::New());
+    filter->SetEigenToMeasureParameterEstimationFilter(EstimationFilterType::New());
+    return filter;
+  }
+
+  std::vector<ImageType::Pointer> m_Images;
+  FilterType::SigmaArrayType      m_SigmaArray;
+};
+} // namespace
+
+TEST_F(itkMultiScaleHessianEnhancementBatchProcessorUnitTest, MatchesSeparateFilters)
+{
+  /* Every volume through a filter of its own */
+  std::vector<ImageType::Pointer> expected;
+  for (const ImageType::Pointer & image : m_Images)
+  {
+    FilterType::Pointer filter = this->CreateFilter();
+    filter->SetInput(image);
+    EXPECT_NO_THROW(filter->Update());
+    expected.push_back(filter->GetOutput());
+  }
+
+  BatchProcessorType::Pointer processor = BatchProcessorType::New();
+  EXPECT_TRUE(processor->GetOverlapInputOutput());
+  processor->SetEnhancementFilter(this->CreateFilter());
+
+  for (bool overlapInputOutput : { false, true })
+  {
+    processor->SetOverlapInputOutput(overlapInputOutput);
+
+    std::vector<itk::SizeValueType> readOrder;
+    std::vector<itk::SizeValueType> writeOrder;
+    std::vector<ImageType::Pointer> written;
+    EXPECT_NO_THROW(processor->Process(
+      m_Images.size(),
+      [this, &readOrder](itk::SizeValueType volume) {
+        readOrder.push_back(volume);
+        return m_Images[volume];
+      },
+      [&writeOrder, &written](itk::SizeValueType volume, ImageType * output) {
+        writeOrder.push_back(volume);
+        written.push_back(output);
+      }));
+    EXPECT_EQ(m_Images.size(), processor->GetNumberOfProcessedVolumes());
+    EXPECT_EQ(std::vector<itk::SizeValueType>({ 0, 1, 2 }), readOrder);
+    EXPECT_EQ(std::vector<itk::SizeValueType>({ 0, 1, 2 }), writeOrder);
+
+    /* Every result is its own image, and the same as with a filter of its own */
+    ASSERT_EQ(m_Images.size(), written.size());
+    for (unsigned int volume = 0; volume < written.size(); ++volume)
+    {
+      for (unsigned int other = 0; other < volume; ++other)
+      {
+        EXPECT_NE(written[other].GetPointer(), written[volume].GetPointer());
+      }
+
+      ASSERT_EQ(expected[volume]->GetBufferedRegion(), written[volume]->GetBufferedRegion());
+      itk::ImageRegionConstIterator<ImageType> expectedIt(expected[volume], expected[volume]->GetBufferedRegion());
+      itk::ImageRegionConstIterator<ImageType> writtenIt(written[volume], written[volume]->GetBufferedRegion());
+      for (; !expectedIt.IsAtEnd(); ++expectedIt, ++writtenIt)
+      {
+        ASSERT_FLOAT_EQ(expectedIt.Get(), writtenIt.Get()) << "volume " << volume;
+      }
+    }
+  }
+}
+
+TEST_F(itkMultiScaleHessianEnhancementBatchProcessorUnitTest, Errors)
+{
+  const BatchProcessorType::ReaderType reader = [this](itk::SizeValueType volume) { return m_Images[volume]; };
+  const BatchProcessorType::WriterType writer = [](itk::SizeValueType, ImageType *) {};
+
+  BatchProcessorType::Pointer processor = BatchProcessorType::New();
+  EXPECT_ANY_THROW(processor->Process(1, reader, writer));
+
+  processor->SetEnhancementFilter(this->CreateFilter());
+  EXPECT_ANY_THROW(processor->Process(1, nullptr, writer));
+  EXPECT_ANY_THROW(processor->Process(1, reader, nullptr));
+  EXPECT_NO_THROW(processor->Process(0, reader, writer));
+  EXPECT_EQ(0u, processor->GetNumberOfProcessedVolumes());
+
+  for (bool overlapInputOutput : { false, true })
+  {
+    processor->SetOverlapInputOutput(overlapInputOutput);
+
+    /* A missing volume stops the batch */
+    EXPECT_ANY_THROW(processor->Process(
+      2, [](itk::SizeValueType) { return ImageType::Pointer(); }, writer));
+
+    /* So does a failing writer, after the volumes before it were written */
+    EXPECT_THROW(processor->Process(3,
+                                    reader,
+                                    [](itk::SizeValueType volume, ImageType *) {
+                                      if (volume == 1)
+                                      {
+                                        throw std::runtime_error("cannot write");
+                                      }
+                                    }),
+                 std::runtime_error);
+    EXPECT_EQ(1u, processor->GetNumberOfProcessedVolumes());
+  }
+}
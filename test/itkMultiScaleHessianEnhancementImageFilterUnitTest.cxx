@@ -0,0 +1,1305 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkGTest.h"
+#include "itkMultiScaleHessianEnhancementImageFilter.h"
+#include "itkKrcahEigenToMeasureImageFilter.h"
+#include "itkKrcahEigenToMeasureParameterEstimationFilter.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageMaskSpatialObject.h"
+#include "itkStreamingImageFilter.h"
+#include "itkCastImageFilter.h"
+#include "itkPipelineMonitorImageFilter.h"
+#include "itkHalfFloat.h"
+#include "itkObjectFactoryBase.h"
+#include "itkVersion.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+class itkMultiScaleHessianEnhancementImageFilterUnitTest : public ::testing::Test
+{
+public:
+  /* Useful typedefs */
+  static const unsigned int DIMENSION = 3;
+  using ImageType = itk::Image<float, DIMENSION>;
+  using FilterType = itk::MultiScaleHessianEnhancementImageFilter<ImageType, ImageType>;
+  using EigenValueImageType = FilterType::EigenValueImageType;
+  using MeasureFilterType = itk::KrcahEigenToMeasureImageFilter<EigenValueImageType, ImageType>;
+  using EstimationFilterType = itk::KrcahEigenToMeasureParameterEstimationFilter<EigenValueImageType>;
+
+  itkMultiScaleHessianEnhancementImageFilterUnitTest()
+  {
+    /* An uneven image so tiles do not divide it */
+    ImageType::SizeType size;
+    size[0] = 23;
+    size[1] = 17;
+    size[2] = 11;
+
+    ImageType::SpacingType spacing;
+    spacing[0] = 0.5;
+    spacing[1] = 0.75;
+    spacing[2] = 1.0;
+
+    m_Image = ImageType::New();
+    m_Image->SetRegions(size);
+    m_Image->SetSpacing(spacing);
+    m_Image->Allocate();
+
+    /* A bright oblique plate on a smooth background */
+    itk::ImageRegionIteratorWithIndex<ImageType> it(m_Image, m_Image->GetLargestPossibleRegion());
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+      const ImageType::IndexType index = it.GetIndex();
+      const double               distance = 0.5 * index[0] + 0.3 * index[1] - index[2] - 1.0;
+      it.Set(static_cast<float>(1000.0 * std::exp(-distance * distance / 4.0) + 10.0 * index[0]));
+    }
+
+    m_SigmaArray = FilterType::GenerateEquispacedSigmaArray(0.75, 1.5, 2);
+  }
+  ~itkMultiScaleHessianEnhancementImageFilterUnitTest() override = default;
+
+protected:
+  void
+  SetUp() override
+  {}
+  void
+  TearDown() override
+  {}
+
+  FilterType::Pointer
+  CreateFilter() const
+  {
+    FilterType::Pointer filter = FilterType::New();
+    filter->SetInput(m_Image);
+    filter->SetSigmaArray(m_SigmaArray);
+    filter->SetEigenToMeasureImageFilter(MeasureFilterType::New());
+    filter->SetEigenToMeasureParameterEstimationFilter(EstimationFilterType::New());
+    return filter;
+  }
+
+  static void
+  ExpectImagesNear(const ImageType * expected, const ImageType * actual)
+  {
+    ASSERT_EQ(expected->GetBufferedRegion(), actual->GetBufferedRegion());
+    itk::ImageRegionConstIterator<ImageType> expectedIt(expected, expected->GetBufferedRegion());
+    itk::ImageRegionConstIterator<ImageType> actualIt(actual, actual->GetBufferedRegion());
+    for (; !expectedIt.IsAtEnd(); ++expectedIt, ++actualIt)
+    {
+      ASSERT_NEAR(expectedIt.Get(), actualIt.Get(), 1e-4 * (1.0 + std::abs(expectedIt.Get())));
+    }
+  }
+
+  ImageType::Pointer         m_Image;
+  FilterType::SigmaArrayType m_SigmaArray;
+};
+
+/* Stands in for a device implementation of the eigenanalysis and counts its runs */
+class OverriddenEigenAnalysisFilter
+  : public itkMultiScaleHessianEnhancementImageFilterUnitTest::FilterType::EigenAnalysisFilterType
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(OverriddenEigenAnalysisFilter);
+
+  using Self = OverriddenEigenAnalysisFilter;
+  using Superclass = itkMultiScaleHessianEnhancementImageFilterUnitTest::FilterType::EigenAnalysisFilterType;
+  using Pointer = itk::SmartPointer<Self>;
+  using ConstPointer = itk::SmartPointer<const Self>;
+
+  itkNewMacro(Self);
+  itkTypeMacro(OverriddenEigenAnalysisFilter, AnalyticSymmetricEigenValueImageFilter);
+
+  static unsigned int NumberOfRuns;
+
+protected:
+  OverriddenEigenAnalysisFilter() = default;
+
+  void
+  BeforeThreadedGenerateData() override
+  {
+    ++NumberOfRuns;
+    Superclass::BeforeThreadedGenerateData();
+  }
+};
+unsigned int OverriddenEigenAnalysisFilter::NumberOfRuns = 0;
+
+class EigenAnalysisOverrideFactory : public itk::ObjectFactoryBase
+{
+public:
+  ITK_DISALLOW_COPY_AND_ASSIGN(EigenAnalysisOverrideFactory);
+
+  using Self = EigenAnalysisOverrideFactory;
+  using Superclass = itk::ObjectFactoryBase;
+  using Pointer = itk::SmartPointer<Self>;
+  using ConstPointer = itk::SmartPointer<const Self>;
+
+  itkFactorylessNewMacro(Self);
+  itkTypeMacro(EigenAnalysisOverrideFactory, ObjectFactoryBase);
+
+  const char *
+  GetITKSourceVersion() const override
+  {
+    return ITK_SOURCE_VERSION;
+  }
+
+  const char *
+  GetDescription() const override
+  {
+    return "Overrides the eigenanalysis of the multiscale filter";
+  }
+
+protected:
+  EigenAnalysisOverrideFactory()
+  {
+    this->RegisterOverride(typeid(OverriddenEigenAnalysisFilter::Superclass).name(),
+                           typeid(OverriddenEigenAnalysisFilter).name(),
+                           "Overridden eigenanalysis",
+                           true,
+                           itk::CreateObjectFunction<OverriddenEigenAnalysisFilter>::New());
+  }
+};
+} // namespace
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, TiledExecutionSettings)
+{
+  FilterType::Pointer filter = FilterType::New();
+  EXPECT_FALSE(filter->GetUseTiledExecution());
+  filter->UseTiledExecutionOn();
+  EXPECT_TRUE(filter->GetUseTiledExecution());
+
+  FilterType::TileSizeType tileSize;
+  tileSize.Fill(64);
+  EXPECT_EQ(tileSize, filter->GetTileSize());
+  tileSize[0] = 8;
+  filter->SetTileSize(tileSize);
+  EXPECT_EQ(tileSize, filter->GetTileSize());
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, TiledExecutionMatchesStagedExecution)
+{
+  FilterType::Pointer staged = this->CreateFilter();
+  EXPECT_NO_THROW(staged->Update());
+
+  FilterType::Pointer tiled = this->CreateFilter();
+  tiled->UseTiledExecutionOn();
+  FilterType::TileSizeType tileSize;
+  tileSize[0] = 8;
+  tileSize[1] = 5;
+  tileSize[2] = 4;
+  tiled->SetTileSize(tileSize);
+  tiled->CollectProfileOn();
+  EXPECT_NO_THROW(tiled->Update());
+
+  ExpectImagesNear(staged->GetOutput(), tiled->GetOutput());
+
+  /* The pre-pass runs once for every scale, not once for every tile */
+  unsigned int estimations = 0;
+  for (const FilterType::StageProfileType & record : tiled->GetProfile())
+  {
+    estimations += (record.Stage == "ParameterEstimation") ? 1 : 0;
+  }
+  EXPECT_EQ(m_SigmaArray.GetSize(), estimations);
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, TileMajorOrder)
+{
+  using ScaleImageType = FilterType::ScaleImageType;
+  using HessianBackendEnum = FilterType::HessianBackendEnum;
+
+  const FilterType::SigmaArrayType sigmaArray = FilterType::GenerateLogarithmicSigmaArray(0.75, 1.5, 3);
+  FilterType::TileSizeType         tileSize;
+  tileSize[0] = 8;
+  tileSize[1] = 5;
+  tileSize[2] = 4;
+
+  for (bool useIncrementalScaleSpace : { false, true })
+  {
+    FilterType::Pointer scaleMajor = this->CreateFilter();
+    scaleMajor->SetSigmaArray(sigmaArray);
+    scaleMajor->UseTiledExecutionOn();
+    scaleMajor->SetTileSize(tileSize);
+    scaleMajor->SetUseIncrementalScaleSpace(useIncrementalScaleSpace);
+    scaleMajor->GenerateScaleOutputOn();
+    EXPECT_NO_THROW(scaleMajor->Update());
+
+    FilterType::Pointer tileMajor = this->CreateFilter();
+    EXPECT_FALSE(tileMajor->GetUseTileMajorOrder());
+    tileMajor->UseTileMajorOrderOn();
+    EXPECT_TRUE(tileMajor->GetUseTileMajorOrder());
+    tileMajor->SetSigmaArray(sigmaArray);
+    tileMajor->UseTiledExecutionOn();
+    tileMajor->SetTileSize(tileSize);
+    tileMajor->SetUseIncrementalScaleSpace(useIncrementalScaleSpace);
+    tileMajor->GenerateScaleOutputOn();
+    EXPECT_NO_THROW(tileMajor->Update());
+    ExpectImagesNear(scaleMajor->GetOutput(), tileMajor->GetOutput());
+
+    /* Without a scale-space every tile runs the same kernels in both orders */
+    if (!useIncrementalScaleSpace)
+    {
+      itk::ImageRegionConstIterator<ScaleImageType> scaleMajorIt(scaleMajor->GetScaleOutput(),
+                                                                 scaleMajor->GetScaleOutput()->GetBufferedRegion());
+      itk::ImageRegionConstIterator<ScaleImageType> tileMajorIt(tileMajor->GetScaleOutput(),
+                                                                tileMajor->GetScaleOutput()->GetBufferedRegion());
+      for (; !scaleMajorIt.IsAtEnd(); ++scaleMajorIt, ++tileMajorIt)
+      {
+        ASSERT_EQ(scaleMajorIt.Get(), tileMajorIt.Get()) << scaleMajorIt.GetIndex();
+      }
+    }
+  }
+
+  /* The spectrum of each tile is shared by every scale */
+  FilterType::Pointer scaleMajor = this->CreateFilter();
+  scaleMajor->SetHessianBackend(HessianBackendEnum::FourierTransform);
+  scaleMajor->UseTiledExecutionOn();
+  scaleMajor->SetTileSize(tileSize);
+  EXPECT_NO_THROW(scaleMajor->Update());
+
+  FilterType::Pointer tileMajor = this->CreateFilter();
+  tileMajor->SetHessianBackend(HessianBackendEnum::FourierTransform);
+  tileMajor->UseTiledExecutionOn();
+  tileMajor->UseTileMajorOrderOn();
+  tileMajor->SetTileSize(tileSize);
+  EXPECT_NO_THROW(tileMajor->Update());
+  ExpectImagesNear(scaleMajor->GetOutput(), tileMajor->GetOutput());
+
+  /* Without tiles the order has no effect */
+  FilterType::Pointer staged = this->CreateFilter();
+  EXPECT_NO_THROW(staged->Update());
+  FilterType::Pointer untiled = this->CreateFilter();
+  untiled->UseTileMajorOrderOn();
+  EXPECT_NO_THROW(untiled->Update());
+  ExpectImagesNear(staged->GetOutput(), untiled->GetOutput());
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, MemoryBudget)
+{
+  /* Without a budget the settings are followed */
+  FilterType::Pointer staged = this->CreateFilter();
+  EXPECT_EQ(0u, staged->GetMemoryBudget());
+  EXPECT_NO_THROW(staged->Update());
+  EXPECT_FALSE(staged->GetExecutionPlan().UseTiledExecution);
+  EXPECT_FALSE(staged->GetExecutionPlan().ReleaseIntermediateData);
+  EXPECT_GT(staged->GetExecutionPlan().EstimatedPeakMemory, 0u);
+
+  /* A generous budget stages every scale and releases the intermediates */
+  FilterType::Pointer generous = this->CreateFilter();
+  generous->SetMemoryBudget(1ul << 30);
+  EXPECT_EQ(1ul << 30, generous->GetMemoryBudget());
+  EXPECT_NO_THROW(generous->Update());
+  EXPECT_FALSE(generous->GetExecutionPlan().UseTiledExecution);
+  EXPECT_TRUE(generous->GetExecutionPlan().ReleaseIntermediateData);
+  EXPECT_EQ(1u, generous->GetExecutionPlan().NumberOfEstimationDivisions);
+  EXPECT_LE(generous->GetExecutionPlan().EstimatedPeakMemory, generous->GetMemoryBudget());
+  ExpectImagesNear(staged->GetOutput(), generous->GetOutput());
+
+  /* A smaller budget first streams the estimation in more pieces */
+  const itk::SizeValueType stagedPeak = generous->GetExecutionPlan().EstimatedPeakMemory;
+  FilterType::Pointer      streamed = this->CreateFilter();
+  streamed->SetMemoryBudget(stagedPeak - 1);
+  EXPECT_NO_THROW(streamed->Update());
+  EXPECT_FALSE(streamed->GetExecutionPlan().UseTiledExecution);
+  EXPECT_GT(streamed->GetExecutionPlan().NumberOfEstimationDivisions,
+            generous->GetExecutionPlan().NumberOfEstimationDivisions);
+  EXPECT_LE(streamed->GetExecutionPlan().EstimatedPeakMemory, stagedPeak - 1);
+  ExpectImagesNear(staged->GetOutput(), streamed->GetOutput());
+
+  /* Budgets short of the output, the copy of the eigenvalues and the measure fall back to smaller and smaller
+   * tiles */
+  const itk::SizeValueType pixels = m_Image->GetLargestPossibleRegion().GetNumberOfPixels();
+  const itk::SizeValueType stagedFloor = pixels * (2 * sizeof(float) + sizeof(FilterType::EigenValueArrayType));
+  itk::SizeValueType       previousTilePixels = pixels;
+  for (itk::SizeValueType budget : { stagedFloor, stagedFloor / 2 })
+  {
+    FilterType::Pointer tight = this->CreateFilter();
+    tight->SetMemoryBudget(budget);
+    EXPECT_NO_THROW(tight->Update());
+
+    const FilterType::ExecutionPlanType & plan = tight->GetExecutionPlan();
+    EXPECT_TRUE(plan.UseTiledExecution);
+    EXPECT_LE(plan.EstimatedPeakMemory, budget);
+    EXPECT_GE(plan.NumberOfEstimationDivisions, 1u);
+    EXPECT_EQ(plan.NumberOfEstimationDivisions,
+              tight->GetEigenToMeasureParameterEstimationFilter()->GetNumberOfStreamDivisions());
+
+    itk::SizeValueType tilePixels = 1;
+    for (unsigned int d = 0; d < DIMENSION; ++d)
+    {
+      tilePixels *= plan.TileSize[d];
+    }
+    EXPECT_LT(tilePixels, previousTilePixels);
+    previousTilePixels = tilePixels;
+
+    ExpectImagesNear(staged->GetOutput(), tight->GetOutput());
+  }
+
+  /* Nothing fits in a handful of bytes */
+  FilterType::Pointer impossible = this->CreateFilter();
+  impossible->SetMemoryBudget(16);
+  EXPECT_ANY_THROW(impossible->Update());
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, GraftEigenValues)
+{
+  /* Runs of a stage in the last update */
+  auto countStage = [](const FilterType * filter, const std::string & stage) -> unsigned int {
+    unsigned int count = 0;
+    for (const FilterType::StageProfileType & record : filter->GetProfile())
+    {
+      count += (record.Stage == stage) ? 1 : 0;
+    }
+    return count;
+  };
+
+  /* By default the hessian is streamed in the pieces of the estimation */
+  FilterType::Pointer streamed = this->CreateFilter();
+  EXPECT_FALSE(streamed->GetGraftEigenValues());
+  streamed->CollectProfileOn();
+  EXPECT_NO_THROW(streamed->Update());
+  EXPECT_GT(countStage(streamed, "Hessian"), m_SigmaArray.GetSize());
+
+  /* Grafting computes the whole hessian of every scale at once */
+  FilterType::Pointer grafted = this->CreateFilter();
+  grafted->GraftEigenValuesOn();
+  EXPECT_TRUE(grafted->GetGraftEigenValues());
+  grafted->CollectProfileOn();
+  EXPECT_NO_THROW(grafted->Update());
+  EXPECT_EQ(m_SigmaArray.GetSize(), countStage(grafted, "Hessian"));
+  ExpectImagesNear(streamed->GetOutput(), grafted->GetOutput());
+
+  /* Without the copy and the streaming the whole hessian is held, which takes more memory */
+  EXPECT_LT(streamed->GetExecutionPlan().EstimatedPeakMemory, grafted->GetExecutionPlan().EstimatedPeakMemory);
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, Profile)
+{
+  FilterType::Pointer plain = this->CreateFilter();
+  EXPECT_FALSE(plain->GetCollectProfile());
+  EXPECT_NO_THROW(plain->Update());
+  EXPECT_TRUE(plain->GetProfile().empty());
+
+  for (bool useIncrementalScaleSpace : { false, true })
+  {
+    FilterType::Pointer filter = this->CreateFilter();
+    filter->CollectProfileOn();
+    EXPECT_TRUE(filter->GetCollectProfile());
+    filter->SetUseIncrementalScaleSpace(useIncrementalScaleSpace);
+    EXPECT_NO_THROW(filter->Update());
+    if (!useIncrementalScaleSpace)
+    {
+      ExpectImagesNear(plain->GetOutput(), filter->GetOutput());
+    }
+
+    /* Every stage of every scale is recorded */
+    const FilterType::ProfileType & profile = filter->GetProfile();
+    const itk::SizeValueType        pixels = m_Image->GetLargestPossibleRegion().GetNumberOfPixels();
+    std::vector<std::string>        stages;
+    for (const FilterType::StageProfileType & record : profile)
+    {
+      stages.push_back(record.Stage);
+      ASSERT_LT(record.ScaleLevel, m_SigmaArray.GetSize());
+      EXPECT_EQ(m_SigmaArray[record.ScaleLevel], record.Sigma);
+      EXPECT_GE(record.Start, 0.0);
+      EXPECT_GE(record.WallTime, 0.0);
+      EXPECT_GE(record.CPUTime, 0.0);
+      if (record.Stage == "Measure")
+      {
+        EXPECT_EQ(pixels * sizeof(float), record.BytesAllocated);
+      }
+      if (record.Stage == "Fold")
+      {
+        EXPECT_EQ(0u, record.BytesAllocated);
+        EXPECT_EQ(2 * pixels * sizeof(float), record.BytesRead);
+      }
+    }
+    for (const char * stage : { "ParameterEstimation", "Measure", "Fold" })
+    {
+      EXPECT_EQ(m_SigmaArray.GetSize(), static_cast<unsigned int>(std::count(stages.begin(), stages.end(), stage)))
+        << stage;
+    }
+
+    /* The estimation streams the hessian and the eigenanalysis piece by piece */
+    for (const char * stage : { "Hessian", "EigenAnalysis" })
+    {
+      EXPECT_GT(static_cast<unsigned int>(std::count(stages.begin(), stages.end(), stage)), m_SigmaArray.GetSize())
+        << stage;
+    }
+    EXPECT_EQ(useIncrementalScaleSpace ? 1 : 0, std::count(stages.begin(), stages.end(), "ScaleSpace"));
+
+    std::ostringstream json;
+    filter->WriteProfile(json);
+    EXPECT_NE(std::string::npos, json.str().find("\"totals\""));
+    EXPECT_NE(std::string::npos, json.str().find("\"stage\": \"Fold\""));
+
+    std::ostringstream trace;
+    filter->WriteProfileTraceEvents(trace);
+    EXPECT_NE(std::string::npos, trace.str().find("\"traceEvents\""));
+    EXPECT_NE(std::string::npos, trace.str().find("\"name\":\"Measure\""));
+
+    /* The observers are gone once profiling is turned off */
+    filter->CollectProfileOff();
+    EXPECT_NO_THROW(filter->Update());
+    EXPECT_TRUE(filter->GetProfile().empty());
+  }
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, CacheScales)
+{
+  using MaskImageType = itk::Image<unsigned char, DIMENSION>;
+  using SpatialObjectType = itk::ImageMaskSpatialObject<DIMENSION>;
+
+  /* Runs of a stage in the last update */
+  auto countStage = [](const FilterType * filter, const std::string & stage) -> unsigned int {
+    unsigned int count = 0;
+    for (const FilterType::StageProfileType & record : filter->GetProfile())
+    {
+      count += (record.Stage == stage) ? 1 : 0;
+    }
+    return count;
+  };
+
+  FilterType::Pointer filter = this->CreateFilter();
+  EXPECT_FALSE(filter->GetCacheScales());
+  filter->CacheScalesOn();
+  EXPECT_TRUE(filter->GetCacheScales());
+  filter->CollectProfileOn();
+  filter->GenerateScaleOutputOn();
+  EXPECT_NO_THROW(filter->Update());
+  EXPECT_EQ(2u, filter->GetNumberOfCachedScales());
+  EXPECT_EQ(2u, countStage(filter, "Hessian"));
+
+  FilterType::Pointer reference = this->CreateFilter();
+  reference->GenerateScaleOutputOn();
+  EXPECT_NO_THROW(reference->Update());
+  ExpectImagesNear(reference->GetOutput(), filter->GetOutput());
+
+  /* Adding a sigma only computes the hessian of that scale */
+  const FilterType::SigmaArrayType moreSigmas = FilterType::GenerateEquispacedSigmaArray(0.75, 1.5, 3);
+  filter->SetSigmaArray(moreSigmas);
+  EXPECT_NO_THROW(filter->Update());
+  EXPECT_EQ(3u, filter->GetNumberOfCachedScales());
+  EXPECT_EQ(1u, countStage(filter, "Hessian"));
+  EXPECT_EQ(1u, countStage(filter, "ParameterEstimation"));
+  EXPECT_EQ(3u, countStage(filter, "Measure"));
+
+  reference->SetSigmaArray(moreSigmas);
+  EXPECT_NO_THROW(reference->Update());
+  ExpectImagesNear(reference->GetOutput(), filter->GetOutput());
+  itk::ImageRegionConstIterator<FilterType::ScaleImageType> referenceScaleIt(
+    reference->GetScaleOutput(), reference->GetScaleOutput()->GetBufferedRegion());
+  itk::ImageRegionConstIterator<FilterType::ScaleImageType> scaleIt(filter->GetScaleOutput(),
+                                                                    filter->GetScaleOutput()->GetBufferedRegion());
+  for (; !referenceScaleIt.IsAtEnd(); ++referenceScaleIt, ++scaleIt)
+  {
+    ASSERT_EQ(referenceScaleIt.Get(), scaleIt.Get());
+  }
+
+  /* A new mask only estimates the parameters and computes the measure again */
+  MaskImageType::Pointer maskImage = MaskImageType::New();
+  maskImage->CopyInformation(m_Image);
+  maskImage->SetRegions(m_Image->GetLargestPossibleRegion());
+  maskImage->Allocate();
+  maskImage->FillBuffer(0);
+  MaskImageType::RegionType box;
+  box.SetIndex(0, 3);
+  box.SetIndex(1, 2);
+  box.SetIndex(2, 1);
+  box.SetSize(0, 14);
+  box.SetSize(1, 10);
+  box.SetSize(2, 7);
+  itk::ImageRegionIteratorWithIndex<MaskImageType> boxIt(maskImage, box);
+  for (boxIt.GoToBegin(); !boxIt.IsAtEnd(); ++boxIt)
+  {
+    boxIt.Set(1);
+  }
+  SpatialObjectType::Pointer mask = SpatialObjectType::New();
+  mask->SetImage(maskImage);
+  mask->Update();
+
+  filter->SetImageMask(mask);
+  EXPECT_NO_THROW(filter->Update());
+  EXPECT_EQ(0u, countStage(filter, "Hessian"));
+  EXPECT_EQ(3u, countStage(filter, "ParameterEstimation"));
+  EXPECT_EQ(3u, countStage(filter, "Measure"));
+
+  reference->SetImageMask(mask);
+  EXPECT_NO_THROW(reference->Update());
+  ExpectImagesNear(reference->GetOutput(), filter->GetOutput());
+
+  /* A new input computes every hessian again, removed sigma values are forgotten */
+  filter->SetSigmaArray(m_SigmaArray);
+  m_Image->Modified();
+  EXPECT_NO_THROW(filter->Update());
+  EXPECT_EQ(2u, filter->GetNumberOfCachedScales());
+  EXPECT_EQ(2u, countStage(filter, "Hessian"));
+
+  /* Tiles bypass the cache and free it */
+  filter->UseTiledExecutionOn();
+  EXPECT_NO_THROW(filter->Update());
+  EXPECT_EQ(0u, filter->GetNumberOfCachedScales());
+  filter->UseTiledExecutionOff();
+  EXPECT_NO_THROW(filter->Update());
+  EXPECT_EQ(2u, filter->GetNumberOfCachedScales());
+  filter->ReleaseScaleCache();
+  EXPECT_EQ(0u, filter->GetNumberOfCachedScales());
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, CacheScalesWithinMemoryBudget)
+{
+  FilterType::Pointer reference = this->CreateFilter();
+  reference->SetMemoryBudget(1ul << 30);
+  EXPECT_NO_THROW(reference->Update());
+  EXPECT_EQ(0u, reference->GetExecutionPlan().NumberOfCachedScales);
+
+  /* The eigenvalues of every scale are counted */
+  const itk::SizeValueType eigenImage =
+    m_Image->GetLargestPossibleRegion().GetNumberOfPixels() * sizeof(FilterType::EigenValueArrayType);
+  FilterType::Pointer cached = this->CreateFilter();
+  cached->CacheScalesOn();
+  cached->SetMemoryBudget(1ul << 30);
+  EXPECT_NO_THROW(cached->Update());
+  EXPECT_EQ(2u, cached->GetExecutionPlan().NumberOfCachedScales);
+  EXPECT_EQ(2u, cached->GetNumberOfCachedScales());
+  EXPECT_GE(cached->GetExecutionPlan().EstimatedPeakMemory,
+            reference->GetExecutionPlan().EstimatedPeakMemory + eigenImage);
+  const itk::SizeValueType cachedPeak = cached->GetExecutionPlan().EstimatedPeakMemory;
+  ExpectImagesNear(reference->GetOutput(), cached->GetOutput());
+
+  /* A budget short of the whole cache keeps fewer scales, then none before falling back to tiles */
+  cached->SetMemoryBudget(cachedPeak - 1);
+  EXPECT_NO_THROW(cached->Update());
+  EXPECT_FALSE(cached->GetExecutionPlan().UseTiledExecution);
+  EXPECT_EQ(1u, cached->GetExecutionPlan().NumberOfCachedScales);
+  EXPECT_EQ(1u, cached->GetNumberOfCachedScales());
+  EXPECT_LE(cached->GetExecutionPlan().EstimatedPeakMemory, cached->GetMemoryBudget());
+  ExpectImagesNear(reference->GetOutput(), cached->GetOutput());
+
+  cached->SetMemoryBudget(cachedPeak - eigenImage - 1);
+  EXPECT_NO_THROW(cached->Update());
+  EXPECT_FALSE(cached->GetExecutionPlan().UseTiledExecution);
+  EXPECT_EQ(0u, cached->GetExecutionPlan().NumberOfCachedScales);
+  EXPECT_EQ(0u, cached->GetNumberOfCachedScales());
+  ExpectImagesNear(reference->GetOutput(), cached->GetOutput());
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, PreallocatedOutput)
+{
+  FilterType::Pointer reference = this->CreateFilter();
+  EXPECT_NO_THROW(reference->Update());
+
+  /* The output is written into the buffer of the given image */
+  ImageType::Pointer preallocated = ImageType::New();
+  preallocated->SetRegions(m_Image->GetLargestPossibleRegion());
+  preallocated->Allocate();
+  preallocated->FillBuffer(-1.0f);
+
+  FilterType::Pointer filter = this->CreateFilter();
+  EXPECT_EQ(nullptr, filter->GetPreallocatedOutput());
+  filter->SetPreallocatedOutput(preallocated);
+  EXPECT_EQ(preallocated.GetPointer(), filter->GetPreallocatedOutput());
+  EXPECT_NO_THROW(filter->Update());
+  EXPECT_EQ(preallocated->GetBufferPointer(), filter->GetOutput()->GetBufferPointer());
+  ExpectImagesNear(reference->GetOutput(), preallocated);
+
+  /* A buffer of another region cannot be written into */
+  ImageType::RegionType smallerRegion = m_Image->GetLargestPossibleRegion();
+  smallerRegion.SetSize(0, smallerRegion.GetSize(0) - 1);
+  ImageType::Pointer smaller = ImageType::New();
+  smaller->SetRegions(smallerRegion);
+  smaller->Allocate();
+  filter->SetPreallocatedOutput(smaller);
+  EXPECT_ANY_THROW(filter->Update());
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, MaximumOverScalesWithScaleOutput)
+{
+  using ScaleImageType = FilterType::ScaleImageType;
+
+  /* The response at every single scale */
+  std::vector<FilterType::Pointer> singleScaleFilters;
+  for (unsigned int i = 0; i < m_SigmaArray.GetSize(); ++i)
+  {
+    FilterType::SigmaArrayType sigmaArray(1);
+    sigmaArray.SetElement(0, m_SigmaArray.GetElement(i));
+
+    FilterType::Pointer filter = this->CreateFilter();
+    filter->SetSigmaArray(sigmaArray);
+    EXPECT_NO_THROW(filter->Update());
+    singleScaleFilters.push_back(filter);
+  }
+
+  FilterType::Pointer filter = this->CreateFilter();
+  EXPECT_FALSE(filter->GetGenerateScaleOutput());
+  filter->GenerateScaleOutputOn();
+  EXPECT_TRUE(filter->GetGenerateScaleOutput());
+  EXPECT_NO_THROW(filter->Update());
+  ASSERT_EQ(filter->GetOutput()->GetBufferedRegion(), filter->GetScaleOutput()->GetBufferedRegion());
+
+  itk::ImageRegionConstIterator<ImageType>      outputIt(filter->GetOutput(), filter->GetOutput()->GetBufferedRegion());
+  itk::ImageRegionConstIterator<ScaleImageType> scaleIt(filter->GetScaleOutput(),
+                                                        filter->GetScaleOutput()->GetBufferedRegion());
+  for (; !outputIt.IsAtEnd(); ++outputIt, ++scaleIt)
+  {
+    const ImageType::IndexType index = outputIt.GetIndex();
+    const unsigned int         scale = scaleIt.Get();
+    ASSERT_LT(scale, m_SigmaArray.GetSize());
+    const float selected = singleScaleFilters[scale]->GetOutput()->GetPixel(index);
+    ASSERT_FLOAT_EQ(selected, outputIt.Get());
+    for (const auto & single : singleScaleFilters)
+    {
+      ASSERT_GE(std::abs(outputIt.Get()), std::abs(single->GetOutput()->GetPixel(index)));
+    }
+  }
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, TooManyScalesForScaleOutput)
+{
+  FilterType::Pointer filter = this->CreateFilter();
+  filter->SetSigmaArray(FilterType::GenerateEquispacedSigmaArray(0.5, 2.0, 257));
+  filter->GenerateScaleOutputOn();
+  EXPECT_ANY_THROW(filter->Update());
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, MaskedExecution)
+{
+  using MaskImageType = itk::Image<unsigned char, DIMENSION>;
+  using SpatialObjectType = itk::ImageMaskSpatialObject<DIMENSION>;
+
+  /* A box inside of the image */
+  MaskImageType::Pointer maskImage = MaskImageType::New();
+  maskImage->CopyInformation(m_Image);
+  maskImage->SetRegions(m_Image->GetLargestPossibleRegion());
+  maskImage->Allocate();
+  maskImage->FillBuffer(0);
+
+  MaskImageType::RegionType box;
+  box.SetIndex(0, 4);
+  box.SetIndex(1, 3);
+  box.SetIndex(2, 2);
+  box.SetSize(0, 12);
+  box.SetSize(1, 9);
+  box.SetSize(2, 6);
+  itk::ImageRegionIteratorWithIndex<MaskImageType> boxIt(maskImage, box);
+  for (boxIt.GoToBegin(); !boxIt.IsAtEnd(); ++boxIt)
+  {
+    boxIt.Set(1);
+  }
+
+  SpatialObjectType::Pointer mask = SpatialObjectType::New();
+  mask->SetImage(maskImage);
+  mask->Update();
+
+  FilterType::Pointer staged = this->CreateFilter();
+  staged->SetImageMask(mask);
+  EXPECT_NO_THROW(staged->Update());
+
+  /* Nothing is computed outside of the mask */
+  itk::ImageRegionConstIterator<ImageType>     outputIt(staged->GetOutput(), staged->GetOutput()->GetBufferedRegion());
+  itk::ImageRegionConstIterator<MaskImageType> maskIt(maskImage, staged->GetOutput()->GetBufferedRegion());
+  itk::SizeValueType                           nonZeroInside = 0;
+  for (; !outputIt.IsAtEnd(); ++outputIt, ++maskIt)
+  {
+    if (maskIt.Get() == 0)
+    {
+      ASSERT_EQ(0.0f, outputIt.Get());
+    }
+    else if (outputIt.Get() != 0.0f)
+    {
+      ++nonZeroInside;
+    }
+  }
+  EXPECT_GT(nonZeroInside, 0u);
+
+  FilterType::Pointer tiled = this->CreateFilter();
+  tiled->SetImageMask(mask);
+  tiled->UseTiledExecutionOn();
+  FilterType::TileSizeType tileSize;
+  tileSize.Fill(6);
+  tiled->SetTileSize(tileSize);
+  tiled->CollectProfileOn();
+  EXPECT_NO_THROW(tiled->Update());
+
+  ExpectImagesNear(staged->GetOutput(), tiled->GetOutput());
+
+  /* The pre-pass runs once for every scale, not once for every tile */
+  unsigned int estimations = 0;
+  for (const FilterType::StageProfileType & record : tiled->GetProfile())
+  {
+    estimations += (record.Stage == "ParameterEstimation") ? 1 : 0;
+  }
+  EXPECT_EQ(m_SigmaArray.GetSize(), estimations);
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, MaskRunsFollowTheMaskAndGeometry)
+{
+  using MaskImageType = itk::Image<unsigned char, DIMENSION>;
+  using SpatialObjectType = itk::ImageMaskSpatialObject<DIMENSION>;
+
+  /* A box starting at first along the first direction, fixed in physical space */
+  auto createMask = [this](itk::IndexValueType first) -> SpatialObjectType::Pointer {
+    MaskImageType::Pointer maskImage = MaskImageType::New();
+    maskImage->CopyInformation(m_Image);
+    maskImage->SetRegions(m_Image->GetLargestPossibleRegion());
+    maskImage->Allocate();
+    maskImage->FillBuffer(0);
+
+    MaskImageType::RegionType box;
+    box.SetIndex(0, first);
+    box.SetIndex(1, 3);
+    box.SetIndex(2, 2);
+    box.SetSize(0, 8);
+    box.SetSize(1, 9);
+    box.SetSize(2, 6);
+    itk::ImageRegionIteratorWithIndex<MaskImageType> boxIt(maskImage, box);
+    for (boxIt.GoToBegin(); !boxIt.IsAtEnd(); ++boxIt)
+    {
+      boxIt.Set(1);
+    }
+
+    SpatialObjectType::Pointer mask = SpatialObjectType::New();
+    mask->SetImage(maskImage);
+    mask->Update();
+    return mask;
+  };
+
+  /* An older mask set after a newer one is rasterized again */
+  SpatialObjectType::Pointer older = createMask(2);
+  SpatialObjectType::Pointer newer = createMask(12);
+  ASSERT_LT(older->GetMTime(), newer->GetMTime());
+
+  FilterType::Pointer filter = this->CreateFilter();
+  filter->SetImageMask(newer);
+  EXPECT_NO_THROW(filter->Update());
+  filter->SetImageMask(older);
+  EXPECT_NO_THROW(filter->Update());
+
+  FilterType::Pointer reference = this->CreateFilter();
+  reference->SetImageMask(older);
+  EXPECT_NO_THROW(reference->Update());
+  ExpectImagesNear(reference->GetOutput(), filter->GetOutput());
+
+  /* So is the same mask over an input of the same size moved by three pixels */
+  ImageType::PointType origin = m_Image->GetOrigin();
+  origin[0] += 3 * m_Image->GetSpacing()[0];
+  m_Image->SetOrigin(origin);
+  EXPECT_NO_THROW(filter->Update());
+
+  FilterType::Pointer moved = this->CreateFilter();
+  moved->SetImageMask(older);
+  EXPECT_NO_THROW(moved->Update());
+  ExpectImagesNear(moved->GetOutput(), filter->GetOutput());
+
+  itk::ImageRegionConstIterator<ImageType> referenceIt(reference->GetOutput(),
+                                                       reference->GetOutput()->GetBufferedRegion());
+  itk::ImageRegionConstIterator<ImageType> movedIt(moved->GetOutput(), moved->GetOutput()->GetBufferedRegion());
+  double                                   difference = 0.0;
+  for (; !referenceIt.IsAtEnd(); ++referenceIt, ++movedIt)
+  {
+    difference = std::max(difference, static_cast<double>(std::abs(referenceIt.Get() - movedIt.Get())));
+  }
+  EXPECT_GT(difference, 0.0);
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, EmptyMask)
+{
+  using MaskImageType = itk::Image<unsigned char, DIMENSION>;
+  using SpatialObjectType = itk::ImageMaskSpatialObject<DIMENSION>;
+
+  MaskImageType::Pointer maskImage = MaskImageType::New();
+  maskImage->CopyInformation(m_Image);
+  maskImage->SetRegions(m_Image->GetLargestPossibleRegion());
+  maskImage->Allocate();
+  maskImage->FillBuffer(0);
+
+  SpatialObjectType::Pointer mask = SpatialObjectType::New();
+  mask->SetImage(maskImage);
+  mask->Update();
+
+  FilterType::Pointer filter = this->CreateFilter();
+  filter->SetImageMask(mask);
+  filter->GenerateScaleOutputOn();
+  EXPECT_NO_THROW(filter->Update());
+  ASSERT_EQ(m_Image->GetLargestPossibleRegion(), filter->GetOutput()->GetBufferedRegion());
+
+  itk::ImageRegionConstIterator<ImageType> outputIt(filter->GetOutput(), filter->GetOutput()->GetBufferedRegion());
+  itk::ImageRegionConstIterator<FilterType::ScaleImageType> scaleIt(filter->GetScaleOutput(),
+                                                                    filter->GetScaleOutput()->GetBufferedRegion());
+  for (; !outputIt.IsAtEnd(); ++outputIt, ++scaleIt)
+  {
+    ASSERT_EQ(0.0f, outputIt.Get());
+    ASSERT_EQ(0u, scaleIt.Get());
+  }
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, StreamedMatchesWholeImage)
+{
+  using StreamingFilterType = itk::StreamingImageFilter<ImageType, ImageType>;
+
+  FilterType::Pointer whole = this->CreateFilter();
+  EXPECT_NO_THROW(whole->Update());
+
+  for (bool useTiledExecution : { false, true })
+  {
+    FilterType::Pointer filter = this->CreateFilter();
+    filter->SetUseTiledExecution(useTiledExecution);
+
+    StreamingFilterType::Pointer streamer = StreamingFilterType::New();
+    streamer->SetInput(filter->GetOutput());
+    streamer->SetNumberOfStreamDivisions(4);
+    EXPECT_NO_THROW(streamer->Update());
+    ExpectImagesNear(whole->GetOutput(), streamer->GetOutput());
+
+    /* The last piece only needed the input padded by the widest kernel */
+    EXPECT_LT(m_Image->GetRequestedRegion().GetNumberOfPixels(),
+              m_Image->GetLargestPossibleRegion().GetNumberOfPixels());
+
+    /* Changing the sigmas invalidates the cached parameters */
+    filter->SetSigmaArray(FilterType::GenerateEquispacedSigmaArray(1.0, 1.5, 2));
+    EXPECT_NO_THROW(streamer->Update());
+
+    FilterType::Pointer reference = this->CreateFilter();
+    reference->SetSigmaArray(FilterType::GenerateEquispacedSigmaArray(1.0, 1.5, 2));
+    EXPECT_NO_THROW(reference->Update());
+    ExpectImagesNear(reference->GetOutput(), streamer->GetOutput());
+  }
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, OutOfCoreExecution)
+{
+  using CastFilterType = itk::CastImageFilter<ImageType, ImageType>;
+  using MonitorFilterType = itk::PipelineMonitorImageFilter<ImageType>;
+  using StreamingFilterType = itk::StreamingImageFilter<ImageType, ImageType>;
+
+  FilterType::Pointer whole = this->CreateFilter();
+  EXPECT_NO_THROW(whole->Update());
+
+  for (bool useTiledExecution : { false, true })
+  {
+    /* An upstream filter which only produces what is requested of it */
+    CastFilterType::Pointer caster = CastFilterType::New();
+    caster->SetInput(m_Image);
+    caster->InPlaceOff();
+    MonitorFilterType::Pointer monitor = MonitorFilterType::New();
+    monitor->SetInput(caster->GetOutput());
+
+    FilterType::Pointer filter = this->CreateFilter();
+    filter->SetInput(monitor->GetOutput());
+    filter->SetUseTiledExecution(useTiledExecution);
+    EXPECT_FALSE(filter->GetUseOutOfCoreExecution());
+    filter->UseOutOfCoreExecutionOn();
+    EXPECT_TRUE(filter->GetUseOutOfCoreExecution());
+
+    StreamingFilterType::Pointer streamer = StreamingFilterType::New();
+    streamer->SetInput(filter->GetOutput());
+    streamer->SetNumberOfStreamDivisions(4);
+    EXPECT_NO_THROW(streamer->Update());
+    ExpectImagesNear(whole->GetOutput(), streamer->GetOutput());
+
+    /* The input was pulled piece by piece, by the estimation and by every output piece. The padding of the
+     * middle pieces may reach across these few slices, but not that of the first and the last */
+    const MonitorFilterType::RegionVectorType & regions = monitor->GetUpdatedBufferedRegions();
+    ASSERT_GT(regions.size(), 4u);
+    EXPECT_LT(regions.front().GetNumberOfPixels(), m_Image->GetLargestPossibleRegion().GetNumberOfPixels());
+    EXPECT_LT(regions.back().GetNumberOfPixels(), m_Image->GetLargestPossibleRegion().GetNumberOfPixels());
+  }
+
+  /* The scale-space is smoothed from the buffered input */
+  FilterType::Pointer scaleSpace = this->CreateFilter();
+  scaleSpace->UseOutOfCoreExecutionOn();
+  scaleSpace->UseIncrementalScaleSpaceOn();
+  EXPECT_ANY_THROW(scaleSpace->Update());
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, IncrementalScaleSpace)
+{
+  using StreamingFilterType = itk::StreamingImageFilter<ImageType, ImageType>;
+
+  const FilterType::SigmaArrayType sigmaArray = FilterType::GenerateLogarithmicSigmaArray(0.75, 1.5, 3);
+
+  FilterType::Pointer direct = this->CreateFilter();
+  EXPECT_FALSE(direct->GetUseIncrementalScaleSpace());
+  direct->SetSigmaArray(sigmaArray);
+  EXPECT_NO_THROW(direct->Update());
+
+  FilterType::Pointer staged = this->CreateFilter();
+  staged->UseIncrementalScaleSpaceOn();
+  EXPECT_TRUE(staged->GetUseIncrementalScaleSpace());
+  staged->SetSigmaArray(sigmaArray);
+  EXPECT_NO_THROW(staged->Update());
+
+  /* The same response up to kernel truncation and the boundary */
+  double             maximum = 0.0;
+  double             totalError = 0.0;
+  itk::SizeValueType numberOfPixels = 0;
+
+  itk::ImageRegionConstIterator<ImageType> directIt(direct->GetOutput(), direct->GetOutput()->GetBufferedRegion());
+  itk::ImageRegionConstIterator<ImageType> stagedIt(staged->GetOutput(), staged->GetOutput()->GetBufferedRegion());
+  for (; !directIt.IsAtEnd(); ++directIt, ++stagedIt, ++numberOfPixels)
+  {
+    maximum = std::max(maximum, static_cast<double>(std::abs(directIt.Get())));
+    totalError += std::abs(directIt.Get() - stagedIt.Get());
+  }
+  ASSERT_GT(maximum, 0.0);
+  EXPECT_LT(totalError / numberOfPixels, 1e-2 * maximum);
+
+  /* Tiled and streamed execution walk the same scale-space */
+  FilterType::Pointer tiled = this->CreateFilter();
+  tiled->UseIncrementalScaleSpaceOn();
+  tiled->UseTiledExecutionOn();
+  tiled->SetSigmaArray(sigmaArray);
+  FilterType::TileSizeType tileSize;
+  tileSize.Fill(6);
+  tiled->SetTileSize(tileSize);
+  EXPECT_NO_THROW(tiled->Update());
+  ExpectImagesNear(staged->GetOutput(), tiled->GetOutput());
+
+  FilterType::Pointer streamed = this->CreateFilter();
+  streamed->UseIncrementalScaleSpaceOn();
+  streamed->SetSigmaArray(sigmaArray);
+  StreamingFilterType::Pointer streamer = StreamingFilterType::New();
+  streamer->SetInput(streamed->GetOutput());
+  streamer->SetNumberOfStreamDivisions(4);
+  EXPECT_NO_THROW(streamer->Update());
+  ExpectImagesNear(staged->GetOutput(), streamer->GetOutput());
+
+  /* A single scale is not smoothed at all */
+  FilterType::Pointer single = this->CreateFilter();
+  single->UseIncrementalScaleSpaceOn();
+  single->SetSigmaArray(FilterType::GenerateEquispacedSigmaArray(1.0, 1.0, 1));
+  EXPECT_NO_THROW(single->Update());
+  FilterType::Pointer singleDirect = this->CreateFilter();
+  singleDirect->SetSigmaArray(FilterType::GenerateEquispacedSigmaArray(1.0, 1.0, 1));
+  EXPECT_NO_THROW(singleDirect->Update());
+  ExpectImagesNear(singleDirect->GetOutput(), single->GetOutput());
+
+  /* The scale-space has to be built from the smallest sigma up */
+  FilterType::SigmaArrayType descending(2);
+  descending.SetElement(0, 1.5);
+  descending.SetElement(1, 0.75);
+  staged->SetSigmaArray(descending);
+  EXPECT_ANY_THROW(staged->Update());
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, HessianBackend)
+{
+  using HessianBackendEnum = FilterType::HessianBackendEnum;
+
+  FilterType::Pointer discrete = this->CreateFilter();
+  EXPECT_EQ(HessianBackendEnum::DiscreteGaussian, discrete->GetHessianBackend());
+  EXPECT_EQ(4.0, discrete->GetRecursiveSigmaThreshold());
+  EXPECT_NO_THROW(discrete->Update());
+
+  FilterType::Pointer recursive = this->CreateFilter();
+  recursive->SetHessianBackend(HessianBackendEnum::RecursiveGaussian);
+  EXPECT_EQ(HessianBackendEnum::RecursiveGaussian, recursive->GetHessianBackend());
+  EXPECT_NO_THROW(recursive->Update());
+
+  /* The recursive filters approximate the same response */
+  double             maximum = 0.0;
+  double             totalError = 0.0;
+  itk::SizeValueType numberOfPixels = 0;
+
+  itk::ImageRegionConstIterator<ImageType> discreteIt(discrete->GetOutput(),
+                                                      discrete->GetOutput()->GetBufferedRegion());
+  itk::ImageRegionConstIterator<ImageType> recursiveIt(recursive->GetOutput(),
+                                                       recursive->GetOutput()->GetBufferedRegion());
+  for (; !discreteIt.IsAtEnd(); ++discreteIt, ++recursiveIt, ++numberOfPixels)
+  {
+    maximum = std::max(maximum, static_cast<double>(std::abs(discreteIt.Get())));
+    totalError += std::abs(discreteIt.Get() - recursiveIt.Get());
+  }
+  ASSERT_GT(maximum, 0.0);
+  EXPECT_LT(totalError / numberOfPixels, 5e-2 * maximum);
+
+  /* So does the fourier transform */
+  FilterType::Pointer fourier = this->CreateFilter();
+  fourier->SetHessianBackend(HessianBackendEnum::FourierTransform);
+  EXPECT_NO_THROW(fourier->Update());
+
+  totalError = 0.0;
+  itk::ImageRegionConstIterator<ImageType> fourierIt(fourier->GetOutput(), fourier->GetOutput()->GetBufferedRegion());
+  for (discreteIt.GoToBegin(); !discreteIt.IsAtEnd(); ++discreteIt, ++fourierIt)
+  {
+    totalError += std::abs(discreteIt.Get() - fourierIt.Get());
+  }
+  EXPECT_LT(totalError / numberOfPixels, 5e-2 * maximum);
+
+  /* Automatic picks the recursive filters above the threshold only */
+  FilterType::Pointer automatic = this->CreateFilter();
+  automatic->SetHessianBackend(HessianBackendEnum::Automatic);
+  automatic->SetRecursiveSigmaThreshold(0.0);
+  EXPECT_NO_THROW(automatic->Update());
+  ExpectImagesNear(recursive->GetOutput(), automatic->GetOutput());
+
+  automatic->SetRecursiveSigmaThreshold(100.0);
+  EXPECT_NO_THROW(automatic->Update());
+  ExpectImagesNear(discrete->GetOutput(), automatic->GetOutput());
+
+  /* Tiles never use the recursive filters automatically */
+  automatic->SetRecursiveSigmaThreshold(0.0);
+  automatic->UseTiledExecutionOn();
+  EXPECT_NO_THROW(automatic->Update());
+  ExpectImagesNear(discrete->GetOutput(), automatic->GetOutput());
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, HalfPrecisionStorage)
+{
+  using HalfFilterType =
+    itk::MultiScaleHessianEnhancementImageFilter<ImageType, ImageType, itk::HalfFloat, itk::HalfFloat>;
+  using HalfEigenValueImageType = HalfFilterType::EigenValueImageType;
+  using HalfMeasureFilterType = itk::KrcahEigenToMeasureImageFilter<HalfEigenValueImageType, ImageType>;
+  using HalfEstimationFilterType = itk::KrcahEigenToMeasureParameterEstimationFilter<HalfEigenValueImageType>;
+  EXPECT_EQ(6 * sizeof(itk::HalfFloat), sizeof(HalfFilterType::HessianPixelType));
+
+  FilterType::Pointer reference = this->CreateFilter();
+  EXPECT_NO_THROW(reference->Update());
+
+  HalfFilterType::Pointer half = HalfFilterType::New();
+  half->SetInput(m_Image);
+  half->SetSigmaArray(m_SigmaArray);
+  half->SetEigenToMeasureImageFilter(HalfMeasureFilterType::New());
+  half->SetEigenToMeasureParameterEstimationFilter(HalfEstimationFilterType::New());
+  EXPECT_NO_THROW(half->Update());
+
+  /* The binary16 intermediates change the response by about their rounding error */
+  double             maximum = 0.0;
+  double             maximumError = 0.0;
+  double             totalError = 0.0;
+  itk::SizeValueType numberOfPixels = 0;
+
+  itk::ImageRegionConstIterator<ImageType> referenceIt(reference->GetOutput(),
+                                                       reference->GetOutput()->GetBufferedRegion());
+  itk::ImageRegionConstIterator<ImageType> halfIt(half->GetOutput(), half->GetOutput()->GetBufferedRegion());
+  for (; !referenceIt.IsAtEnd(); ++referenceIt, ++halfIt, ++numberOfPixels)
+  {
+    const double error = std::abs(referenceIt.Get() - halfIt.Get());
+    maximum = std::max(maximum, static_cast<double>(std::abs(referenceIt.Get())));
+    maximumError = std::max(maximumError, error);
+    totalError += error;
+  }
+  ASSERT_GT(maximum, 0.0);
+  std::ostringstream meanError;
+  meanError << totalError / numberOfPixels / maximum;
+  RecordProperty("HalfFloatMeanRelativeError", meanError.str());
+  std::ostringstream peakError;
+  peakError << maximumError / maximum;
+  RecordProperty("HalfFloatMaximumRelativeError", peakError.str());
+  EXPECT_LT(totalError / numberOfPixels, 2e-3 * maximum);
+  EXPECT_LT(maximumError, 1e-2 * maximum);
+
+  /* Tiles see the same rounding */
+  HalfFilterType::Pointer tiled = HalfFilterType::New();
+  tiled->SetInput(m_Image);
+  tiled->SetSigmaArray(m_SigmaArray);
+  tiled->SetEigenToMeasureImageFilter(HalfMeasureFilterType::New());
+  tiled->SetEigenToMeasureParameterEstimationFilter(HalfEstimationFilterType::New());
+  tiled->UseTiledExecutionOn();
+  EXPECT_NO_THROW(tiled->Update());
+  ExpectImagesNear(half->GetOutput(), tiled->GetOutput());
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, FoldedPreprocessing)
+{
+  FilterType::Pointer filter = FilterType::New();
+  EXPECT_FALSE(filter->GetUsePreprocessing());
+  EXPECT_EQ(1.0, filter->GetPreprocessingSigma());
+  EXPECT_EQ(10.0, filter->GetPreprocessingScalingConstant());
+  filter->UsePreprocessingOn();
+  EXPECT_TRUE(filter->GetUsePreprocessing());
+
+  FilterType::Pointer plain = this->CreateFilter();
+  EXPECT_NO_THROW(plain->Update());
+
+  FilterType::Pointer staged = this->CreateFilter();
+  staged->UsePreprocessingOn();
+  staged->SetPreprocessingSigma(0.75);
+  staged->SetPreprocessingScalingConstant(5.0);
+  EXPECT_NO_THROW(staged->Update());
+
+  /* The tiles are padded for the wider kernels of the unsharp mask */
+  FilterType::Pointer tiled = this->CreateFilter();
+  tiled->UsePreprocessingOn();
+  tiled->SetPreprocessingSigma(0.75);
+  tiled->SetPreprocessingScalingConstant(5.0);
+  tiled->UseTiledExecutionOn();
+  FilterType::TileSizeType tileSize;
+  tileSize[0] = 8;
+  tileSize[1] = 5;
+  tileSize[2] = 4;
+  tiled->SetTileSize(tileSize);
+  EXPECT_NO_THROW(tiled->Update());
+  ExpectImagesNear(staged->GetOutput(), tiled->GetOutput());
+
+  /* The unsharp mask changes the response */
+  double                                   difference = 0.0;
+  itk::ImageRegionConstIterator<ImageType> plainIt(plain->GetOutput(), plain->GetOutput()->GetBufferedRegion());
+  itk::ImageRegionConstIterator<ImageType> stagedIt(staged->GetOutput(), staged->GetOutput()->GetBufferedRegion());
+  for (; !plainIt.IsAtEnd(); ++plainIt, ++stagedIt)
+  {
+    difference = std::max(difference, static_cast<double>(std::abs(plainIt.Get() - stagedIt.Get())));
+  }
+  EXPECT_GT(difference, 1e-3);
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, WorkingGrid)
+{
+  const ImageType::SizeType     size = m_Image->GetLargestPossibleRegion().GetSize();
+  FilterType::ShrinkFactorsType ones;
+  ones.Fill(1);
+
+  FilterType::Pointer reference = this->CreateFilter();
+  EXPECT_EQ(0u, reference->GetMaximumKernelRadius());
+  EXPECT_EQ(ones, reference->ComputeWorkingGridShrinkFactors(4.0, m_Image->GetSpacing(), size));
+  EXPECT_NO_THROW(reference->Update());
+
+  /* The finest direction is binned the most and the kernels fit on the working grid */
+  FilterType::Pointer filter = this->CreateFilter();
+  filter->SetMaximumKernelRadius(3);
+  EXPECT_EQ(3u, filter->GetMaximumKernelRadius());
+  const FilterType::ShrinkFactorsType factors =
+    filter->ComputeWorkingGridShrinkFactors(1.5, m_Image->GetSpacing(), size);
+  EXPECT_GT(factors[0], 1u);
+  EXPECT_GE(factors[0], factors[1]);
+  EXPECT_GE(factors[1], factors[2]);
+
+  ImageType::SpacingType workingSpacing = m_Image->GetSpacing();
+  for (unsigned int d = 0; d < DIMENSION; ++d)
+  {
+    workingSpacing[d] *= factors[d];
+  }
+  const ImageType::SizeType radius =
+    FilterType::HessianFilterType::New()->ComputeKernelRadius(1.5, workingSpacing);
+  for (unsigned int d = 0; d < DIMENSION; ++d)
+  {
+    EXPECT_LE(radius[d], 3u) << "direction " << d;
+  }
+
+  /* The interpolated measure approximates the one on the input grid */
+  filter->CollectProfileOn();
+  EXPECT_NO_THROW(filter->Update());
+  itk::SizeValueType resampleStages = 0;
+  for (const FilterType::StageProfileType & record : filter->GetProfile())
+  {
+    resampleStages += (record.Stage == "Resample") ? 1 : 0;
+  }
+  EXPECT_GT(resampleStages, 0u);
+
+  double                                   maximum = 0.0;
+  double                                   totalError = 0.0;
+  itk::ImageRegionConstIterator<ImageType> referenceIt(reference->GetOutput(),
+                                                       reference->GetOutput()->GetBufferedRegion());
+  itk::ImageRegionConstIterator<ImageType> filterIt(filter->GetOutput(), filter->GetOutput()->GetBufferedRegion());
+  for (; !referenceIt.IsAtEnd(); ++referenceIt, ++filterIt)
+  {
+    maximum = std::max(maximum, static_cast<double>(std::abs(referenceIt.Get())));
+    totalError += std::abs(referenceIt.Get() - filterIt.Get());
+  }
+  ASSERT_GT(maximum, 0.0);
+  EXPECT_LT(totalError / reference->GetOutput()->GetBufferedRegion().GetNumberOfPixels(), 0.1 * maximum);
+
+  /* Tiles interpolate the same working grids */
+  FilterType::Pointer tiled = this->CreateFilter();
+  tiled->SetMaximumKernelRadius(3);
+  tiled->UseTiledExecutionOn();
+  FilterType::TileSizeType tileSize;
+  tileSize.Fill(6);
+  tiled->SetTileSize(tileSize);
+  EXPECT_NO_THROW(tiled->Update());
+  ExpectImagesNear(filter->GetOutput(), tiled->GetOutput());
+
+  /* A maximum every kernel fits within changes nothing */
+  FilterType::Pointer wide = this->CreateFilter();
+  wide->SetMaximumKernelRadius(1000);
+  EXPECT_NO_THROW(wide->Update());
+  ExpectImagesNear(reference->GetOutput(), wide->GetOutput());
+
+  /* The scale-space smooths the input grid */
+  filter->UseIncrementalScaleSpaceOn();
+  EXPECT_ANY_THROW(filter->Update());
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, WorkingGridWithinMemoryBudget)
+{
+  const ImageType::SizeType size = m_Image->GetLargestPossibleRegion().GetSize();
+  const itk::SizeValueType  outputs = m_Image->GetLargestPossibleRegion().GetNumberOfPixels() * sizeof(float);
+
+  FilterType::Pointer filter = this->CreateFilter();
+  filter->SetMaximumKernelRadius(3);
+  filter->SetMemoryBudget(1ul << 30);
+
+  /* The measure of every scale on a working grid is kept until its fold, the binned input while it is computed */
+  itk::SizeValueType workingResponses = 0;
+  itk::SizeValueType largestWorkingGrid = 0;
+  for (unsigned int scaleLevel = 0; scaleLevel < m_SigmaArray.GetSize(); ++scaleLevel)
+  {
+    const FilterType::ShrinkFactorsType factors =
+      filter->ComputeWorkingGridShrinkFactors(m_SigmaArray[scaleLevel], m_Image->GetSpacing(), size);
+    itk::SizeValueType workingPixels = 1;
+    bool               coarsened = false;
+    for (unsigned int d = 0; d < DIMENSION; ++d)
+    {
+      workingPixels *= size[d] / factors[d];
+      coarsened = coarsened || (factors[d] > 1);
+    }
+    if (coarsened)
+    {
+      workingResponses += workingPixels * sizeof(float);
+      largestWorkingGrid = std::max(largestWorkingGrid, workingPixels);
+    }
+  }
+  ASSERT_GT(workingResponses, 0u);
+
+  EXPECT_NO_THROW(filter->Update());
+  const FilterType::ExecutionPlanType & plan = filter->GetExecutionPlan();
+  EXPECT_FALSE(plan.UseTiledExecution);
+  EXPECT_GE(plan.EstimatedPeakMemory, outputs + workingResponses + outputs);
+  EXPECT_GE(plan.EstimatedPeakMemory,
+            workingResponses + largestWorkingGrid * sizeof(FilterType::ScaleSpaceImageType::PixelType));
+
+  /* The working grids are kept whatever the tiles, so a budget short of them and the output fits no plan */
+  filter->SetMemoryBudget(outputs + workingResponses - 1);
+  EXPECT_ANY_THROW(filter->Update());
+}
+
+TEST_F(itkMultiScaleHessianEnhancementImageFilterUnitTest, StageOverrideThroughObjectFactory)
+{
+  FilterType::Pointer reference = this->CreateFilter();
+  EXPECT_NO_THROW(reference->Update());
+
+  /* The stages are created with the filter, so the factory only has to be registered while it is constructed */
+  EigenAnalysisOverrideFactory::Pointer factory = EigenAnalysisOverrideFactory::New();
+  itk::ObjectFactoryBase::RegisterFactory(factory);
+  FilterType::Pointer overridden = this->CreateFilter();
+  itk::ObjectFactoryBase::UnRegisterFactory(factory);
+
+  OverriddenEigenAnalysisFilter::NumberOfRuns = 0;
+  EXPECT_NO_THROW(overridden->Update());
+  EXPECT_GE(OverriddenEigenAnalysisFilter::NumberOfRuns, m_SigmaArray.GetSize());
+  this->ExpectImagesNear(reference->GetOutput(), overridden->GetOutput());
+
+  /* A filter created without the factory keeps the host eigenanalysis */
+  OverriddenEigenAnalysisFilter::NumberOfRuns = 0;
+  FilterType::Pointer host = this->CreateFilter();
+  EXPECT_NO_THROW(host->Update());
+  EXPECT_EQ(0u, OverriddenEigenAnalysisFilter::NumberOfRuns);
+}
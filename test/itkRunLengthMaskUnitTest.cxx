@@ -0,0 +1,176 @@
+/*=========================================================================
+ *
+ *  Copyright NumFOCUS
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *         http://www.apache.org/licenses/LICENSE-2.0.txt
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS,
+ *  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *  See the License for the specific language governing permissions and
+ *  limitations under the License.
+ *
+ *=========================================================================*/
+
+#include "itkGTest.h"
+#include "itkRunLengthMask.h"
+#include "itkImage.h"
+#include "itkImageMaskSpatialObject.h"
+#include "itkImageRegionIteratorWithIndex.h"
+#include "itkMultiThreaderBase.h"
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+class itkRunLengthMaskUnitTest : public ::testing::Test
+{
+public:
+  /* Useful typedefs */
+  static const unsigned int DIMENSION = 3;
+  using MaskImageType = itk::Image<unsigned char, DIMENSION>;
+  using SpatialObjectType = itk::ImageMaskSpatialObject<DIMENSION>;
+  using RunLengthMaskType = itk::RunLengthMask<DIMENSION>;
+
+  itkRunLengthMaskUnitTest()
+  {
+    MaskImageType::SizeType size;
+    size[0] = 13;
+    size[1] = 9;
+    size[2] = 7;
+
+    m_Image = MaskImageType::New();
+    m_Image->SetRegions(size);
+    m_Image->Allocate();
+
+    /* A ball with a hole in it, so some scanlines have two runs */
+    itk::ImageRegionIteratorWithIndex<MaskImageType> it(m_Image, m_Image->GetLargestPossibleRegion());
+    for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+    {
+      const MaskImageType::IndexType index = it.GetIndex();
+      const double                   x = index[0] - 6.0;
+      const double                   y = index[1] - 4.0;
+      const double                   z = index[2] - 3.0;
+      const double                   radius2 = x * x + y * y + z * z;
+      it.Set((radius2 <= 12.0 && radius2 > 2.0) ? 1 : 0);
+    }
+
+    m_SpatialObject = SpatialObjectType::New();
+    m_SpatialObject->SetImage(m_Image);
+    m_SpatialObject->Update();
+  }
+  ~itkRunLengthMaskUnitTest() override = default;
+
+protected:
+  void
+  SetUp() override
+  {}
+  void
+  TearDown() override
+  {}
+
+  MaskImageType::Pointer     m_Image;
+  SpatialObjectType::Pointer m_SpatialObject;
+};
+} // namespace
+
+TEST_F(itkRunLengthMaskUnitTest, EmptyMask)
+{
+  RunLengthMaskType::Pointer mask = RunLengthMaskType::New();
+  EXPECT_EQ(0u, mask->GetNumberOfRuns());
+  EXPECT_EQ(0u, mask->GetNumberOfInsidePixels());
+
+  RunLengthMaskType::IndexType index;
+  index.Fill(0);
+  EXPECT_FALSE(mask->IsInside(index));
+  EXPECT_ANY_THROW(mask->Rasterize(nullptr, m_Image, m_Image->GetLargestPossibleRegion()));
+}
+
+TEST_F(itkRunLengthMaskUnitTest, MatchesSpatialObject)
+{
+  RunLengthMaskType::Pointer mask = RunLengthMaskType::New();
+  mask->Rasterize(m_SpatialObject, m_Image, m_Image->GetLargestPossibleRegion(), itk::MultiThreaderBase::New());
+  EXPECT_EQ(m_Image->GetLargestPossibleRegion(), mask->GetRegion());
+
+  itk::SizeValueType                               numberOfInsidePixels = 0;
+  MaskImageType::IndexType                         lower;
+  MaskImageType::IndexType                         upper;
+  itk::ImageRegionIteratorWithIndex<MaskImageType> it(m_Image, m_Image->GetLargestPossibleRegion());
+  lower.Fill(100);
+  upper.Fill(-100);
+  for (it.GoToBegin(); !it.IsAtEnd(); ++it)
+  {
+    const bool inside = (it.Get() != 0);
+    ASSERT_EQ(inside, mask->IsInside(it.GetIndex())) << it.GetIndex();
+    if (inside)
+    {
+      ++numberOfInsidePixels;
+      for (unsigned int d = 0; d < DIMENSION; ++d)
+      {
+        lower[d] = std::min(lower[d], it.GetIndex()[d]);
+        upper[d] = std::max(upper[d], it.GetIndex()[d]);
+      }
+    }
+  }
+  EXPECT_EQ(numberOfInsidePixels, mask->GetNumberOfInsidePixels());
+  EXPECT_GT(mask->GetNumberOfRuns(), m_Image->GetLargestPossibleRegion().GetSize(1));
+
+  RunLengthMaskType::RegionType boundingRegion;
+  boundingRegion.SetIndex(lower);
+  for (unsigned int d = 0; d < DIMENSION; ++d)
+  {
+    boundingRegion.SetSize(d, upper[d] - lower[d] + 1);
+  }
+  EXPECT_EQ(boundingRegion, mask->GetBoundingRegion());
+}
+
+TEST_F(itkRunLengthMaskUnitTest, VisitRunsIsClipped)
+{
+  RunLengthMaskType::Pointer mask = RunLengthMaskType::New();
+  mask->Rasterize(m_SpatialObject, m_Image, m_Image->GetLargestPossibleRegion());
+
+  /* Every partial scanline through the center */
+  MaskImageType::IndexType lineStart;
+  lineStart[1] = 4;
+  lineStart[2] = 3;
+  for (itk::IndexValueType first = -2; first < 15; ++first)
+  {
+    for (itk::SizeValueType length = 0; length < 8; ++length)
+    {
+      lineStart[0] = first;
+      std::vector<bool>   visited(length, false);
+      itk::IndexValueType previousEnd = first - 1;
+      const auto          last = first + static_cast<itk::IndexValueType>(length);
+      mask->VisitRuns(lineStart, length, [&](itk::IndexValueType start, itk::SizeValueType runLength) {
+        ASSERT_GT(runLength, 0u);
+        ASSERT_GT(start, previousEnd);
+        ASSERT_GE(start, first);
+        ASSERT_LE(start + static_cast<itk::IndexValueType>(runLength), last);
+        for (itk::SizeValueType x = 0; x < runLength; ++x)
+        {
+          visited[start - first + x] = true;
+        }
+        previousEnd = start + static_cast<itk::IndexValueType>(runLength);
+      });
+
+      for (itk::SizeValueType x = 0; x < length; ++x)
+      {
+        MaskImageType::IndexType index = lineStart;
+        index[0] += static_cast<itk::IndexValueType>(x);
+        const bool inside = m_Image->GetLargestPossibleRegion().IsInside(index) && m_Image->GetPixel(index) != 0;
+        ASSERT_EQ(inside, static_cast<bool>(visited[x])) << index;
+      }
+    }
+  }
+
+  /* Scanlines outside of the region have no runs */
+  lineStart[0] = 0;
+  lineStart[1] = 9;
+  bool visitedOutside = false;
+  mask->VisitRuns(lineStart, 13, [&](itk::IndexValueType, itk::SizeValueType) { visitedOutside = true; });
+  EXPECT_FALSE(visitedOutside);
+}